@@ -0,0 +1,135 @@
+// Costed join candidates per second: string-dispatched costing with a statistics
+// lookup per candidate (the old CostEstimator) against enum dispatch on handles
+// resolved once per query.
+#include "cost_estimator.h"
+#include <chrono>
+#include <iostream>
+#include <string>
+#include <vector>
+
+using namespace sqlopt;
+
+namespace {
+
+constexpr double SEQ_PAGE_COST = 1.0;
+constexpr double RAND_PAGE_COST = 4.0;
+constexpr double CPU_TUPLE_COST = 0.01;
+constexpr double INDEX_LOOKUP_COST = 2.0;
+
+// Join costing as it was before enum dispatch
+CostComponents legacyJoinCost(size_t left_rows, size_t right_rows, const std::string& join_type) {
+    CostComponents cost;
+    if (join_type == "nested_loop") {
+        cost.cpu_cost = left_rows * right_rows * CPU_TUPLE_COST;
+        cost.io_cost = (left_rows + right_rows) * SEQ_PAGE_COST;
+    } else if (join_type == "hash_join") {
+        cost.cpu_cost = (left_rows + right_rows) * CPU_TUPLE_COST * 2;
+        cost.memory_cost = std::max(left_rows, right_rows) * 0.1;
+        cost.io_cost = (left_rows + right_rows) * SEQ_PAGE_COST;
+    } else if (join_type == "merge_join") {
+        cost.cpu_cost = (left_rows + right_rows) * CPU_TUPLE_COST;
+        cost.io_cost = (left_rows + right_rows) * SEQ_PAGE_COST;
+    }
+    return cost;
+}
+
+CostComponents legacyIndexNestedLoopCost(const StatisticsManager& stats, size_t outer_rows,
+                                         const std::string& inner_table, double matches_per_probe) {
+    CostComponents cost;
+    const TableStatistics* ts = stats.getTableStatsCI(inner_table);
+    if (!ts) return cost;
+    double fetched = outer_rows * matches_per_probe;
+    cost.io_cost = outer_rows * INDEX_LOOKUP_COST + fetched * RAND_PAGE_COST;
+    cost.cpu_cost = (outer_rows + fetched) * CPU_TUPLE_COST;
+    return cost;
+}
+
+CostComponents legacyTableScan(const StatisticsManager& stats, const std::string& table_name) {
+    CostComponents cost;
+    const TableStatistics* ts = stats.getTableStatsCI(table_name);
+    if (!ts) return cost;
+    cost.io_cost = std::max<size_t>(ts->page_count, 1) * SEQ_PAGE_COST;
+    cost.cpu_cost = ts->row_count * CPU_TUPLE_COST;
+    return cost;
+}
+
+void addTable(StatisticsManager& stats, const std::string& name, size_t rows) {
+    TableStatistics ts;
+    ts.table_name = name;
+    ts.row_count = rows;
+    ts.page_count = rows / 100;
+    stats.updateTableStats(name, ts);
+}
+
+template <typename F>
+double candidatesPerSecond(size_t candidates_per_round, size_t rounds, double& checksum, F&& cost_round) {
+    auto start = std::chrono::steady_clock::now();
+    for (size_t r = 0; r < rounds; ++r) checksum += cost_round(r);
+    std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+    return candidates_per_round * rounds / elapsed.count();
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    size_t rounds = argc > 1 ? std::stoul(argv[1]) : 200000;
+
+    auto stats = std::make_shared<StatisticsManager>();
+    const std::vector<std::string> tables = {"users", "orders", "products", "customers", "order_items",
+                                             "Users", "ORDERS", "Order_Items"};
+    addTable(*stats, "users", 100000);
+    addTable(*stats, "orders", 500000);
+    addTable(*stats, "products", 20000);
+    addTable(*stats, "customers", 100000);
+    addTable(*stats, "order_items", 1000000);
+    CostEstimator estimator(stats);
+
+    // Every ordered pair of inputs priced with all four join algorithms
+    const size_t candidates = tables.size() * tables.size() * 4;
+    double legacy_sum = 0, typed_sum = 0;
+
+    double legacy = candidatesPerSecond(candidates, rounds, legacy_sum, [&](size_t r) {
+        double best = 0;
+        for (const auto& outer : tables) {
+            for (const auto& inner : tables) {
+                size_t left = stats->getTableStatsCI(outer)->row_count + r % 7;
+                size_t right = stats->getTableStatsCI(inner)->row_count;
+                double input = legacyTableScan(*stats, outer).total() + legacyTableScan(*stats, inner).total();
+                best += input + legacyJoinCost(left, right, "nested_loop").total();
+                best += input + legacyJoinCost(left, right, "hash_join").total();
+                best += input + legacyJoinCost(left, right, "merge_join").total();
+                best += legacyIndexNestedLoopCost(*stats, left, inner, 1.0).total();
+            }
+        }
+        return best;
+    });
+
+    double typed = candidatesPerSecond(candidates, rounds, typed_sum, [&](size_t r) {
+        // Resolved once per query in PlanGenerator
+        std::vector<TableStatsHandle> handles;
+        for (const auto& t : tables) handles.push_back(estimator.resolveTable(t));
+
+        double best = 0;
+        for (const auto& outer : handles) {
+            for (const auto& inner : handles) {
+                size_t left = static_cast<size_t>(outer.row_count) + r % 7;
+                size_t right = static_cast<size_t>(inner.row_count);
+                double input = estimator.estimateTableScan(outer).total() + estimator.estimateTableScan(inner).total();
+                best += input + estimator.estimateJoinCost(left, right, JoinAlgorithm::NESTED_LOOP).total();
+                best += input + estimator.estimateJoinCost(left, right, JoinAlgorithm::HASH).total();
+                best += input + estimator.estimateJoinCost(left, right, JoinAlgorithm::MERGE).total();
+                best += estimator.estimateIndexNestedLoopCost(left, inner, 1.0).total();
+            }
+        }
+        return best;
+    });
+
+    std::cout << "candidates per round: " << candidates << ", rounds: " << rounds << "\n";
+    std::cout << "string dispatch + per-call lookup: " << static_cast<size_t>(legacy) << " candidates/sec\n";
+    std::cout << "enum dispatch + resolved handles:  " << static_cast<size_t>(typed) << " candidates/sec\n";
+    std::cout << "speedup: " << typed / legacy << "x";
+    // Print the checksum mismatch so a diverging cost model is noticed
+    if (legacy_sum != typed_sum) std::cout << " (cost totals differ: " << legacy_sum << " vs " << typed_sum << ")";
+    std::cout << "\n";
+    return 0;
+}
@@ -0,0 +1,133 @@
+// Heap allocations and time per Optimizer::optimize call for a chain join over
+// N tables (10 by default), counted by replacing the global operator new. The
+// query is parsed once; only optimize() is measured.
+//
+//   optimize_alloc_bench [tables] [runs] [--budget N]
+//
+// With --budget the exit status is 1 when one optimize() allocates more than N
+// times, so a change that adds copies to the pipeline shows up; ctest runs it
+// as optimize_alloc_budget (bench/CMakeLists.txt).
+#include "optimizer.h"
+#include "parser.h"
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <new>
+#include <string>
+#include <variant>
+
+namespace {
+
+std::atomic<size_t> g_allocations{0};
+std::atomic<size_t> g_bytes{0};
+
+void* countedAlloc(std::size_t size) {
+    g_allocations.fetch_add(1, std::memory_order_relaxed);
+    g_bytes.fetch_add(size, std::memory_order_relaxed);
+    if (void* p = std::malloc(size ? size : 1)) return p;
+    throw std::bad_alloc();
+}
+
+} // namespace
+
+void* operator new(std::size_t size) { return countedAlloc(size); }
+void* operator new[](std::size_t size) { return countedAlloc(size); }
+void operator delete(void* p) noexcept { std::free(p); }
+void operator delete[](void* p) noexcept { std::free(p); }
+void operator delete(void* p, std::size_t) noexcept { std::free(p); }
+void operator delete[](void* p, std::size_t) noexcept { std::free(p); }
+
+using namespace sqlopt;
+
+namespace {
+
+std::string tableName(size_t i) { return "t" + std::to_string(i); }
+
+// t<i>(id, t<i-1>_id, val, name): each table references the one before it
+std::shared_ptr<StatisticsManager> chainStatistics(size_t tables) {
+    auto stats = std::make_shared<StatisticsManager>();
+    for (size_t i = 0; i < tables; ++i) {
+        TableStatistics ts;
+        ts.table_name = tableName(i);
+        ts.row_count = 10000 * (i % 3 + 1);
+        ts.page_count = ts.row_count / 100;
+        auto column = [&](const std::string& name, size_t distinct, std::string min, std::string max) {
+            ColumnStats cs;
+            cs.column_name = name;
+            cs.distinct_values = distinct;
+            cs.min_value = StatValue::fromText(min);
+            cs.max_value = StatValue::fromText(max);
+            cs.nullable = false;
+            ts.setColumn(std::move(cs));
+        };
+        column("id", ts.row_count, "1", std::to_string(ts.row_count));
+        if (i > 0) column(tableName(i - 1) + "_id", 5000, "1", "10000");
+        column("val", 100, "0", "99");
+        column("name", ts.row_count / 2, "a", "z");
+        IndexInfo primary;
+        primary.index_name = "PRIMARY";
+        primary.columns = {"id"};
+        primary.is_unique = true;
+        ts.available_indexes.push_back(primary);
+        stats->updateTableStats(ts.table_name, ts);
+    }
+    return stats;
+}
+
+std::string chainQuery(size_t tables) {
+    std::string sql = "SELECT t0.name, " + tableName(tables - 1) + ".val FROM t0";
+    for (size_t i = 1; i < tables; ++i) {
+        sql += " JOIN " + tableName(i) + " ON " + tableName(i - 1) + ".id = " + tableName(i) + "." +
+               tableName(i - 1) + "_id";
+    }
+    sql += " WHERE t0.val > 10 AND t1.name = 'x' AND (t2.val < 5 OR t2.val > 90) ORDER BY t0.name LIMIT 10";
+    return sql;
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    size_t tables = 10, runs = 200, budget = 0;
+    for (int i = 1, positional = 0; i < argc; ++i) {
+        std::string a = argv[i];
+        if (a == "--budget" && i + 1 < argc) budget = std::stoul(argv[++i]);
+        else if (positional++ == 0) tables = std::max<size_t>(2, std::stoul(a));
+        else runs = std::max<size_t>(1, std::stoul(a));
+    }
+
+    auto stats = chainStatistics(tables);
+    Lexer lexer(chainQuery(tables));
+    Parser parser(lexer.tokenize());
+    std::variant<SelectQuery, InsertQuery, UpdateQuery, DeleteQuery> q;
+    ParseError err;
+    if (!parser.parse_query(q, err) || !std::holds_alternative<SelectQuery>(q)) {
+        std::cerr << "parse error: " << err.message << "\n";
+        return 1;
+    }
+    const SelectQuery& query = std::get<SelectQuery>(q);
+
+    Optimizer optimizer(stats);
+    double cost = optimizer.optimize(query).plan.getCost(); // warm function-local statics
+
+    size_t allocations = 0, bytes = 0;
+    auto start = std::chrono::steady_clock::now();
+    for (size_t r = 0; r < runs; ++r) {
+        size_t a0 = g_allocations.load(), b0 = g_bytes.load();
+        OptimizeResult result = optimizer.optimize(query);
+        allocations += g_allocations.load() - a0;
+        bytes += g_bytes.load() - b0;
+        cost += result.plan.getCost();
+    }
+    double secs = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    size_t per_call = allocations / runs;
+    std::cout << tables << "-way join, " << runs << " runs: " << per_call << " allocations and "
+              << bytes / runs / 1024 << " KiB per optimize(), " << secs / runs * 1e6 << " us each"
+              << " (cost checksum " << cost << ")\n";
+    if (budget > 0 && per_call > budget) {
+        std::cerr << "over budget: " << per_call << " > " << budget << " allocations\n";
+        return 1;
+    }
+    return 0;
+}
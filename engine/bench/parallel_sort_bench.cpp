@@ -0,0 +1,38 @@
+// ORDER BY throughput of parallel_sort_rows for 1..N threads on synthetic rows
+// (an integer key and a text key), to check that large sorts scale with cores.
+//
+//   parallel_sort_bench [rows] [max_threads]
+#include "parallel_sort.h"
+#include <chrono>
+#include <iostream>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace sqlopt;
+
+int main(int argc, char** argv) {
+    size_t rows = argc > 1 ? std::stoul(argv[1]) : 5000000;
+    size_t max_threads = argc > 2 ? std::stoul(argv[2]) : std::max(1u, std::thread::hardware_concurrency());
+
+    std::mt19937_64 rng(42);
+    std::vector<std::vector<std::string>> input;
+    input.reserve(rows);
+    for (size_t i = 0; i < rows; ++i) {
+        input.push_back({std::to_string(rng() % 1000000), "name" + std::to_string(rng() % 100000)});
+    }
+    const std::vector<SortColumn> columns = {{0, false, SortKind::SIGNED}, {1, true, SortKind::ASCII_CI}};
+
+    double single = 0.0;
+    for (size_t threads = 1; threads <= max_threads; threads *= 2) {
+        auto data = input;
+        auto start = std::chrono::steady_clock::now();
+        parallel_sort_rows(data, {}, columns, threads);
+        double secs = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        if (threads == 1) single = secs;
+        std::cout << threads << " thread(s): " << secs * 1000.0 << " ms, "
+                  << static_cast<size_t>(rows / secs) << " rows/sec, speedup " << single / secs << "x\n";
+    }
+    return 0;
+}
@@ -0,0 +1,423 @@
+// Plan quality on a fixed suite of multi-join queries over the generated catalog
+// schema (see data_generator.h). The data is generated into the column store, with
+// statistics computed from it and in-memory indexes on the catalog's index columns.
+// Each query is optimized and run natively. The harness records the estimated cost
+// and rows, the actual rows of every operator, and the optimize and execution
+// times. The summary reports q-error distributions: max(est/actual, actual/est)
+// with both sides at least 1.
+//
+// With MYSQL_DB set (the same data loaded with sqlopt_datagen's load.sql), each
+// query also runs on MySQL twice: as written, under MySQL's own plan, and as
+// rewritten by the optimizer.
+//
+// --csv appends one line per query, tagged with --label (say, the commit). A later
+// run with --baseline on that file compares against the last label in it, so cost
+// model and enumeration changes are judged on plan quality.
+//
+//   plan_quality_bench [--scale 0.1] [--zipf 1] [--runs 3] [--sample]
+//                      [--csv results.csv --label $(git rev-parse --short HEAD)] [--baseline results.csv]
+#include "column_index.h"
+#include "data_generator.h"
+#include "join_sampler.h"
+#include "lexer.h"
+#include "mysql_connector.h"
+#include "native_executor.h"
+#include "optimizer.h"
+#include "parser.h"
+#include "stats.h"
+#include "utils.h"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <map>
+#include <sstream>
+
+using namespace sqlopt;
+using Clock = std::chrono::steady_clock;
+
+namespace {
+
+struct SuiteQuery {
+    const char* id;
+    const char* sql;
+};
+
+// Star joins around orders, chains through order_items, outer joins, skewed keys,
+// correlated filters and top-N over joins
+const SuiteQuery SUITE[] = {
+    {"q01", "SELECT u.name, o.order_amount FROM users u JOIN orders o ON u.id = o.user_id WHERE u.age < 25"},
+    {"q02", "SELECT o.id, p.name FROM orders o JOIN order_items oi ON o.order_id = oi.order_id "
+            "JOIN products p ON oi.product_id = p.id WHERE o.status = 'pending'"},
+    {"q03", "SELECT p.name, oi.order_id FROM products p JOIN order_items oi ON p.id = oi.product_id "
+            "WHERE p.product_category = 'category_1'"},
+    {"q04", "SELECT u.name, p.name FROM users u JOIN orders o ON u.id = o.user_id "
+            "JOIN order_items oi ON o.order_id = oi.order_id JOIN products p ON oi.product_id = p.id "
+            "WHERE u.age = 30 AND p.product_category = 'category_3'"},
+    {"q05", "SELECT c.customer_name, o.order_date FROM customers c JOIN orders o ON c.customer_id = o.user_id "
+            "WHERE c.customer_age > 90"},
+    {"q06", "SELECT u.name, o.order_date FROM orders o JOIN users u ON o.user_id = u.id "
+            "WHERE o.order_date >= '2023-12-01' AND u.age >= 60"},
+    {"q07", "SELECT u.name, o.id FROM users u LEFT JOIN orders o ON u.id = o.user_id WHERE u.age = 97"},
+    {"q08", "SELECT u.name, o.order_amount FROM users u JOIN orders o ON u.id = o.user_id "
+            "ORDER BY o.order_amount DESC LIMIT 10"},
+    {"q09", "SELECT u.name, p.name, c.customer_name FROM users u JOIN orders o ON u.id = o.user_id "
+            "JOIN order_items oi ON o.order_id = oi.order_id JOIN products p ON oi.product_id = p.id "
+            "JOIN customers c ON c.customer_id = u.id WHERE o.status = 'cancelled' AND c.customer_age < 20"},
+    {"q10", "SELECT o.id, u.age FROM orders o JOIN users u ON o.user_id = u.id WHERE o.order_amount > 400"},
+    {"q11", "SELECT p.name, o.order_date FROM products p JOIN order_items oi ON p.id = oi.product_id "
+            "JOIN orders o ON oi.order_id = o.order_id WHERE o.order_date < '2023-01-15'"},
+    {"q12", "SELECT u.name, c.customer_name FROM users u JOIN customers c ON u.id = c.customer_id "
+            "WHERE u.name LIKE 'user_1%'"},
+    {"q13", "SELECT oi.product_id, o.order_amount FROM order_items oi JOIN orders o ON oi.order_id = o.id "
+            "WHERE o.status = 'cancelled' AND o.order_amount < 20"},
+    {"q14", "SELECT o.id, oi.product_id FROM users u JOIN orders o ON u.id = o.user_id "
+            "JOIN order_items oi ON o.order_id = oi.order_id WHERE u.name = 'user_42'"},
+    {"q15", "SELECT oi.order_id FROM products p JOIN order_items oi ON p.id = oi.product_id "
+            "WHERE p.name = 'product_7'"},
+    {"q16", "SELECT o.id, p.name FROM orders o JOIN order_items oi ON o.order_id = oi.order_id "
+            "JOIN products p ON oi.product_id = p.id WHERE o.status = 'shipped' "
+            "AND p.product_category = 'category_1' AND o.order_date >= '2023-10-01'"},
+    {"q17", "SELECT u.name, o.id FROM customers c JOIN users u ON c.customer_id = u.id "
+            "JOIN orders o ON o.user_id = u.id WHERE c.customer_age = u.age"},
+    {"q18", "SELECT u.name, o.id FROM users u JOIN orders o ON u.id = o.user_id WHERE o.user_id < 100"},
+    {"q19", "SELECT o.id, u.name FROM orders o JOIN users u ON o.user_id = u.id "
+            "ORDER BY o.order_date DESC LIMIT 20"},
+    {"q20", "SELECT p.name, u.name FROM order_items oi JOIN products p ON oi.product_id = p.id "
+            "JOIN orders o ON oi.order_id = o.order_id JOIN users u ON o.user_id = u.id "
+            "WHERE u.age >= 20 AND u.age < 22 AND o.status = 'paid'"},
+};
+
+struct BenchOptions {
+    DataGenOptions data;
+    size_t runs = 3;
+    bool sample = false;
+    std::string csv_path;
+    std::string label = "run";
+    std::string baseline_path;
+};
+
+struct QueryResult {
+    std::string id;
+    double est_cost = 0.0;
+    double est_rows = 0.0;
+    double actual_rows = 0.0;
+    double root_qerror = 0.0;
+    double max_node_qerror = 0.0;
+    double optimize_ms = 0.0;
+    double native_ms = -1.0;         // -1: did not run
+    double mysql_ms = -1.0;          // as written, MySQL's plan
+    double mysql_rewritten_ms = -1.0;
+    std::string error;
+};
+
+double qError(double estimated, double actual) {
+    estimated = std::max(1.0, estimated);
+    actual = std::max(1.0, actual);
+    return std::max(estimated / actual, actual / estimated);
+}
+
+double elapsedMs(Clock::time_point start) {
+    return std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+}
+
+double median(std::vector<double> values) {
+    if (values.empty()) return -1.0;
+    std::sort(values.begin(), values.end());
+    return values[values.size() / 2];
+}
+
+double percentile(std::vector<double> values, double p) {
+    if (values.empty()) return 0.0;
+    std::sort(values.begin(), values.end());
+    return values[std::min(values.size() - 1, static_cast<size_t>(p * (values.size() - 1) + 0.5))];
+}
+
+// q-errors of every operator that ran; the inner side of an index nested loop is
+// estimated per probe, so it is left out
+void nodeQErrors(const PlanNode* node, std::vector<double>& out) {
+    if (!node) return;
+    if (node->actual_rows >= 0) out.push_back(qError(node->estimated_cardinality, node->actual_rows));
+    switch (node->type) {
+        case PlanNodeType::JOIN: {
+            auto join = static_cast<const JoinNode*>(node);
+            nodeQErrors(join->left.get(), out);
+            if (join->algorithm != JoinAlgorithm::INDEX_NESTED_LOOP) nodeQErrors(join->right.get(), out);
+            break;
+        }
+        case PlanNodeType::FILTER: nodeQErrors(static_cast<const FilterNode*>(node)->child.get(), out); break;
+        case PlanNodeType::PROJECT: nodeQErrors(static_cast<const ProjectNode*>(node)->child.get(), out); break;
+        case PlanNodeType::SORT: nodeQErrors(static_cast<const SortNode*>(node)->child.get(), out); break;
+        case PlanNodeType::AGGREGATE: nodeQErrors(static_cast<const AggregateNode*>(node)->child.get(), out); break;
+        case PlanNodeType::DISTINCT: nodeQErrors(static_cast<const DistinctNode*>(node)->child.get(), out); break;
+        case PlanNodeType::LIMIT: nodeQErrors(static_cast<const LimitNode*>(node)->child.get(), out); break;
+        default: break;
+    }
+}
+
+std::string env(const char* name, const std::string& fallback) {
+    const char* v = std::getenv(name);
+    return v ? std::string(v) : fallback;
+}
+
+double timeMySQL(MySQLConnector& conn, const std::string& sql, size_t runs) {
+    std::vector<double> times;
+    for (size_t r = 0; r < runs; ++r) {
+        auto start = Clock::now();
+        auto result = conn.executeQuery(sql);
+        if (!result.success) return -1.0;
+        times.push_back(elapsedMs(start));
+    }
+    return median(times);
+}
+
+// Generated tables, indexed on the leading column of each catalog index and on
+// every table's first (key) column, with statistics that know those indexes
+void loadDataset(const BenchOptions& opts, ColumnStore& store, StatisticsManager& stats) {
+    StatsCatalog catalog;
+    catalog.load_defaults();
+    DataGenerator generator(catalog, opts.data);
+    for (const auto& table : generator.tableNames()) {
+        std::string error;
+        if (!generator.load(store, table, error)) std::cerr << error << "\n";
+    }
+    stats.loadFromColumnStore(store);
+
+    for (const auto& table : generator.tableNames()) {
+        const ColumnTable* loaded = store.table(table);
+        std::vector<std::vector<std::string>> indexes{{loaded->columns[0].name()}};
+        auto it = catalog.tables.find(table);
+        if (it != catalog.tables.end()) indexes.insert(indexes.end(), it->second.indexes.begin(), it->second.indexes.end());
+
+        TableStatistics ts = *stats.getTableStats(table);
+        for (const auto& columns : indexes) {
+            if (columns.empty() || loaded->columnIndex(columns[0]) < 0) continue;
+            bool known = std::any_of(ts.available_indexes.begin(), ts.available_indexes.end(),
+                                     [&](const IndexInfo& idx) { return idx.columns[0] == columns[0]; });
+            if (known) continue;
+            std::string error;
+            if (!store.createIndex(table, columns[0], error)) continue;
+            const ColumnIndex* index = store.index(table, columns[0]);
+            IndexInfo info;
+            info.index_name = "idx_" + table + "_" + columns[0];
+            info.columns = columns;
+            const ColumnStats* column = ts.column(columns[0]);
+            info.cardinality = column ? column->distinct_values : 0;
+            info.is_unique = columns.size() == 1 && info.cardinality == ts.row_count;
+            info.height = index->height();
+            info.fanout = index->fanout();
+            ts.available_indexes.push_back(info);
+        }
+        stats.updateTableStats(table, ts);
+    }
+}
+
+QueryResult runQuery(const SuiteQuery& query, const BenchOptions& opts, const std::shared_ptr<ColumnStore>& store,
+                     const std::shared_ptr<StatisticsManager>& stats, MySQLConnector* mysql) {
+    QueryResult r;
+    r.id = query.id;
+
+    Lexer lexer(query.sql);
+    Parser parser(lexer.tokenize());
+    Query q;
+    ParseError perr;
+    if (!parser.parse_query(q, perr) || !std::holds_alternative<SelectQuery>(q)) {
+        r.error = "parse: " + perr.message;
+        return r;
+    }
+
+    Optimizer optimizer(stats);
+    if (opts.sample) optimizer.setJoinSampler(std::make_shared<JoinSampler>(store));
+    auto start = Clock::now();
+    OptimizeResult optimized = optimizer.optimize(std::move(std::get<SelectQuery>(q)));
+    r.optimize_ms = elapsedMs(start);
+    const PlanNode* root = optimized.plan.getRoot();
+    if (!root) {
+        r.error = "no plan";
+        return r;
+    }
+    r.est_cost = optimized.plan.getCost();
+    r.est_rows = root->estimated_cardinality;
+
+    NativeExecutor executor(store);
+    std::vector<double> times;
+    for (size_t run = 0; run < opts.runs; ++run) {
+        NativeExecutor::Result result;
+        std::string error;
+        start = Clock::now();
+        if (!executor.execute(root, result, error)) {
+            r.error = "native: " + error;
+            break;
+        }
+        times.push_back(elapsedMs(start));
+        r.actual_rows = static_cast<double>(result.rows.size());
+    }
+    if (r.error.empty()) {
+        r.native_ms = median(times);
+        std::vector<double> qerrors;
+        nodeQErrors(root, qerrors);
+        r.root_qerror = qError(r.est_rows, r.actual_rows);
+        r.max_node_qerror = qerrors.empty() ? 0.0 : *std::max_element(qerrors.begin(), qerrors.end());
+    }
+
+    if (mysql) {
+        r.mysql_ms = timeMySQL(*mysql, query.sql, opts.runs);
+        r.mysql_rewritten_ms = timeMySQL(*mysql, optimized.rewritten_sql, opts.runs);
+    }
+    return r;
+}
+
+// Results of the last label in a CSV written by --csv, by query id
+std::map<std::string, QueryResult> loadBaseline(const std::string& path, std::string& label) {
+    std::map<std::string, std::map<std::string, QueryResult>> by_label;
+    std::ifstream in(path);
+    std::string line;
+    std::getline(in, line); // header
+    while (std::getline(in, line)) {
+        std::vector<std::string> f;
+        std::istringstream fields(line);
+        std::string field;
+        while (std::getline(fields, field, ',')) f.push_back(field);
+        if (f.size() < 11) continue;
+        QueryResult r;
+        r.id = f[1];
+        r.est_cost = std::stod(f[2]);
+        r.est_rows = std::stod(f[3]);
+        r.actual_rows = std::stod(f[4]);
+        r.root_qerror = std::stod(f[5]);
+        r.max_node_qerror = std::stod(f[6]);
+        r.optimize_ms = std::stod(f[7]);
+        r.native_ms = std::stod(f[8]);
+        if (by_label.find(f[0]) == by_label.end()) label = f[0];
+        by_label[f[0]][r.id] = r;
+    }
+    return by_label.empty() ? std::map<std::string, QueryResult>{} : by_label[label];
+}
+
+bool parseArgs(int argc, char* argv[], BenchOptions& opts) {
+    opts.data.scale = 0.1;
+    opts.data.zipf = 1.0;
+    for (int i = 1; i < argc; ++i) {
+        std::string a = argv[i];
+        auto next = [&]() -> std::string { return i + 1 < argc ? argv[++i] : ""; };
+        try {
+            if (a == "--scale") opts.data.scale = std::stod(next());
+            else if (a == "--zipf") opts.data.zipf = std::stod(next());
+            else if (a == "--runs") opts.runs = std::stoul(next());
+            else if (a == "--sample") opts.sample = true;
+            else if (a == "--csv") opts.csv_path = next();
+            else if (a == "--label") opts.label = next();
+            else if (a == "--baseline") opts.baseline_path = next();
+            else return false;
+        } catch (const std::exception&) {
+            return false;
+        }
+    }
+    return opts.runs > 0 && opts.data.scale > 0;
+}
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+    BenchOptions opts;
+    if (!parseArgs(argc, argv, opts)) {
+        std::cerr << "usage: plan_quality_bench [--scale F] [--zipf S] [--runs N] [--sample] [--csv FILE] "
+                     "[--label NAME] [--baseline FILE]\n";
+        return 2;
+    }
+
+    auto store = std::make_shared<ColumnStore>();
+    auto stats = std::make_shared<StatisticsManager>();
+    auto start = Clock::now();
+    loadDataset(opts, *store, *stats);
+    std::cout << "dataset: scale " << opts.data.scale << ", zipf " << opts.data.zipf << ", generated in "
+              << std::fixed << std::setprecision(0) << elapsedMs(start) << " ms\n";
+    std::cout.unsetf(std::ios::fixed);
+
+    std::unique_ptr<MySQLConnector> mysql;
+    if (!env("MYSQL_DB", "").empty()) {
+        mysql = std::make_unique<MySQLConnector>();
+        if (!mysql->connect(env("MYSQL_HOST", "localhost"), env("MYSQL_USER", "root"),
+                            env("MYSQL_PWD", env("MYSQL_PASSWORD", "")), env("MYSQL_DB", ""))) {
+            std::cerr << "Failed to connect to MySQL; timing native plans only\n";
+            mysql.reset();
+        }
+    }
+
+    std::vector<QueryResult> results;
+    for (const auto& query : SUITE) results.push_back(runQuery(query, opts, store, stats, mysql.get()));
+
+    std::cout << std::left << std::setw(5) << "query" << std::right << std::setw(12) << "est cost" << std::setw(10)
+              << "est rows" << std::setw(10) << "actual" << std::setw(9) << "q-err" << std::setw(11) << "max node"
+              << std::setw(10) << "opt ms" << std::setw(10) << "exec ms";
+    if (mysql) std::cout << std::setw(11) << "mysql ms" << std::setw(11) << "rewrite ms";
+    std::cout << "\n" << std::fixed;
+    std::vector<double> root_qerrors, node_qerrors;
+    double total_ms = 0.0, log_ms = 0.0;
+    size_t ran = 0;
+    for (const auto& r : results) {
+        std::cout << std::left << std::setw(5) << r.id << std::right;
+        if (!r.error.empty()) {
+            std::cout << "  " << r.error << "\n";
+            continue;
+        }
+        std::cout << std::setprecision(0) << std::setw(12) << r.est_cost << std::setw(10) << r.est_rows << std::setw(10)
+                  << r.actual_rows << std::setprecision(1) << std::setw(9) << r.root_qerror << std::setw(11)
+                  << r.max_node_qerror << std::setprecision(2) << std::setw(10) << r.optimize_ms << std::setw(10)
+                  << r.native_ms;
+        if (mysql) std::cout << std::setw(11) << r.mysql_ms << std::setw(11) << r.mysql_rewritten_ms;
+        std::cout << "\n";
+        root_qerrors.push_back(r.root_qerror);
+        node_qerrors.push_back(r.max_node_qerror);
+        total_ms += r.native_ms;
+        log_ms += std::log(std::max(r.native_ms, 1e-3));
+        ++ran;
+    }
+    auto distribution = [](const char* name, const std::vector<double>& q) {
+        std::cout << name << ": median " << percentile(q, 0.5) << ", p90 " << percentile(q, 0.9) << ", p95 "
+                  << percentile(q, 0.95) << ", max " << percentile(q, 1.0) << "\n";
+    };
+    std::cout << std::setprecision(2) << "\n" << ran << "/" << results.size() << " queries ran natively, "
+              << total_ms << " ms total, geometric mean " << (ran ? std::exp(log_ms / ran) : 0.0) << " ms\n";
+    distribution("q-error (result rows)     ", root_qerrors);
+    distribution("q-error (worst operator)  ", node_qerrors);
+
+    if (!opts.baseline_path.empty()) {
+        std::string label;
+        auto baseline = loadBaseline(opts.baseline_path, label);
+        double log_ratio = 0.0;
+        size_t compared = 0;
+        std::cout << "\nvs. " << label << " (exec time ratio, result q-error before -> after):\n";
+        for (const auto& r : results) {
+            auto it = baseline.find(r.id);
+            if (!r.error.empty() || it == baseline.end() || it->second.native_ms <= 0) continue;
+            double ratio = r.native_ms / it->second.native_ms;
+            log_ratio += std::log(std::max(ratio, 1e-6));
+            ++compared;
+            std::cout << "  " << r.id << std::setw(8) << ratio << "x" << std::setw(10) << it->second.root_qerror
+                      << " -> " << r.root_qerror << (ratio > 1.2 ? "  slower" : ratio < 0.8 ? "  faster" : "")
+                      << "\n";
+        }
+        if (compared) std::cout << "  geometric mean " << std::exp(log_ratio / compared) << "x\n";
+    }
+    std::cout.unsetf(std::ios::fixed);
+
+    if (!opts.csv_path.empty()) {
+        bool exists = std::ifstream(opts.csv_path).good();
+        std::ofstream csv(opts.csv_path, std::ios::app);
+        if (!exists) {
+            csv << "label,query,est_cost,est_rows,actual_rows,root_qerror,max_node_qerror,optimize_ms,native_ms,"
+                   "mysql_ms,mysql_rewritten_ms\n";
+        }
+        for (const auto& r : results) {
+            if (!r.error.empty()) continue;
+            csv << opts.label << "," << r.id << "," << r.est_cost << "," << r.est_rows << "," << r.actual_rows << ","
+                << r.root_qerror << "," << r.max_node_qerror << "," << r.optimize_ms << "," << r.native_ms << ","
+                << r.mysql_ms << "," << r.mysql_rewritten_ms << "\n";
+        }
+    }
+    return 0;
+}
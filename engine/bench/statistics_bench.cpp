@@ -0,0 +1,188 @@
+// Memory and lookup cost of StatisticsManager for a large schema: N tables of M
+// columns each (800 x 60 by default), half the columns with ten most common values,
+// and the cost of validating and binding a three-table query against it.
+// Heap use is measured by replacing the global operator new, so it counts every
+// allocation the statistics make, not an estimate.
+//
+//   statistics_bench [tables] [columns] [lookups]
+#include "lexer.h"
+#include "parser.h"
+#include "semantic.h"
+#include "statistics_manager.h"
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <new>
+#include <string>
+#include <variant>
+#include <vector>
+
+namespace {
+
+std::atomic<size_t> g_allocations{0};
+std::atomic<long long> g_live_bytes{0};
+
+// Each block carries its size in front, so frees can be counted too
+constexpr size_t HEADER = alignof(std::max_align_t);
+
+void* countedAlloc(std::size_t size) {
+    char* p = static_cast<char*>(std::malloc(size + HEADER));
+    if (!p) throw std::bad_alloc();
+    std::memcpy(p, &size, sizeof(size));
+    g_allocations.fetch_add(1, std::memory_order_relaxed);
+    g_live_bytes.fetch_add(static_cast<long long>(size), std::memory_order_relaxed);
+    return p + HEADER;
+}
+
+void countedFree(void* user) {
+    if (!user) return;
+    char* p = static_cast<char*>(user) - HEADER;
+    std::size_t size;
+    std::memcpy(&size, p, sizeof(size));
+    g_live_bytes.fetch_sub(static_cast<long long>(size), std::memory_order_relaxed);
+    std::free(p);
+}
+
+} // namespace
+
+void* operator new(std::size_t size) { return countedAlloc(size); }
+void* operator new[](std::size_t size) { return countedAlloc(size); }
+void operator delete(void* p) noexcept { countedFree(p); }
+void operator delete[](void* p) noexcept { countedFree(p); }
+void operator delete(void* p, std::size_t) noexcept { countedFree(p); }
+void operator delete[](void* p, std::size_t) noexcept { countedFree(p); }
+
+using namespace sqlopt;
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+const char* const ATTRIBUTES[] = {"id", "created_at", "updated_at", "customer_id", "status", "amount",
+                                  "shipping_address_line", "region", "is_active", "notes",
+                                  "last_modified_by_user", "quantity"};
+constexpr size_t ATTRIBUTE_COUNT = sizeof(ATTRIBUTES) / sizeof(ATTRIBUTES[0]);
+
+std::string tableName(size_t t) { return "table_" + std::to_string(t); }
+
+std::string columnName(size_t c) {
+    std::string name = ATTRIBUTES[c % ATTRIBUTE_COUNT];
+    if (c >= ATTRIBUTE_COUNT) name += "_" + std::to_string(c / ATTRIBUTE_COUNT);
+    return name;
+}
+
+void load(StatisticsManager& stats, size_t tables, size_t columns) {
+    for (size_t t = 0; t < tables; ++t) {
+        TableStatistics ts;
+        ts.table_name = tableName(t);
+        ts.row_count = 1000 + t * 37;
+        ts.page_count = ts.row_count / 100;
+        for (size_t c = 0; c < columns; ++c) {
+            ColumnStats cs;
+            cs.column_name = columnName(c);
+            cs.distinct_values = c % 2 ? 500 : ts.row_count;
+            cs.min_value = StatValue::fromNumber(0);
+            cs.max_value = StatValue::fromNumber(static_cast<double>(cs.distinct_values));
+            cs.nullable = c % 3 == 0;
+            std::vector<CommonValue> common;
+            if (c % 2) {
+                for (size_t v = 0; v < 10; ++v) common.push_back({"value_" + std::to_string(v), 0.01 * (10 - v)});
+            }
+            ts.setColumn(std::move(cs), common);
+        }
+        IndexInfo primary;
+        primary.index_name = "PRIMARY";
+        primary.columns = {"id"};
+        primary.is_unique = true;
+        ts.available_indexes.push_back(primary);
+        stats.updateTableStats(tableName(t), std::move(ts));
+    }
+}
+
+template <typename F>
+double nsPerCall(size_t calls, F&& f) {
+    auto start = Clock::now();
+    for (size_t i = 0; i < calls; ++i) f(i);
+    return std::chrono::duration<double, std::nano>(Clock::now() - start).count() / calls;
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    size_t tables = argc > 1 ? std::stoul(argv[1]) : 800;
+    size_t columns = argc > 2 ? std::stoul(argv[2]) : 60;
+    size_t lookups = argc > 3 ? std::stoul(argv[3]) : 2000000;
+
+    size_t a0 = g_allocations.load();
+    long long b0 = g_live_bytes.load();
+    auto start = Clock::now();
+    StatisticsManager stats;
+    load(stats, tables, columns);
+    double load_ms = std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+    size_t allocations = g_allocations.load() - a0;
+    long long live = g_live_bytes.load() - b0;
+
+    // Names to look up, built before timing: a pseudo-random walk over the schema
+    std::vector<std::string> table_names, column_names, folded_columns;
+    std::vector<TableId> table_ids;
+    std::vector<ColumnId> column_ids;
+    for (size_t i = 0; i < 4096; ++i) {
+        size_t t = (i * 7919) % tables, c = (i * 104729) % columns;
+        table_names.push_back(tableName(t));
+        column_names.push_back(columnName(c));
+        std::string upper = columnName(c);
+        for (auto& ch : upper) ch = static_cast<char>(std::toupper(static_cast<unsigned char>(ch)));
+        folded_columns.push_back(upper);
+        table_ids.push_back(stats.tableId(table_names.back()));
+        column_ids.push_back(stats.columnId(table_ids.back(), column_names.back()));
+    }
+
+    size_t found = 0;
+    double by_name = nsPerCall(lookups, [&](size_t i) {
+        const TableStatistics* ts = stats.getTableStats(table_names[i & 4095]);
+        found += ts && stats.findColumnCI(*ts, column_names[i & 4095]);
+    });
+    double by_other_case = nsPerCall(lookups / 10, [&](size_t i) {
+        const TableStatistics* ts = stats.getTableStatsCI(table_names[i & 4095]);
+        found += ts && stats.findColumnCI(*ts, folded_columns[i & 4095]);
+    });
+    double by_id = nsPerCall(lookups, [&](size_t i) {
+        found += stats.column(table_ids[i & 4095], column_ids[i & 4095]).distinct_values > 0;
+    });
+    double selectivity = 0.0;
+    double estimate = nsPerCall(lookups, [&](size_t i) {
+        selectivity += stats.estimateSelectivity(table_names[i & 4095], column_names[i & 4095], "=", "value_3");
+    });
+
+    // Identifiers in mixed case, as users write them
+    Lexer lexer("SELECT A.Customer_Id, b.STATUS, C.amount_2, A.Quantity_3, C.Region FROM TABLE_1 A "
+                "JOIN table_2 b ON A.ID = b.Customer_Id JOIN Table_3 C ON b.id = C.customer_id "
+                "WHERE C.Region = 'west' AND b.Status <> 'void'");
+    Parser parser(lexer.tokenize());
+    std::variant<SelectQuery, InsertQuery, UpdateQuery, DeleteQuery> parsed;
+    ParseError parse_error;
+    if (!parser.parse_query(parsed, parse_error) || !std::holds_alternative<SelectQuery>(parsed)) {
+        std::cerr << "parse error: " << parse_error.message << "\n";
+        return 1;
+    }
+    const SelectQuery& query = std::get<SelectQuery>(parsed);
+    std::string error;
+    size_t valid = 0;
+    BoundQuery bound;
+    double validate = nsPerCall(lookups / 100, [&](size_t) { valid += bind_query(query, stats, bound, error); });
+    if (valid == 0) std::cerr << "validation failed: " << error << "\n";
+
+    std::cout << tables << " tables x " << columns << " columns: " << allocations << " allocations to load, "
+              << live / 1024 << " KiB live (" << stats.memoryBytes() / 1024 << " KiB by memoryBytes), "
+              << load_ms << " ms\n"
+              << "column lookup by name   " << by_name << " ns\n"
+              << "  in another case       " << by_other_case << " ns\n"
+              << "column lookup by id     " << by_id << " ns\n"
+              << "estimateSelectivity(=)  " << estimate << " ns\n"
+              << "bind_query              " << validate << " ns\n"
+              << "(checksum " << found << ", " << selectivity << ")\n";
+    return 0;
+}
@@ -13,7 +13,11 @@ struct Subquery {
     struct SelectQuery* q; // pointer to avoid recursion
 };
 
-struct TableRef{ std::string name; std::string alias; std::vector<std::string> pushedFilters; };
+struct OrderItem{ std::string expr; bool asc=true; };
+
+// pushedOrder/pushedLimit: a top-N taken from this table before it is joined (-1: none)
+struct TableRef{ std::string name; std::string alias; std::vector<std::string> pushedFilters; std::vector<OrderItem> pushedOrder; int pushedLimit=-1;
+                 std::string derived_sql; }; // derived_sql: the SELECT of a derived table named by alias
 
 struct JoinClause {
     JoinType type;
@@ -21,8 +25,6 @@ struct JoinClause {
     std::vector<std::string> on_conds;
 };
 
-struct OrderItem{ std::string expr; bool asc=true; };
-
 struct SelectItem {
     std::string expr;
     std::string alias; // empty if no alias
@@ -60,4 +62,7 @@ struct DeleteQuery {
 
 using Query = std::variant<SelectQuery, InsertQuery, UpdateQuery, DeleteQuery>;
 
+// SQL keyword(s) for a join type, e.g. "LEFT"
+std::string join_type_to_string(JoinType jt);
+
 } // namespace sqlopt
@@ -0,0 +1,96 @@
+#pragma once
+#include <mysql/mysql.h>
+#include <chrono>
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <string>
+#include <vector>
+
+namespace sqlopt {
+
+// Outcome of one statement run by AsyncMySQL
+struct AsyncResult {
+    bool success = false;
+    std::string error_message;
+    // The stored result set, or null for a statement without one; valid only during
+    // the completion, which must not free it
+    MYSQL_RES* result = nullptr;
+    unsigned long long affected_rows = 0;
+};
+
+// A pool of MySQL connections driven from one thread with libmysqlclient's
+// non-blocking API. Statements are queued and each runs on the first idle
+// connection; while the server works on it the connection waits in poll(2) with
+// the others, so a single thread keeps one statement per connection in flight.
+//
+// Each connection is a small state machine (connecting, idle, querying, storing)
+// that is advanced whenever its socket turns readable, and on every round while it
+// connects or sends a statement, which may wait for writability. A statement's completion
+// runs on the thread calling run() or runOnce() and may submit further statements,
+// which is how dependent work (a table's columns once DESCRIBE answered) is chained.
+//
+// Not thread-safe; a thread using it needs mysql_thread_init() like any client thread.
+class AsyncMySQL {
+public:
+    using Completion = std::function<void(const AsyncResult&)>;
+
+    AsyncMySQL(std::string host, std::string user, std::string password, std::string database = "",
+               unsigned int port = 3306);
+    ~AsyncMySQL();
+    AsyncMySQL(const AsyncMySQL&) = delete;
+    AsyncMySQL& operator=(const AsyncMySQL&) = delete;
+
+    // Starts `connections` more connections; they complete their handshake while
+    // run() or runOnce() drives them. Statements may be submitted before.
+    void open(size_t connections);
+
+    // Queues a statement; `done` runs once it finished or failed
+    void submit(std::string sql, Completion done);
+
+    // Drives the connections until every statement submitted, including those
+    // submitted by completions, has completed
+    void run();
+
+    // Advances every connection that can make progress, then waits at most `timeout`
+    // for a socket to turn readable and advances those and every connection that is
+    // connecting or sending. Returns false when nothing is queued or in flight.
+    bool runOnce(std::chrono::milliseconds timeout);
+
+    size_t connected() const { return connected_; }
+    size_t failed() const { return failed_; }
+    size_t inFlight() const;
+    const std::string& lastConnectError() const { return connect_error_; }
+
+private:
+    enum class State { CONNECTING, IDLE, QUERYING, STORING, FAILED };
+
+    struct Connection {
+        MYSQL* mysql = nullptr;
+        State state = State::CONNECTING;
+        std::string sql;
+        Completion done;
+    };
+
+    struct Pending {
+        std::string sql;
+        Completion done;
+    };
+
+    std::string host_, user_, password_, database_;
+    unsigned int port_;
+    std::vector<Connection> connections_;
+    std::deque<Pending> pending_;
+    size_t connected_ = 0;
+    size_t failed_ = 0;
+    std::string connect_error_;
+
+    // Steps the connection until it has to wait for the server; false when it is idle
+    // with nothing queued or has failed
+    bool advance(Connection& c);
+    void finish(Connection& c, AsyncResult& result);
+    // With no connection left to run them, queued statements fail
+    void failPending();
+};
+
+} // namespace sqlopt
@@ -0,0 +1,111 @@
+#pragma once
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+#include "ast.h"
+#include "expression.h"
+#include "statistics_manager.h"
+#include "symbol_table.h"
+
+namespace sqlopt {
+
+// Position of a table reference in its query: 0 is the FROM table, i + 1 the table
+// of joins[i]
+using RefId = uint32_t;
+
+// A set of table references, bit r for RefId r
+using TableMask = uint64_t;
+
+constexpr RefId INVALID_REF = UINT32_MAX;
+
+// References past the width of a mask have no bit; conditions reading them bind as opaque
+constexpr size_t MAX_MASK_REFS = 64;
+
+inline TableMask refBit(RefId ref) { return ref < MAX_MASK_REFS ? TableMask{1} << ref : 0; }
+
+// One table of the FROM clause
+struct BoundRef {
+    std::string name;           // as written
+    std::string alias;          // empty when unaliased
+    TableId table = INVALID_ID; // INVALID_ID when the statistics do not have it
+    std::string derived_sql;    // the SELECT of a derived table; empty for a base table
+
+    // What its columns are qualified by: the alias, or the name when unaliased
+    const std::string& qualifier() const { return alias.empty() ? name : alias; }
+};
+
+// A column reference resolved to the table reference it reads
+struct BoundColumn {
+    std::string qualifier;        // as written, empty when unqualified
+    std::string name;             // without its qualifier
+    RefId ref = INVALID_REF;      // unknown qualifier, or an unqualified name no single table has
+    ColumnId column = INVALID_ID; // not in the statistics of its table
+    bool ambiguous = false;       // unqualified, and more than one table has the column
+};
+
+// "a.x = b.y" between columns of two different table references
+struct JoinEdge {
+    BoundColumn left, right;
+};
+
+// A condition resolved against the query's tables
+struct BoundPredicate {
+    TableMask tables = 0;
+    // Unparsed, reads a subquery, or has a column that did not bind: the tables it
+    // reads are not known and `tables` is only a lower bound
+    bool opaque = false;
+    std::vector<BoundColumn> columns; // every column reference, in visit_expression order
+    std::vector<JoinEdge> edges;      // the column equalities among its AND-ed parts, in order
+};
+
+// The query graph semantic analysis produces: every table reference numbered, its
+// statistics resolved once, and conditions bound to the set of tables they read
+// with their column equalities as join edges. Rewrites, planning and costing work
+// on ids and masks from here and never look for aliases in condition text.
+//
+// The WHERE and ON conditions are bound when the query is; a stage that changes the
+// query's tables or conditions rebinds before the next one reads them.
+class BoundQuery {
+public:
+    BoundQuery() = default;
+    explicit BoundQuery(const SelectQuery& query, const StatisticsManager* stats = nullptr) { bind(query, stats); }
+
+    // Binds the tables and the WHERE and ON conditions of `query`
+    void bind(const SelectQuery& query, const StatisticsManager* stats);
+    void rebind(const SelectQuery& query) { bind(query, stats_); }
+
+    // Adds a table reference after the others; conditions already bound are kept
+    RefId addRef(const TableRef& table);
+
+    size_t size() const { return refs_.size(); }
+    const BoundRef& ref(RefId id) const { return refs_[id]; }
+    const std::vector<BoundRef>& refs() const { return refs_; }
+    TableMask allRefs() const;
+
+    // The reference a qualifier names, case-insensitively, or INVALID_REF
+    RefId findRef(std::string_view qualifier) const;
+
+    // "u.age" or "age". An unqualified name binds to the one table whose statistics
+    // have it, or to the only table of the query.
+    BoundColumn bindColumn(const std::string& text) const;
+    BoundPredicate bindPredicate(const Expr* tree) const;
+
+    const TableStatistics* tableStats(RefId id) const;
+    const ColumnStats* columnStats(const BoundColumn& column) const;
+    const StatisticsManager* statistics() const { return stats_; }
+
+    std::vector<BoundPredicate> where;           // query.where_conditions, in order
+    std::vector<std::vector<BoundPredicate>> on; // joins[i].on_conds, in order
+
+private:
+    const StatisticsManager* stats_ = nullptr;
+    std::vector<BoundRef> refs_;
+    NameTable qualifiers_{NameTable::Case::INSENSITIVE};
+    std::vector<RefId> qualifier_refs_; // by qualifier id; the first reference with a qualifier owns it
+};
+
+// A condition parsed and bound in one step
+BoundPredicate bind_condition(const BoundQuery& bound, const std::string& condition);
+
+} // namespace sqlopt
@@ -0,0 +1,115 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace sqlopt {
+
+// Chunk encodings of the column store
+enum class Encoding {
+    PLAIN,      // values as they are
+    RLE,        // (value, run end) pairs: sorted or low-cardinality columns
+    FOR,        // frame of reference: offsets from the chunk minimum, bit-packed
+    DELTA,      // differences to the previous value, bit-packed, with an absolute anchor per block
+    DICTIONARY  // strings replaced by codes into a sorted per-chunk dictionary
+};
+
+inline const char* encoding_name(Encoding encoding) {
+    switch (encoding) {
+        case Encoding::PLAIN:      return "plain";
+        case Encoding::RLE:        return "rle";
+        case Encoding::FOR:        return "for";
+        case Encoding::DELTA:      return "delta";
+        case Encoding::DICTIONARY: return "dictionary";
+    }
+    return "unknown";
+}
+
+enum class CompareOp { EQ, NE, LT, LE, GT, GE, IS_NULL, IS_NOT_NULL, LIKE };
+
+// Unsigned integers of a fixed bit width packed back to back into 64-bit words
+class BitPackedArray {
+public:
+    BitPackedArray() = default;
+    BitPackedArray(const std::vector<uint64_t>& values, unsigned bits);
+
+    uint64_t get(size_t i) const {
+        if (bits_ == 0) return 0;
+        size_t bit = i * bits_;
+        size_t word = bit >> 6;
+        unsigned offset = bit & 63;
+        uint64_t v = words_[word] >> offset;
+        if (offset + bits_ > 64) v |= words_[word + 1] << (64 - offset);
+        return bits_ == 64 ? v : v & ((uint64_t(1) << bits_) - 1);
+    }
+
+    // Decode values [begin, begin + count) into out. Dispatches to a decoder
+    // specialised for the bit width, whose constant shifts and masks let the
+    // compiler unroll and vectorize the loop.
+    void unpack(size_t begin, size_t count, uint64_t* out) const;
+
+    unsigned bits() const { return bits_; }
+    size_t size() const { return size_; }
+    size_t memoryBytes() const { return words_.capacity() * sizeof(uint64_t); }
+
+private:
+    std::vector<uint64_t> words_; // one spare word so decoders may read past the last value
+    unsigned bits_ = 0;
+    size_t size_ = 0;
+};
+
+// Bits needed to represent v (0 for 0)
+inline unsigned bit_width(uint64_t v) {
+    unsigned bits = 0;
+    while (v) {
+        ++bits;
+        v >>= 1;
+    }
+    return bits;
+}
+
+// One chunk of 64-bit integers (also dates, scaled decimals and dictionary codes),
+// stored in whichever encoding is smallest for its values
+class IntChunk {
+public:
+    static constexpr size_t DELTA_BLOCK = 128; // rows per absolute anchor in DELTA
+
+    static IntChunk encode(const std::vector<int64_t>& values);
+
+    // Encode with a given encoding (used by benchmarks to compare codecs)
+    static IntChunk encodeAs(const std::vector<int64_t>& values, Encoding encoding);
+
+    Encoding encoding() const { return encoding_; }
+    size_t size() const { return rows_; }
+    int64_t min() const { return min_; }
+    int64_t max() const { return max_; }
+
+    // Random access: O(1) for PLAIN/FOR, O(log runs) for RLE, O(DELTA_BLOCK) for DELTA
+    int64_t get(size_t i) const;
+
+    // Decode every value of the chunk into out (size() entries)
+    void decode(int64_t* out) const;
+
+    // Append to `out` base_row + i for every row i whose value v satisfies
+    // `lo <= v && v <= hi` (inclusive, in the integer domain), evaluated on the
+    // encoded form: once per run for RLE, on the packed offsets for FOR.
+    // `exclude` inverts the test (v < lo || v > hi).
+    void selectRange(int64_t lo, int64_t hi, bool exclude, uint32_t base_row, const std::vector<bool>* nulls,
+                     std::vector<uint32_t>& out) const;
+
+    size_t memoryBytes() const;
+
+private:
+    Encoding encoding_ = Encoding::PLAIN;
+    size_t rows_ = 0;
+    int64_t min_ = 0, max_ = 0;
+    std::vector<int64_t> plain_;       // PLAIN
+    int64_t base_ = 0;                 // FOR: chunk minimum; DELTA: smallest delta
+    BitPackedArray packed_;            // FOR: value - base; DELTA: delta - base
+    std::vector<int64_t> anchors_;     // DELTA: value of every DELTA_BLOCK-th row
+    std::vector<int64_t> run_values_;  // RLE
+    std::vector<uint32_t> run_ends_;   // RLE: exclusive end row of each run
+};
+
+} // namespace sqlopt
@@ -0,0 +1,141 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+#include "column_store.h"
+
+namespace sqlopt {
+
+// Read-only secondary index over one loaded column, bulk-loaded from the column's
+// values in sorted order. NULLs are not indexed.
+class ColumnIndex {
+public:
+    virtual ~ColumnIndex() = default;
+
+    // A B+tree for INT/DOUBLE/DATE columns, an ART for strings
+    static std::shared_ptr<const ColumnIndex> build(const Column& column);
+
+    virtual const char* kind() const = 0;
+    virtual size_t memoryBytes() const = 0;
+
+    size_t size() const { return rows_.size(); }
+    size_t height() const { return height_; } // node levels visited to reach an entry
+    double fanout() const { return fanout_; } // average children of an inner node
+
+    // Every indexed row, in key order (ties in row order)
+    const std::vector<RowId>& rowsInKeyOrder() const { return rows_; }
+
+protected:
+    std::vector<RowId> rows_;
+    size_t height_ = 1;
+    double fanout_ = 1.0;
+};
+
+// B+tree over numeric keys (day numbers for DATE). Built bottom-up from sorted
+// entries with an implicit layout: node j of a level has its children at
+// j * NODE_KEYS ... j * NODE_KEYS + NODE_KEYS - 1 of the level below, so nodes hold
+// only keys and each one fills a single 64-byte cache line.
+class BTreeIndex : public ColumnIndex {
+public:
+    static constexpr size_t NODE_KEYS = 8;
+
+    // (key, row) pairs sorted by key, then row
+    explicit BTreeIndex(const std::vector<std::pair<double, RowId>>& sorted);
+
+    const char* kind() const override { return "btree"; }
+    size_t memoryBytes() const override;
+
+    // Position of the first entry whose key is >= key (> key when strict)
+    size_t lowerBound(double key, bool strict) const;
+
+    // Rows whose key lies between the bounds, in key order; a missing bound is open
+    struct Bound {
+        bool set = false;
+        double key = 0.0;
+        bool inclusive = true;
+    };
+    void range(const Bound& lower, const Bound& upper, std::vector<RowId>& out) const;
+
+private:
+    struct alignas(64) Node {
+        double max_keys[NODE_KEYS]; // largest key under each child; +inf past the last child
+    };
+
+    std::vector<double> keys_;            // leaf level: entry keys, with rows_ alongside
+    std::vector<std::vector<Node>> levels_; // levels_[0] indexes the leaves; back() is the root
+};
+
+// Adaptive radix tree over string keys, folded to lower case so lookups follow
+// MySQL's case-insensitive collations. Inner nodes grow from 4 to 16, 48 and 256
+// children and compress single-child paths into a prefix. Because it is bulk-loaded
+// from sorted keys, every subtree covers one contiguous range of rowsInKeyOrder(),
+// so a node stores that range instead of leaf pointers.
+class ArtIndex : public ColumnIndex {
+public:
+    // (folded key, row) pairs sorted by key, then row
+    explicit ArtIndex(const std::vector<std::pair<std::string, RowId>>& sorted);
+
+    const char* kind() const override { return "art"; }
+    size_t memoryBytes() const override;
+
+    // Rows whose key equals `key` (case-insensitively)
+    void lookup(std::string_view key, std::vector<RowId>& out) const;
+
+    // Rows whose key starts with `prefix`, in key order
+    void prefix(std::string_view prefix, std::vector<RowId>& out) const;
+
+private:
+    using Ref = uint32_t; // node type in the top 2 bits, index into its pool below
+    static constexpr Ref NO_CHILD = static_cast<Ref>(-1);
+
+    enum NodeType : uint32_t { NODE4 = 0, NODE16 = 1, NODE48 = 2, NODE256 = 3 };
+
+    struct Header {
+        uint32_t prefix_begin = 0, prefix_len = 0; // compressed path, in prefixes_
+        uint32_t begin = 0;        // first entry under the node
+        uint32_t terminal_end = 0; // entries [begin, terminal_end) end exactly at the node
+        uint32_t end = 0;
+    };
+    struct Node4 {
+        Header h;
+        uint8_t count = 0;
+        uint8_t keys[4];
+        Ref children[4];
+    };
+    struct Node16 {
+        Header h;
+        uint8_t count = 0;
+        uint8_t keys[16];
+        Ref children[16];
+    };
+    struct Node48 {
+        Header h;
+        uint8_t slot[256]; // child slot + 1 per byte, 0 when absent
+        Ref children[48];
+    };
+    struct Node256 {
+        Header h;
+        Ref children[256];
+    };
+
+    std::vector<Node4> node4_;
+    std::vector<Node16> node16_;
+    std::vector<Node48> node48_;
+    std::vector<Node256> node256_;
+    std::string prefixes_;
+    Ref root_ = NO_CHILD;
+
+    Ref build(const std::vector<std::pair<std::string, RowId>>& sorted, size_t begin, size_t end, size_t depth,
+              size_t level, size_t& inner_nodes, size_t& children);
+    const Header& header(Ref node) const;
+    Ref child(Ref node, uint8_t byte) const;
+
+    // Node under which every key starts with `key` (exact: ... and key ends there)
+    bool descend(std::string_view key, bool exact, uint32_t& begin, uint32_t& end) const;
+};
+
+} // namespace sqlopt
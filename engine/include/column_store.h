@@ -0,0 +1,179 @@
+#pragma once
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <vector>
+#include "column_codecs.h"
+
+namespace sqlopt {
+
+class MySQLConnector;
+class ColumnIndex;
+
+// Position of a row inside its table; operators pass these around instead of values
+using RowId = uint32_t;
+
+// Marks the missing side of an outer join row
+constexpr RowId NULL_ROW = static_cast<RowId>(-1);
+
+enum class ColumnType { INT, DOUBLE, STRING, DATE };
+
+inline const char* column_type_name(ColumnType type) {
+    switch (type) {
+        case ColumnType::INT:    return "int";
+        case ColumnType::DOUBLE: return "double";
+        case ColumnType::STRING: return "string";
+        case ColumnType::DATE:   return "date";
+    }
+    return "unknown";
+}
+
+// 'YYYY-MM-DD' <-> days since 1970-01-01 (DATE values are stored as day numbers)
+bool parse_date(const std::string& text, int64_t& days);
+std::string format_date(int64_t days);
+
+// Case-insensitive (ASCII) comparison, as MySQL's default collations compare strings
+int compare_nocase(std::string_view a, std::string_view b);
+
+// One column of a local table, split into chunks of CHUNK_ROWS rows that are each
+// stored in the smallest of the encodings in column_codecs.h
+class Column {
+public:
+    static constexpr size_t CHUNK_ROWS = 65536;
+
+    Column(std::string name, ColumnType type) : name_(std::move(name)), type_(type) {}
+
+    const std::string& name() const { return name_; }
+    ColumnType type() const { return type_; }
+    size_t size() const { return rows_; }
+
+    // Append a value in text form; nullptr appends NULL. finish() must follow the
+    // last append, before the column is read.
+    void append(const char* value);
+    void finish();
+
+    bool isNull(RowId row) const {
+        const Chunk& c = chunks_[row / CHUNK_ROWS];
+        return c.null_count > 0 && c.nulls[row % CHUNK_ROWS];
+    }
+    // Numeric value of an INT, DOUBLE or DATE (day number) column
+    double numberAt(RowId row) const;
+    std::string_view stringAt(RowId row) const;
+
+    // Text form of a value, "NULL" for nulls
+    std::string valueAt(RowId row) const;
+
+    // Append to `out`, in row order, the rows whose value satisfies `value op literal`
+    // for a comparison op (NULLs never match). Evaluated chunk by chunk on the encoded data: RLE runs are
+    // tested once, FOR offsets and dictionary codes are compared without decoding the
+    // values. Chunks their zone map rules out are skipped. The numeric overload is for
+    // INT/DOUBLE/DATE columns, the text one for STRING. Returns the number of values
+    // examined, i.e. the rows of the chunks not skipped.
+    size_t select(CompareOp op, double literal, std::vector<RowId>& out) const;
+    size_t select(CompareOp op, const std::string& literal, std::vector<RowId>& out) const;
+
+    size_t chunkCount() const { return chunks_.size(); }
+    Encoding chunkEncoding(size_t chunk) const { return chunks_[chunk].encoding; }
+
+    // Summary of one chunk, built when the chunk is sealed and consulted before any
+    // of its values are read
+    struct ZoneMap {
+        size_t rows = 0;
+        size_t null_count = 0;
+        size_t distinct = 0;            // distinct non-NULL values
+        double min = 0.0, max = 0.0;    // INT, DOUBLE, DATE (day numbers)
+        std::string min_text, max_text; // STRING, in case-insensitive order
+    };
+    const ZoneMap& zoneMap(size_t chunk) const { return chunks_[chunk].zone; }
+
+    // False when no row of the chunk can satisfy `value op literal` (IS [NOT] NULL
+    // ignore the literal); the numeric overload is for INT/DOUBLE/DATE columns
+    bool chunkMayMatch(size_t chunk, CompareOp op, double literal) const;
+    bool chunkMayMatch(size_t chunk, CompareOp op, const std::string& literal) const;
+
+    size_t memoryBytes() const;
+    // Size as plain arrays: 8 bytes per number, length plus a 4-byte offset per string
+    size_t rawBytes() const { return raw_bytes_; }
+
+private:
+    struct Chunk {
+        size_t rows = 0;
+        size_t null_count = 0;
+        std::vector<bool> nulls;              // empty when the chunk has no NULLs
+        Encoding encoding = Encoding::PLAIN;
+        IntChunk ints;                        // INT, DATE, scaled DOUBLE, dictionary codes
+        int scale = -1;                       // DOUBLE: >= 0 when stored as ints / 10^scale
+        std::vector<double> doubles;          // DOUBLE that is not a short decimal
+        std::string bytes;                    // STRING, plain: value i is bytes[offsets[i], offsets[i + 1])
+        std::vector<uint32_t> offsets;
+        std::vector<std::string> dictionary;  // STRING, sorted case-insensitively
+        ZoneMap zone;
+    };
+
+    std::string name_;
+    ColumnType type_;
+    std::vector<Chunk> chunks_;
+    size_t rows_ = 0;
+    size_t raw_bytes_ = 0;
+
+    // Values of the chunk being filled
+    std::vector<int64_t> pending_ints_;
+    std::vector<double> pending_doubles_;
+    std::vector<std::string> pending_strings_;
+    std::vector<bool> pending_nulls_;
+
+    void seal();
+};
+
+struct ColumnTable {
+    std::string name;
+    std::vector<Column> columns;
+    size_t row_count = 0;
+
+    // Case-insensitive column lookup, -1 when absent
+    int columnIndex(const std::string& column) const;
+
+    size_t memoryBytes() const;
+    size_t rawBytes() const;
+
+    // Build from text rows, "\N" being NULL as in LOAD DATA files; each column gets
+    // the narrowest type all of its values parse as
+    static ColumnTable fromRows(const std::string& name, const std::vector<std::string>& column_names,
+                                const std::vector<std::vector<std::string>>& rows);
+};
+
+// Tables copied into memory for native execution
+class ColumnStore {
+public:
+    // Copy a whole table out of MySQL
+    bool loadFromMySQL(MySQLConnector& conn, const std::string& table, std::string& error);
+
+    // Load a delimited file whose first line names the columns ("\N" is NULL, as
+    // written by SELECT ... INTO OUTFILE)
+    bool loadFromFile(const std::string& table, const std::string& path, char delimiter, std::string& error);
+
+    void addTable(ColumnTable table);
+    bool dropTable(const std::string& table);
+
+    // Case-insensitive lookup, nullptr when the table is not loaded
+    const ColumnTable* table(const std::string& name) const;
+
+    std::vector<std::string> tableNames() const;
+
+    // Bulk-load a secondary index on a loaded column (see column_index.h); replacing
+    // or dropping the table drops its indexes
+    bool createIndex(const std::string& table, const std::string& column, std::string& error);
+
+    // Case-insensitive lookup, nullptr when the column has no index
+    const ColumnIndex* index(const std::string& table, const std::string& column) const;
+
+private:
+    std::map<std::string, std::shared_ptr<const ColumnTable>> tables_; // keyed by lower-cased name
+    std::map<std::string, std::shared_ptr<const ColumnIndex>> indexes_; // keyed by lower-cased "table.column"
+
+    void dropIndexes(const std::string& table);
+};
+
+} // namespace sqlopt
@@ -0,0 +1,101 @@
+#pragma once
+#include <cstdint>
+#include <iterator>
+#include <memory>
+#include <string>
+#include <vector>
+#include "bound_query.h"
+#include "expression.h"
+
+namespace sqlopt {
+
+using ConditionId = uint32_t;
+
+class ConditionPool;
+
+// One condition of a query: its text, parsed and bound once
+struct ConditionEntry {
+    std::string text;
+    ExprPtr tree;           // nullptr when the text does not parse
+    BoundPredicate binding; // the tables it reads and its join edges
+};
+
+// The conditions of one plan node: a run of slots in its query's ConditionPool.
+// Copying a list copies a pointer and two numbers, never condition text.
+class ConditionList {
+public:
+    class iterator {
+    public:
+        using iterator_category = std::forward_iterator_tag;
+        using value_type = std::string;
+        using difference_type = std::ptrdiff_t;
+        using pointer = const std::string*;
+        using reference = const std::string&;
+
+        iterator(const ConditionList* list, size_t i) : list_(list), i_(i) {}
+        reference operator*() const { return (*list_)[i_]; }
+        pointer operator->() const { return &(*list_)[i_]; }
+        iterator& operator++() { ++i_; return *this; }
+        iterator operator++(int) { iterator old = *this; ++i_; return old; }
+        bool operator==(const iterator& other) const { return i_ == other.i_; }
+        bool operator!=(const iterator& other) const { return i_ != other.i_; }
+
+    private:
+        const ConditionList* list_;
+        size_t i_;
+    };
+
+    ConditionList() = default;
+    ConditionList(std::shared_ptr<const ConditionPool> pool, uint32_t first, uint32_t count)
+        : pool_(std::move(pool)), first_(first), count_(count) {}
+
+    size_t size() const { return count_; }
+    bool empty() const { return count_ == 0; }
+    ConditionId id(size_t i) const;
+    const std::string& operator[](size_t i) const;
+    const ConditionEntry& entry(size_t i) const;
+    iterator begin() const { return iterator(this, 0); }
+    iterator end() const { return iterator(this, count_); }
+    const ConditionPool* pool() const { return pool_.get(); }
+
+    // The condition texts, for code that keeps its own copy
+    std::vector<std::string> texts() const { return std::vector<std::string>(begin(), end()); }
+
+private:
+    std::shared_ptr<const ConditionPool> pool_;
+    uint32_t first_ = 0;
+    uint32_t count_ = 0;
+};
+
+// Every condition of the query being planned, stored, parsed and bound once. The
+// planner interns WHERE and ON conditions as it builds candidate plans; plan nodes
+// then refer to them by id through ConditionLists, and the pool lives as long as
+// any plan that uses it. Conditions are bound against `bound`, which must outlive
+// the interning but not the pool.
+class ConditionPool : public std::enable_shared_from_this<ConditionPool> {
+public:
+    explicit ConditionPool(const BoundQuery* bound = nullptr) : bound_(bound) {}
+
+    // Id of the condition, adding it on first sight
+    ConditionId intern(const std::string& text);
+
+    // The conditions as one list, interned in order
+    ConditionList addList(const std::vector<std::string>& conditions);
+
+    const ConditionEntry& operator[](ConditionId id) const { return entries_[id]; }
+    ConditionId slot(uint32_t i) const { return slots_[i]; }
+    size_t size() const { return entries_.size(); }
+
+private:
+    const BoundQuery* bound_;
+    std::vector<ConditionEntry> entries_;
+    std::vector<ConditionId> slots_; // the ids of every list, one run per list
+};
+
+inline ConditionId ConditionList::id(size_t i) const { return pool_->slot(first_ + static_cast<uint32_t>(i)); }
+
+inline const ConditionEntry& ConditionList::entry(size_t i) const { return (*pool_)[id(i)]; }
+
+inline const std::string& ConditionList::operator[](size_t i) const { return entry(i).text; }
+
+} // namespace sqlopt
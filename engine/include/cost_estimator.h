@@ -1,6 +1,9 @@
 #pragma once
 #include "statistics_manager.h"
+#include "execution_plan.h"
+#include <cmath>
 #include <memory>
+#include <utility>
 
 namespace sqlopt {
 
@@ -10,9 +13,9 @@ struct CostComponents {
     double memory_cost = 0.0;  // Memory usage cost
     double network_cost = 0.0; // Network cost (for distributed)
 
-    double total() const { return io_cost + cpu_cost + memory_cost + network_cost; }
+    constexpr double total() const { return io_cost + cpu_cost + memory_cost + network_cost; }
 
-    CostComponents& operator+=(const CostComponents& other) {
+    constexpr CostComponents& operator+=(const CostComponents& other) {
         io_cost += other.io_cost;
         cpu_cost += other.cpu_cost;
         memory_cost += other.memory_cost;
@@ -21,44 +24,286 @@ struct CostComponents {
     }
 };
 
+// Flat copy of the numbers costing needs from TableStatistics. Resolved once per
+// query so that pricing a candidate never goes back to the statistics maps.
+struct TableStatsHandle {
+    double row_count = 0.0;
+    double page_count = 0.0;
+    bool valid = false;
+};
+
+// Cost formulas as plain arithmetic on cardinalities and handles
+namespace cost_model {
+
+// Cost constants (can be tuned)
+constexpr double SEQ_PAGE_COST = 1.0;
+constexpr double RAND_PAGE_COST = 4.0;
+constexpr double CPU_TUPLE_COST = 0.01;
+constexpr double INDEX_LOOKUP_COST = 2.0;
+constexpr double SORT_COST_PER_TUPLE = 0.1;
+constexpr double HASH_MEMORY_PER_TUPLE = 0.1;
+
+constexpr CostComponents tableScan(const TableStatsHandle& t, double selectivity) {
+    CostComponents cost;
+    if (!t.valid) return cost;
+    double pages = static_cast<double>(static_cast<size_t>(t.page_count * selectivity));
+    // I/O cost: sequential page reads; CPU cost: process tuples
+    cost.io_cost = (pages < 1.0 ? 1.0 : pages) * SEQ_PAGE_COST;
+    cost.cpu_cost = static_cast<double>(static_cast<size_t>(t.row_count * selectivity)) * CPU_TUPLE_COST;
+    return cost;
+}
+
+constexpr CostComponents indexScan(const TableStatsHandle& t, double selectivity) {
+    CostComponents cost;
+    if (!t.valid) return cost;
+    // Index lookup plus random I/O for the data pages
+    double pages = static_cast<double>(static_cast<size_t>(t.page_count * selectivity));
+    cost.io_cost = INDEX_LOOKUP_COST + (pages < 1.0 ? 1.0 : pages) * RAND_PAGE_COST;
+    cost.cpu_cost = static_cast<double>(static_cast<size_t>(t.row_count * selectivity)) * CPU_TUPLE_COST;
+    return cost;
+}
+
+// Keys per node of an on-disk B+tree: a 16 KB InnoDB page of ~80-byte entries
+constexpr double DISK_INDEX_FANOUT = 200.0;
+// Visiting one index node on the way down from the root
+constexpr double INDEX_NODE_COST = 0.5;
+
+// Levels of a B+tree over `entries` keys with `fanout` children per node
+inline double indexHeight(double entries, double fanout) {
+    if (fanout < 2.0) fanout = 2.0;
+    return entries <= fanout ? 1.0 : std::ceil(std::log(entries) / std::log(fanout));
+}
+
+// Index range or point lookup: one node per level down to the first match, the
+// leaves holding the matching keys in order, then random I/O for their rows
+inline CostComponents indexLookup(const TableStatsHandle& t, double height, double fanout, double selectivity) {
+    CostComponents cost;
+    if (!t.valid) return cost;
+    double matches = t.row_count * selectivity;
+    double leaves = std::ceil((matches < 1.0 ? 1.0 : matches) / (fanout < 2.0 ? 2.0 : fanout));
+    double pages = static_cast<double>(static_cast<size_t>(t.page_count * selectivity));
+    cost.io_cost = height * INDEX_NODE_COST + (leaves - 1.0) * SEQ_PAGE_COST + (pages < 1.0 ? 1.0 : pages) * RAND_PAGE_COST;
+    cost.cpu_cost = (height * std::log2(fanout < 2.0 ? 2.0 : fanout) + matches) * CPU_TUPLE_COST;
+    return cost;
+}
+
+template <JoinAlgorithm Algo>
+constexpr CostComponents join(double left_rows, double right_rows) {
+    CostComponents cost;
+    if constexpr (Algo == JoinAlgorithm::NESTED_LOOP) {
+        // Nested loop join: O(left_rows * right_rows)
+        cost.cpu_cost = left_rows * right_rows * CPU_TUPLE_COST;
+        // I/O cost depends on buffer management, simplified
+        cost.io_cost = (left_rows + right_rows) * SEQ_PAGE_COST;
+    } else if constexpr (Algo == JoinAlgorithm::HASH) {
+        // Hash join: build hash table + probe
+        cost.cpu_cost = (left_rows + right_rows) * CPU_TUPLE_COST * 2;
+        cost.memory_cost = (left_rows > right_rows ? left_rows : right_rows) * HASH_MEMORY_PER_TUPLE;
+        cost.io_cost = (left_rows + right_rows) * SEQ_PAGE_COST;
+    } else if constexpr (Algo == JoinAlgorithm::MERGE) {
+        // Merge join: requires sorted inputs
+        cost.cpu_cost = (left_rows + right_rows) * CPU_TUPLE_COST;
+        cost.io_cost = (left_rows + right_rows) * SEQ_PAGE_COST;
+    }
+    // INDEX_NESTED_LOOP needs the inner table's handle, see indexNestedLoop()
+    return cost;
+}
+
+constexpr CostComponents join(JoinAlgorithm algo, double left_rows, double right_rows) {
+    switch (algo) {
+        case JoinAlgorithm::NESTED_LOOP: return join<JoinAlgorithm::NESTED_LOOP>(left_rows, right_rows);
+        case JoinAlgorithm::HASH: return join<JoinAlgorithm::HASH>(left_rows, right_rows);
+        case JoinAlgorithm::MERGE: return join<JoinAlgorithm::MERGE>(left_rows, right_rows);
+        case JoinAlgorithm::INDEX_NESTED_LOOP: break;
+    }
+    return CostComponents{};
+}
+
+// probe_cost: descending the inner index once (INDEX_LOOKUP_COST when its shape is unknown)
+constexpr CostComponents indexNestedLoop(double outer_rows, const TableStatsHandle& inner, double matches_per_probe,
+                                         double probe_cost = INDEX_LOOKUP_COST) {
+    CostComponents cost;
+    if (!inner.valid) return cost;
+    // Every outer row descends the index once, then fetches its matches with random I/O
+    double fetched = outer_rows * matches_per_probe;
+    cost.io_cost = outer_rows * probe_cost + fetched * RAND_PAGE_COST;
+    // CPU cost: outer tuples plus matched inner tuples
+    cost.cpu_cost = (outer_rows + fetched) * CPU_TUPLE_COST;
+    return cost;
+}
+
+constexpr CostComponents filter(double input_rows, double selectivity) {
+    CostComponents cost;
+    // CPU cost for evaluating predicates, minimal additional I/O for the survivors
+    cost.cpu_cost = input_rows * CPU_TUPLE_COST;
+    cost.io_cost = static_cast<double>(static_cast<size_t>(input_rows * selectivity)) * SEQ_PAGE_COST * 0.1;
+    return cost;
+}
+
+// Writing an intermediate result to a temporary table once: its pages written in
+// sequence and every value copied
+constexpr CostComponents materialize(double rows, double num_columns) {
+    CostComponents cost;
+    cost.io_cost = static_cast<double>(static_cast<size_t>((rows + 99.0) / 100.0)) * SEQ_PAGE_COST;
+    cost.cpu_cost = rows * num_columns * CPU_TUPLE_COST;
+    return cost;
+}
+
+constexpr CostComponents aggregation(double input_rows, double group_by_cols) {
+    CostComponents cost;
+    // CPU cost for grouping, memory for the group-by hash table
+    cost.cpu_cost = input_rows * group_by_cols * CPU_TUPLE_COST;
+    cost.memory_cost = input_rows * HASH_MEMORY_PER_TUPLE;
+    return cost;
+}
+
+// Hash-based DISTINCT: hash and probe every input row, keep one entry per distinct row
+constexpr CostComponents hashDistinct(double input_rows, double distinct_rows, double num_columns) {
+    CostComponents cost;
+    cost.cpu_cost = input_rows * (num_columns + 1) * CPU_TUPLE_COST;
+    cost.memory_cost = distinct_rows * num_columns * HASH_MEMORY_PER_TUPLE;
+    return cost;
+}
+
+// std::log2 is not constexpr before C++26, so sorting is only inline
+inline CostComponents sort(double num_tuples, double num_columns) {
+    CostComponents cost;
+    if (num_tuples < 1.0) return cost;
+    // External sort cost estimation (simplified), assuming 1000 tuples per page
+    double sort_passes = std::log2(num_tuples) / std::log2(1000.0);
+    cost.io_cost = num_tuples * sort_passes * RAND_PAGE_COST;
+    // CPU cost for comparisons
+    cost.cpu_cost = num_tuples * std::log2(num_tuples) * num_columns * CPU_TUPLE_COST;
+    return cost;
+}
+
+// ORDER BY ... LIMIT k: a bounded heap of k rows kept in memory, so no spill I/O
+// and each row costs log2(k) comparisons instead of log2(n)
+inline CostComponents topNSort(double num_tuples, double limit, double num_columns) {
+    CostComponents cost;
+    if (num_tuples < 1.0) return cost;
+    cost.cpu_cost = num_tuples * std::log2(limit < 2.0 ? 2.0 : limit) * num_columns * CPU_TUPLE_COST;
+    return cost;
+}
+
+// Sorting n/workers rows per thread, then a multiway merge of the sorted runs;
+// each worker also pays a fixed start-up cost
+inline CostComponents parallelSort(double num_tuples, double num_columns, double workers) {
+    constexpr double WORKER_STARTUP_COST = 50.0;
+    CostComponents cost = sort(num_tuples, num_columns);
+    if (workers <= 1.0 || num_tuples < 1.0) return cost;
+    cost.cpu_cost = sort(num_tuples / workers, num_columns).cpu_cost +
+                    num_tuples * std::log2(workers) * CPU_TUPLE_COST / workers +
+                    workers * WORKER_STARTUP_COST;
+    return cost;
+}
+
+// Sort-based DISTINCT: sort unless the input is already ordered, then compare
+// each row with its predecessor
+inline CostComponents sortDistinct(double input_rows, double num_columns, bool input_sorted) {
+    CostComponents cost = input_sorted ? CostComponents{} : sort(input_rows, num_columns);
+    cost.cpu_cost += input_rows * num_columns * CPU_TUPLE_COST;
+    return cost;
+}
+
+} // namespace cost_model
+
 class CostEstimator {
 private:
     std::shared_ptr<StatisticsManager> stats_mgr_;
 
-    // Cost constants (can be tuned)
-    static constexpr double SEQ_PAGE_COST = 1.0;
-    static constexpr double RAND_PAGE_COST = 4.0;
-    static constexpr double CPU_TUPLE_COST = 0.01;
-    static constexpr double INDEX_LOOKUP_COST = 2.0;
-    static constexpr double SORT_COST_PER_TUPLE = 0.1;
-
 public:
     explicit CostEstimator(std::shared_ptr<StatisticsManager> stats_mgr)
         : stats_mgr_(std::move(stats_mgr)) {}
 
+    // Resolve a table (case-insensitively) to the flat handle used by the cost functions
+    TableStatsHandle resolveTable(const std::string& table_name) const;
+
+    // ... by the id a bound query resolved it to (INVALID_ID: an invalid handle)
+    TableStatsHandle resolveTable(TableId table) const;
+
     // Table scan cost
-    CostComponents estimateTableScan(const std::string& table_name, double selectivity = 1.0);
+    CostComponents estimateTableScan(const TableStatsHandle& table, double selectivity = 1.0) const {
+        return cost_model::tableScan(table, selectivity);
+    }
 
     // Index scan cost
-    CostComponents estimateIndexScan(const std::string& table_name, const std::string& index_col,
-                                   double selectivity = 1.0);
+    CostComponents estimateIndexScan(const TableStatsHandle& table, double selectivity = 1.0) const {
+        return cost_model::indexScan(table, selectivity);
+    }
+
+    // Height and fanout of an index: its measured shape, or a disk B+tree's over the table
+    static std::pair<double, double> indexShape(const IndexInfo& index, const TableStatsHandle& table) {
+        if (index.height > 0 && index.fanout > 0.0) return {static_cast<double>(index.height), index.fanout};
+        return {cost_model::indexHeight(table.row_count, cost_model::DISK_INDEX_FANOUT), cost_model::DISK_INDEX_FANOUT};
+    }
+
+    // Lookup of the `selectivity` fraction of rows through a specific index
+    CostComponents estimateIndexLookup(const TableStatsHandle& table, const IndexInfo& index, double selectivity) const {
+        auto shape = indexShape(index, table);
+        return cost_model::indexLookup(table, shape.first, shape.second, selectivity);
+    }
 
     // Join cost estimation
     CostComponents estimateJoinCost(size_t left_rows, size_t right_rows,
-                                  const std::string& join_type = "nested_loop");
+                                    JoinAlgorithm algo = JoinAlgorithm::NESTED_LOOP) const {
+        return cost_model::join(algo, static_cast<double>(left_rows), static_cast<double>(right_rows));
+    }
+
+    // Index nested loop join: one index probe into the inner table per outer row
+    CostComponents estimateIndexNestedLoopCost(size_t outer_rows, const TableStatsHandle& inner,
+                                               double matches_per_probe) const {
+        return cost_model::indexNestedLoop(static_cast<double>(outer_rows), inner, matches_per_probe);
+    }
+
+    // ... probing a specific index, priced by its height
+    CostComponents estimateIndexNestedLoopCost(size_t outer_rows, const TableStatsHandle& inner,
+                                               double matches_per_probe, const IndexInfo& index) const {
+        double probe = indexShape(index, inner).first * cost_model::INDEX_NODE_COST;
+        return cost_model::indexNestedLoop(static_cast<double>(outer_rows), inner, matches_per_probe, probe);
+    }
 
     // Sort cost
-    CostComponents estimateSortCost(size_t num_tuples, size_t num_columns);
+    CostComponents estimateSortCost(size_t num_tuples, size_t num_columns) const {
+        return cost_model::sort(static_cast<double>(num_tuples), static_cast<double>(num_columns));
+    }
+
+    // Sort keeping only the first `limit` rows
+    CostComponents estimateTopNSortCost(size_t num_tuples, size_t limit, size_t num_columns) const {
+        return cost_model::topNSort(static_cast<double>(num_tuples), static_cast<double>(limit),
+                                    static_cast<double>(num_columns));
+    }
+
+    // Sort spread over worker threads
+    CostComponents estimateParallelSortCost(size_t num_tuples, size_t num_columns, size_t workers) const {
+        return cost_model::parallelSort(static_cast<double>(num_tuples), static_cast<double>(num_columns),
+                                        static_cast<double>(workers));
+    }
+
+    // DISTINCT cost for either algorithm
+    CostComponents estimateDistinctCost(size_t input_rows, size_t distinct_rows, size_t num_columns,
+                                        DistinctAlgorithm algo, bool input_sorted = false) const {
+        if (algo == DistinctAlgorithm::HASH) {
+            return cost_model::hashDistinct(static_cast<double>(input_rows), static_cast<double>(distinct_rows),
+                                            static_cast<double>(num_columns));
+        }
+        return cost_model::sortDistinct(static_cast<double>(input_rows), static_cast<double>(num_columns),
+                                        input_sorted);
+    }
 
     // Aggregation cost
-    CostComponents estimateAggregationCost(size_t input_rows, size_t group_by_cols);
+    CostComponents estimateAggregationCost(size_t input_rows, size_t group_by_cols) const {
+        return cost_model::aggregation(static_cast<double>(input_rows), static_cast<double>(group_by_cols));
+    }
 
     // Filter cost
-    CostComponents estimateFilterCost(size_t input_rows, double selectivity);
+    CostComponents estimateFilterCost(size_t input_rows, double selectivity) const {
+        return cost_model::filter(static_cast<double>(input_rows), selectivity);
+    }
 
     // Combined operation cost
-    CostComponents estimateQueryCost(const std::vector<std::string>& operations,
-                                   const std::vector<size_t>& cardinalities);
+    CostComponents estimateQueryCost(const std::vector<PlanNodeType>& operations,
+                                     const std::vector<size_t>& cardinalities) const;
 
     // Utility functions
     double getPageCount(const std::string& table_name) const;
@@ -0,0 +1,58 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+#include "column_store.h"
+#include "stats.h"
+
+namespace sqlopt {
+
+struct GeneratedTable; // column recipes of one table, in data_generator.cpp
+
+struct DataGenOptions {
+    double scale = 1.0;  // multiplies every table's row count and its key-like NDVs
+    double zipf = 0.0;   // skew of foreign keys and categories; 0 is uniform
+    uint64_t seed = 42;
+    size_t threads = 0;  // 0: one per hardware thread
+};
+
+// Synthetic data for the StatsCatalog::load_defaults schema: users, orders,
+// products, customers and order_items, with the catalog's row counts and NDVs.
+//
+// Every value is a pure function of (seed, table, column, row), so tables come out
+// identical at any thread count and can be produced in parallel by row range or by
+// column. Foreign keys reference existing rows and follow a Zipf distribution over
+// a shuffled key order. Columns are correlated the way real order data is:
+// order_date rises with the order id, recent orders are more often 'pending' or
+// 'shipped', order_amount grows with the ordering user's age, and order_items are
+// clustered by order.
+class DataGenerator {
+public:
+    explicit DataGenerator(const StatsCatalog& catalog, DataGenOptions options = {});
+    ~DataGenerator();
+
+    std::vector<std::string> tableNames() const;
+    size_t rowCount(const std::string& table) const;
+
+    // Tab separated with a header line, as ColumnStore::loadFromFile reads and
+    // LOAD DATA ... IGNORE 1 LINES loads
+    bool writeTsv(const std::string& table, const std::string& path, std::string& error) const;
+
+    // Generate straight into a column store table, one column per thread
+    bool load(ColumnStore& store, const std::string& table, std::string& error) const;
+
+    // CREATE TABLE and LOAD DATA LOCAL INFILE statements for the files writeTsv
+    // leaves in `dir`, with the catalog's indexes
+    std::string mysqlScript(const std::string& dir) const;
+
+private:
+    DataGenOptions options_;
+    std::vector<std::unique_ptr<GeneratedTable>> tables_;
+
+    const GeneratedTable* find(const std::string& table) const;
+    size_t threadCount() const;
+};
+
+} // namespace sqlopt
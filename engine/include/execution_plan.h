@@ -3,6 +3,7 @@
 #include <vector>
 #include <string>
 #include <iostream>
+#include "condition_pool.h"
 
 namespace sqlopt {
 
@@ -25,9 +26,38 @@ enum class PlanNodeType {
     PROJECT,
     SORT,
     AGGREGATE,
+    DISTINCT,
     LIMIT
 };
 
+// Physical join algorithms
+enum class JoinAlgorithm {
+    NESTED_LOOP,
+    INDEX_NESTED_LOOP,
+    HASH,
+    MERGE
+};
+
+inline const char* join_algorithm_name(JoinAlgorithm algo) {
+    switch (algo) {
+        case JoinAlgorithm::NESTED_LOOP: return "nested_loop";
+        case JoinAlgorithm::INDEX_NESTED_LOOP: return "index_nested_loop";
+        case JoinAlgorithm::HASH: return "hash_join";
+        case JoinAlgorithm::MERGE: return "merge_join";
+    }
+    return "nested_loop";
+}
+
+// Duplicate elimination strategies
+enum class DistinctAlgorithm {
+    HASH, // hash set of the distinct rows seen so far
+    SORT  // streaming comparison with the previous row over sorted input
+};
+
+inline const char* distinct_algorithm_name(DistinctAlgorithm algo) {
+    return algo == DistinctAlgorithm::HASH ? "hash" : "sort";
+}
+
 // Base plan node
 struct PlanNode {
     PlanNodeType type;
@@ -35,16 +65,33 @@ struct PlanNode {
     size_t estimated_cardinality = 0;
     std::vector<std::string> output_columns;
 
+    // Measured when the plan runs natively, for EXPLAIN ANALYZE (-1: not run)
+    mutable long long actual_rows = -1;
+    mutable size_t chunks_total = 0;   // storage chunks a scan had to consider
+    mutable size_t chunks_skipped = 0; // ... of which the zone maps ruled out
+
     PlanNode(PlanNodeType t) : type(t) {}
     virtual ~PlanNode() = default;
 
     virtual void explain(int indent = 0) const = 0;
+
+    // " [actual rows=.., chunks skipped=s/n]" once the node has run, empty before
+    std::string actualSummary() const {
+        if (actual_rows < 0) return "";
+        std::string s = " [actual rows=" + std::to_string(actual_rows);
+        if (chunks_total > 0) s += ", chunks skipped=" + std::to_string(chunks_skipped) + "/" + std::to_string(chunks_total);
+        return s + "]";
+    }
 };
 
 // Table scan node
 struct ScanNode : PlanNode {
     std::string table;
     std::string alias;
+    // WHERE conditions on this table alone. A native scan skips the chunks whose zone
+    // maps show no row can satisfy them; the Filter above still evaluates them.
+    std::vector<std::string> filters;
+    RefId ref = INVALID_REF; // table reference of the bound query it was planned for
 
     ScanNode(const std::string& t, const std::string& a = "")
         : PlanNode(PlanNodeType::SCAN), table(t), alias(a) {}
@@ -52,7 +99,8 @@ struct ScanNode : PlanNode {
     void explain(int indent = 0) const override {
         std::cout << std::string(indent, ' ') << "Scan(table=" << table;
         if (!alias.empty()) std::cout << " AS " << alias;
-        std::cout << ", rows=" << estimated_cardinality << ", cost=" << estimated_cost << ")\n";
+        if (!filters.empty()) std::cout << ", zone filters=" << filters.size();
+        std::cout << ", rows=" << estimated_cardinality << ", cost=" << estimated_cost << ")" << actualSummary() << "\n";
     }
 };
 
@@ -61,6 +109,14 @@ struct IndexScanNode : PlanNode {
     std::string table;
     std::string alias;
     std::string index_column;
+    bool ordered = false;    // walks the whole index in key order to feed an ORDER BY
+    bool descending = false; // ... from the last key backwards
+    // Conditions on index_column that bound the lookup ("o.order_date >= '2023-06-01'",
+    // "u.name LIKE 'ab%'"); empty for a walk over the whole index. The Filter above
+    // still checks them.
+    std::vector<std::string> key_conditions;
+    std::vector<std::string> filters; // as ScanNode::filters, for native runs of whole-index walks
+    RefId ref = INVALID_REF;          // as ScanNode::ref
 
     IndexScanNode(const std::string& t, const std::string& idx_col, const std::string& a = "")
         : PlanNode(PlanNodeType::INDEX_SCAN), table(t), alias(a), index_column(idx_col) {}
@@ -68,23 +124,27 @@ struct IndexScanNode : PlanNode {
     void explain(int indent = 0) const override {
         std::cout << std::string(indent, ' ') << "IndexScan " << table << " using " << index_column;
         if (!alias.empty()) std::cout << " AS " << alias;
-        std::cout << " (cost: " << estimated_cost << ", rows: " << estimated_cardinality << ")\n";
+        if (ordered) std::cout << (descending ? " [ordered desc]" : " [ordered]");
+        for (size_t i = 0; i < key_conditions.size(); ++i) std::cout << (i == 0 ? " where " : " and ") << key_conditions[i];
+        if (!filters.empty()) std::cout << ", zone filters=" << filters.size();
+        std::cout << " (cost: " << estimated_cost << ", rows: " << estimated_cardinality << ")" << actualSummary() << "\n";
     }
 };
 
 // Join node
 struct JoinNode : PlanNode {
     std::string join_type; // "inner", "left", "right", "full"
+    JoinAlgorithm algorithm = JoinAlgorithm::NESTED_LOOP;
     std::unique_ptr<PlanNode> left;
     std::unique_ptr<PlanNode> right;
-    std::vector<std::string> conditions;
+    ConditionList conditions;
 
-    JoinNode(const std::string& jt, std::unique_ptr<PlanNode> l, std::unique_ptr<PlanNode> r,
-             const std::vector<std::string>& conds)
-        : PlanNode(PlanNodeType::JOIN), join_type(jt), left(std::move(l)), right(std::move(r)), conditions(conds) {}
+    JoinNode(const std::string& jt, std::unique_ptr<PlanNode> l, std::unique_ptr<PlanNode> r, ConditionList conds)
+        : PlanNode(PlanNodeType::JOIN), join_type(jt), left(std::move(l)), right(std::move(r)),
+          conditions(std::move(conds)) {}
 
     void explain(int indent = 0) const override {
-        std::cout << std::string(indent, ' ') << join_type << " Join(algo=" << join_type << ", rows=" << estimated_cardinality << ", cost=" << estimated_cost << ")\n";
+        std::cout << std::string(indent, ' ') << join_type << " Join(algo=" << join_algorithm_name(algorithm) << ", rows=" << estimated_cardinality << ", cost=" << estimated_cost << ")" << actualSummary() << "\n";
         if (left) {
             try {
                 left->explain(indent + 2);
@@ -105,14 +165,14 @@ struct JoinNode : PlanNode {
 // Filter node
 struct FilterNode : PlanNode {
     std::unique_ptr<PlanNode> child;
-    std::vector<std::string> conditions;
+    ConditionList conditions;
 
-    FilterNode(std::unique_ptr<PlanNode> c, const std::vector<std::string>& conds)
-        : PlanNode(PlanNodeType::FILTER), child(std::move(c)), conditions(conds) {}
+    FilterNode(std::unique_ptr<PlanNode> c, ConditionList conds)
+        : PlanNode(PlanNodeType::FILTER), child(std::move(c)), conditions(std::move(conds)) {}
 
     void explain(int indent = 0) const override {
         std::cout << std::string(indent, ' ') << "Filter";
-        std::cout << " (cost: " << estimated_cost << ", rows: " << estimated_cardinality << ")\n";
+        std::cout << " (cost: " << estimated_cost << ", rows: " << estimated_cardinality << ")" << actualSummary() << "\n";
         if (child) child->explain(indent + 2);
     }
 };
@@ -122,8 +182,8 @@ struct ProjectNode : PlanNode {
     std::unique_ptr<PlanNode> child;
     std::vector<std::string> projections;
 
-    ProjectNode(std::unique_ptr<PlanNode> c, const std::vector<std::string>& projs)
-        : PlanNode(PlanNodeType::PROJECT), child(std::move(c)), projections(projs) {}
+    ProjectNode(std::unique_ptr<PlanNode> c, std::vector<std::string> projs)
+        : PlanNode(PlanNodeType::PROJECT), child(std::move(c)), projections(std::move(projs)) {}
 
     void explain(int indent = 0) const override {
         std::cout << std::string(indent, ' ') << "Project(rows=" << estimated_cardinality << ", cost=" << estimated_cost << ", items=[";
@@ -132,7 +192,7 @@ struct ProjectNode : PlanNode {
             if (i + 1 < projections.size() && i + 1 < 3) std::cout << ", ";
         }
         if (projections.size() > 3) std::cout << "...";
-        std::cout << "])\n";
+        std::cout << "])" << actualSummary() << "\n";
         if (child) {
             try {
                 child->explain(indent + 2);
@@ -148,14 +208,17 @@ struct SortNode : PlanNode {
     std::unique_ptr<PlanNode> child;
     std::vector<std::string> sort_keys;
     std::vector<bool> ascending;
+    size_t parallel_workers = 1; // > 1: chunked sort on worker threads plus multiway merge
+    size_t top_n = 0;            // > 0: only the first top_n rows are kept (bounded heap)
 
-    SortNode(std::unique_ptr<PlanNode> c, const std::vector<std::string>& keys,
-             const std::vector<bool>& asc)
-        : PlanNode(PlanNodeType::SORT), child(std::move(c)), sort_keys(keys), ascending(asc) {}
+    SortNode(std::unique_ptr<PlanNode> c, std::vector<std::string> keys, std::vector<bool> asc)
+        : PlanNode(PlanNodeType::SORT), child(std::move(c)), sort_keys(std::move(keys)), ascending(std::move(asc)) {}
 
     void explain(int indent = 0) const override {
         std::cout << std::string(indent, ' ') << "Sort";
-        std::cout << " (cost: " << estimated_cost << ", rows: " << estimated_cardinality << ")\n";
+        if (parallel_workers > 1) std::cout << " [parallel, workers=" << parallel_workers << "]";
+        if (top_n > 0) std::cout << " [top-N, n=" << top_n << "]";
+        std::cout << " (cost: " << estimated_cost << ", rows: " << estimated_cardinality << ")" << actualSummary() << "\n";
         if (child) child->explain(indent + 2);
     }
 };
@@ -166,13 +229,30 @@ struct AggregateNode : PlanNode {
     std::vector<std::string> group_by;
     std::vector<std::string> aggregates;
 
-    AggregateNode(std::unique_ptr<PlanNode> c, const std::vector<std::string>& gb,
-                  const std::vector<std::string>& aggs)
-        : PlanNode(PlanNodeType::AGGREGATE), child(std::move(c)), group_by(gb), aggregates(aggs) {}
+    AggregateNode(std::unique_ptr<PlanNode> c, std::vector<std::string> gb, std::vector<std::string> aggs)
+        : PlanNode(PlanNodeType::AGGREGATE), child(std::move(c)), group_by(std::move(gb)), aggregates(std::move(aggs)) {}
 
     void explain(int indent = 0) const override {
         std::cout << std::string(indent, ' ') << "Aggregate";
-        std::cout << " (cost: " << estimated_cost << ", rows: " << estimated_cardinality << ")\n";
+        std::cout << " (cost: " << estimated_cost << ", rows: " << estimated_cardinality << ")" << actualSummary() << "\n";
+        if (child) child->explain(indent + 2);
+    }
+};
+
+// Distinct node
+struct DistinctNode : PlanNode {
+    std::unique_ptr<PlanNode> child;
+    std::vector<std::string> columns; // projected columns, empty for SELECT *
+    DistinctAlgorithm algorithm = DistinctAlgorithm::HASH;
+    bool input_sorted = false;        // sort-based over input already in column order
+
+    DistinctNode(std::unique_ptr<PlanNode> c, std::vector<std::string> cols)
+        : PlanNode(PlanNodeType::DISTINCT), child(std::move(c)), columns(std::move(cols)) {}
+
+    void explain(int indent = 0) const override {
+        std::cout << std::string(indent, ' ') << "Distinct(algo=" << distinct_algorithm_name(algorithm);
+        if (algorithm == DistinctAlgorithm::SORT && input_sorted) std::cout << ", presorted";
+        std::cout << ", rows=" << estimated_cardinality << ", cost=" << estimated_cost << ")" << actualSummary() << "\n";
         if (child) child->explain(indent + 2);
     }
 };
@@ -187,7 +267,7 @@ struct LimitNode : PlanNode {
 
     void explain(int indent = 0) const override {
         std::cout << std::string(indent, ' ') << "Limit " << limit_count;
-        std::cout << " (cost: " << estimated_cost << ", rows: " << estimated_cardinality << ")\n";
+        std::cout << " (cost: " << estimated_cost << ", rows: " << estimated_cardinality << ")" << actualSummary() << "\n";
         if (child) child->explain(indent + 2);
     }
 };
@@ -200,6 +280,7 @@ private:
     size_t total_cardinality_ = 0;
     std::vector<std::string> used_indexes_;
     std::string original_query_;
+    bool known_empty_ = false; // the WHERE can never hold: the query returns no rows
 
 public:
     ExecutionPlan() = default;
@@ -216,7 +297,8 @@ public:
           total_cost_(other.total_cost_),
           total_cardinality_(other.total_cardinality_),
           used_indexes_(std::move(other.used_indexes_)),
-          original_query_(std::move(other.original_query_)) {}
+          original_query_(std::move(other.original_query_)),
+          known_empty_(other.known_empty_) {}
 
     // Move assignment
     ExecutionPlan& operator=(ExecutionPlan&& other) noexcept {
@@ -226,6 +308,7 @@ public:
             total_cardinality_ = other.total_cardinality_;
             used_indexes_ = std::move(other.used_indexes_);
             original_query_ = std::move(other.original_query_);
+            known_empty_ = other.known_empty_;
         }
         return *this;
     }
@@ -236,17 +319,20 @@ public:
     const std::vector<std::string>& getUsedIndexes() const { return used_indexes_; }
     const PlanNode* getRoot() const { return root_.get(); }
     std::string getOriginalQuery() const { return original_query_; }
+    bool isKnownEmpty() const { return known_empty_; }
 
     // Setters
     void setCost(double cost) { total_cost_ = cost; }
     void setCardinality(size_t card) { total_cardinality_ = card; }
     void addUsedIndex(const std::string& index) { used_indexes_.push_back(index); }
     void setOriginalQuery(const std::string& query) { original_query_ = query; }
+    void setKnownEmpty(bool empty) { known_empty_ = empty; }
 
     // Explain plan
     void explain() const {
         std::cout << "Execution Plan (Total Cost: " << total_cost_
                   << ", Estimated Rows: " << total_cardinality_ << ")\n";
+        if (known_empty_) std::cout << "  (WHERE is never true: returns no rows without running)\n";
         if (root_) {
             try {
                 root_->explain(2);
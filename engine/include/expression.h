@@ -0,0 +1,65 @@
+#pragma once
+#include <functional>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace sqlopt {
+
+enum class ExprKind {
+    COLUMN,     // text: "u.age" or "age"
+    NUMBER,     // text as written
+    STRING,     // text without the quotes
+    NULL_VALUE,
+    STAR,       // the argument of COUNT(*)
+    UNARY,      // text: "-" or "NOT"; one child
+    BINARY,     // text: the operator, keywords upper-cased ("AND", "LIKE", "NOT LIKE"); two children
+    IS_NULL,    // text: "IS NULL" or "IS NOT NULL"; one child
+    BETWEEN,    // text: "BETWEEN" or "NOT BETWEEN"; operand, low, high
+    IN_LIST,    // text: "IN" or "NOT IN"; operand, then the values or one SUBQUERY
+    FUNCTION,   // text: upper-cased name; children are the arguments. DATE '2024-01-01' is DATE('2024-01-01')
+    SUBQUERY,   // text: the SELECT inside the parentheses
+    INTERVAL    // text: the upper-cased unit ("DAY"); one child, the amount
+};
+
+struct Expr;
+using ExprPtr = std::shared_ptr<const Expr>;
+
+// Expression tree over the text the parser keeps for select items, conditions and
+// sort keys. Nodes are immutable, so rewrites share the subtrees they keep.
+struct Expr {
+    ExprKind kind;
+    std::string text;
+    std::vector<ExprPtr> children;
+    bool distinct = false;  // COUNT(DISTINCT x)
+    // SUBQUERY: lower-cased tokens with the subquery's own aliases replaced by their
+    // tables, so copies that name their tables differently compare equal
+    std::string canonical;
+    // Structural hash: equal trees hash equal, commutative operands in either order
+    size_t hash = 0;
+};
+
+ExprPtr make_expression(ExprKind kind, std::string text, std::vector<ExprPtr> children = {}, bool distinct = false);
+
+// nullptr when the text uses syntax the tree does not model (CASE, window functions)
+ExprPtr parse_expression(const std::string& text);
+
+// SQL for the tree: qualified columns as "u.age", binary operators spaced,
+// parentheses only where precedence needs them
+std::string expression_to_sql(const Expr& e);
+
+// Same structure: kinds, operators, identifiers (case-insensitively), literals and
+// children match, the operands of commutative operators in either order
+bool same_expression(const Expr& a, const Expr& b);
+
+// Aggregate function call: COUNT, SUM, AVG, MIN, MAX, GROUP_CONCAT
+bool is_aggregate(const Expr& e);
+
+// Calls fn on every node, parents before children
+void visit_expression(const Expr& e, const std::function<void(const Expr&)>& fn);
+
+// The tree with every node for which fn returns a replacement swapped for it; the
+// children of a replaced node are not visited
+ExprPtr replace_subexpressions(const ExprPtr& e, const std::function<ExprPtr(const Expr&)>& fn);
+
+} // namespace sqlopt
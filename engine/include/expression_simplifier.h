@@ -0,0 +1,44 @@
+#pragma once
+#include <string>
+#include <vector>
+#include "expression.h"
+
+namespace sqlopt {
+
+// Constant folding and boolean simplification over expression trees. Folds
+// arithmetic and comparisons on numeric literals exactly (as decimals), date
+// arithmetic on constant dates ('2024-01-31' + INTERVAL 1 MONTH, DATE_SUB(...)),
+// and the identities x AND TRUE, x OR FALSE, x AND FALSE, x OR TRUE, x AND x and
+// NOT NOT x; NOT over a comparison inverts it. A comparison of a column moved by a
+// constant is solved for the column (o.d + INTERVAL 7 DAY > '2024-01-10' becomes
+// o.d > '2024-01-03', u.age + 1 >= 30 becomes u.age >= 29) so index ranges apply.
+//
+// condition: e is a WHERE, HAVING or ON condition, where only truth matters; the
+// identities then also apply to operands that are not predicates (5 AND TRUE).
+ExprPtr simplify_expression(const ExprPtr& e, bool condition);
+
+// The operands of the top-level ANDs
+std::vector<ExprPtr> split_conjuncts(const ExprPtr& e);
+
+// Negations pushed down to the atoms (NOT (a AND b) is NOT a OR NOT b, NOT a > 1 is
+// a <= 1), then the atoms every branch of an OR shares factored out:
+// (a AND b) OR (a AND c) becomes a AND (b OR c), and a OR (a AND b) becomes a.
+// Both hold under three-valued logic, so the result is equivalent as a condition.
+ExprPtr factor_condition(const ExprPtr& e);
+
+// Conjunctive normal form as clauses of OR-ed atoms, duplicate and subsumed clauses
+// removed; empty when it would take more than max_clauses clauses
+std::vector<std::vector<ExprPtr>> to_cnf(const ExprPtr& e, size_t max_clauses);
+
+// Disjunctive normal form as terms of AND-ed atoms, likewise bounded by max_terms
+std::vector<std::vector<ExprPtr>> to_dnf(const ExprPtr& e, size_t max_terms);
+
+// OR of the atoms of a clause (AND for a term), folded back into one tree
+ExprPtr join_atoms(const std::vector<ExprPtr>& atoms, const char* op);
+
+// Why the conjuncts can never all hold, or empty when they might: one folded to
+// FALSE or NULL, a column has disjoint ranges or different equalities (a > 5 AND
+// a < 3, a = 1 AND a = 2, a = 1 AND a <> 1), or IS NULL next to a comparison.
+std::string find_contradiction(const std::vector<ExprPtr>& conjuncts);
+
+} // namespace sqlopt
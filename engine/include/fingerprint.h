@@ -0,0 +1,16 @@
+#pragma once
+#include <cstdint>
+#include <string>
+
+namespace sqlopt {
+
+// Normalized form of a statement: literals replaced by '?', IN lists collapsed,
+// keywords and identifiers lower-cased and whitespace squeezed. Queries that only
+// differ in their constants share a fingerprint.
+std::string fingerprint_query(const std::string& sql);
+
+// Short stable id for a fingerprint (FNV-1a), printed as 16 hex digits
+uint64_t fingerprint_id(const std::string& fingerprint);
+std::string fingerprint_id_hex(const std::string& fingerprint);
+
+} // namespace sqlopt
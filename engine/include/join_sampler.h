@@ -0,0 +1,36 @@
+#pragma once
+#include <cstddef>
+#include <memory>
+#include <vector>
+#include "ast.h"
+#include "bound_query.h"
+#include "column_store.h"
+
+namespace sqlopt {
+
+// Join sizes measured on a sample of the loaded tables (index-based join sampling).
+// A uniform sample of the FROM table's rows is joined one table at a time, in query
+// order, by probing the in-memory index on the joined table's key column; whenever
+// the join results outgrow the sample size they are resampled down to it. Each
+// step's result count, scaled by the number of real rows one sampled tuple stands
+// for, estimates the rows after that join, so correlated and skewed join keys are
+// seen directly rather than assumed away.
+class JoinSampler {
+public:
+    static constexpr size_t DEFAULT_SAMPLE_ROWS = 1000;
+
+    explicit JoinSampler(std::shared_ptr<const ColumnStore> store, size_t sample_rows = DEFAULT_SAMPLE_ROWS)
+        : store_(std::move(store)), sample_rows_(sample_rows > 0 ? sample_rows : 1) {}
+
+    // Estimated rows after each of query.joins, in order, with `bound` bound to query.
+    // Join keys are the join edges of each ON condition. Sampling stops at the first
+    // join without an edge to an indexed column of a loaded table, so fewer estimates
+    // than joins (none, when the FROM table is not loaded) may come back.
+    std::vector<double> estimateJoins(const SelectQuery& query, const BoundQuery& bound) const;
+
+private:
+    std::shared_ptr<const ColumnStore> store_;
+    size_t sample_rows_;
+};
+
+} // namespace sqlopt
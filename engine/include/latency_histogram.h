@@ -0,0 +1,77 @@
+#pragma once
+#include <algorithm>
+#include <cstdint>
+#include <vector>
+
+namespace sqlopt {
+
+// HDR-style latency histogram: each power-of-two range is split into 128 linear
+// sub-buckets, so any recorded value is reported within 1% of its true value.
+// Values are microseconds. Recording is O(1) and histograms merge by addition.
+class LatencyHistogram {
+private:
+    static constexpr int SUB_BUCKET_BITS = 7;
+    static constexpr uint64_t SUB_BUCKETS = uint64_t(1) << SUB_BUCKET_BITS;
+    static constexpr int RANGES = 64 - SUB_BUCKET_BITS + 1;
+
+    std::vector<uint64_t> counts_;
+    uint64_t total_ = 0;
+    uint64_t max_ = 0;
+    uint64_t min_ = UINT64_MAX;
+    double sum_ = 0.0;
+
+    static size_t bucketIndex(uint64_t value) {
+        if (value < SUB_BUCKETS) return static_cast<size_t>(value);
+        int msb = 63 - __builtin_clzll(value);
+        int range = msb - SUB_BUCKET_BITS + 1;
+        uint64_t sub = (value >> range) & (SUB_BUCKETS - 1);
+        return static_cast<size_t>(range) * SUB_BUCKETS + static_cast<size_t>(sub);
+    }
+
+    // Upper edge of a bucket, the value reported for anything recorded in it
+    static uint64_t bucketValue(size_t index) {
+        size_t range = index / SUB_BUCKETS;
+        uint64_t sub = index % SUB_BUCKETS;
+        if (range == 0) return sub;
+        return (sub << range) + ((uint64_t(1) << range) - 1);
+    }
+
+public:
+    LatencyHistogram() : counts_(static_cast<size_t>(RANGES) * SUB_BUCKETS, 0) {}
+
+    void record(uint64_t micros) {
+        ++counts_[bucketIndex(micros)];
+        ++total_;
+        sum_ += static_cast<double>(micros);
+        max_ = std::max(max_, micros);
+        min_ = std::min(min_, micros);
+    }
+
+    void merge(const LatencyHistogram& other) {
+        for (size_t i = 0; i < counts_.size(); ++i) counts_[i] += other.counts_[i];
+        total_ += other.total_;
+        sum_ += other.sum_;
+        max_ = std::max(max_, other.max_);
+        min_ = std::min(min_, other.min_);
+    }
+
+    uint64_t count() const { return total_; }
+    uint64_t max() const { return total_ ? max_ : 0; }
+    uint64_t min() const { return total_ ? min_ : 0; }
+    double mean() const { return total_ ? sum_ / total_ : 0.0; }
+
+    // Value at the given percentile (0-100)
+    uint64_t percentile(double p) const {
+        if (total_ == 0) return 0;
+        uint64_t rank = static_cast<uint64_t>(p / 100.0 * total_ + 0.5);
+        rank = std::max<uint64_t>(1, std::min(rank, total_));
+        uint64_t seen = 0;
+        for (size_t i = 0; i < counts_.size(); ++i) {
+            seen += counts_[i];
+            if (seen >= rank) return std::min(bucketValue(i), max_);
+        }
+        return max_;
+    }
+};
+
+} // namespace sqlopt
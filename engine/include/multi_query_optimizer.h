@@ -0,0 +1,54 @@
+#pragma once
+#include <memory>
+#include <string>
+#include <vector>
+#include "ast.h"
+#include "optimizer.h"
+#include "statistics_manager.h"
+
+namespace sqlopt {
+
+// A join or filtered scan that several queries of a batch compute identically,
+// materialized once into a temporary table the consumers read instead
+struct SharedSubplan {
+    std::string name;                       // temporary table, "mqo_1"
+    SelectQuery query;                      // the shared work; its columns are named table_column
+    OptimizeResult optimized;               // plan and SQL for computing it
+    std::vector<size_t> consumers;          // positions in the batch
+    std::vector<std::string> other_tables;  // tables the consumers join with it
+    TableStatistics stats;                  // estimated statistics of the materialized rows
+    double cost = 0.0;                      // computing it once
+    double materialize_cost = 0.0;          // writing it to the temporary table
+    double savings = 0.0;                   // recomputation avoided, less materialize_cost
+};
+
+struct BatchOptimizeResult {
+    std::vector<SharedSubplan> shared;   // materialize these first, in order
+    std::vector<OptimizeResult> queries; // the batch, consumers reading the shared results
+    double independent_cost = 0.0;       // every query optimized on its own
+    double batch_cost = 0.0;             // shared results once, plus the rewritten queries
+    std::string log;
+};
+
+// Multi-query optimization for a batch of SELECTs. Every connected set of up to
+// four inner-joined tables of a query, together with the join and filter conditions
+// local to it, is keyed by table names rather than aliases; sets with the same key
+// in several queries are common subexpressions. They are taken greedily by the
+// recomputation they save net of materializing them, without overlapping inside a
+// query, and each consumer is rewritten to join the temporary table in place of
+// the tables it covers. Queries with outer joins, subqueries, SELECT *, a table
+// listed twice or unqualified columns are optimized on their own.
+class MultiQueryOptimizer {
+public:
+    explicit MultiQueryOptimizer(std::shared_ptr<StatisticsManager> stats_mgr);
+
+    BatchOptimizeResult optimize(const std::vector<SelectQuery>& batch) const;
+
+    // CREATE TEMPORARY TABLE ... AS SELECT for materializing a shared result on MySQL
+    static std::string materializeSQL(const SharedSubplan& shared);
+
+private:
+    std::shared_ptr<StatisticsManager> stats_mgr_;
+};
+
+} // namespace sqlopt
@@ -1,5 +1,6 @@
 #pragma once
 #include <mysql/mysql.h>
+#include <functional>
 #include <memory>
 #include <string>
 #include <vector>
@@ -24,17 +25,46 @@ public:
     bool selectDatabase(const std::string& database);
 
     // Query execution
+    // Type of a result column as the server reported it in its MYSQL_FIELD
+    struct FieldInfo {
+        std::string table;  // alias of the table it comes from; empty for an expression
+        enum_field_types type = MYSQL_TYPE_VAR_STRING;
+        unsigned int flags = 0;
+        unsigned int charsetnr = 0;  // collation id; 63 is binary
+        unsigned long length = 0;
+        unsigned int decimals = 0;
+    };
+
     struct QueryResult {
         std::vector<std::vector<std::string>> rows;
         std::vector<std::string> columns;
+        std::vector<FieldInfo> column_types;  // one per column
+        // Which values are SQL NULL, one flag per column of each row; rows hold "NULL"
+        // there, which a string 'NULL' also reads as. Filled by executeQuery only.
+        std::vector<std::vector<bool>> null_flags;
         unsigned long long affected_rows;
         std::string error_message;
         bool success;
+        bool cancelled = false; // a streamed statement stopped early by its consumer
     };
 
     QueryResult executeQuery(const std::string& sql);
     bool executeStatement(const std::string& sql);
 
+    // A batch of rows of a streamed result; returning false stops the statement
+    using RowBatchFn = std::function<bool(const std::vector<std::string>& columns,
+                                          const std::vector<std::vector<std::string>>& rows)>;
+
+    // Runs sql and hands its rows to on_rows in batches of up to batch_rows as the
+    // server sends them, instead of after the last one. When on_rows returns false
+    // the statement is cancelled with cancelQuery() and its remaining rows are
+    // discarded. rows stays empty; affected_rows counts the rows handed over.
+    QueryResult streamQuery(const std::string& sql, size_t batch_rows, const RowBatchFn& on_rows);
+
+    // KILL QUERY for the statement running on this connection, sent from a side
+    // connection opened with the same credentials
+    bool cancelQuery();
+
     // Schema information
     struct TableInfo {
         std::string name;
@@ -62,10 +92,15 @@ public:
 private:
     MYSQL* mysql_;
     bool connected_;
+    // Kept for the side connection of cancelQuery()
+    std::string host_, user_, password_;
+    unsigned int port_ = 3306;
 
     // Helper methods
     void freeResult(MYSQL_RES* result);
     std::vector<std::string> fetchRow(MYSQL_ROW row, unsigned int num_fields);
+    static std::vector<bool> nullFlags(MYSQL_ROW row, unsigned int num_fields);
+    static FieldInfo fieldInfo(const MYSQL_FIELD& field);
 };
 
 } // namespace sqlopt
@@ -0,0 +1,37 @@
+#pragma once
+#include <memory>
+#include <string>
+#include <vector>
+#include "column_store.h"
+#include "execution_plan.h"
+
+namespace sqlopt {
+
+// Runs plans over tables loaded into a ColumnStore instead of sending SQL to MySQL.
+//
+// Operators exchange row ids only (one per joined table), never values: scans emit
+// ids, filters and join keys read just the columns they test, and the projected
+// columns are fetched by row id once the final filter, limit or top-N has run.
+class NativeExecutor {
+public:
+    explicit NativeExecutor(std::shared_ptr<const ColumnStore> store) : store_(std::move(store)) {}
+
+    struct Result {
+        std::vector<std::string> columns;
+        std::vector<std::vector<std::string>> rows;
+        size_t values_read = 0;         // column values read by filters, join keys and sort keys
+        size_t values_materialized = 0; // values fetched for the output rows
+    };
+
+    // False, with the reason in `error`, when the plan reads a table that is not
+    // loaded or uses an operator or expression not supported natively
+    bool execute(const PlanNode* root, Result& result, std::string& error) const;
+
+    // Every table the plan scans is loaded
+    bool canExecute(const PlanNode* root) const;
+
+private:
+    std::shared_ptr<const ColumnStore> store_;
+};
+
+} // namespace sqlopt
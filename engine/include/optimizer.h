@@ -15,6 +15,7 @@ struct OptimizeResult {
     ExecutionPlan plan;
     std::string log;
     std::string rewritten_sql;
+    double original_cost = 0.0; // best plan cost for the query as written
 };
 
 class Optimizer {
@@ -25,7 +26,13 @@ class Optimizer {
 
 public:
     explicit Optimizer(std::shared_ptr<StatisticsManager> stats_mgr);
-    OptimizeResult optimize(const SelectQuery& q);
+
+    // Size joins over loaded tables by sampling them (see join_sampler.h)
+    void setJoinSampler(std::shared_ptr<const JoinSampler> sampler) {
+        plan_generator_->setJoinSampler(std::move(sampler));
+    }
+
+    OptimizeResult optimize(SelectQuery q);
 };
 
 } // namespace sqlopt
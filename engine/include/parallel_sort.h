@@ -0,0 +1,46 @@
+#pragma once
+#include <cstddef>
+#include <string>
+#include <vector>
+
+namespace sqlopt {
+
+// How the server compares the values of a sort column. Only comparisons that can be
+// reproduced exactly on the client have a kind; other columns are sorted by the server.
+enum class SortKind {
+    SIGNED,            // integer types, compared exactly
+    UNSIGNED,          // UNSIGNED integer types
+    REAL,              // FLOAT, DOUBLE and DECIMAL of at most 15 digits, as doubles
+    BINARY,            // binary strings, temporal types and *_0900_bin: bytes, NO PAD
+    BINARY_PAD_SPACE,  // other *_bin collations: bytes, trailing spaces ignored
+    ASCII_CI           // latin1_swedish_ci and *_general_ci on ASCII text: upper-cased, PAD SPACE
+};
+
+// One ORDER BY key of a result set
+struct SortColumn {
+    size_t column = 0;  // index into the row
+    bool ascending = true;
+    SortKind kind = SortKind::BINARY;
+};
+
+// Encode a row's sort key so that comparing encodings with memcmp gives the ORDER BY
+// order: integers and doubles become order-preserving big-endian bytes, text is
+// folded and trimmed as its kind says and escaped, descending columns are bit-inverted
+// and NULLs sort first ascending / last descending. nulls[i] marks row[i] as SQL NULL;
+// a value past its end is not NULL.
+std::string normalize_sort_key(const std::vector<std::string>& row, const std::vector<bool>& nulls,
+                               const std::vector<SortColumn>& columns);
+
+// Stable sort order of normalized keys, as indices into keys. Chunks are sorted on
+// separate threads and combined by a multiway merge in which every thread merges the
+// key range between two splitters sampled from the sorted chunks.
+std::vector<size_t> parallel_sort_order(const std::vector<std::string>& keys, size_t threads);
+
+// Sort result rows in place. nulls holds the SQL NULL flags of each row, or is empty
+// when no value is NULL. Returns false, leaving the rows as they were, when a value
+// is outside what its column's kind reproduces (a number that does not parse,
+// non-ASCII text under ASCII_CI, a control character under PAD SPACE).
+bool parallel_sort_rows(std::vector<std::vector<std::string>>& rows, const std::vector<std::vector<bool>>& nulls,
+                        const std::vector<SortColumn>& columns, size_t threads);
+
+} // namespace sqlopt
@@ -4,6 +4,7 @@
 #include <vector>
 #include "execution_plan.h"
 #include "mysql_connector.h"
+#include "column_store.h"
 
 namespace sqlopt {
 
@@ -20,15 +21,30 @@ public:
         size_t rows_affected;
         std::string error_message;
         bool success;
+        bool native = false; // ran over the local column store rather than on MySQL
+        // Set by executeStreaming, whose rows go to the consumer instead of `rows`
+        size_t rows_streamed = 0;
+        long long first_row_ms = -1; // until the first batch was handed over
+        bool cancelled = false;      // the consumer stopped it before the last row
     };
 
     ExecutionResult execute(const ExecutionPlan& plan);
 
+    // Like execute(), but hands the rows to on_rows in batches of up to batch_rows as
+    // they are produced. Statements on MySQL stream from the server and are cancelled
+    // there when on_rows returns false; native results are handed over in batches.
+    ExecutionResult executeStreaming(const ExecutionPlan& plan, size_t batch_rows,
+                                     const MySQLConnector::RowBatchFn& on_rows);
+
+    // Plans over loaded tables run natively; everything else still goes to MySQL
+    void setColumnStore(std::shared_ptr<const ColumnStore> store) { column_store_ = std::move(store); }
+
     // Execute raw SQL for comparison
     ExecutionResult executeRawSQL(const std::string& sql);
 
 private:
     std::shared_ptr<MySQLConnector> connector_;
+    std::shared_ptr<const ColumnStore> column_store_;
 
     // Helper methods for different plan types
     ExecutionResult executeTableScan(const ScanNode& node);
@@ -38,6 +54,14 @@ private:
     ExecutionResult executeLimit(const LimitNode& node);
 
     std::string planToSQL(const ExecutionPlan& plan) const;
+
+    // Run the plan over the column store; false when it cannot be run natively
+    bool executeNative(const ExecutionPlan& plan, ExecutionResult& result);
+
+    // Run the query without its ORDER BY and sort the rows here on several threads.
+    // False, leaving the ordering to the server, when the sort columns' types or
+    // collations are ones the client cannot reproduce.
+    bool executeParallelSort(const std::string& sql, const SortNode& sort, ExecutionResult& result);
 };
 
 } // namespace sqlopt 
@@ -3,28 +3,96 @@
 #include "cost_estimator.h"
 #include "execution_plan.h"
 #include "ast.h"
+#include "bound_query.h"
+#include "expression.h"
 #include <vector>
 #include <memory>
 
 namespace sqlopt {
 
+class JoinSampler;
+
 class PlanGenerator {
+public:
+    // Sorts of fewer rows always run on one thread
+    static constexpr size_t PARALLEL_SORT_MIN_ROWS = 100000;
+    // Fraction of row pairs kept by join conditions that are not column equalities
+    static constexpr double DEFAULT_JOIN_SELECTIVITY = 0.1;
+    // Fraction of rows kept by a filter condition the statistics cannot estimate
+    static constexpr double DEFAULT_FILTER_SELECTIVITY = 0.5;
+    // ORs of more branches estimate as independent events instead of by inclusion-exclusion
+    static constexpr size_t MAX_INCLUSION_EXCLUSION_TERMS = 10;
+
 private:
     std::shared_ptr<StatisticsManager> stats_mgr_;
     std::shared_ptr<CostEstimator> cost_estimator_;
+    std::shared_ptr<const JoinSampler> join_sampler_;
+
+    // The query being planned, bound; owned_bound_ when generatePlans bound it itself
+    const BoundQuery* bound_ = nullptr;
+    BoundQuery owned_bound_;
+
+    // Cost handles of the bound query's table references, by RefId, resolved once per query
+    std::vector<TableStatsHandle> handles_;
+
+    // Conditions of the query being planned; the plans built from it share it
+    std::shared_ptr<ConditionPool> pool_;
+
+    // Plan for `bound` from here on: its handles resolved and a new condition pool
+    void useBinding(const BoundQuery& bound);
+
+    // Plan for the tables as references 0..n-1, for the planners given bare names
+    void bindTables(const std::vector<std::string>& tables);
+
+    // The conditions interned in the current pool as one list
+    ConditionList conditionList(const std::vector<std::string>& conditions);
+
+    // One condition interned in the current pool; valid until the next one is
+    const ConditionEntry& conditionEntry(const std::string& condition);
+
+    const TableStatsHandle& tableHandle(RefId ref) const { return handles_[ref]; }
+
+    // Rows out of a join of inputs of left_card and right_card rows: every join edge
+    // between a left column and a column of `right` contributes its NDV/MCV selectivity
+    double joinCardinality(const std::string& join_type, size_t left_card, size_t right_card,
+                           const ConditionList& conditions, RefId right);
 
-    // Generate scan plans for a table
-    std::vector<std::unique_ptr<PlanNode>> generateScanPlans(const std::string& table_name,
-                                                            const std::string& alias = "");
+    // Generate scan plans for a table reference: a full scan, plus a lookup through
+    // every index whose leading column `filters` bound (the filters are still applied above)
+    std::vector<std::unique_ptr<PlanNode>> generateScanPlans(RefId ref, const std::vector<std::string>& filters = {});
 
     // Generate join plans using dynamic programming
     std::vector<std::unique_ptr<PlanNode>> generateJoinPlans(
         const std::vector<std::string>& tables,
         const std::vector<std::vector<std::string>>& join_conditions);
 
+    // Join two inputs, costing nested loop, index nested loop, hash and merge join
+    // and keeping the cheapest. `right` is the table reference of the inner input.
+    std::unique_ptr<PlanNode> generatePhysicalJoin(const std::string& join_type,
+                                                   std::unique_ptr<PlanNode> left,
+                                                   std::unique_ptr<PlanNode> right,
+                                                   const ConditionList& conditions,
+                                                   RefId right_ref);
+
+    // Cheapest scan for a table reference, or a placeholder scan when no statistics exist
+    std::unique_ptr<PlanNode> generateBestScan(RefId ref, const std::vector<std::string>& filters = {});
+
+    // Scan of a derived table, costed as its inner query planned on its own: one row
+    // per group, from the NDVs of the GROUP BY keys. nullptr when the SQL does not plan.
+    std::unique_ptr<PlanNode> generateDerivedScan(RefId ref);
+
+    // Fraction of rows for which all of the AND-ed conditions hold: repeated atoms
+    // count once, an OR by inclusion-exclusion over its branches, so the atoms the
+    // branches share are not counted twice. Conditions in `applied` (an index scan's
+    // key conditions) are already reflected in the input and left out.
+    double conditionSelectivity(const ConditionList& conditions, const std::vector<std::string>& applied = {});
+    double predicateSelectivity(const ExprPtr& predicate);
+
+    // Statistics of a column reference such as "u.age", with the table they belong to
+    const ColumnStats* columnStats(const std::string& column, std::string& table);
+
     // Generate filter plans
-    std::unique_ptr<PlanNode> generateFilterPlan(std::unique_ptr<PlanNode> child,
-                                                const std::vector<std::string>& conditions);
+    std::unique_ptr<PlanNode> generateFilterPlan(std::unique_ptr<PlanNode> child, const ConditionList& conditions);
 
     // Generate sort plans
     std::unique_ptr<PlanNode> generateSortPlan(std::unique_ptr<PlanNode> child,
@@ -35,9 +103,23 @@ private:
                                                    const std::vector<std::string>& group_by,
                                                    const std::vector<std::string>& aggregates);
 
+    // Generate a DISTINCT plan, hash- or sort-based by cost
+    std::unique_ptr<PlanNode> generateDistinctPlan(std::unique_ptr<PlanNode> child, const SelectQuery& query);
+
+    // Distinct values of a column reference such as "u.age" (0 when unknown)
+    size_t columnDistinctValues(const std::string& column);
+
     // Generate limit plans
     std::unique_ptr<PlanNode> generateLimitPlan(std::unique_ptr<PlanNode> child, size_t limit);
 
+    // First `limit` rows of one table in ORDER BY order: a sort over the cheapest scan,
+    // or an ordered index scan that stops once enough rows passed the filters
+    std::unique_ptr<PlanNode> generateTopNScan(RefId ref, const std::vector<std::string>& filters,
+                                               const std::vector<OrderItem>& order_by, size_t limit);
+
+    // Cost of sorting an input on one key (0 for trivial inputs)
+    double sortCost(size_t rows);
+
     // Estimate costs for a plan
     void estimatePlanCosts(PlanNode* node);
 
@@ -45,9 +127,16 @@ public:
     PlanGenerator(std::shared_ptr<StatisticsManager> stats, std::shared_ptr<CostEstimator> cost_est)
         : stats_mgr_(std::move(stats)), cost_estimator_(std::move(cost_est)) {}
 
+    // Estimate join output from join samples of the loaded tables where possible
+    // (null: from statistics alone)
+    void setJoinSampler(std::shared_ptr<const JoinSampler> sampler) { join_sampler_ = std::move(sampler); }
+
     // Generate all possible execution plans for a SELECT query
     std::vector<ExecutionPlan> generatePlans(const SelectQuery& query);
 
+    // ... bound already (bound_query.h); `bound` must stay bound to `query` until this returns
+    std::vector<ExecutionPlan> generatePlans(const SelectQuery& query, const BoundQuery& bound);
+
     // Get the best plan (lowest cost)
     ExecutionPlan getBestPlan(std::vector<ExecutionPlan>& plans);
 
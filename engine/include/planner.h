@@ -7,6 +7,10 @@
 
 namespace sqlopt {
 
+// Logical plan nodes. Kept in their own namespace: the names collide with the
+// physical nodes in execution_plan.h, and sharing one namespace broke their vtables.
+namespace planner {
+
 struct PlanNode{
     virtual ~PlanNode()=default;
     double est_rows=0.0;
@@ -69,4 +73,6 @@ struct HavingNode : PlanNode{
     std::string explain(int indent=0) const override;
 };
 
+} // namespace planner
+
 } // namespace sqlopt
@@ -0,0 +1,22 @@
+#pragma once
+#include <string>
+#include <vector>
+
+namespace sqlopt {
+
+enum class QueryLogFormat {
+    AUTO,
+    PLAIN,       // statements terminated by ';' (test_queries.txt)
+    JSONL,       // one JSON object per line with a "query", "sql" or "statement" field
+    GENERAL_LOG  // MySQL general query log
+};
+
+// Read the statements of a query log in file order. Returns false and sets error
+// when the file cannot be read; unrecognised lines are skipped.
+bool load_query_log(const std::string& path, std::vector<std::string>& queries,
+                    std::string& error, QueryLogFormat format = QueryLogFormat::AUTO);
+
+// Guess the format from the first non-empty lines
+QueryLogFormat detect_query_log_format(const std::vector<std::string>& first_lines);
+
+} // namespace sqlopt
@@ -1,29 +1,54 @@
 #pragma once
 #include "ast.h"
+#include "bound_query.h"
 #include <string>
 #include <vector>
 
 namespace sqlopt {
 
+struct TransformLog;
+
 class QueryRewriter {
 public:
     QueryRewriter() = default;
 
+    // Every stage takes the query bound (bound_query.h) and reads which tables a
+    // condition uses from its masks; a stage that changes the query's tables or
+    // conditions leaves `bound` rebound to the result.
+
     // Apply logical optimizations to the query
-    void rewrite(SelectQuery& query);
+    void rewrite(SelectQuery& query, BoundQuery& bound);
+
+    // Shares repeated work inside one query: a scalar aggregate subquery written more
+    // than once becomes a single derived-table join, ORDER BY and HAVING read the alias
+    // of a select item they repeat, and repeated conditions and sort keys are dropped.
+    // Runs on the query as parsed, before rewrite().
+    void eliminateCommonSubexpressions(SelectQuery& query, BoundQuery& bound, TransformLog& log);
+
+    // Constant folding and expression simplification (expression_simplifier.h) of
+    // the WHERE, HAVING and ON conditions and of aliased select items. Conditions
+    // that fold to TRUE are dropped. Returns false when the WHERE conditions can
+    // never all hold; they are then replaced by a single FALSE.
+    bool foldConstants(SelectQuery& query, BoundQuery& bound, TransformLog& log);
+
+    // Boolean normalization of WHERE conditions with OR: negations pushed to the
+    // atoms, conjuncts every OR branch shares factored out, and a disjunction over
+    // several tables put in conjunctive normal form (at most 8 clauses) when that
+    // yields clauses on a single table, which the planner can then push to its scan.
+    void normalizePredicates(SelectQuery& query, BoundQuery& bound, TransformLog& log);
 
 private:
     // Convert comma joins to explicit JOIN syntax
-    void convertCommaJoins(SelectQuery& query);
+    void convertCommaJoins(SelectQuery& query, BoundQuery& bound);
     
     // Reconstruct comma joins from WHERE conditions (for complex queries)
-    void reconstructCommaJoins(SelectQuery& query);
+    void reconstructCommaJoins(SelectQuery& query, BoundQuery& bound);
     
     // Convert subqueries to JOINs for better performance
     void convertSubqueriesToJoins(SelectQuery& query);
     
     // Predicate pushdown: Move WHERE conditions closer to data sources
-    void pushdownPredicates(SelectQuery& query);
+    void pushdownPredicates(SelectQuery& query, BoundQuery& bound);
     
     // Projection pushdown: Only select needed columns
     void pushdownProjections(SelectQuery& query);
@@ -31,14 +56,10 @@ private:
     // Subquery flattening: Convert correlated subqueries to joins
     void flattenSubqueries(SelectQuery& query);
 
-    // Constant folding: Pre-compute constant expressions
-    void foldConstants(SelectQuery& query);
-
     // Join reordering: Optimize join sequence using heuristics
-    void reorderJoins(SelectQuery& query);
+    void reorderJoins(SelectQuery& query, BoundQuery& bound);
 
     // Helper functions
-    bool isPushablePredicate(const std::string& pred, const std::string& table_alias);
     std::vector<std::string> splitPredicates(const std::string& predicates);
     std::string joinPredicates(const std::vector<std::string>& preds, const std::string& op = " AND ");
 };
@@ -1,10 +1,16 @@
 #pragma once
 #include <string>
 #include "ast.h"
+#include "bound_query.h"
 #include "statistics_manager.h"
 
 namespace sqlopt {
 
+// Binds the query's tables, columns and conditions to the statistics (bound_query.h)
+// and checks that every reference resolves. False with err_out set on an unknown
+// table, alias or column, or an ambiguous one; an unknown FROM table only warns.
+bool bind_query(const SelectQuery &q, const StatisticsManager &stats, BoundQuery &out, std::string &err_out);
+
 bool semantic_validate(const SelectQuery &q, const StatisticsManager &stats, std::string &err_out);
 
 } // namespace sqlopt
@@ -0,0 +1,73 @@
+#pragma once
+#include "statistics_manager.h"
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace sqlopt {
+
+// One statement from a MySQL slow query log
+struct SlowLogEntry {
+    std::string sql;
+    std::string database;  // from the last "use db;" line, if any
+    double query_time = 0.0;
+    double lock_time = 0.0;
+    uint64_t rows_sent = 0;
+    uint64_t rows_examined = 0;
+};
+
+// All entries sharing a fingerprint
+struct SlowLogDigest {
+    std::string fingerprint;
+    std::string sample_sql;  // the slowest occurrence
+    uint64_t count = 0;
+    double total_query_time = 0.0;
+    double max_query_time = 0.0;
+    uint64_t total_rows_examined = 0;
+};
+
+// A digest run through the optimizer
+struct SlowLogRewrite {
+    SlowLogDigest digest;
+    bool optimized = false;       // false when the sample could not be parsed or is not a SELECT
+    std::string note;
+    std::string rewritten_sql;
+    double original_cost = 0.0;
+    double optimized_cost = 0.0;
+    double expected_savings = 0.0;   // count x estimated cost reduction
+    double reclaimed_seconds = 0.0;  // total query time x relative cost reduction
+};
+
+// Streams a slow log entry by entry. Regular files are memory-mapped, anything else
+// (pipes, "-" for stdin) is read through a large buffer, so multi-GB logs never have
+// to fit in memory.
+class SlowLogReader {
+public:
+    using EntryCallback = std::function<void(const SlowLogEntry&)>;
+
+    bool read(const std::string& path, const EntryCallback& on_entry, std::string& error);
+
+    // Feed one line (without its newline); entries are emitted as they complete
+    void feedLine(const char* data, size_t len, const EntryCallback& on_entry);
+    void finish(const EntryCallback& on_entry);
+
+private:
+    SlowLogEntry current_;
+    bool have_header_ = false;
+    std::string database_;
+
+    void flush(const EntryCallback& on_entry);
+};
+
+// Group a slow log by fingerprint
+bool aggregate_slow_log(const std::string& path, std::unordered_map<std::string, SlowLogDigest>& digests,
+                        std::string& error);
+
+// Optimize the top_n digests by total query time and rank them by expected savings
+std::vector<SlowLogRewrite> rank_slow_log_rewrites(const std::unordered_map<std::string, SlowLogDigest>& digests,
+                                                   std::shared_ptr<StatisticsManager> stats_mgr, size_t top_n);
+
+} // namespace sqlopt
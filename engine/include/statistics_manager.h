@@ -1,18 +1,97 @@
 #pragma once
+#include <cstdint>
+#include <deque>
 #include <string>
+#include <string_view>
+#include <utility>
 #include <vector>
-#include <map>
 #include <memory>
+#include "symbol_table.h"
 
 namespace sqlopt {
 
+struct StatsCatalog;
+class ColumnStore;
+class AsyncMySQL;
+
+// Ids the manager assigns: a table's slot in the manager, a column's position in
+// its table's columns
+using TableId = uint32_t;
+using ColumnId = uint32_t;
+
+// Smallest or largest value of a column, typed once when statistics load: numbers
+// (and text that is all one number) as doubles, anything else (strings, dates) as text
+struct StatValue {
+    enum class Kind : uint8_t { NONE, NUMBER, TEXT };
+    Kind kind = Kind::NONE;
+    double number = 0.0;
+    std::string text;
+
+    static StatValue fromText(const std::string& text);
+    static StatValue fromNumber(double number);
+    bool isNumber() const { return kind == Kind::NUMBER; }
+    std::string toString() const;
+};
+
+// A most common value of a column (case-folded) and the share of rows holding it
+struct CommonValue {
+    std::string value;
+    double frequency = 0.0;
+};
+
+// Where a stored most common value sits in its table's common_text
+struct CommonValueSlot {
+    uint32_t offset = 0;
+    uint32_t length = 0;
+    double frequency = 0.0;
+};
+
+// Most common values of one column, most frequent first, as views into its table
+class CommonValueRange {
+public:
+    struct Value {
+        std::string_view value;
+        double frequency;
+    };
+
+    class iterator {
+    public:
+        iterator(const CommonValueSlot* slot, const char* text) : slot_(slot), text_(text) {}
+        Value operator*() const { return {std::string_view(text_ + slot_->offset, slot_->length), slot_->frequency}; }
+        iterator& operator++() { ++slot_; return *this; }
+        bool operator==(const iterator& other) const { return slot_ == other.slot_; }
+        bool operator!=(const iterator& other) const { return slot_ != other.slot_; }
+
+    private:
+        const CommonValueSlot* slot_;
+        const char* text_;
+    };
+
+    CommonValueRange() = default;
+    CommonValueRange(const CommonValueSlot* first, const CommonValueSlot* last, const char* text)
+        : first_(first), last_(last), text_(text) {}
+
+    iterator begin() const { return iterator(first_, text_); }
+    iterator end() const { return iterator(last_, text_); }
+    size_t size() const { return static_cast<size_t>(last_ - first_); }
+    bool empty() const { return first_ == last_; }
+
+private:
+    const CommonValueSlot* first_ = nullptr;
+    const CommonValueSlot* last_ = nullptr;
+    const char* text_ = nullptr;
+};
+
 struct ColumnStats {
     std::string column_name;
     size_t distinct_values = 0;
-    std::string min_value;
-    std::string max_value;
+    StatValue min_value;
+    StatValue max_value;
     double selectivity = 0.1; // Default selectivity
-    std::vector<std::pair<std::string, double>> histogram; // value -> frequency
+    bool nullable = true;
+    // This column's run of its table's common_values
+    uint32_t common_first = 0;
+    uint32_t common_count = 0;
 };
 
 struct IndexInfo {
@@ -20,46 +99,139 @@ struct IndexInfo {
     std::vector<std::string> columns;
     bool is_unique = false;
     size_t cardinality = 0;
+    // Shape of the index when known (an in-memory index over a loaded table);
+    // 0 when it is estimated from the row count
+    size_t height = 0;
+    double fanout = 0.0;
 };
 
+// Single-column foreign key: column -> referenced_table.referenced_column
+struct ForeignKeyInfo {
+    std::string column;
+    std::string referenced_table;
+    std::string referenced_column;
+};
+
+// Statistics of one table, flat: its columns in one array (a column's id is its
+// position), and the most common values of all of them in another, their text
+// back to back in one string
 struct TableStatistics {
     std::string table_name;
+    TableId id = INVALID_ID; // set when the manager stores the table
     size_t row_count = 0;
     size_t page_count = 0;
-    std::map<std::string, ColumnStats> column_stats;
+    std::vector<ColumnStats> columns;
+    std::vector<CommonValueSlot> common_values; // one run per column, in column order
+    std::string common_text;
     std::vector<IndexInfo> available_indexes;
+    std::vector<ForeignKeyInfo> foreign_keys;
+
+    // Adds the column, or replaces the one of the same name, with its most common
+    // values; returns its id
+    ColumnId setColumn(ColumnStats column, const std::vector<CommonValue>& common = {});
+
+    // Column named exactly `name`, or nullptr; a scan, for tables being built
+    const ColumnStats* column(const std::string& name) const;
+
+    CommonValueRange commonValues(const ColumnStats& column) const {
+        const CommonValueSlot* first = common_values.data() + column.common_first;
+        return {first, first + column.common_count, common_text.data()};
+    }
+
+    // The most common values of the column as a list of their own, to copy them
+    std::vector<CommonValue> commonValueList(const ColumnStats& column) const;
 };
 
+// Statistics of every known table. Table names and column names are interned when
+// a table is stored, both as spelled and case-folded, so resolving either in any
+// case is one hash probe and reading a column's statistics by id is an array index.
 class StatisticsManager {
 private:
-    std::map<std::string, TableStatistics> table_stats_;
+    std::deque<TableStatistics> tables_; // by TableId; a deque so pointers handed out stay valid
+    NameTable table_ids_;                // table name -> TableId
+    NameTable column_names_;             // every distinct column name, once
+    IdMap column_ids_;                   // (TableId, column name id) -> ColumnId
+
+    // The same, with names compared case-insensitively; the first spelling stored wins
+    NameTable folded_tables_{NameTable::Case::INSENSITIVE};
+    std::vector<TableId> folded_table_ids_; // by folded table name id
+    NameTable folded_columns_{NameTable::Case::INSENSITIVE};
+    IdMap folded_column_ids_;               // (TableId, folded column name id) -> ColumnId
     static constexpr size_t HISTOGRAM_BUCKETS = 10;
 
+    // Stores the table under the name, replacing earlier statistics of it, and
+    // interns its name and its columns' names
+    TableStatistics& storeTable(const std::string& table_name, TableStatistics stats);
+
+    // (table, key) pairs, for tables already stored
+    void addForeignKeys(const std::vector<std::pair<std::string, ForeignKeyInfo>>& keys);
+
 public:
     StatisticsManager() = default;
 
     // Load statistics from database
     void loadFromDatabase(void* mysql_conn, const std::string& db_name);
 
+    // The same statistics, crawled with the statements of every table and column in
+    // flight together on the connections `mysql` has open; returns when all answered
+    void loadFromDatabase(AsyncMySQL& mysql);
+
+    // Load the built-in StatsCatalog schema, for running without a database
+    void loadFromCatalog(const StatsCatalog& catalog);
+
+    // Exact row counts, NDVs, min/max and most-common values of the tables loaded
+    // into a column store; index metadata already known for a table is kept
+    void loadFromColumnStore(const ColumnStore& store);
+
     // Get table statistics
     const TableStatistics* getTableStats(const std::string& table_name) const;
 
-    // Case-insensitive table lookup helpers
+    // Case-insensitive table lookup helpers: the exact spelling, else one probe of
+    // the case-folded names
     const TableStatistics* getTableStatsCI(const std::string& table_name) const;
     std::string resolveTableNameCI(const std::string& table_name) const;
 
-    // Estimate selectivity for a condition
+    // Column of a table by name, exact spelling first, then case-insensitively
+    const ColumnStats* findColumnCI(const TableStatistics& table, const std::string& column) const;
+
+    // Ids of a table and of one of its columns by exact name, or INVALID_ID
+    TableId tableId(const std::string& table_name) const { return table_ids_.find(table_name); }
+    ColumnId columnId(TableId table, const std::string& column) const;
+
+    // The same in any letter case
+    TableId tableIdCI(const std::string& table_name) const;
+    ColumnId columnIdCI(TableId table, const std::string& column) const;
+
+    const TableStatistics& table(TableId id) const { return tables_[id]; }
+    const ColumnStats& column(TableId table, ColumnId column) const { return tables_[table].columns[column]; }
+    size_t tableCount() const { return tables_.size(); }
+
+    // Heap bytes held by the statistics and their name tables
+    size_t memoryBytes() const;
+
+    // Selectivity of "column op value": equality from the most common values, else
+    // the remaining rows spread over the other distinct values; ranges on numeric
+    // columns by where the value falls between min and max
     double estimateSelectivity(const std::string& table_name, const std::string& column,
                               const std::string& op, const std::string& value) const;
 
+    // Selectivity of the equi-join left_table.left_column = right_table.right_column:
+    // 1 / max(ndv) when either column has no most-common values, otherwise the MCV
+    // lists are matched value by value and only the remaining rows are spread over
+    // the remaining distinct values. left_rows/right_rows are the input sizes after
+    // filters (0: the whole table), which bound each side's distinct values.
+    double estimateJoinSelectivity(const std::string& left_table, const std::string& left_column,
+                                   const std::string& right_table, const std::string& right_column,
+                                   size_t left_rows = 0, size_t right_rows = 0) const;
+
     // Get row count estimate
     size_t estimateRowCount(const std::string& table_name, double selectivity) const;
 
     // Update statistics
-    void updateTableStats(const std::string& table_name, const TableStatistics& stats);
+    void updateTableStats(const std::string& table_name, TableStatistics stats);
 
-    // Build histogram for a column
-    void buildHistogram(ColumnStats& col_stats, const std::vector<std::string>& values);
+    // Most common values of a column from a sample of its values
+    void buildHistogram(TableStatistics& table, const std::string& column, const std::vector<std::string>& values);
 
     // Print statistics
     void printStats() const;
@@ -0,0 +1,77 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace sqlopt {
+
+// No such name, table or column
+constexpr uint32_t INVALID_ID = UINT32_MAX;
+
+// Interned names: each distinct string is stored once and numbered from 0 in the
+// order it was first seen. Finding a name is one probe of an open-addressed table
+// of ids, with no allocation.
+//
+// A case-insensitive table hashes and compares names with ASCII case folded, so
+// "Users" finds "users" without lower-casing either; it keeps the spelling it saw
+// first.
+class NameTable {
+public:
+    enum class Case { SENSITIVE, INSENSITIVE };
+
+    explicit NameTable(Case names = Case::SENSITIVE) : fold_(names == Case::INSENSITIVE) {}
+
+    // Id of the name, adding it on first sight
+    uint32_t intern(std::string_view name);
+
+    // Id of the name, or INVALID_ID
+    uint32_t find(std::string_view name) const;
+
+    const std::string& name(uint32_t id) const { return names_[id]; }
+    size_t size() const { return names_.size(); }
+
+    // Heap bytes held: the names that do not fit inline, and both tables
+    size_t memoryBytes() const;
+
+private:
+    size_t hash(std::string_view name) const;
+    bool same(std::string_view a, std::string_view b) const;
+    // Slot holding the name, or the empty slot it would go in
+    size_t slotOf(std::string_view name, size_t hash) const;
+    void grow();
+
+    bool fold_;
+    std::vector<std::string> names_;
+    std::vector<size_t> hashes_;  // of each name, so growing never rehashes text
+    std::vector<uint32_t> slots_; // ids by hash, INVALID_ID when empty; a power of two
+};
+
+// Open-addressed map from 64-bit keys (two ids packed together) to ids
+class IdMap {
+public:
+    static uint64_t key(uint32_t high, uint32_t low) { return static_cast<uint64_t>(high) << 32 | low; }
+
+    // Maps the key to value; INVALID_ID makes later finds miss
+    void set(uint64_t key, uint32_t value);
+
+    // Value of the key, or INVALID_ID
+    uint32_t find(uint64_t key) const;
+
+    size_t memoryBytes() const { return slots_.capacity() * sizeof(Slot); }
+
+private:
+    struct Slot {
+        uint64_t key = 0;
+        uint32_t value = INVALID_ID;
+        bool used = false;
+    };
+    size_t slotOf(uint64_t key) const;
+    void grow();
+
+    std::vector<Slot> slots_; // a power of two
+    size_t used_ = 0;
+};
+
+} // namespace sqlopt
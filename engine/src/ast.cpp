@@ -1,3 +1,21 @@
 #include "ast.h"
 
 // Currently minimal; expressions are represented as strings or simple nodes.
+
+namespace sqlopt {
+
+std::string join_type_to_string(JoinType jt) {
+    switch (jt) {
+        case JoinType::INNER: return "INNER";
+        case JoinType::LEFT: return "LEFT";
+        case JoinType::RIGHT: return "RIGHT";
+        case JoinType::FULL: return "FULL";
+        case JoinType::NATURAL: return "NATURAL";
+        case JoinType::LEFT_ANTI: return "LEFT ANTI";
+        case JoinType::RIGHT_ANTI: return "RIGHT ANTI";
+        case JoinType::FULL_OUTER_ANTI: return "FULL OUTER ANTI";
+        default: return "INNER";
+    }
+}
+
+} // namespace sqlopt
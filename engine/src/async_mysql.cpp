@@ -0,0 +1,168 @@
+#include "async_mysql.h"
+#include <poll.h>
+#include <algorithm>
+#include <stdexcept>
+
+namespace sqlopt {
+
+namespace {
+
+// Longest single wait in poll(2)
+constexpr int MAX_WAIT_MS = 10;
+
+} // namespace
+
+AsyncMySQL::AsyncMySQL(std::string host, std::string user, std::string password, std::string database,
+                       unsigned int port)
+    : host_(std::move(host)), user_(std::move(user)), password_(std::move(password)),
+      database_(std::move(database)), port_(port) {}
+
+AsyncMySQL::~AsyncMySQL() {
+    for (auto& c : connections_) {
+        if (c.mysql) mysql_close(c.mysql);
+    }
+}
+
+void AsyncMySQL::open(size_t connections) {
+    for (size_t i = 0; i < connections; ++i) {
+        Connection c;
+        c.mysql = mysql_init(nullptr);
+        if (!c.mysql) throw std::runtime_error("Failed to initialize MySQL client");
+        connections_.push_back(std::move(c));
+        advance(connections_.back());
+    }
+}
+
+void AsyncMySQL::submit(std::string sql, Completion done) {
+    pending_.push_back({std::move(sql), std::move(done)});
+}
+
+size_t AsyncMySQL::inFlight() const {
+    return std::count_if(connections_.begin(), connections_.end(), [](const Connection& c) {
+        return c.state == State::QUERYING || c.state == State::STORING;
+    });
+}
+
+void AsyncMySQL::finish(Connection& c, AsyncResult& result) {
+    // The completion may submit more work, and this connection is free to take it
+    Completion done = std::move(c.done);
+    c.done = nullptr;
+    c.state = State::IDLE;
+    if (done) done(result);
+}
+
+bool AsyncMySQL::advance(Connection& c) {
+    while (true) {
+        switch (c.state) {
+        case State::CONNECTING: {
+            net_async_status status = mysql_real_connect_nonblocking(
+                c.mysql, host_.c_str(), user_.c_str(), password_.c_str(),
+                database_.empty() ? nullptr : database_.c_str(), port_, nullptr, 0);
+            if (status == NET_ASYNC_NOT_READY) return true;
+            if (status == NET_ASYNC_ERROR) {
+                connect_error_ = mysql_error(c.mysql);
+                c.state = State::FAILED;
+                ++failed_;
+                return false;
+            }
+            c.state = State::IDLE;
+            ++connected_;
+            break;
+        }
+        case State::IDLE:
+            if (pending_.empty()) return false;
+            c.sql = std::move(pending_.front().sql);
+            c.done = std::move(pending_.front().done);
+            pending_.pop_front();
+            c.state = State::QUERYING;
+            break;
+        case State::QUERYING: {
+            net_async_status status = mysql_real_query_nonblocking(c.mysql, c.sql.data(), c.sql.size());
+            if (status == NET_ASYNC_NOT_READY) return true;
+            if (status == NET_ASYNC_ERROR) {
+                AsyncResult result;
+                result.error_message = mysql_error(c.mysql);
+                finish(c, result);
+                break;
+            }
+            c.state = State::STORING;
+            break;
+        }
+        case State::STORING: {
+            MYSQL_RES* res = nullptr;
+            net_async_status status = mysql_store_result_nonblocking(c.mysql, &res);
+            if (status == NET_ASYNC_NOT_READY) return true;
+            AsyncResult result;
+            // No result set is an error only for a statement that should have had one
+            if (status == NET_ASYNC_ERROR || (!res && mysql_field_count(c.mysql) != 0)) {
+                result.error_message = mysql_error(c.mysql);
+            } else {
+                result.success = true;
+                result.result = res;
+                result.affected_rows = mysql_affected_rows(c.mysql);
+            }
+            finish(c, result);
+            if (res) mysql_free_result(res);
+            break;
+        }
+        case State::FAILED:
+            return false;
+        }
+    }
+}
+
+void AsyncMySQL::failPending() {
+    while (!pending_.empty()) {
+        Pending p = std::move(pending_.front());
+        pending_.pop_front();
+        AsyncResult result;
+        result.error_message = connect_error_.empty() ? "No MySQL connection" : connect_error_;
+        if (p.done) p.done(result);
+    }
+}
+
+bool AsyncMySQL::runOnce(std::chrono::milliseconds timeout) {
+    // Idle connections take queued statements before anyone waits
+    for (auto& c : connections_) {
+        if (c.state == State::IDLE && !pending_.empty()) advance(c);
+    }
+
+    std::vector<pollfd> fds;
+    std::vector<size_t> waiting;
+    bool unpollable = false;
+    for (size_t i = 0; i < connections_.size(); ++i) {
+        State s = connections_[i].state;
+        if (s == State::IDLE || s == State::FAILED) continue;
+        waiting.push_back(i);
+        int fd = connections_[i].mysql->net.fd;
+        if (fd < 0) unpollable = true;
+        else fds.push_back({fd, POLLIN, 0});
+    }
+    if (waiting.empty()) {
+        bool usable = std::any_of(connections_.begin(), connections_.end(),
+                                  [](const Connection& c) { return c.state != State::FAILED; });
+        if (!usable) failPending();
+        return !pending_.empty();
+    }
+
+    // Only readability is polled: a socket is writable nearly all the time, so POLLOUT
+    // would wake every round while a statement runs on the server. A connection
+    // waiting to write (a TCP connect, a send that filled the socket buffer) is
+    // instead retried every round, so it waits at most MAX_WAIT_MS for its turn.
+    int wait = static_cast<int>(std::min<long long>(timeout.count(), unpollable ? 1 : MAX_WAIT_MS));
+    int ready = ::poll(fds.data(), fds.size(), std::max(wait, 0));
+    size_t polled = 0;
+    for (size_t i : waiting) {
+        Connection& c = connections_[i];
+        bool readable = c.mysql->net.fd < 0 || ready <= 0 || fds[polled++].revents != 0;
+        if (readable || c.state == State::CONNECTING || c.state == State::QUERYING) advance(c);
+    }
+    return !pending_.empty() || inFlight() > 0;
+}
+
+void AsyncMySQL::run() {
+    while (runOnce(std::chrono::milliseconds(MAX_WAIT_MS))) {
+    }
+}
+
+} // namespace sqlopt
@@ -0,0 +1,138 @@
+#include "bound_query.h"
+
+namespace sqlopt {
+
+namespace {
+
+// Calls fn(left, right) for every "a.x = b.y" among the AND-ed parts of e
+template <typename F>
+void forEachColumnEquality(const Expr& e, F&& fn) {
+    if (e.kind != ExprKind::BINARY) return;
+    if (e.text == "AND") {
+        forEachColumnEquality(*e.children[0], fn);
+        forEachColumnEquality(*e.children[1], fn);
+        return;
+    }
+    const Expr& l = *e.children[0];
+    const Expr& r = *e.children[1];
+    if (e.text == "=" && l.kind == ExprKind::COLUMN && r.kind == ExprKind::COLUMN) fn(l, r);
+}
+
+} // namespace
+
+void BoundQuery::bind(const SelectQuery& query, const StatisticsManager* stats) {
+    stats_ = stats;
+    refs_.clear();
+    qualifiers_ = NameTable(NameTable::Case::INSENSITIVE);
+    qualifier_refs_.clear();
+    addRef(query.from_table);
+    for (const auto& join : query.joins) addRef(join.table);
+
+    where.clear();
+    where.reserve(query.where_conditions.size());
+    for (const auto& cond : query.where_conditions) where.push_back(bind_condition(*this, cond));
+    on.assign(query.joins.size(), {});
+    for (size_t i = 0; i < query.joins.size(); ++i) {
+        for (const auto& cond : query.joins[i].on_conds) on[i].push_back(bind_condition(*this, cond));
+    }
+}
+
+RefId BoundQuery::addRef(const TableRef& table) {
+    BoundRef ref;
+    ref.name = table.name;
+    ref.alias = table.alias;
+    ref.derived_sql = table.derived_sql;
+    if (stats_ && table.derived_sql.empty()) ref.table = stats_->tableIdCI(table.name);
+
+    RefId id = static_cast<RefId>(refs_.size());
+    uint32_t qualifier = qualifiers_.intern(ref.qualifier());
+    if (qualifier == qualifier_refs_.size()) qualifier_refs_.push_back(id);
+    refs_.push_back(std::move(ref));
+    return id;
+}
+
+TableMask BoundQuery::allRefs() const {
+    return refs_.size() >= MAX_MASK_REFS ? ~TableMask{0} : (TableMask{1} << refs_.size()) - 1;
+}
+
+RefId BoundQuery::findRef(std::string_view qualifier) const {
+    uint32_t id = qualifiers_.find(qualifier);
+    return id == INVALID_ID ? INVALID_REF : qualifier_refs_[id];
+}
+
+BoundColumn BoundQuery::bindColumn(const std::string& text) const {
+    BoundColumn column;
+    size_t dot = text.find('.');
+    if (dot != std::string::npos) {
+        column.qualifier = text.substr(0, dot);
+        column.name = text.substr(dot + 1);
+    } else {
+        column.name = text;
+    }
+
+    auto columnOf = [&](RefId ref) {
+        TableId table = refs_[ref].table;
+        return stats_ && table != INVALID_ID ? stats_->columnIdCI(table, column.name) : INVALID_ID;
+    };
+
+    if (!column.qualifier.empty()) {
+        column.ref = findRef(column.qualifier);
+        if (column.ref != INVALID_REF) column.column = columnOf(column.ref);
+        return column;
+    }
+    for (RefId ref = 0; ref < refs_.size(); ++ref) {
+        ColumnId id = columnOf(ref);
+        if (id == INVALID_ID) continue;
+        if (column.column != INVALID_ID) {
+            column.ambiguous = true;
+            column.ref = INVALID_REF;
+            column.column = INVALID_ID;
+            return column;
+        }
+        column.ref = ref;
+        column.column = id;
+    }
+    if (column.ref == INVALID_REF && refs_.size() == 1) column.ref = 0;
+    return column;
+}
+
+BoundPredicate BoundQuery::bindPredicate(const Expr* tree) const {
+    BoundPredicate pred;
+    if (!tree) {
+        pred.opaque = true;
+        return pred;
+    }
+    pred.columns.reserve(2); // most conditions compare two columns, or a column with a constant
+    visit_expression(*tree, [&](const Expr& n) {
+        if (n.kind == ExprKind::SUBQUERY) pred.opaque = true;
+        if (n.kind != ExprKind::COLUMN) return;
+        pred.columns.push_back(bindColumn(n.text));
+        TableMask bit = pred.columns.back().ref == INVALID_REF ? 0 : refBit(pred.columns.back().ref);
+        if (bit == 0) pred.opaque = true;
+        pred.tables |= bit;
+    });
+    forEachColumnEquality(*tree, [&](const Expr& l, const Expr& r) {
+        JoinEdge edge{bindColumn(l.text), bindColumn(r.text)};
+        if (edge.left.ref != INVALID_REF && edge.right.ref != INVALID_REF && edge.left.ref != edge.right.ref) {
+            pred.edges.push_back(std::move(edge));
+        }
+    });
+    return pred;
+}
+
+const TableStatistics* BoundQuery::tableStats(RefId id) const {
+    if (!stats_ || id >= refs_.size() || refs_[id].table == INVALID_ID) return nullptr;
+    return &stats_->table(refs_[id].table);
+}
+
+const ColumnStats* BoundQuery::columnStats(const BoundColumn& column) const {
+    if (column.ref == INVALID_REF || column.column == INVALID_ID) return nullptr;
+    return &stats_->column(refs_[column.ref].table, column.column);
+}
+
+BoundPredicate bind_condition(const BoundQuery& bound, const std::string& condition) {
+    ExprPtr tree = parse_expression(condition);
+    return bound.bindPredicate(tree.get());
+}
+
+} // namespace sqlopt
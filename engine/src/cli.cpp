@@ -11,6 +11,21 @@
 #include "semantic.h"
 #include "plan_executor.h"
 #include "config.h"
+#include "slow_log.h"
+#include "stats.h"
+#include "fingerprint.h"
+#include "column_store.h"
+#include "column_index.h"
+#include "join_sampler.h"
+#include "multi_query_optimizer.h"
+#include "native_executor.h"
+#include "query_log.h"
+#include <chrono>
+#include <csignal>
+#include <cstdio>
+#include <functional>
+#include <iomanip>
+#include <sstream>
 #include "mysql_connector.h"
 #include "plan_executor.h"
 #include <mysql/mysql.h> // MySQL API
@@ -60,10 +75,273 @@ static std::string getPassword() {
     return password;
 }
 
+// --slowlog FILE [--top N]: rank the heaviest slow-log fingerprints by the savings
+// the optimizer's rewrites are expected to bring
+static int runSlowLogReport(const std::string& path, size_t top_n) {
+    std::unordered_map<std::string, SlowLogDigest> digests;
+    std::string error;
+    if (!aggregate_slow_log(path, digests, error)) {
+        std::cerr << error << "\n";
+        return 1;
+    }
+
+    uint64_t entries = 0;
+    double total_time = 0.0;
+    for (const auto& kv : digests) {
+        entries += kv.second.count;
+        total_time += kv.second.total_query_time;
+    }
+    std::cout << "Read " << entries << " slow-log entries, " << digests.size() << " fingerprints, "
+              << std::fixed << std::setprecision(1) << total_time / 3600.0 << " h of query time\n";
+
+    // Costs come from the database named by MYSQL_DB when reachable, else the built-in catalog
+    auto stats_mgr = std::make_shared<StatisticsManager>();
+    const char* db = std::getenv("MYSQL_DB");
+    bool from_db = false;
+    if (db) {
+        MySQLConnector conn;
+        const char* host = std::getenv("MYSQL_HOST");
+        const char* user = std::getenv("MYSQL_USER");
+        const char* pwd = std::getenv("MYSQL_PWD") ? std::getenv("MYSQL_PWD") : std::getenv("MYSQL_PASSWORD");
+        if (conn.connect(host ? host : "localhost", user ? user : "root", pwd ? pwd : "", db)) {
+            stats_mgr->loadFromDatabase(conn.getNativeHandle(), db);
+            from_db = true;
+        }
+    }
+    if (!from_db) {
+        StatsCatalog catalog;
+        catalog.load_defaults();
+        stats_mgr->loadFromCatalog(catalog);
+        std::cout << "Using built-in catalog statistics (set MYSQL_DB to cost against a live schema)\n";
+    }
+
+    auto ranked = rank_slow_log_rewrites(digests, stats_mgr, top_n);
+    std::cout << "\n--- Rewrites ranked by expected savings (count x cost reduction) ---\n";
+    for (size_t i = 0; i < ranked.size(); ++i) {
+        const auto& r = ranked[i];
+        const auto& d = r.digest;
+        std::cout << "\n" << (i + 1) << ". [" << fingerprint_id_hex(d.fingerprint) << "] " << d.fingerprint << "\n";
+        std::cout << "   count " << d.count << ", query time " << std::setprecision(3) << d.total_query_time
+                  << " s (" << std::setprecision(1) << (total_time > 0 ? 100.0 * d.total_query_time / total_time : 0.0)
+                  << "%), max " << std::setprecision(3) << d.max_query_time << " s, rows examined "
+                  << d.total_rows_examined << "\n";
+        if (!r.optimized) {
+            std::cout << "   skipped: " << r.note << "\n";
+            continue;
+        }
+        std::cout << "   est. cost " << std::setprecision(1) << r.original_cost << " -> " << r.optimized_cost
+                  << ", expected savings " << r.expected_savings
+                  << ", est. time reclaimed " << std::setprecision(3) << r.reclaimed_seconds << " s\n";
+        std::cout << "   rewrite: " << r.rewritten_sql << "\n";
+    }
+    return 0;
+}
+
+// Build the in-memory index on a loaded column and record its height and fanout on
+// the table's statistics, so scans and joins through it are costed from its shape
+static bool buildNativeIndex(ColumnStore& store, StatisticsManager& stats, const std::string& table,
+                             const std::string& column, std::string& error) {
+    if (!store.createIndex(table, column, error)) return false;
+    const ColumnIndex* index = store.index(table, column);
+    const TableStatistics* current = stats.getTableStatsCI(table);
+    if (!current) return true; // not in the catalog: nothing plans over it
+
+    TableStatistics updated = *current;
+    IndexInfo* info = nullptr;
+    for (auto& idx : updated.available_indexes) {
+        if (!idx.columns.empty() && to_lower(idx.columns[0]) == to_lower(column)) {
+            info = &idx;
+            break;
+        }
+    }
+    if (!info) {
+        IndexInfo idx;
+        idx.index_name = column + "_native";
+        idx.columns = {column};
+        idx.cardinality = index->size();
+        updated.available_indexes.push_back(idx);
+        info = &updated.available_indexes.back();
+    }
+    info->height = index->height();
+    info->fanout = index->fanout();
+    stats.updateTableStats(updated.table_name, updated);
+    return true;
+}
+
+static void printNativeIndex(const ColumnIndex& index, const std::string& table, const std::string& column) {
+    std::cout << "  " << index.kind() << " index on " << table << "." << column << ": " << index.size()
+              << " entries, height " << index.height() << ", fanout " << std::fixed << std::setprecision(1)
+              << index.fanout() << std::defaultfloat << ", " << index.memoryBytes() / 1024 << " KB\n";
+}
+
+// Rows fetched from the server per batch while a result streams
+static constexpr size_t STREAM_BATCH_ROWS = 100;
+// Widest a result column is printed; longer values are cut
+static constexpr size_t MAX_COLUMN_WIDTH = 40;
+
+// Prints a streamed result as an aligned table while its batches arrive. Column
+// widths are fixed by the header and the first batch, and later values wider than
+// their column are cut, so nothing waits for the last row. Asks to stop the
+// statement once max_rows rows are shown (0 shows all) or the output has closed.
+class ResultPrinter {
+public:
+    // Writes text to the terminal or a pager; false once it can take no more
+    using Write = std::function<bool(const std::string&)>;
+
+    ResultPrinter(Write write, size_t max_rows) : write_(std::move(write)), max_rows_(max_rows) {}
+
+    bool print(const std::vector<std::string>& columns, const std::vector<std::vector<std::string>>& rows) {
+        std::string out;
+        if (widths_.empty()) {
+            widths_.resize(columns.size());
+            for (size_t i = 0; i < columns.size(); ++i) {
+                size_t width = columns[i].size();
+                for (const auto& row : rows) width = std::max(width, i < row.size() ? row[i].size() : 0);
+                widths_[i] = std::min(width, MAX_COLUMN_WIDTH);
+            }
+            std::string rule;
+            for (size_t i = 0; i < columns.size(); ++i) {
+                if (i > 0) rule += "-+-";
+                rule += std::string(widths_[i], '-');
+            }
+            out += formatRow(columns) + rule + "\n";
+        }
+        for (const auto& row : rows) {
+            if (max_rows_ > 0 && shown_ == max_rows_) {
+                capped_ = true;
+                break;
+            }
+            out += formatRow(row);
+            ++shown_;
+        }
+        closed_ = !write_(out);
+        return !capped_ && !closed_;
+    }
+
+    size_t shown() const { return shown_; }
+    bool capped() const { return capped_; }
+    bool closed() const { return closed_; }
+
+private:
+    Write write_;
+    size_t max_rows_;
+    std::vector<size_t> widths_;
+    size_t shown_ = 0;
+    bool capped_ = false;
+    bool closed_ = false;
+
+    std::string formatRow(const std::vector<std::string>& values) const {
+        std::string line;
+        for (size_t i = 0; i < values.size(); ++i) {
+            size_t width = i < widths_.size() ? widths_[i] : values[i].size();
+            std::string value = values[i];
+            if (value.size() > width) value = width > 3 ? value.substr(0, width - 3) + "..." : value.substr(0, width);
+            if (i > 0) line += " | ";
+            line += value;
+            if (i + 1 < values.size()) line += std::string(width - value.size(), ' ');
+        }
+        return line + "\n";
+    }
+};
+
+// \batch FILE: optimize the SELECTs of a query file together, materialize the
+// subexpressions they share once, then run every query. Shared results go to the
+// column store when they and all their consumers' tables are loaded, otherwise to
+// MySQL temporary tables; both are dropped after the batch.
+static void runBatch(const std::string& path, const std::shared_ptr<MySQLConnector>& conn,
+                     const std::shared_ptr<ColumnStore>& column_store,
+                     const std::shared_ptr<StatisticsManager>& stats_mgr) {
+    std::vector<std::string> statements;
+    std::string error;
+    if (!load_query_log(path, statements, error)) {
+        std::cout << "Batch failed: " << error << "\n";
+        return;
+    }
+    std::vector<SelectQuery> batch;
+    std::vector<std::string> sql;
+    for (const auto& statement : statements) {
+        Lexer lx(statement);
+        Parser p(lx.tokenize());
+        Query q; ParseError perr;
+        if (!p.parse_query(q, perr) || !std::holds_alternative<SelectQuery>(q)) {
+            std::cout << "Skipped (not a SELECT the optimizer parses): " << statement << "\n";
+            continue;
+        }
+        batch.push_back(std::get<SelectQuery>(q));
+        sql.push_back(statement);
+    }
+
+    MultiQueryOptimizer mqo(stats_mgr);
+    auto res = mqo.optimize(batch);
+    std::cout << "\n-- Batch log --\n" << res.log;
+
+    NativeExecutor native(column_store);
+    std::vector<bool> fallback(batch.size(), false);
+    std::vector<std::string> native_results, mysql_results;
+    for (const auto& shared : res.shared) {
+        bool local = native.canExecute(shared.optimized.plan.getRoot()) &&
+                     std::all_of(shared.other_tables.begin(), shared.other_tables.end(),
+                                 [&](const std::string& t) { return column_store->table(t) != nullptr; });
+        bool ok = false;
+        if (local) {
+            NativeExecutor::Result rows;
+            if (native.execute(shared.optimized.plan.getRoot(), rows, error)) {
+                std::vector<std::string> names;
+                for (const auto& item : shared.query.select_items) names.push_back(item.alias);
+                column_store->addTable(ColumnTable::fromRows(shared.name, names, rows.rows));
+                native_results.push_back(shared.name);
+                ok = true;
+            }
+        } else if (conn->executeStatement(MultiQueryOptimizer::materializeSQL(shared))) {
+            mysql_results.push_back(shared.name);
+            ok = true;
+        }
+        std::cout << (ok ? "Materialized " : "Could not materialize ") << shared.name
+                  << (local ? " in memory" : " on MySQL") << "\n";
+        if (!ok) {
+            for (size_t q : shared.consumers) fallback[q] = true;
+        }
+    }
+
+    PlanExecutor executor(conn);
+    executor.setColumnStore(column_store);
+    Optimizer opt(stats_mgr);
+    for (size_t i = 0; i < batch.size(); ++i) {
+        OptimizeResult single;
+        if (fallback[i]) single = opt.optimize(batch[i]);
+        const OptimizeResult& plan = fallback[i] ? single : res.queries[i];
+        auto start = std::chrono::steady_clock::now();
+        auto result = executor.execute(plan.plan);
+        double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+        std::cout << "\n[" << (i + 1) << "] " << sql[i] << "\n    " << plan.rewritten_sql << "\n    ";
+        if (!result.success) {
+            std::cout << "Execution failed: " << result.error_message << "\n";
+        } else {
+            std::cout << result.rows.size() << " rows" << (result.native ? " (native)" : "") << " in " << std::fixed
+                      << std::setprecision(1) << ms << std::defaultfloat << " ms\n";
+        }
+    }
+
+    for (const auto& name : native_results) column_store->dropTable(name);
+    for (const auto& name : mysql_results) conn->executeStatement("DROP TEMPORARY TABLE IF EXISTS " + name);
+    std::cout << "\n";
+}
+
 int main(int argc, char* argv[]){
-    (void)argc; (void)argv; // suppress unused parameter warnings
     std::ios::sync_with_stdio(false);
     std::cin.tie(nullptr);
+    // A pager that quits closes its pipe; the write fails and the query is cancelled
+    std::signal(SIGPIPE, SIG_IGN);
+
+    for (int i = 1; i < argc; ++i) {
+        if (std::string(argv[i]) == "--slowlog" && i + 1 < argc) {
+            size_t top_n = 20;
+            for (int j = 1; j + 1 < argc; ++j) {
+                if (std::string(argv[j]) == "--top") top_n = std::strtoul(argv[j + 1], nullptr, 10);
+            }
+            return runSlowLogReport(argv[i + 1], top_n);
+        }
+    }
 
     Config cfg;
     // Read defaults from environment
@@ -191,14 +469,127 @@ int main(int argc, char* argv[]){
     // Load statistics from selected database
     stats_mgr->loadFromDatabase(conn->getNativeHandle(), db);
 
-    std::cout << "sqlopt> type SQL. Use EXPLAIN prefix to show plan. Ctrl-D to exit.\n";
+    // Tables copied into memory with \load; plans over them run natively
+    auto column_store = std::make_shared<ColumnStore>();
+    // Set by \\sample on: joins over loaded tables are sized from samples of them
+    std::shared_ptr<const JoinSampler> join_sampler;
+    // Set by \\pager and \\maxrows: where results are printed, and how many rows of one
+    std::string pager_command;
+    size_t max_rows = 1000;
+
+    std::cout << "sqlopt> type SQL. Use EXPLAIN prefix to show plan, EXPLAIN ANALYZE for measured rows. Ctrl-D to exit.\n";
+    std::cout << "        \\load TABLE [FILE] copies a table (from MySQL, or a tab/comma separated file) for native execution.\n";
+    std::cout << "        \\index TABLE COLUMN builds an in-memory index on a loaded column (B+tree, or ART for strings).\n";
+    std::cout << "        \\sample on|off estimates join sizes by sampling loaded tables through their indexes.\n";
+    std::cout << "        \\batch FILE runs the queries of a file together, computing shared joins and filters once.\n";
+    std::cout << "        \\pager [COMMAND] pipes results through a pager (default $PAGER or less -S), \\nopager stops.\n";
+    std::cout << "        \\maxrows N cancels a query once N rows are shown (" << max_rows << " now, 0 shows all).\n";
     std::string line;
     while(true){
         std::cout << "sql> ";
         if(!std::getline(std::cin, line)) break;
         line = trim(line);
         if(line.empty()) continue;
-        if(to_lower(line.rfind("explain",0)==0?line.substr(0,7):"")=="explain"){ line=line.substr(7); }
+        if(line.rfind("\\nopager", 0) == 0){
+            pager_command.clear();
+            std::cout << "PAGER set to stdout\n";
+            continue;
+        }
+        if(line.rfind("\\pager", 0) == 0){
+            pager_command = trim(line.substr(6));
+            if(pager_command.empty()) pager_command = std::getenv("PAGER") ? std::getenv("PAGER") : "less -S";
+            std::cout << "PAGER set to '" << pager_command << "'\n";
+            continue;
+        }
+        if(line.rfind("\\maxrows", 0) == 0){
+            std::string n = trim(line.substr(8));
+            if(n.empty() || n.find_first_not_of("0123456789") != std::string::npos){
+                std::cout << "Usage: \\maxrows N (now " << max_rows << ", 0 shows all)\n";
+                continue;
+            }
+            max_rows = std::stoul(n);
+            std::cout << (max_rows ? "Showing at most " + n + " rows per result\n" : std::string("Showing all rows\n"));
+            continue;
+        }
+        if(line.rfind("\\batch", 0) == 0){
+            std::string path = trim(line.substr(6));
+            if(path.empty()){
+                std::cout << "Usage: \\batch FILE\n";
+                continue;
+            }
+            runBatch(path, conn, column_store, stats_mgr);
+            continue;
+        }
+        if(line.rfind("\\sample", 0) == 0){
+            std::string mode = to_lower(trim(line.substr(7)));
+            if(mode != "on" && mode != "off"){
+                std::cout << "Usage: \\sample on|off (join sampling is " << (join_sampler ? "on" : "off") << ")\n";
+                continue;
+            }
+            join_sampler = mode == "on" ? std::make_shared<JoinSampler>(column_store) : nullptr;
+            std::cout << "Join sampling " << mode << "\n";
+            continue;
+        }
+        if(line.rfind("\\index", 0) == 0){
+            std::istringstream args(line);
+            std::string command, table, column;
+            args >> command >> table >> column;
+            if(column.empty()){
+                std::cout << "Usage: \\index TABLE COLUMN\n";
+                continue;
+            }
+            std::string error;
+            if(!buildNativeIndex(*column_store, *stats_mgr, table, column, error)){
+                std::cout << "Index failed: " << error << "\n";
+                continue;
+            }
+            printNativeIndex(*column_store->index(table, column), table, column);
+            continue;
+        }
+        if(line.rfind("\\load", 0) == 0 || line.rfind("\\unload", 0) == 0){
+            std::istringstream args(line);
+            std::string command, table, file;
+            args >> command >> table >> file;
+            if(table.empty()){
+                std::cout << "Usage: \\load TABLE [FILE] | \\unload TABLE\n";
+                continue;
+            }
+            if(command == "\\unload"){
+                std::cout << (column_store->dropTable(table) ? "Unloaded " : "Not loaded: ") << table << "\n";
+                continue;
+            }
+            std::string error;
+            bool ok = file.empty()
+                ? column_store->loadFromMySQL(*conn, table, error)
+                : column_store->loadFromFile(table, file, file.size() > 4 && file.substr(file.size() - 4) == ".csv" ? ',' : '\t', error);
+            if(!ok){
+                std::cout << "Load failed: " << error << "\n";
+                continue;
+            }
+            const ColumnTable* loaded = column_store->table(table);
+            std::cout << "Loaded " << loaded->name << " (" << loaded->row_count << " rows):";
+            for(const auto& column : loaded->columns) std::cout << " " << column.name() << ":" << column_type_name(column.type());
+            std::cout << "\n  " << loaded->rawBytes() / 1024 << " KB as text, " << loaded->memoryBytes() / 1024
+                      << " KB encoded\n";
+
+            // Index the leading column of each of the table's MySQL indexes
+            std::vector<std::string> indexed;
+            if(const TableStatistics* ts = stats_mgr->getTableStatsCI(table)){
+                for(const auto& idx : ts->available_indexes){
+                    if(!idx.columns.empty()) indexed.push_back(idx.columns[0]);
+                }
+            }
+            for(const auto& column : indexed){
+                if(column_store->index(table, column)) continue;
+                if(buildNativeIndex(*column_store, *stats_mgr, table, column, error)){
+                    printNativeIndex(*column_store->index(table, column), loaded->name, column);
+                }
+            }
+            continue;
+        }
+        bool analyze = false;
+        if(to_lower(line.substr(0, 15)) == "explain analyze"){ analyze = true; line = line.substr(15); }
+        else if(to_lower(line.rfind("explain",0)==0?line.substr(0,7):"")=="explain"){ line=line.substr(7); }
 
         Lexer lx(line);
         auto toks = lx.tokenize();
@@ -262,35 +653,12 @@ int main(int argc, char* argv[]){
                 }
             }
             Optimizer opt(stats_mgr);
+            opt.setJoinSampler(join_sampler);
             auto res = opt.optimize(sq);
             std::cout << "\n-- Transform log --\n" << res.log;
             std::cout << "\n--- Plan ---\n";
-            // Show plan summary to avoid segfaults
             if (res.plan.getRoot() != nullptr) {
-                std::cout << "Project(rows=" << res.plan.getCardinality() << ", cost=" << res.plan.getCost() << ", items=[";
-                if (!sq.select_items.empty()) {
-                    for (size_t i = 0; i < sq.select_items.size() && i < 3; ++i) {
-                        std::cout << sq.select_items[i].expr;
-                        if (!sq.select_items[i].alias.empty()) std::cout << " as " << sq.select_items[i].alias;
-                        if (i + 1 < sq.select_items.size() && i + 1 < 3) std::cout << ", ";
-                    }
-                    if (sq.select_items.size() > 3) std::cout << "...";
-                } else {
-                    std::cout << "*";
-                }
-                std::cout << "])\n";
-                
-                if (!sq.joins.empty()) {
-                    std::cout << "  INNER Join(algo=NESTED, rows=" << res.plan.getCardinality() << ", cost=" << res.plan.getCost() << ")\n";
-                    std::cout << "    Scan(table=" << sq.from_table.name;
-                    if (!sq.from_table.alias.empty()) std::cout << " AS " << sq.from_table.alias;
-                    std::cout << ", rows=7, cost=7)\n";
-                    std::cout << "    Scan(table=" << sq.joins[0].table.name;
-                    if (!sq.joins[0].table.alias.empty()) std::cout << " AS " << sq.joins[0].table.alias;
-                    std::cout << ", rows=7, cost=7)\n";
-                } else {
-                    std::cout << "  Scan(table=" << sq.from_table.name << ", rows=" << res.plan.getCardinality() << ", cost=" << res.plan.getCost() << ")\n";
-                }
+                res.plan.explain();
             } else {
                 std::cout << "Execution Plan (Total Cost: " << res.plan.getCost()
                           << ", Estimated Rows: " << res.plan.getCardinality() << ")\n";
@@ -300,21 +668,46 @@ int main(int argc, char* argv[]){
             std::cout << "\n--- Optimized SQL ---\n";
             std::cout << res.rewritten_sql << "\n\n";
 
-            // Execute the optimized plan on MySQL
+            // Execute the optimized plan on MySQL, printing rows as they arrive
             PlanExecutor executor(conn);
-            auto result = executor.execute(res.plan);
-            std::cout << "\n--- Execution Results ---\n";
+            executor.setColumnStore(column_store);
+            std::cout << "\n--- Execution Results ---\n" << std::flush;
+            FILE* pager = pager_command.empty() ? nullptr : popen(pager_command.c_str(), "w");
+            if (!pager_command.empty() && !pager) std::cout << "Could not start pager '" << pager_command << "'\n";
+            ResultPrinter::Write write = [](const std::string& text) {
+                std::cout << text << std::flush;
+                return true;
+            };
+            if (pager) {
+                write = [pager](const std::string& text) {
+                    return std::fwrite(text.data(), 1, text.size(), pager) == text.size() && std::fflush(pager) == 0;
+                };
+            }
+            ResultPrinter printer(write, max_rows);
+            auto result = executor.executeStreaming(res.plan, STREAM_BATCH_ROWS,
+                [&](const std::vector<std::string>& columns, const std::vector<std::vector<std::string>>& rows) {
+                    return printer.print(columns, rows);
+                });
+            if (pager) pclose(pager);
+            if (result.native) std::cout << "(executed natively over loaded tables)\n";
             if (!result.success) {
                 std::cout << "Execution failed: " << result.error_message << "\n";
-            } else if (result.rows.empty()) {
+            } else if (result.rows_streamed == 0) {
                 std::cout << "No results.\n";
             } else {
-                for (const auto& row : result.rows) {
-                    for (size_t i = 0; i < row.size(); ++i) {
-                        std::cout << row[i];
-                        if (i + 1 < row.size()) std::cout << " | ";
-                    }
-                    std::cout << "\n";
+                std::cout << "(" << printer.shown() << " rows";
+                if (printer.capped()) std::cout << ", stopped at \\maxrows " << max_rows;
+                else if (printer.closed()) std::cout << ", stopped when the pager quit";
+                if (result.cancelled && !result.native) std::cout << "; the query was cancelled on the server";
+                std::cout << "; first row after " << result.first_row_ms << " ms, " << result.execution_time_ms
+                          << " ms total)\n";
+            }
+            if (analyze) {
+                std::cout << "\n--- Plan (analyzed) ---\n";
+                if (result.native) {
+                    res.plan.explain();
+                } else {
+                    std::cout << "Actual rows are measured only when the plan runs natively over loaded tables.\n";
                 }
             }
             std::cout << "\n";
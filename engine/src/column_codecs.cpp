@@ -0,0 +1,298 @@
+#include "column_codecs.h"
+#include <algorithm>
+#include <array>
+#include <utility>
+
+namespace sqlopt {
+
+namespace {
+
+// Decoder for one bit width. The high word is shifted in two steps so an offset
+// of 0 needs no branch (a shift by 64 would be undefined).
+template <unsigned B>
+void unpackFixed(const uint64_t* words, size_t begin, size_t count, uint64_t* out) {
+    constexpr uint64_t MASK = B == 64 ? ~uint64_t(0) : (uint64_t(1) << B) - 1;
+    for (size_t i = 0; i < count; ++i) {
+        size_t bit = (begin + i) * B;
+        size_t word = bit >> 6;
+        unsigned offset = bit & 63;
+        uint64_t lo = words[word] >> offset;
+        uint64_t hi = (words[word + 1] << 1) << (63 - offset);
+        out[i] = (lo | hi) & MASK;
+    }
+}
+
+using UnpackFn = void (*)(const uint64_t*, size_t, size_t, uint64_t*);
+
+template <size_t... I>
+constexpr std::array<UnpackFn, sizeof...(I)> makeUnpackers(std::index_sequence<I...>) {
+    return {{&unpackFixed<I + 1>...}};
+}
+
+constexpr std::array<UnpackFn, 64> UNPACKERS = makeUnpackers(std::make_index_sequence<64>());
+
+constexpr size_t DECODE_BATCH = 256;
+
+uint64_t range(int64_t lo, int64_t hi) {
+    return static_cast<uint64_t>(hi) - static_cast<uint64_t>(lo);
+}
+
+bool isNull(const std::vector<bool>* nulls, size_t i) {
+    return nulls && (*nulls)[i];
+}
+
+} // namespace
+
+BitPackedArray::BitPackedArray(const std::vector<uint64_t>& values, unsigned bits)
+    : words_(bits == 0 ? 1 : (values.size() * bits + 63) / 64 + 1, 0), bits_(bits), size_(values.size()) {
+    if (bits_ == 0) return;
+    for (size_t i = 0; i < values.size(); ++i) {
+        size_t bit = i * bits_;
+        size_t word = bit >> 6;
+        unsigned offset = bit & 63;
+        words_[word] |= values[i] << offset;
+        if (offset + bits_ > 64) words_[word + 1] |= values[i] >> (64 - offset);
+    }
+}
+
+void BitPackedArray::unpack(size_t begin, size_t count, uint64_t* out) const {
+    if (bits_ == 0) {
+        std::fill(out, out + count, 0);
+        return;
+    }
+    UNPACKERS[bits_ - 1](words_.data(), begin, count, out);
+}
+
+IntChunk IntChunk::encode(const std::vector<int64_t>& values) {
+    size_t n = values.size();
+    if (n == 0) return encodeAs(values, Encoding::PLAIN);
+
+    int64_t lo = *std::min_element(values.begin(), values.end());
+    int64_t hi = *std::max_element(values.begin(), values.end());
+
+    size_t runs = 1;
+    for (size_t i = 1; i < n; ++i) runs += values[i] != values[i - 1];
+
+    // Deltas within each block; overflowing deltas rule DELTA out
+    bool delta_ok = true;
+    int64_t dmin = 0, dmax = 0;
+    bool first_delta = true;
+    for (size_t i = 1; i < n && delta_ok; ++i) {
+        if (i % DELTA_BLOCK == 0) continue;
+        int64_t d;
+        if (__builtin_sub_overflow(values[i], values[i - 1], &d)) {
+            delta_ok = false;
+            break;
+        }
+        if (first_delta) {
+            dmin = dmax = d;
+            first_delta = false;
+        }
+        dmin = std::min(dmin, d);
+        dmax = std::max(dmax, d);
+    }
+
+    // Encoded sizes in bits; on ties the earlier (cheaper to access) encoding wins
+    std::vector<std::pair<double, Encoding>> sizes = {
+        {static_cast<double>(n) * bit_width(range(lo, hi)), Encoding::FOR},
+        {static_cast<double>(runs) * (64 + 32), Encoding::RLE},
+        {static_cast<double>(n) * 64, Encoding::PLAIN},
+    };
+    if (delta_ok) {
+        double anchors = static_cast<double>((n + DELTA_BLOCK - 1) / DELTA_BLOCK) * 64;
+        sizes.insert(sizes.begin() + 2, {anchors + static_cast<double>(n) * bit_width(range(dmin, dmax)), Encoding::DELTA});
+    }
+    auto best = std::min_element(sizes.begin(), sizes.end(),
+                                 [](const auto& a, const auto& b) { return a.first < b.first; });
+    return encodeAs(values, best->second);
+}
+
+IntChunk IntChunk::encodeAs(const std::vector<int64_t>& values, Encoding encoding) {
+    IntChunk chunk;
+    chunk.rows_ = values.size();
+    chunk.encoding_ = encoding;
+    if (values.empty()) {
+        chunk.encoding_ = Encoding::PLAIN;
+        return chunk;
+    }
+    chunk.min_ = *std::min_element(values.begin(), values.end());
+    chunk.max_ = *std::max_element(values.begin(), values.end());
+
+    switch (encoding) {
+        case Encoding::FOR: {
+            chunk.base_ = chunk.min_;
+            std::vector<uint64_t> offsets(values.size());
+            for (size_t i = 0; i < values.size(); ++i) offsets[i] = range(chunk.base_, values[i]);
+            chunk.packed_ = BitPackedArray(offsets, bit_width(range(chunk.min_, chunk.max_)));
+            break;
+        }
+        case Encoding::DELTA: {
+            std::vector<int64_t> deltas(values.size(), 0);
+            int64_t dmin = 0;
+            bool first = true;
+            for (size_t i = 0; i < values.size(); ++i) {
+                if (i % DELTA_BLOCK == 0) {
+                    chunk.anchors_.push_back(values[i]);
+                    continue;
+                }
+                deltas[i] = values[i] - values[i - 1];
+                if (first || deltas[i] < dmin) dmin = deltas[i];
+                first = false;
+            }
+            chunk.base_ = dmin;
+            std::vector<uint64_t> offsets(values.size(), 0);
+            uint64_t widest = 0;
+            for (size_t i = 0; i < values.size(); ++i) {
+                if (i % DELTA_BLOCK == 0) continue;
+                offsets[i] = range(dmin, deltas[i]);
+                widest = std::max(widest, offsets[i]);
+            }
+            chunk.packed_ = BitPackedArray(offsets, bit_width(widest));
+            break;
+        }
+        case Encoding::RLE:
+            for (size_t i = 0; i < values.size(); ++i) {
+                if (i == 0 || values[i] != values[i - 1]) {
+                    chunk.run_values_.push_back(values[i]);
+                    chunk.run_ends_.push_back(static_cast<uint32_t>(i + 1));
+                } else {
+                    chunk.run_ends_.back() = static_cast<uint32_t>(i + 1);
+                }
+            }
+            break;
+        case Encoding::PLAIN:
+        case Encoding::DICTIONARY:
+            chunk.encoding_ = Encoding::PLAIN;
+            chunk.plain_ = values;
+            break;
+    }
+    return chunk;
+}
+
+int64_t IntChunk::get(size_t i) const {
+    switch (encoding_) {
+        case Encoding::FOR:
+            return static_cast<int64_t>(static_cast<uint64_t>(base_) + packed_.get(i));
+        case Encoding::DELTA: {
+            size_t block = i / DELTA_BLOCK;
+            int64_t v = anchors_[block];
+            for (size_t j = block * DELTA_BLOCK + 1; j <= i; ++j) {
+                v = static_cast<int64_t>(static_cast<uint64_t>(v) + static_cast<uint64_t>(base_) + packed_.get(j));
+            }
+            return v;
+        }
+        case Encoding::RLE: {
+            auto run = std::upper_bound(run_ends_.begin(), run_ends_.end(), static_cast<uint32_t>(i));
+            return run_values_[run - run_ends_.begin()];
+        }
+        default:
+            return plain_[i];
+    }
+}
+
+void IntChunk::decode(int64_t* out) const {
+    switch (encoding_) {
+        case Encoding::FOR: {
+            uint64_t buffer[DECODE_BATCH];
+            for (size_t begin = 0; begin < rows_; begin += DECODE_BATCH) {
+                size_t count = std::min(DECODE_BATCH, rows_ - begin);
+                packed_.unpack(begin, count, buffer);
+                for (size_t i = 0; i < count; ++i) {
+                    out[begin + i] = static_cast<int64_t>(static_cast<uint64_t>(base_) + buffer[i]);
+                }
+            }
+            break;
+        }
+        case Encoding::DELTA: {
+            uint64_t buffer[DELTA_BLOCK];
+            for (size_t block = 0; block * DELTA_BLOCK < rows_; ++block) {
+                size_t begin = block * DELTA_BLOCK;
+                size_t count = std::min(DELTA_BLOCK, rows_ - begin);
+                packed_.unpack(begin, count, buffer);
+                uint64_t v = static_cast<uint64_t>(anchors_[block]);
+                out[begin] = static_cast<int64_t>(v);
+                for (size_t i = 1; i < count; ++i) {
+                    v += static_cast<uint64_t>(base_) + buffer[i];
+                    out[begin + i] = static_cast<int64_t>(v);
+                }
+            }
+            break;
+        }
+        case Encoding::RLE: {
+            uint32_t start = 0;
+            for (size_t r = 0; r < run_values_.size(); ++r) {
+                std::fill(out + start, out + run_ends_[r], run_values_[r]);
+                start = run_ends_[r];
+            }
+            break;
+        }
+        default:
+            std::copy(plain_.begin(), plain_.end(), out);
+            break;
+    }
+}
+
+void IntChunk::selectRange(int64_t lo, int64_t hi, bool exclude, uint32_t base_row, const std::vector<bool>* nulls,
+                           std::vector<uint32_t>& out) const {
+    if (rows_ == 0) return;
+
+    // Nothing in the chunk can match: no decoding at all
+    bool disjoint = lo > hi || hi < min_ || lo > max_;
+    if (!exclude && disjoint) return;
+    bool covers = lo <= min_ && max_ <= hi;
+    if (exclude && covers) return;
+    if ((!exclude && covers) || (exclude && disjoint)) {
+        for (size_t i = 0; i < rows_; ++i) {
+            if (!isNull(nulls, i)) out.push_back(base_row + static_cast<uint32_t>(i));
+        }
+        return;
+    }
+
+    switch (encoding_) {
+        case Encoding::RLE: {
+            // One comparison per run
+            uint32_t start = 0;
+            for (size_t r = 0; r < run_values_.size(); ++r) {
+                bool in = lo <= run_values_[r] && run_values_[r] <= hi;
+                if (in != exclude) {
+                    for (uint32_t i = start; i < run_ends_[r]; ++i) {
+                        if (!isNull(nulls, i)) out.push_back(base_row + i);
+                    }
+                }
+                start = run_ends_[r];
+            }
+            return;
+        }
+        case Encoding::FOR: {
+            // Compare the packed offsets against the bounds moved into offset space
+            uint64_t olo = lo <= base_ ? 0 : range(base_, lo);
+            uint64_t ohi = range(base_, std::min(hi, max_));
+            uint64_t buffer[DECODE_BATCH];
+            for (size_t begin = 0; begin < rows_; begin += DECODE_BATCH) {
+                size_t count = std::min(DECODE_BATCH, rows_ - begin);
+                packed_.unpack(begin, count, buffer);
+                for (size_t i = 0; i < count; ++i) {
+                    bool in = olo <= buffer[i] && buffer[i] <= ohi;
+                    if (in != exclude && !isNull(nulls, begin + i)) out.push_back(base_row + static_cast<uint32_t>(begin + i));
+                }
+            }
+            return;
+        }
+        default: {
+            std::vector<int64_t> decoded(rows_);
+            decode(decoded.data());
+            for (size_t i = 0; i < rows_; ++i) {
+                bool in = lo <= decoded[i] && decoded[i] <= hi;
+                if (in != exclude && !isNull(nulls, i)) out.push_back(base_row + static_cast<uint32_t>(i));
+            }
+            return;
+        }
+    }
+}
+
+size_t IntChunk::memoryBytes() const {
+    return plain_.capacity() * sizeof(int64_t) + packed_.memoryBytes() + anchors_.capacity() * sizeof(int64_t) +
+           run_values_.capacity() * sizeof(int64_t) + run_ends_.capacity() * sizeof(uint32_t);
+}
+
+} // namespace sqlopt
@@ -0,0 +1,274 @@
+#include "column_index.h"
+#include "utils.h"
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+namespace sqlopt {
+
+std::shared_ptr<const ColumnIndex> ColumnIndex::build(const Column& column) {
+    if (column.type() == ColumnType::STRING) {
+        std::vector<std::pair<std::string, RowId>> entries;
+        entries.reserve(column.size());
+        for (RowId row = 0; row < column.size(); ++row) {
+            if (!column.isNull(row)) entries.emplace_back(to_lower(std::string(column.stringAt(row))), row);
+        }
+        std::sort(entries.begin(), entries.end());
+        return std::make_shared<ArtIndex>(entries);
+    }
+
+    std::vector<std::pair<double, RowId>> entries;
+    entries.reserve(column.size());
+    for (RowId row = 0; row < column.size(); ++row) {
+        if (!column.isNull(row)) entries.emplace_back(column.numberAt(row), row);
+    }
+    std::sort(entries.begin(), entries.end());
+    return std::make_shared<BTreeIndex>(entries);
+}
+
+// ---------------------------------------------------------------------------
+// B+tree
+
+BTreeIndex::BTreeIndex(const std::vector<std::pair<double, RowId>>& sorted) {
+    keys_.reserve(sorted.size());
+    rows_.reserve(sorted.size());
+    for (const auto& entry : sorted) {
+        keys_.push_back(entry.first);
+        rows_.push_back(entry.second);
+    }
+
+    // Largest key of each block of NODE_KEYS entries, then of each block of nodes,
+    // until one node remains
+    constexpr double PAD = std::numeric_limits<double>::infinity();
+    std::vector<double> maxima;
+    for (size_t leaf = 0; leaf * NODE_KEYS < keys_.size(); ++leaf) {
+        maxima.push_back(keys_[std::min(keys_.size(), (leaf + 1) * NODE_KEYS) - 1]);
+    }
+    size_t inner = 0, children = 0;
+    while (!maxima.empty()) {
+        std::vector<Node> level((maxima.size() + NODE_KEYS - 1) / NODE_KEYS);
+        std::vector<double> next;
+        for (size_t j = 0; j < level.size(); ++j) {
+            size_t used = std::min(NODE_KEYS, maxima.size() - j * NODE_KEYS);
+            for (size_t s = 0; s < NODE_KEYS; ++s) level[j].max_keys[s] = s < used ? maxima[j * NODE_KEYS + s] : PAD;
+            next.push_back(level[j].max_keys[used - 1]);
+            ++inner;
+            children += used;
+        }
+        levels_.push_back(std::move(level));
+        if (next.size() == 1) break;
+        maxima = std::move(next);
+    }
+    height_ = levels_.size() + 1;
+    fanout_ = inner > 0 ? static_cast<double>(children) / inner : 1.0;
+}
+
+size_t BTreeIndex::lowerBound(double key, bool strict) const {
+    if (keys_.empty()) return 0;
+    auto past = [&](double k) { return strict ? k > key : k >= key; };
+
+    // Descend into the first child whose largest key reaches `key`
+    size_t node = 0;
+    for (size_t l = levels_.size(); l-- > 0;) {
+        const Node& n = levels_[l][node];
+        size_t s = 0;
+        while (s < NODE_KEYS && !past(n.max_keys[s])) ++s;
+        if (s == NODE_KEYS) return keys_.size();
+        node = node * NODE_KEYS + s;
+    }
+    size_t begin = node * NODE_KEYS;
+    if (begin >= keys_.size()) return keys_.size();
+    size_t end = std::min(keys_.size(), begin + NODE_KEYS);
+    while (begin < end && !past(keys_[begin])) ++begin;
+    return begin;
+}
+
+void BTreeIndex::range(const Bound& lower, const Bound& upper, std::vector<RowId>& out) const {
+    size_t begin = lower.set ? lowerBound(lower.key, !lower.inclusive) : 0;
+    size_t end = upper.set ? lowerBound(upper.key, upper.inclusive) : keys_.size();
+    if (begin < end) out.insert(out.end(), rows_.begin() + begin, rows_.begin() + end);
+}
+
+size_t BTreeIndex::memoryBytes() const {
+    size_t bytes = keys_.capacity() * sizeof(double) + rows_.capacity() * sizeof(RowId);
+    for (const auto& level : levels_) bytes += level.capacity() * sizeof(Node);
+    return bytes;
+}
+
+// ---------------------------------------------------------------------------
+// Adaptive radix tree
+
+ArtIndex::ArtIndex(const std::vector<std::pair<std::string, RowId>>& sorted) {
+    rows_.reserve(sorted.size());
+    for (const auto& entry : sorted) rows_.push_back(entry.second);
+    if (sorted.empty()) return;
+
+    size_t inner = 0, children = 0;
+    height_ = 0;
+    root_ = build(sorted, 0, sorted.size(), 0, 1, inner, children);
+    fanout_ = inner > 0 ? static_cast<double>(children) / inner : 1.0;
+}
+
+ArtIndex::Ref ArtIndex::build(const std::vector<std::pair<std::string, RowId>>& sorted, size_t begin, size_t end,
+                              size_t depth, size_t level, size_t& inner_nodes, size_t& children) {
+    height_ = std::max(height_, level);
+
+    // Sorted keys share whatever the first and last share
+    const std::string& first = sorted[begin].first;
+    const std::string& last = sorted[end - 1].first;
+    size_t common = depth;
+    while (common < first.size() && common < last.size() && first[common] == last[common]) ++common;
+
+    Header h;
+    h.prefix_begin = static_cast<uint32_t>(prefixes_.size());
+    h.prefix_len = static_cast<uint32_t>(common - depth);
+    prefixes_.append(first, depth, common - depth);
+    depth = common;
+    h.begin = static_cast<uint32_t>(begin);
+    h.end = static_cast<uint32_t>(end);
+    size_t split = begin;
+    while (split < end && sorted[split].first.size() == depth) ++split; // shorter keys sort first
+    h.terminal_end = static_cast<uint32_t>(split);
+
+    // Children: one per distinct next byte
+    std::vector<std::pair<uint8_t, std::pair<size_t, size_t>>> groups;
+    for (size_t i = split; i < end;) {
+        uint8_t byte = static_cast<uint8_t>(sorted[i].first[depth]);
+        size_t j = i;
+        while (j < end && static_cast<uint8_t>(sorted[j].first[depth]) == byte) ++j;
+        groups.push_back({byte, {i, j}});
+        i = j;
+    }
+    std::vector<Ref> refs;
+    for (const auto& g : groups) {
+        refs.push_back(build(sorted, g.second.first, g.second.second, depth + 1, level + 1, inner_nodes, children));
+    }
+    if (!groups.empty()) {
+        ++inner_nodes;
+        children += groups.size();
+    }
+
+    size_t n = groups.size();
+    if (n <= 4) {
+        Node4 node;
+        node.h = h;
+        node.count = static_cast<uint8_t>(n);
+        for (size_t i = 0; i < n; ++i) {
+            node.keys[i] = groups[i].first;
+            node.children[i] = refs[i];
+        }
+        node4_.push_back(node);
+        return (NODE4 << 30) | static_cast<Ref>(node4_.size() - 1);
+    }
+    if (n <= 16) {
+        Node16 node;
+        node.h = h;
+        node.count = static_cast<uint8_t>(n);
+        for (size_t i = 0; i < n; ++i) {
+            node.keys[i] = groups[i].first;
+            node.children[i] = refs[i];
+        }
+        node16_.push_back(node);
+        return (NODE16 << 30) | static_cast<Ref>(node16_.size() - 1);
+    }
+    if (n <= 48) {
+        Node48 node;
+        node.h = h;
+        std::fill(std::begin(node.slot), std::end(node.slot), 0);
+        for (size_t i = 0; i < n; ++i) {
+            node.slot[groups[i].first] = static_cast<uint8_t>(i + 1);
+            node.children[i] = refs[i];
+        }
+        node48_.push_back(node);
+        return (NODE48 << 30) | static_cast<Ref>(node48_.size() - 1);
+    }
+    Node256 node;
+    node.h = h;
+    std::fill(std::begin(node.children), std::end(node.children), NO_CHILD);
+    for (size_t i = 0; i < n; ++i) node.children[groups[i].first] = refs[i];
+    node256_.push_back(node);
+    return (NODE256 << 30) | static_cast<Ref>(node256_.size() - 1);
+}
+
+const ArtIndex::Header& ArtIndex::header(Ref node) const {
+    uint32_t index = node & 0x3FFFFFFF;
+    switch (node >> 30) {
+        case NODE4: return node4_[index].h;
+        case NODE16: return node16_[index].h;
+        case NODE48: return node48_[index].h;
+        default: return node256_[index].h;
+    }
+}
+
+ArtIndex::Ref ArtIndex::child(Ref node, uint8_t byte) const {
+    uint32_t index = node & 0x3FFFFFFF;
+    switch (node >> 30) {
+        case NODE4: {
+            const Node4& n = node4_[index];
+            for (uint8_t i = 0; i < n.count; ++i) {
+                if (n.keys[i] == byte) return n.children[i];
+            }
+            return NO_CHILD;
+        }
+        case NODE16: {
+            // Keys are sorted: the loop stops at the first larger byte
+            const Node16& n = node16_[index];
+            for (uint8_t i = 0; i < n.count && n.keys[i] <= byte; ++i) {
+                if (n.keys[i] == byte) return n.children[i];
+            }
+            return NO_CHILD;
+        }
+        case NODE48: {
+            const Node48& n = node48_[index];
+            return n.slot[byte] ? n.children[n.slot[byte] - 1] : NO_CHILD;
+        }
+        default:
+            return node256_[index].children[byte];
+    }
+}
+
+bool ArtIndex::descend(std::string_view key, bool exact, uint32_t& begin, uint32_t& end) const {
+    Ref node = root_;
+    size_t depth = 0;
+    while (node != NO_CHILD) {
+        const Header& h = header(node);
+        std::string_view prefix(prefixes_.data() + h.prefix_begin, h.prefix_len);
+        size_t rest = key.size() - depth;
+        if (rest < prefix.size()) {
+            // The key ends inside the compressed path: only a prefix search can match
+            if (exact || prefix.compare(0, rest, key.substr(depth)) != 0) return false;
+            begin = h.begin;
+            end = h.end;
+            return true;
+        }
+        if (key.compare(depth, prefix.size(), prefix) != 0) return false;
+        depth += prefix.size();
+        if (depth == key.size()) {
+            begin = h.begin;
+            end = exact ? h.terminal_end : h.end;
+            return begin < end;
+        }
+        node = child(node, static_cast<uint8_t>(key[depth]));
+        ++depth;
+    }
+    return false;
+}
+
+void ArtIndex::lookup(std::string_view key, std::vector<RowId>& out) const {
+    std::string folded = to_lower(std::string(key));
+    uint32_t begin, end;
+    if (descend(folded, true, begin, end)) out.insert(out.end(), rows_.begin() + begin, rows_.begin() + end);
+}
+
+void ArtIndex::prefix(std::string_view prefix, std::vector<RowId>& out) const {
+    std::string folded = to_lower(std::string(prefix));
+    uint32_t begin, end;
+    if (descend(folded, false, begin, end)) out.insert(out.end(), rows_.begin() + begin, rows_.begin() + end);
+}
+
+size_t ArtIndex::memoryBytes() const {
+    return rows_.capacity() * sizeof(RowId) + node4_.capacity() * sizeof(Node4) + node16_.capacity() * sizeof(Node16) +
+           node48_.capacity() * sizeof(Node48) + node256_.capacity() * sizeof(Node256) + prefixes_.capacity();
+}
+
+} // namespace sqlopt
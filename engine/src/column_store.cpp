@@ -0,0 +1,653 @@
+#include "column_store.h"
+#include "column_index.h"
+#include "mysql_connector.h"
+#include "utils.h"
+#include <cerrno>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <limits>
+
+namespace sqlopt {
+
+namespace {
+
+const char* const NULL_TOKEN = "\\N";
+
+bool parsesAsInt(const std::string& s) {
+    if (s.empty()) return false;
+    errno = 0;
+    char* end = nullptr;
+    std::strtoll(s.c_str(), &end, 10);
+    return errno == 0 && *end == '\0';
+}
+
+bool parsesAsDouble(const std::string& s) {
+    if (s.empty()) return false;
+    errno = 0;
+    char* end = nullptr;
+    std::strtod(s.c_str(), &end);
+    return errno == 0 && *end == '\0';
+}
+
+std::vector<std::string> splitLine(const std::string& line, char delimiter) {
+    std::vector<std::string> fields;
+    size_t start = 0;
+    while (true) {
+        size_t end = line.find(delimiter, start);
+        if (end == std::string::npos) {
+            fields.push_back(line.substr(start));
+            break;
+        }
+        fields.push_back(line.substr(start, end - start));
+        start = end + 1;
+    }
+    if (!fields.empty() && !fields.back().empty() && fields.back().back() == '\r') fields.back().pop_back();
+    return fields;
+}
+
+} // namespace
+
+bool parse_date(const std::string& text, int64_t& days) {
+    if (text.size() != 10 || text[4] != '-' || text[7] != '-') return false;
+    for (size_t i : {0, 1, 2, 3, 5, 6, 8, 9}) {
+        if (!std::isdigit(static_cast<unsigned char>(text[i]))) return false;
+    }
+    int64_t y = std::stoi(text.substr(0, 4));
+    unsigned m = std::stoi(text.substr(5, 2));
+    unsigned d = std::stoi(text.substr(8, 2));
+    if (m < 1 || m > 12 || d < 1 || d > 31) return false;
+
+    // Days from civil (proleptic Gregorian), after H. Hinnant
+    y -= m <= 2;
+    int64_t era = (y >= 0 ? y : y - 399) / 400;
+    unsigned yoe = static_cast<unsigned>(y - era * 400);
+    unsigned doy = (153 * (m + (m > 2 ? -3 : 9)) + 2) / 5 + d - 1;
+    unsigned doe = yoe * 365 + yoe / 4 - yoe / 100 + doy;
+    days = era * 146097 + static_cast<int64_t>(doe) - 719468;
+    return true;
+}
+
+std::string format_date(int64_t days) {
+    days += 719468;
+    int64_t era = (days >= 0 ? days : days - 146096) / 146097;
+    unsigned doe = static_cast<unsigned>(days - era * 146097);
+    unsigned yoe = (doe - doe / 1460 + doe / 36524 - doe / 146096) / 365;
+    int64_t y = static_cast<int64_t>(yoe) + era * 400;
+    unsigned doy = doe - (365 * yoe + yoe / 4 - yoe / 100);
+    unsigned mp = (5 * doy + 2) / 153;
+    unsigned d = doy - (153 * mp + 2) / 5 + 1;
+    unsigned m = mp < 10 ? mp + 3 : mp - 9;
+    y += m <= 2;
+
+    char buffer[32];
+    std::snprintf(buffer, sizeof(buffer), "%04d-%02u-%02u", static_cast<int>(y), m, d);
+    return buffer;
+}
+
+int compare_nocase(std::string_view a, std::string_view b) {
+    size_t n = std::min(a.size(), b.size());
+    for (size_t i = 0; i < n; ++i) {
+        int ca = std::tolower(static_cast<unsigned char>(a[i]));
+        int cb = std::tolower(static_cast<unsigned char>(b[i]));
+        if (ca != cb) return ca < cb ? -1 : 1;
+    }
+    return a.size() < b.size() ? -1 : a.size() > b.size() ? 1 : 0;
+}
+
+namespace {
+
+constexpr int MAX_DECIMAL_SCALE = 4;
+
+double pow10(int scale) {
+    double p = 1.0;
+    for (int i = 0; i < scale; ++i) p *= 10.0;
+    return p;
+}
+
+// Smallest scale s such that every value is an integer number of 10^-s units
+// (a DECIMAL column such as an amount in cents), or -1
+int decimalScale(const std::vector<double>& values, const std::vector<bool>& nulls) {
+    for (int scale = 0; scale <= MAX_DECIMAL_SCALE; ++scale) {
+        double p = pow10(scale);
+        bool exact = true;
+        for (size_t i = 0; i < values.size() && exact; ++i) {
+            if (nulls[i]) continue;
+            double scaled = values[i] * p;
+            exact = std::fabs(scaled) < 9.0e15 && static_cast<double>(std::llround(scaled)) / p == values[i];
+        }
+        if (exact) return scale;
+    }
+    return -1;
+}
+
+// Integer-domain bounds of `v op literal` for values stored as v * 10^scale:
+// rows with lo <= v <= hi match (or do not, when exclude is set). False when no row can match.
+bool integerRange(CompareOp op, double literal, int scale, int64_t& lo, int64_t& hi, bool& exclude) {
+    constexpr double LIMIT = 9.0e18;
+    double p = pow10(scale < 0 ? 0 : scale);
+    double y = literal * p;
+    if (!(std::fabs(y) < LIMIT)) {
+        // Beyond the int64 range: every value is on the same side of the literal
+        bool above = y > 0;
+        lo = std::numeric_limits<int64_t>::min();
+        hi = std::numeric_limits<int64_t>::max();
+        exclude = false;
+        switch (op) {
+            case CompareOp::LT: case CompareOp::LE: case CompareOp::NE: return above;
+            case CompareOp::GT: case CompareOp::GE: return !above;
+            default: return false;
+        }
+    }
+    int64_t r = std::llround(y);
+    bool exact = static_cast<double>(r) / p == literal;
+    int64_t floor_y = exact ? r : static_cast<int64_t>(std::floor(y));
+    int64_t ceil_y = exact ? r : static_cast<int64_t>(std::ceil(y));
+
+    lo = std::numeric_limits<int64_t>::min();
+    hi = std::numeric_limits<int64_t>::max();
+    exclude = false;
+    switch (op) {
+        case CompareOp::EQ:
+            if (!exact) return false;
+            lo = hi = r;
+            return true;
+        case CompareOp::NE:
+            if (exact) {
+                lo = hi = r;
+                exclude = true;
+            }
+            return true;
+        case CompareOp::LT: hi = ceil_y - 1; return true;
+        case CompareOp::LE: hi = floor_y; return true;
+        case CompareOp::GT: lo = floor_y + 1; return true;
+        case CompareOp::GE: lo = ceil_y; return true;
+        default: return false;
+    }
+}
+
+bool compareDoubles(double v, CompareOp op, double literal) {
+    switch (op) {
+        case CompareOp::EQ: return v == literal;
+        case CompareOp::NE: return v != literal;
+        case CompareOp::LT: return v < literal;
+        case CompareOp::LE: return v <= literal;
+        case CompareOp::GT: return v > literal;
+        case CompareOp::GE: return v >= literal;
+        default: return false;
+    }
+}
+
+bool caseInsensitiveLess(const std::string& a, const std::string& b) {
+    int cmp = compare_nocase(a, b);
+    return cmp != 0 ? cmp < 0 : a < b;
+}
+
+template <typename T>
+size_t countDistinct(const std::vector<T>& values, const std::vector<bool>& nulls) {
+    std::vector<T> present;
+    present.reserve(values.size());
+    for (size_t i = 0; i < values.size(); ++i) {
+        if (!nulls[i]) present.push_back(values[i]);
+    }
+    std::sort(present.begin(), present.end());
+    return std::unique(present.begin(), present.end()) - present.begin();
+}
+
+// Whether some value in [min, max] can satisfy `value op literal`, given cmp_min and
+// cmp_max, the comparisons of min and max with the literal
+bool rangeMayMatch(CompareOp op, int cmp_min, int cmp_max) {
+    switch (op) {
+        case CompareOp::EQ: return cmp_min <= 0 && cmp_max >= 0;
+        case CompareOp::NE: return !(cmp_min == 0 && cmp_max == 0); // unless every value equals it
+        case CompareOp::LT: return cmp_min < 0;
+        case CompareOp::LE: return cmp_min <= 0;
+        case CompareOp::GT: return cmp_max > 0;
+        case CompareOp::GE: return cmp_max >= 0;
+        default: return true;
+    }
+}
+
+int compareNumbers(double a, double b) {
+    return a < b ? -1 : a > b ? 1 : 0;
+}
+
+} // namespace
+
+void Column::append(const char* value) {
+    bool null = value == nullptr;
+    pending_nulls_.push_back(null);
+    switch (type_) {
+        case ColumnType::INT:
+            pending_ints_.push_back(null ? 0 : std::strtoll(value, nullptr, 10));
+            raw_bytes_ += sizeof(int64_t);
+            break;
+        case ColumnType::DATE: {
+            int64_t days = 0;
+            if (!null) parse_date(value, days);
+            pending_ints_.push_back(days);
+            raw_bytes_ += sizeof(int64_t);
+            break;
+        }
+        case ColumnType::DOUBLE:
+            pending_doubles_.push_back(null ? 0.0 : std::strtod(value, nullptr));
+            raw_bytes_ += sizeof(double);
+            break;
+        case ColumnType::STRING:
+            pending_strings_.emplace_back(null ? "" : value);
+            raw_bytes_ += pending_strings_.back().size() + sizeof(uint32_t);
+            break;
+    }
+    ++rows_;
+    if (pending_nulls_.size() == CHUNK_ROWS) seal();
+}
+
+void Column::finish() {
+    if (!pending_nulls_.empty()) seal();
+}
+
+void Column::seal() {
+    Chunk chunk;
+    chunk.rows = pending_nulls_.size();
+    chunk.null_count = std::count(pending_nulls_.begin(), pending_nulls_.end(), true);
+    if (chunk.null_count > 0) chunk.nulls = pending_nulls_;
+
+    // NULL slots repeat the previous value so they widen neither the range nor the runs
+    auto fillNulls = [&](auto& values) {
+        size_t first = std::find(pending_nulls_.begin(), pending_nulls_.end(), false) - pending_nulls_.begin();
+        if (first == values.size()) return;
+        for (size_t i = 0; i < values.size(); ++i) {
+            if (pending_nulls_[i]) values[i] = values[i == 0 ? first : i - 1];
+        }
+    };
+
+    ZoneMap& zone = chunk.zone;
+    zone.rows = chunk.rows;
+    zone.null_count = chunk.null_count;
+    bool any_value = chunk.null_count < chunk.rows;
+
+    switch (type_) {
+        case ColumnType::INT:
+        case ColumnType::DATE:
+            fillNulls(pending_ints_);
+            chunk.ints = IntChunk::encode(pending_ints_);
+            chunk.encoding = chunk.ints.encoding();
+            if (any_value) {
+                zone.min = static_cast<double>(chunk.ints.min());
+                zone.max = static_cast<double>(chunk.ints.max());
+                zone.distinct = countDistinct(pending_ints_, pending_nulls_);
+            }
+            break;
+        case ColumnType::DOUBLE: {
+            fillNulls(pending_doubles_);
+            if (any_value) {
+                zone.min = *std::min_element(pending_doubles_.begin(), pending_doubles_.end());
+                zone.max = *std::max_element(pending_doubles_.begin(), pending_doubles_.end());
+                zone.distinct = countDistinct(pending_doubles_, pending_nulls_);
+            }
+            chunk.scale = decimalScale(pending_doubles_, pending_nulls_);
+            if (chunk.scale >= 0) {
+                double p = pow10(chunk.scale);
+                std::vector<int64_t> scaled(pending_doubles_.size());
+                for (size_t i = 0; i < scaled.size(); ++i) scaled[i] = std::llround(pending_doubles_[i] * p);
+                chunk.ints = IntChunk::encode(scaled);
+                chunk.encoding = chunk.ints.encoding();
+            } else {
+                chunk.doubles = pending_doubles_;
+            }
+            break;
+        }
+        case ColumnType::STRING: {
+            fillNulls(pending_strings_);
+            std::vector<std::string> dictionary = pending_strings_;
+            std::sort(dictionary.begin(), dictionary.end(), caseInsensitiveLess);
+            dictionary.erase(std::unique(dictionary.begin(), dictionary.end()), dictionary.end());
+            if (any_value) {
+                // NULL slots hold copies of other values, so the dictionary has only real ones
+                zone.min_text = dictionary.front();
+                zone.max_text = dictionary.back();
+                zone.distinct = dictionary.size();
+            }
+
+            // Codes pay off unless almost every value is distinct
+            if (dictionary.size() <= chunk.rows / 2) {
+                std::vector<int64_t> codes(chunk.rows);
+                for (size_t i = 0; i < chunk.rows; ++i) {
+                    codes[i] = std::lower_bound(dictionary.begin(), dictionary.end(), pending_strings_[i],
+                                                caseInsensitiveLess) - dictionary.begin();
+                }
+                chunk.ints = IntChunk::encode(codes);
+                chunk.dictionary = std::move(dictionary);
+                chunk.dictionary.shrink_to_fit();
+                chunk.encoding = Encoding::DICTIONARY;
+            } else {
+                chunk.offsets.reserve(chunk.rows + 1);
+                chunk.offsets.push_back(0);
+                for (const auto& value : pending_strings_) {
+                    chunk.bytes += value;
+                    chunk.offsets.push_back(static_cast<uint32_t>(chunk.bytes.size()));
+                }
+                chunk.bytes.shrink_to_fit();
+            }
+            break;
+        }
+    }
+    chunks_.push_back(std::move(chunk));
+
+    pending_ints_.clear();
+    pending_doubles_.clear();
+    pending_strings_.clear();
+    pending_nulls_.clear();
+}
+
+double Column::numberAt(RowId row) const {
+    const Chunk& c = chunks_[row / CHUNK_ROWS];
+    size_t i = row % CHUNK_ROWS;
+    if (type_ == ColumnType::DOUBLE) {
+        return c.scale >= 0 ? static_cast<double>(c.ints.get(i)) / pow10(c.scale) : c.doubles[i];
+    }
+    return static_cast<double>(c.ints.get(i));
+}
+
+std::string_view Column::stringAt(RowId row) const {
+    const Chunk& c = chunks_[row / CHUNK_ROWS];
+    size_t i = row % CHUNK_ROWS;
+    if (c.encoding == Encoding::DICTIONARY) return c.dictionary[c.ints.get(i)];
+    return std::string_view(c.bytes).substr(c.offsets[i], c.offsets[i + 1] - c.offsets[i]);
+}
+
+std::string Column::valueAt(RowId row) const {
+    if (isNull(row)) return "NULL";
+    const Chunk& c = chunks_[row / CHUNK_ROWS];
+    switch (type_) {
+        case ColumnType::INT: return std::to_string(c.ints.get(row % CHUNK_ROWS));
+        case ColumnType::DATE: return format_date(c.ints.get(row % CHUNK_ROWS));
+        case ColumnType::DOUBLE: {
+            char buffer[64];
+            if (c.scale >= 0) {
+                std::snprintf(buffer, sizeof(buffer), "%.*f", c.scale, numberAt(row));
+            } else {
+                std::snprintf(buffer, sizeof(buffer), "%.15g", numberAt(row));
+            }
+            return buffer;
+        }
+        case ColumnType::STRING: return std::string(stringAt(row));
+    }
+    return "";
+}
+
+bool Column::chunkMayMatch(size_t chunk, CompareOp op, double literal) const {
+    const ZoneMap& z = chunks_[chunk].zone;
+    if (op == CompareOp::IS_NULL) return z.null_count > 0;
+    if (op == CompareOp::IS_NOT_NULL) return z.null_count < z.rows;
+    if (z.null_count == z.rows) return false; // comparisons with NULL are never true
+    return rangeMayMatch(op, compareNumbers(z.min, literal), compareNumbers(z.max, literal));
+}
+
+bool Column::chunkMayMatch(size_t chunk, CompareOp op, const std::string& literal) const {
+    const ZoneMap& z = chunks_[chunk].zone;
+    if (op == CompareOp::IS_NULL) return z.null_count > 0;
+    if (op == CompareOp::IS_NOT_NULL) return z.null_count < z.rows;
+    if (z.null_count == z.rows) return false;
+    return rangeMayMatch(op, compare_nocase(z.min_text, literal), compare_nocase(z.max_text, literal));
+}
+
+size_t Column::select(CompareOp op, double literal, std::vector<RowId>& out) const {
+    size_t examined = 0;
+    for (size_t k = 0; k < chunks_.size(); ++k) {
+        if (!chunkMayMatch(k, op, literal)) continue;
+        const Chunk& c = chunks_[k];
+        examined += c.rows;
+        RowId base = static_cast<RowId>(k * CHUNK_ROWS);
+        const std::vector<bool>* nulls = c.null_count > 0 ? &c.nulls : nullptr;
+
+        if (type_ == ColumnType::DOUBLE && c.scale < 0) {
+            for (size_t i = 0; i < c.rows; ++i) {
+                if ((!nulls || !c.nulls[i]) && compareDoubles(c.doubles[i], op, literal)) out.push_back(base + i);
+            }
+            continue;
+        }
+        int64_t lo, hi;
+        bool exclude;
+        if (!integerRange(op, literal, type_ == ColumnType::DOUBLE ? c.scale : 0, lo, hi, exclude)) continue;
+        c.ints.selectRange(lo, hi, exclude, base, nulls, out);
+    }
+    return examined;
+}
+
+size_t Column::select(CompareOp op, const std::string& literal, std::vector<RowId>& out) const {
+    size_t examined = 0;
+    for (size_t k = 0; k < chunks_.size(); ++k) {
+        if (!chunkMayMatch(k, op, literal)) continue;
+        const Chunk& c = chunks_[k];
+        examined += c.rows;
+        RowId base = static_cast<RowId>(k * CHUNK_ROWS);
+        const std::vector<bool>* nulls = c.null_count > 0 ? &c.nulls : nullptr;
+
+        if (c.encoding != Encoding::DICTIONARY) {
+            for (size_t i = 0; i < c.rows; ++i) {
+                if (nulls && c.nulls[i]) continue;
+                int cmp = compare_nocase(std::string_view(c.bytes).substr(c.offsets[i], c.offsets[i + 1] - c.offsets[i]),
+                                         literal);
+                bool match = op == CompareOp::EQ ? cmp == 0 : op == CompareOp::NE ? cmp != 0 :
+                             op == CompareOp::LT ? cmp < 0 : op == CompareOp::LE ? cmp <= 0 :
+                             op == CompareOp::GT ? cmp > 0 : op == CompareOp::GE && cmp >= 0;
+                if (match) out.push_back(base + i);
+            }
+            continue;
+        }
+
+        // The dictionary is sorted case-insensitively, so the entries equal to the
+        // literal are one code range [first, last) and any comparison is a code range
+        auto ci_less = [](const std::string& a, const std::string& b) { return compare_nocase(a, b) < 0; };
+        int64_t first = std::lower_bound(c.dictionary.begin(), c.dictionary.end(), literal, ci_less) - c.dictionary.begin();
+        int64_t last = std::upper_bound(c.dictionary.begin(), c.dictionary.end(), literal, ci_less) - c.dictionary.begin();
+        int64_t top = static_cast<int64_t>(c.dictionary.size()) - 1;
+        int64_t lo = 0, hi = top;
+        bool exclude = false;
+        switch (op) {
+            case CompareOp::EQ: lo = first; hi = last - 1; break;
+            case CompareOp::NE: lo = first; hi = last - 1; exclude = true; break;
+            case CompareOp::LT: hi = first - 1; break;
+            case CompareOp::LE: hi = last - 1; break;
+            case CompareOp::GT: lo = last; break;
+            case CompareOp::GE: lo = first; break;
+            default: continue;
+        }
+        if (exclude && lo > hi) {
+            c.ints.selectRange(0, top, false, base, nulls, out);
+        } else {
+            c.ints.selectRange(lo, hi, exclude, base, nulls, out);
+        }
+    }
+    return examined;
+}
+
+size_t Column::memoryBytes() const {
+    size_t bytes = 0;
+    auto stringBytes = [](const std::vector<std::string>& v) {
+        size_t b = v.capacity() * sizeof(std::string);
+        for (const auto& s : v) {
+            if (s.capacity() >= sizeof(std::string)) b += s.capacity() + 1; // beyond the inline buffer
+        }
+        return b;
+    };
+    for (const auto& c : chunks_) {
+        bytes += sizeof(Chunk) + c.nulls.capacity() / 8 + c.ints.memoryBytes() + c.doubles.capacity() * sizeof(double) +
+                 c.bytes.capacity() + c.offsets.capacity() * sizeof(uint32_t) + stringBytes(c.dictionary) +
+                 c.zone.min_text.capacity() + c.zone.max_text.capacity();
+    }
+    return bytes;
+}
+
+int ColumnTable::columnIndex(const std::string& column) const {
+    std::string wanted = to_lower(column);
+    for (size_t i = 0; i < columns.size(); ++i) {
+        if (to_lower(columns[i].name()) == wanted) return static_cast<int>(i);
+    }
+    return -1;
+}
+
+size_t ColumnTable::memoryBytes() const {
+    size_t bytes = 0;
+    for (const auto& column : columns) bytes += column.memoryBytes();
+    return bytes;
+}
+
+size_t ColumnTable::rawBytes() const {
+    size_t bytes = 0;
+    for (const auto& column : columns) bytes += column.rawBytes();
+    return bytes;
+}
+
+ColumnTable ColumnTable::fromRows(const std::string& name, const std::vector<std::string>& column_names,
+                                  const std::vector<std::vector<std::string>>& rows) {
+    ColumnTable table;
+    table.name = name;
+    table.row_count = rows.size();
+
+    for (size_t c = 0; c < column_names.size(); ++c) {
+        bool all_int = true, all_double = true, all_date = true;
+        int64_t days;
+        for (const auto& row : rows) {
+            if (c >= row.size() || row[c] == NULL_TOKEN) continue;
+            if (all_date && !parse_date(row[c], days)) all_date = false;
+            if (all_int && !parsesAsInt(row[c])) all_int = false;
+            if (!all_int && all_double && !parsesAsDouble(row[c])) all_double = false;
+            if (!all_int && !all_double && !all_date) break;
+        }
+        ColumnType type = all_int ? ColumnType::INT : all_double ? ColumnType::DOUBLE
+                        : all_date ? ColumnType::DATE : ColumnType::STRING;
+
+        Column column(column_names[c], type);
+        for (const auto& row : rows) {
+            column.append(c >= row.size() || row[c] == NULL_TOKEN ? nullptr : row[c].c_str());
+        }
+        column.finish();
+        table.columns.push_back(std::move(column));
+    }
+    return table;
+}
+
+bool ColumnStore::loadFromMySQL(MySQLConnector& conn, const std::string& table, std::string& error) {
+    MYSQL* mysql = conn.getNativeHandle();
+    if (!mysql) {
+        error = "not connected";
+        return false;
+    }
+
+    std::string sql = "SELECT * FROM `" + table + "`";
+    if (mysql_query(mysql, sql.c_str()) != 0) {
+        error = mysql_error(mysql);
+        return false;
+    }
+    // Stream the rows instead of buffering the whole result client-side twice
+    MYSQL_RES* res = mysql_use_result(mysql);
+    if (!res) {
+        error = mysql_error(mysql);
+        return false;
+    }
+
+    unsigned int num_fields = mysql_num_fields(res);
+    MYSQL_FIELD* fields = mysql_fetch_fields(res);
+    std::vector<std::string> column_names;
+    for (unsigned int i = 0; i < num_fields; ++i) column_names.push_back(fields[i].name);
+
+    std::vector<std::vector<std::string>> rows;
+    MYSQL_ROW row;
+    while ((row = mysql_fetch_row(res))) {
+        std::vector<std::string> values;
+        values.reserve(num_fields);
+        for (unsigned int i = 0; i < num_fields; ++i) values.emplace_back(row[i] ? row[i] : NULL_TOKEN);
+        rows.push_back(std::move(values));
+    }
+    bool ok = mysql_errno(mysql) == 0;
+    if (!ok) error = mysql_error(mysql);
+    mysql_free_result(res);
+    if (!ok) return false;
+
+    addTable(ColumnTable::fromRows(table, column_names, rows));
+    return true;
+}
+
+bool ColumnStore::loadFromFile(const std::string& table, const std::string& path, char delimiter,
+                               std::string& error) {
+    std::ifstream in(path);
+    if (!in) {
+        error = "cannot open " + path;
+        return false;
+    }
+
+    std::string line;
+    if (!std::getline(in, line)) {
+        error = path + " is empty";
+        return false;
+    }
+    std::vector<std::string> column_names = splitLine(line, delimiter);
+
+    std::vector<std::vector<std::string>> rows;
+    while (std::getline(in, line)) {
+        if (line.empty()) continue;
+        rows.push_back(splitLine(line, delimiter));
+        if (rows.back().size() != column_names.size()) {
+            error = path + ": line " + std::to_string(rows.size() + 1) + " has " +
+                    std::to_string(rows.back().size()) + " fields, expected " + std::to_string(column_names.size());
+            return false;
+        }
+    }
+
+    addTable(ColumnTable::fromRows(table, column_names, rows));
+    return true;
+}
+
+void ColumnStore::addTable(ColumnTable table) {
+    std::string key = to_lower(table.name);
+    dropIndexes(key);
+    tables_[key] = std::make_shared<const ColumnTable>(std::move(table));
+}
+
+bool ColumnStore::dropTable(const std::string& table) {
+    dropIndexes(to_lower(table));
+    return tables_.erase(to_lower(table)) > 0;
+}
+
+bool ColumnStore::createIndex(const std::string& table, const std::string& column, std::string& error) {
+    const ColumnTable* loaded = this->table(table);
+    if (!loaded) {
+        error = "table " + table + " is not loaded";
+        return false;
+    }
+    int index = loaded->columnIndex(column);
+    if (index < 0) {
+        error = "no column " + column + " in " + loaded->name;
+        return false;
+    }
+    indexes_[to_lower(loaded->name) + "." + to_lower(column)] = ColumnIndex::build(loaded->columns[index]);
+    return true;
+}
+
+const ColumnIndex* ColumnStore::index(const std::string& table, const std::string& column) const {
+    auto it = indexes_.find(to_lower(table) + "." + to_lower(column));
+    return it == indexes_.end() ? nullptr : it->second.get();
+}
+
+void ColumnStore::dropIndexes(const std::string& table) {
+    std::string prefix = table + ".";
+    for (auto it = indexes_.lower_bound(prefix); it != indexes_.end() && it->first.compare(0, prefix.size(), prefix) == 0;) {
+        it = indexes_.erase(it);
+    }
+}
+
+const ColumnTable* ColumnStore::table(const std::string& name) const {
+    auto it = tables_.find(to_lower(name));
+    return it == tables_.end() ? nullptr : it->second.get();
+}
+
+std::vector<std::string> ColumnStore::tableNames() const {
+    std::vector<std::string> names;
+    for (const auto& kv : tables_) names.push_back(kv.second->name);
+    return names;
+}
+
+} // namespace sqlopt
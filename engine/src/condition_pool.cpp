@@ -0,0 +1,27 @@
+#include "condition_pool.h"
+
+namespace sqlopt {
+
+ConditionId ConditionPool::intern(const std::string& text) {
+    // A query has tens of conditions at most: a scan beats hashing every text
+    for (size_t i = 0; i < entries_.size(); ++i) {
+        if (entries_[i].text == text) return static_cast<ConditionId>(i);
+    }
+
+    ConditionEntry entry;
+    entry.text = text;
+    entry.tree = parse_expression(text);
+    // Without a query to bind against, the tables it reads are unknown
+    if (bound_) entry.binding = bound_->bindPredicate(entry.tree.get());
+    else entry.binding.opaque = true;
+    entries_.push_back(std::move(entry));
+    return static_cast<ConditionId>(entries_.size() - 1);
+}
+
+ConditionList ConditionPool::addList(const std::vector<std::string>& conditions) {
+    uint32_t first = static_cast<uint32_t>(slots_.size());
+    for (const auto& cond : conditions) slots_.push_back(intern(cond));
+    return ConditionList(shared_from_this(), first, static_cast<uint32_t>(conditions.size()));
+}
+
+} // namespace sqlopt
@@ -0,0 +1,408 @@
+#include "data_generator.h"
+#include "utils.h"
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <cstdio>
+#include <fstream>
+#include <sstream>
+#include <thread>
+
+namespace sqlopt {
+
+namespace {
+
+enum class ValueKind {
+    SERIAL,      // row + 1
+    REFERENCE,   // key of another table, Zipf over `ndv` of its keys
+    CLUSTERED,   // key of another table, rising with the row (children stored by parent)
+    LABEL,       // prefix + one of exactly `ndv` numbers
+    RANGE,       // low + uniform in [0, ndv)
+    CATEGORY,    // prefix + one of `ndv` numbers, Zipf
+    CODE,        // unique opaque string
+    ORDER_DATE,  // rises with the row over `ndv` days
+    STATUS,      // drawn by the row's order_date: recent orders are still in flight
+    AMOUNT       // grows with the age of the row's user
+};
+
+const char* const STATUSES[] = {"delivered", "paid", "shipped", "pending", "cancelled"};
+const char* const FIRST_DAY = "2023-01-01";
+
+uint64_t splitmix64(uint64_t x) {
+    x += 0x9E3779B97F4A7C15ULL;
+    x = (x ^ (x >> 30)) * 0xBF58476D1CE4E5B9ULL;
+    x = (x ^ (x >> 27)) * 0x94D049BB133111EBULL;
+    return x ^ (x >> 31);
+}
+
+// Bijection of [0, n) that scatters consecutive values, so the most frequent
+// Zipf ranks are not simply the smallest keys (n < 2^32, so the prime is coprime to n)
+uint64_t permute(uint64_t value, uint64_t n) {
+    return (value % n) * 2654435761ULL % n;
+}
+
+struct GeneratedColumn {
+    std::string name;
+    ColumnType type;
+    ValueKind kind;
+    uint64_t table_rows = 0;
+    uint64_t ndv = 0;
+    int64_t low = 0;
+    std::string prefix;
+    const GeneratedTable* ref = nullptr;    // REFERENCE, CLUSTERED
+    const GeneratedColumn* user = nullptr;  // AMOUNT: the row's user key
+    const GeneratedColumn* age = nullptr;   // AMOUNT: users.age
+    const GeneratedColumn* date = nullptr;  // STATUS: the row's order_date
+    std::vector<double> zipf_cdf;           // REFERENCE, CATEGORY when skewed
+    uint64_t salt = 0;
+};
+
+} // namespace
+
+struct GeneratedTable {
+    std::string name;
+    uint64_t rows = 0;
+    std::vector<std::unique_ptr<GeneratedColumn>> columns;
+    std::vector<std::vector<std::string>> indexes;
+};
+
+namespace {
+
+// Value generation, shared by the file and column store writers
+struct Values {
+    uint64_t seed;
+    int64_t first_day;
+
+    double uniform(const GeneratedColumn& c, uint64_t row) const {
+        return (splitmix64(seed ^ c.salt ^ splitmix64(row)) >> 11) * 0x1.0p-53;
+    }
+
+    uint64_t rank(const GeneratedColumn& c, uint64_t row) const {
+        double u = uniform(c, row);
+        if (c.zipf_cdf.empty()) return std::min(c.ndv - 1, static_cast<uint64_t>(u * c.ndv));
+        return static_cast<uint64_t>(std::upper_bound(c.zipf_cdf.begin(), c.zipf_cdf.end() - 1, u) - c.zipf_cdf.begin());
+    }
+
+    int64_t integer(const GeneratedColumn& c, uint64_t row) const {
+        switch (c.kind) {
+            case ValueKind::SERIAL: return static_cast<int64_t>(row + 1);
+            case ValueKind::REFERENCE: return static_cast<int64_t>(1 + permute(rank(c, row), c.ref->rows));
+            case ValueKind::CLUSTERED: return static_cast<int64_t>(1 + row * c.ref->rows / c.table_rows);
+            case ValueKind::RANGE: return c.low + static_cast<int64_t>(uniform(c, row) * c.ndv);
+            case ValueKind::ORDER_DATE: return first_day + static_cast<int64_t>(row * c.ndv / c.table_rows);
+            default: return 0;
+        }
+    }
+
+    void text(const GeneratedColumn& c, uint64_t row, std::string& out) const {
+        char buffer[64];
+        switch (c.kind) {
+            case ValueKind::LABEL:
+                out += c.prefix;
+                out += std::to_string(1 + permute(row % c.ndv, c.ndv));
+                return;
+            case ValueKind::CATEGORY:
+                out += c.prefix;
+                out += std::to_string(1 + rank(c, row));
+                return;
+            case ValueKind::CODE:
+                std::snprintf(buffer, sizeof(buffer), "%s%012llx", c.prefix.c_str(),
+                              static_cast<unsigned long long>(splitmix64(c.salt ^ row) & 0xFFFFFFFFFFFFULL));
+                out += buffer;
+                return;
+            case ValueKind::ORDER_DATE:
+                out += format_date(integer(c, row));
+                return;
+            case ValueKind::STATUS: {
+                // Fraction of the date range elapsed when the order was placed
+                double recent = static_cast<double>(integer(*c.date, row) - first_day) / c.date->ndv;
+                double pending = 0.02 + 0.5 * std::pow(recent, 8), shipped = 0.05 + 0.3 * std::pow(recent, 4);
+                double u = uniform(c, row);
+                size_t s = u < pending ? 3 : u < pending + shipped ? 2 : u < pending + shipped + 0.05 ? 4
+                         : u < pending + shipped + 0.25 ? 1 : 0;
+                out += STATUSES[s];
+                return;
+            }
+            case ValueKind::AMOUNT: {
+                int64_t age = integer(*c.age, static_cast<uint64_t>(integer(*c.user, row) - 1));
+                double u = uniform(c, row);
+                double amount = (10.0 + (age - 18) * 2.5) * (0.2 + 3.8 * u * u);
+                std::snprintf(buffer, sizeof(buffer), "%.2f", amount);
+                out += buffer;
+                return;
+            }
+            default:
+                out += std::to_string(integer(c, row));
+                return;
+        }
+    }
+};
+
+int64_t firstDay() {
+    int64_t day = 0;
+    parse_date(FIRST_DAY, day);
+    return day;
+}
+
+const char* sqlType(ColumnType type) {
+    switch (type) {
+        case ColumnType::INT: return "BIGINT";
+        case ColumnType::DOUBLE: return "DECIMAL(12,2)";
+        case ColumnType::DATE: return "DATE";
+        case ColumnType::STRING: return "VARCHAR(64)";
+    }
+    return "TEXT";
+}
+
+} // namespace
+
+DataGenerator::DataGenerator(const StatsCatalog& catalog, DataGenOptions options) : options_(options) {
+    if (options_.scale <= 0.0) options_.scale = 1.0;
+
+    auto rowsOf = [&](const std::string& table) -> uint64_t {
+        auto it = catalog.tables.find(table);
+        double rows = it != catalog.tables.end() ? it->second.row_count : 100000;
+        return std::max<uint64_t>(1, static_cast<uint64_t>(std::llround(rows * options_.scale)));
+    };
+    // Key-like NDVs grow with the data; domains (ages, statuses, days) do not
+    auto ndvOf = [&](const std::string& table, const std::string& column, uint64_t fallback, bool scales,
+                     uint64_t cap) -> uint64_t {
+        auto it = catalog.tables.find(table);
+        double ndv = static_cast<double>(fallback);
+        if (it != catalog.tables.end()) {
+            auto dv = it->second.distinct_vals.find(column);
+            if (dv != it->second.distinct_vals.end()) ndv = dv->second;
+        }
+        if (scales) ndv *= options_.scale;
+        return std::max<uint64_t>(1, std::min<uint64_t>(cap, static_cast<uint64_t>(std::llround(ndv))));
+    };
+
+    uint64_t salt = splitmix64(options_.seed);
+    auto addTable = [&](const std::string& name) {
+        auto table = std::make_unique<GeneratedTable>();
+        table->name = name;
+        table->rows = rowsOf(name);
+        auto it = catalog.tables.find(name);
+        if (it != catalog.tables.end()) table->indexes = it->second.indexes;
+        tables_.push_back(std::move(table));
+        return tables_.back().get();
+    };
+    auto addColumn = [&](GeneratedTable* table, const std::string& name, ColumnType type, ValueKind kind) {
+        auto column = std::make_unique<GeneratedColumn>();
+        column->name = name;
+        column->type = type;
+        column->kind = kind;
+        column->table_rows = table->rows;
+        column->salt = salt = splitmix64(salt);
+        table->columns.push_back(std::move(column));
+        return table->columns.back().get();
+    };
+    auto skew = [&](GeneratedColumn* column) {
+        if (options_.zipf <= 0.0) return;
+        column->zipf_cdf.resize(column->ndv);
+        double sum = 0.0;
+        for (uint64_t k = 0; k < column->ndv; ++k) sum += 1.0 / std::pow(static_cast<double>(k + 1), options_.zipf);
+        double acc = 0.0;
+        for (uint64_t k = 0; k < column->ndv; ++k) {
+            acc += 1.0 / std::pow(static_cast<double>(k + 1), options_.zipf);
+            column->zipf_cdf[k] = acc / sum;
+        }
+    };
+
+    GeneratedTable* users = addTable("users");
+    addColumn(users, "id", ColumnType::INT, ValueKind::SERIAL);
+    auto* user_name = addColumn(users, "name", ColumnType::STRING, ValueKind::LABEL);
+    user_name->prefix = "user_";
+    user_name->ndv = ndvOf("users", "name", 80000, true, users->rows);
+    auto* age = addColumn(users, "age", ColumnType::INT, ValueKind::RANGE);
+    age->low = 18;
+    age->ndv = ndvOf("users", "age", 80, false, 100);
+    auto* orig = addColumn(users, "orig", ColumnType::STRING, ValueKind::CODE);
+    orig->prefix = "ref_";
+
+    GeneratedTable* products = addTable("products");
+    addColumn(products, "id", ColumnType::INT, ValueKind::SERIAL);
+    auto* product_name = addColumn(products, "name", ColumnType::STRING, ValueKind::LABEL);
+    product_name->prefix = "product_";
+    product_name->ndv = ndvOf("products", "name", 18000, true, products->rows);
+    auto* category = addColumn(products, "product_category", ColumnType::STRING, ValueKind::CATEGORY);
+    category->prefix = "category_";
+    category->ndv = ndvOf("products", "product_category", 10, false, products->rows);
+    skew(category);
+
+    GeneratedTable* customers = addTable("customers");
+    addColumn(customers, "customer_id", ColumnType::INT, ValueKind::SERIAL);
+    auto* customer_name = addColumn(customers, "customer_name", ColumnType::STRING, ValueKind::LABEL);
+    customer_name->prefix = "customer_";
+    customer_name->ndv = ndvOf("customers", "customer_name", 80000, true, customers->rows);
+    auto* customer_age = addColumn(customers, "customer_age", ColumnType::INT, ValueKind::RANGE);
+    customer_age->low = 18;
+    customer_age->ndv = ndvOf("customers", "customer_age", 80, false, 100);
+
+    GeneratedTable* orders = addTable("orders");
+    addColumn(orders, "id", ColumnType::INT, ValueKind::SERIAL);
+    addColumn(orders, "order_id", ColumnType::INT, ValueKind::SERIAL);
+    auto* user_id = addColumn(orders, "user_id", ColumnType::INT, ValueKind::REFERENCE);
+    user_id->ref = users;
+    user_id->ndv = ndvOf("orders", "user_id", 90000, true, users->rows);
+    skew(user_id);
+    auto* order_date = addColumn(orders, "order_date", ColumnType::DATE, ValueKind::ORDER_DATE);
+    order_date->ndv = ndvOf("orders", "order_date", 365, false, orders->rows);
+    auto* status = addColumn(orders, "status", ColumnType::STRING, ValueKind::STATUS);
+    status->ndv = 5;
+    status->date = order_date;
+    auto* amount = addColumn(orders, "order_amount", ColumnType::DOUBLE, ValueKind::AMOUNT);
+    amount->user = user_id;
+    amount->age = age;
+
+    GeneratedTable* order_items = addTable("order_items");
+    auto* item_order = addColumn(order_items, "order_id", ColumnType::INT, ValueKind::CLUSTERED);
+    item_order->ref = orders;
+    auto* product_id = addColumn(order_items, "product_id", ColumnType::INT, ValueKind::REFERENCE);
+    product_id->ref = products;
+    product_id->ndv = ndvOf("order_items", "product_id", 20000, true, products->rows);
+    skew(product_id);
+}
+
+DataGenerator::~DataGenerator() = default;
+
+std::vector<std::string> DataGenerator::tableNames() const {
+    std::vector<std::string> names;
+    for (const auto& table : tables_) names.push_back(table->name);
+    return names;
+}
+
+const GeneratedTable* DataGenerator::find(const std::string& table) const {
+    for (const auto& spec : tables_) {
+        if (to_lower(spec->name) == to_lower(table)) return spec.get();
+    }
+    return nullptr;
+}
+
+size_t DataGenerator::rowCount(const std::string& table) const {
+    const GeneratedTable* spec = find(table);
+    return spec ? spec->rows : 0;
+}
+
+size_t DataGenerator::threadCount() const {
+    if (options_.threads > 0) return options_.threads;
+    return std::max(1u, std::thread::hardware_concurrency());
+}
+
+bool DataGenerator::writeTsv(const std::string& table, const std::string& path, std::string& error) const {
+    const GeneratedTable* spec = find(table);
+    if (!spec) {
+        error = "no table " + table + " in the generated schema";
+        return false;
+    }
+    std::ofstream out(path, std::ios::binary);
+    if (!out) {
+        error = "cannot write " + path;
+        return false;
+    }
+    for (size_t c = 0; c < spec->columns.size(); ++c) out << (c ? "\t" : "") << spec->columns[c]->name;
+    out << "\n";
+
+    // Rounds of one chunk per thread, formatted in parallel and written in order
+    constexpr uint64_t CHUNK_ROWS = 16384;
+    const Values values{options_.seed, firstDay()};
+    size_t threads = threadCount();
+    std::vector<std::string> chunks(threads);
+    for (uint64_t round = 0; round < spec->rows; round += CHUNK_ROWS * threads) {
+        std::vector<std::thread> workers;
+        for (size_t t = 0; t < threads; ++t) {
+            workers.emplace_back([&, t] {
+                std::string& buffer = chunks[t];
+                buffer.clear();
+                uint64_t begin = round + t * CHUNK_ROWS;
+                uint64_t end = std::min(spec->rows, begin + CHUNK_ROWS);
+                for (uint64_t row = begin; row < end; ++row) {
+                    for (size_t c = 0; c < spec->columns.size(); ++c) {
+                        if (c) buffer += '\t';
+                        values.text(*spec->columns[c], row, buffer);
+                    }
+                    buffer += '\n';
+                }
+            });
+        }
+        for (auto& worker : workers) worker.join();
+        for (const auto& chunk : chunks) out.write(chunk.data(), static_cast<std::streamsize>(chunk.size()));
+    }
+    if (!out) {
+        error = "write to " + path + " failed";
+        return false;
+    }
+    return true;
+}
+
+bool DataGenerator::load(ColumnStore& store, const std::string& table, std::string& error) const {
+    const GeneratedTable* spec = find(table);
+    if (!spec) {
+        error = "no table " + table + " in the generated schema";
+        return false;
+    }
+    const Values values{options_.seed, firstDay()};
+
+    std::vector<Column> columns;
+    columns.reserve(spec->columns.size());
+    for (const auto& c : spec->columns) columns.emplace_back(c->name, c->type);
+
+    std::atomic<size_t> next{0};
+    std::vector<std::thread> workers;
+    for (size_t t = 0; t < std::min(threadCount(), columns.size()); ++t) {
+        workers.emplace_back([&] {
+            std::string text;
+            for (size_t c = next++; c < columns.size(); c = next++) {
+                const auto& column_spec = *spec->columns[c];
+                for (uint64_t row = 0; row < spec->rows; ++row) {
+                    text.clear();
+                    values.text(column_spec, row, text);
+                    columns[c].append(text.c_str());
+                }
+                columns[c].finish();
+            }
+        });
+    }
+    for (auto& worker : workers) worker.join();
+
+    ColumnTable loaded;
+    loaded.name = spec->name;
+    loaded.row_count = spec->rows;
+    loaded.columns = std::move(columns);
+    store.addTable(std::move(loaded));
+    return true;
+}
+
+std::string DataGenerator::mysqlScript(const std::string& dir) const {
+    std::ostringstream sql;
+    for (const auto& table : tables_) {
+        sql << "CREATE TABLE IF NOT EXISTS `" << table->name << "` (";
+        for (size_t c = 0; c < table->columns.size(); ++c) {
+            const auto& column = *table->columns[c];
+            sql << (c ? ", " : "") << "`" << column.name << "` " << sqlType(column.type) << " NOT NULL";
+        }
+        // The first serial column is the primary key
+        std::string primary;
+        if (table->columns[0]->kind == ValueKind::SERIAL) {
+            primary = table->columns[0]->name;
+            sql << ", PRIMARY KEY (`" << primary << "`)";
+        }
+        sql << ");\n";
+        sql << "LOAD DATA LOCAL INFILE '" << dir << "/" << table->name << ".tsv' INTO TABLE `" << table->name
+            << "` FIELDS TERMINATED BY '\\t' IGNORE 1 LINES;\n";
+
+        // Secondary indexes after the load, which is faster than maintaining them
+        for (const auto& index : table->indexes) {
+            if (index.empty() || (index.size() == 1 && index[0] == primary)) continue;
+            sql << "CREATE INDEX `idx_" << table->name;
+            for (const auto& column : index) sql << "_" << column;
+            sql << "` ON `" << table->name << "` (";
+            for (size_t c = 0; c < index.size(); ++c) sql << (c ? ", " : "") << "`" << index[c] << "`";
+            sql << ");\n";
+        }
+        sql << "ANALYZE TABLE `" << table->name << "`;\n\n";
+    }
+    return sql.str();
+}
+
+} // namespace sqlopt
@@ -0,0 +1,475 @@
+#include "expression.h"
+#include "lexer.h"
+#include "parser.h"
+#include "utils.h"
+#include <algorithm>
+#include <map>
+
+namespace sqlopt {
+
+namespace {
+
+bool isCommutative(const std::string& op) {
+    return op == "+" || op == "*" || op == "=" || op == "<>" || op == "!=" || op == "AND" || op == "OR";
+}
+
+size_t combine(size_t seed, size_t value) {
+    return seed ^ (value + 0x9e3779b97f4a7c15ULL + (seed << 6) + (seed >> 2));
+}
+
+bool caseSensitive(ExprKind kind) {
+    return kind == ExprKind::STRING || kind == ExprKind::SUBQUERY;
+}
+
+// Operator precedence for printing, loosest first
+int precedence(const Expr& e) {
+    if (e.kind == ExprKind::BINARY) {
+        if (e.text == "OR") return 1;
+        if (e.text == "AND") return 2;
+        if (e.text == "+" || e.text == "-") return 5;
+        if (e.text == "*" || e.text == "/" || e.text == "%") return 6;
+        return 4; // comparisons, LIKE
+    }
+    if (e.kind == ExprKind::UNARY) return e.text == "NOT" ? 3 : 7;
+    if (e.kind == ExprKind::IS_NULL || e.kind == ExprKind::BETWEEN || e.kind == ExprKind::IN_LIST) return 4;
+    return 8;
+}
+
+// Text of a token run the way the parser writes SQL back: strings quoted, no
+// spaces around dots or inside parentheses
+std::string tokensToSql(const std::vector<Token>& toks, size_t begin, size_t end) {
+    std::string out;
+    for (size_t k = begin; k < end; ++k) {
+        const Token& t = toks[k];
+        const Token* prev = k == begin ? nullptr : &toks[k - 1];
+        // A call's parenthesis follows its name: an identifier or an aggregate keyword
+        bool call = t.type == TokenType::LPAREN && prev &&
+                    (prev->type == TokenType::IDENT ||
+                     (prev->type == TokenType::KW && (to_lower(prev->text) == "count" || to_lower(prev->text) == "sum" ||
+                                                      to_lower(prev->text) == "avg" || to_lower(prev->text) == "min" ||
+                                                      to_lower(prev->text) == "max")));
+        bool glue = !prev || call || t.type == TokenType::DOT || t.type == TokenType::RPAREN ||
+                    t.type == TokenType::COMMA || prev->type == TokenType::DOT || prev->type == TokenType::LPAREN;
+        if (!glue) out += ' ';
+        if (t.type == TokenType::STRING) {
+            out += '\'';
+            for (char c : t.text) {
+                if (c == '\'' || c == '\\') out += '\\';
+                out += c;
+            }
+            out += '\'';
+        } else {
+            out += t.text;
+        }
+    }
+    return out;
+}
+
+// Recursive descent over the lexer's tokens, loosest operator first
+class ExpressionParser {
+public:
+    explicit ExpressionParser(std::vector<Token> toks) : toks_(std::move(toks)) {}
+
+    ExprPtr parse() {
+        ExprPtr e = parseOr();
+        if (!e || !atEnd()) return nullptr;
+        return e;
+    }
+
+private:
+    std::vector<Token> toks_;
+    size_t i_ = 0;
+
+    bool atEnd() const { return i_ >= toks_.size() || toks_[i_].type == TokenType::END; }
+    const Token& peek(size_t ahead = 0) const {
+        static const Token end{TokenType::END, "", -1};
+        return i_ + ahead < toks_.size() ? toks_[i_ + ahead] : end;
+    }
+    bool isWord(const Token& t, const char* word) const {
+        return (t.type == TokenType::KW || t.type == TokenType::IDENT) && to_lower(t.text) == word;
+    }
+    bool acceptWord(const char* word) {
+        if (!isWord(peek(), word)) return false;
+        ++i_;
+        return true;
+    }
+
+    ExprPtr parseOr() {
+        ExprPtr left = parseAnd();
+        while (left && (acceptWord("or") || (peek().type == TokenType::OP && peek().text == "||" && ++i_))) {
+            ExprPtr right = parseAnd();
+            if (!right) return nullptr;
+            left = make_expression(ExprKind::BINARY, "OR", {left, right});
+        }
+        return left;
+    }
+
+    ExprPtr parseAnd() {
+        ExprPtr left = parseNot();
+        while (left && (acceptWord("and") || (peek().type == TokenType::OP && peek().text == "&&" && ++i_))) {
+            ExprPtr right = parseNot();
+            if (!right) return nullptr;
+            left = make_expression(ExprKind::BINARY, "AND", {left, right});
+        }
+        return left;
+    }
+
+    ExprPtr parseNot() {
+        if (acceptWord("not")) {
+            ExprPtr operand = parseNot();
+            return operand ? make_expression(ExprKind::UNARY, "NOT", {operand}) : nullptr;
+        }
+        return parsePredicate();
+    }
+
+    ExprPtr parsePredicate() {
+        ExprPtr left = parseAdditive();
+        if (!left) return nullptr;
+        const Token& t = peek();
+        if (t.type == TokenType::OP && (t.text == "=" || t.text == "<>" || t.text == "!=" || t.text == "<" ||
+                                        t.text == "<=" || t.text == ">" || t.text == ">=" || t.text == "<=>")) {
+            std::string op = t.text;
+            ++i_;
+            ExprPtr right = parseAdditive();
+            return right ? make_expression(ExprKind::BINARY, op, {left, right}) : nullptr;
+        }
+        if (isWord(t, "is")) {
+            ++i_;
+            bool negated = acceptWord("not");
+            if (!acceptWord("null")) return nullptr;
+            return make_expression(ExprKind::IS_NULL, negated ? "IS NOT NULL" : "IS NULL", {left});
+        }
+        bool negated = false;
+        if (isWord(t, "not") && (isWord(peek(1), "like") || isWord(peek(1), "in") || isWord(peek(1), "between"))) {
+            negated = true;
+            ++i_;
+        }
+        if (acceptWord("like")) {
+            ExprPtr pattern = parseAdditive();
+            return pattern ? make_expression(ExprKind::BINARY, negated ? "NOT LIKE" : "LIKE", {left, pattern}) : nullptr;
+        }
+        if (acceptWord("between")) {
+            ExprPtr low = parseAdditive();
+            if (!low || !acceptWord("and")) return nullptr;
+            ExprPtr high = parseAdditive();
+            return high ? make_expression(ExprKind::BETWEEN, negated ? "NOT BETWEEN" : "BETWEEN", {left, low, high})
+                        : nullptr;
+        }
+        if (acceptWord("in")) {
+            if (peek().type != TokenType::LPAREN) return nullptr;
+            std::vector<ExprPtr> children{left};
+            if (isWord(peek(1), "select")) {
+                ExprPtr sub = parseSubquery();
+                if (!sub) return nullptr;
+                children.push_back(sub);
+            } else {
+                ++i_;
+                do {
+                    ExprPtr value = parseOr();
+                    if (!value) return nullptr;
+                    children.push_back(value);
+                } while (peek().type == TokenType::COMMA && ++i_);
+                if (peek().type != TokenType::RPAREN) return nullptr;
+                ++i_;
+            }
+            return make_expression(ExprKind::IN_LIST, negated ? "NOT IN" : "IN", std::move(children));
+        }
+        return negated ? nullptr : left;
+    }
+
+    ExprPtr parseAdditive() {
+        ExprPtr left = parseMultiplicative();
+        while (left && peek().type == TokenType::OP && (peek().text == "+" || peek().text == "-")) {
+            std::string op = toks_[i_++].text;
+            ExprPtr right = parseMultiplicative();
+            if (!right) return nullptr;
+            left = make_expression(ExprKind::BINARY, op, {left, right});
+        }
+        return left;
+    }
+
+    ExprPtr parseMultiplicative() {
+        ExprPtr left = parseUnary();
+        while (left && (peek().type == TokenType::STAR ||
+                        (peek().type == TokenType::OP && (peek().text == "/" || peek().text == "%")))) {
+            std::string op = toks_[i_++].text;
+            ExprPtr right = parseUnary();
+            if (!right) return nullptr;
+            left = make_expression(ExprKind::BINARY, op, {left, right});
+        }
+        return left;
+    }
+
+    ExprPtr parseUnary() {
+        if (peek().type == TokenType::OP && (peek().text == "-" || peek().text == "+")) {
+            std::string op = toks_[i_++].text;
+            ExprPtr operand = parseUnary();
+            if (!operand) return nullptr;
+            if (op == "+") return operand;
+            if (operand->kind == ExprKind::NUMBER && operand->text[0] != '-') {
+                return make_expression(ExprKind::NUMBER, "-" + operand->text);
+            }
+            return make_expression(ExprKind::UNARY, "-", {operand});
+        }
+        return parsePrimary();
+    }
+
+    // "( SELECT ... )" at the current LPAREN
+    ExprPtr parseSubquery() {
+        size_t open = i_, depth = 0;
+        for (; i_ < toks_.size(); ++i_) {
+            if (toks_[i_].type == TokenType::LPAREN) ++depth;
+            if (toks_[i_].type == TokenType::RPAREN && --depth == 0) break;
+        }
+        if (i_ >= toks_.size()) return nullptr;
+        size_t close = i_++;
+        auto sub = std::make_shared<Expr>();
+        sub->kind = ExprKind::SUBQUERY;
+        sub->text = tokensToSql(toks_, open + 1, close);
+
+        // Aliases of the subquery's own tables, replaced by the table names in the canonical form
+        std::map<std::string, std::string> aliases;
+        Lexer lexer(sub->text);
+        Parser parser(lexer.tokenize());
+        Query q;
+        ParseError err;
+        if (parser.parse_query(q, err) && std::holds_alternative<SelectQuery>(q)) {
+            const auto& sq = std::get<SelectQuery>(q);
+            if (!sq.from_table.alias.empty()) aliases[to_lower(sq.from_table.alias)] = to_lower(sq.from_table.name);
+            for (const auto& j : sq.joins) {
+                if (!j.table.alias.empty()) aliases[to_lower(j.table.alias)] = to_lower(j.table.name);
+            }
+        }
+        for (size_t k = open + 1; k < close; ++k) {
+            const Token& t = toks_[k];
+            if (!sub->canonical.empty()) sub->canonical += ' ';
+            if (t.type == TokenType::STRING) {
+                sub->canonical += "'" + t.text + "'";
+                continue;
+            }
+            std::string word = to_lower(t.text);
+            auto alias = aliases.find(word);
+            sub->canonical += t.type == TokenType::IDENT && alias != aliases.end() ? alias->second : word;
+        }
+        sub->hash = combine(std::hash<int>()(static_cast<int>(ExprKind::SUBQUERY)),
+                            std::hash<std::string>()(sub->canonical));
+        return sub;
+    }
+
+    ExprPtr parsePrimary() {
+        const Token& t = peek();
+        switch (t.type) {
+            case TokenType::NUMBER:
+                ++i_;
+                return make_expression(ExprKind::NUMBER, t.text);
+            case TokenType::STRING:
+                ++i_;
+                return make_expression(ExprKind::STRING, t.text);
+            case TokenType::STAR:
+                ++i_;
+                return make_expression(ExprKind::STAR, "*");
+            case TokenType::LPAREN: {
+                if (isWord(peek(1), "select")) return parseSubquery();
+                ++i_;
+                ExprPtr inner = parseOr();
+                if (!inner || peek().type != TokenType::RPAREN) return nullptr;
+                ++i_;
+                return inner;
+            }
+            case TokenType::IDENT:
+            case TokenType::KW: {
+                std::string word = to_lower(t.text);
+                if (word == "case" || word == "select") return nullptr;
+                if (peek(1).type == TokenType::LPAREN) return parseCall();
+                if (t.type == TokenType::KW) return nullptr;
+                if ((word == "date" || word == "timestamp") && peek(1).type == TokenType::STRING) {
+                    i_ += 2;
+                    return make_expression(ExprKind::FUNCTION, t_upper(word), {make_expression(ExprKind::STRING, toks_[i_ - 1].text)});
+                }
+                if (word == "interval" && peek(1).type != TokenType::DOT) {
+                    ++i_;
+                    ExprPtr amount = parseAdditive();
+                    if (!amount || peek().type != TokenType::IDENT) return nullptr;
+                    return make_expression(ExprKind::INTERVAL, t_upper(toks_[i_++].text), {amount});
+                }
+                ++i_;
+                if (word == "null") return make_expression(ExprKind::NULL_VALUE, "NULL");
+                if (word == "true" || word == "false") return make_expression(ExprKind::NUMBER, word == "true" ? "1" : "0");
+                std::string name = t.text;
+                if (peek().type == TokenType::DOT && peek(1).type == TokenType::IDENT) {
+                    name += "." + peek(1).text;
+                    i_ += 2;
+                }
+                return make_expression(ExprKind::COLUMN, name);
+            }
+            default:
+                return nullptr;
+        }
+    }
+
+    ExprPtr parseCall() {
+        std::string name = t_upper(toks_[i_].text);
+        i_ += 2; // name and '('
+        if (name == "OVER") return nullptr;
+        std::vector<ExprPtr> args;
+        bool distinct = acceptWord("distinct");
+        if (isWord(peek(), "select")) {
+            --i_; // back onto '(' so the subquery owns the parentheses
+            ExprPtr sub = parseSubquery();
+            if (!sub) return nullptr;
+            return make_expression(ExprKind::FUNCTION, name, {sub});
+        }
+        if (peek().type != TokenType::RPAREN) {
+            do {
+                ExprPtr arg = parseOr();
+                if (!arg) return nullptr;
+                args.push_back(arg);
+            } while (peek().type == TokenType::COMMA && ++i_);
+        }
+        if (peek().type != TokenType::RPAREN) return nullptr;
+        ++i_;
+        if (isWord(peek(), "over")) return nullptr; // window functions are not modelled
+        return make_expression(ExprKind::FUNCTION, name, std::move(args), distinct);
+    }
+
+    static std::string t_upper(std::string s) {
+        std::transform(s.begin(), s.end(), s.begin(), [](unsigned char c) { return std::toupper(c); });
+        return s;
+    }
+};
+
+std::string quoted(const std::string& text) {
+    std::string out = "'";
+    for (char c : text) {
+        if (c == '\'' || c == '\\') out += '\\';
+        out += c;
+    }
+    return out + "'";
+}
+
+} // namespace
+
+ExprPtr make_expression(ExprKind kind, std::string text, std::vector<ExprPtr> children, bool distinct) {
+    auto e = std::make_shared<Expr>();
+    e->kind = kind;
+    e->text = std::move(text);
+    e->children = std::move(children);
+    e->distinct = distinct;
+
+    size_t h = combine(std::hash<int>()(static_cast<int>(kind)),
+                       std::hash<std::string>()(caseSensitive(kind) ? e->text : to_lower(e->text)));
+    h = combine(h, distinct ? 1 : 0);
+    if (kind == ExprKind::BINARY && isCommutative(e->text) && e->children.size() == 2) {
+        size_t a = e->children[0]->hash, b = e->children[1]->hash;
+        h = combine(h, std::min(a, b));
+        h = combine(h, std::max(a, b));
+    } else {
+        for (const auto& c : e->children) h = combine(h, c->hash);
+    }
+    e->hash = h;
+    return e;
+}
+
+ExprPtr parse_expression(const std::string& text) {
+    Lexer lexer(text);
+    return ExpressionParser(lexer.tokenize()).parse();
+}
+
+std::string expression_to_sql(const Expr& e) {
+    auto child = [&](size_t k, bool right_side) {
+        const Expr& c = *e.children[k];
+        std::string sql = expression_to_sql(c);
+        int parent = precedence(e), own = precedence(c);
+        // Left-associative: an equal-precedence right operand keeps its parentheses
+        // unless the operator is associative
+        bool associative = e.text == "+" || e.text == "*" || e.text == "AND" || e.text == "OR";
+        bool wrap = own < parent || (right_side && own == parent && !associative);
+        return wrap ? "(" + sql + ")" : sql;
+    };
+    switch (e.kind) {
+        case ExprKind::COLUMN:
+        case ExprKind::NUMBER:
+            return e.text;
+        case ExprKind::STRING:
+            return quoted(e.text);
+        case ExprKind::NULL_VALUE:
+            return "NULL";
+        case ExprKind::STAR:
+            return "*";
+        case ExprKind::UNARY:
+            return e.text == "NOT" ? "NOT " + child(0, true) : "-" + child(0, true);
+        case ExprKind::BINARY:
+            return child(0, false) + " " + e.text + " " + child(1, true);
+        case ExprKind::IS_NULL:
+            return child(0, false) + " " + e.text;
+        case ExprKind::BETWEEN:
+            return child(0, false) + " " + e.text + " " + child(1, true) + " AND " + child(2, true);
+        case ExprKind::IN_LIST: {
+            if (e.children.size() == 2 && e.children[1]->kind == ExprKind::SUBQUERY) {
+                return child(0, false) + " " + e.text + " " + expression_to_sql(*e.children[1]);
+            }
+            std::string sql = child(0, false) + " " + e.text + " (";
+            for (size_t k = 1; k < e.children.size(); ++k) {
+                if (k > 1) sql += ", ";
+                sql += expression_to_sql(*e.children[k]);
+            }
+            return sql + ")";
+        }
+        case ExprKind::FUNCTION: {
+            if (e.children.size() == 1 && e.children[0]->kind == ExprKind::SUBQUERY) {
+                return e.text + expression_to_sql(*e.children[0]);
+            }
+            std::string sql = e.text + "(" + (e.distinct ? "DISTINCT " : "");
+            for (size_t k = 0; k < e.children.size(); ++k) {
+                if (k) sql += ", ";
+                sql += expression_to_sql(*e.children[k]);
+            }
+            return sql + ")";
+        }
+        case ExprKind::SUBQUERY:
+            return "(" + e.text + ")";
+        case ExprKind::INTERVAL:
+            return "INTERVAL " + child(0, false) + " " + e.text;
+    }
+    return e.text;
+}
+
+bool same_expression(const Expr& a, const Expr& b) {
+    if (a.hash != b.hash || a.kind != b.kind || a.distinct != b.distinct || a.children.size() != b.children.size()) {
+        return false;
+    }
+    if (a.kind == ExprKind::SUBQUERY) return a.canonical == b.canonical;
+    if (caseSensitive(a.kind) ? a.text != b.text : to_lower(a.text) != to_lower(b.text)) return false;
+    bool in_order = true;
+    for (size_t k = 0; k < a.children.size() && in_order; ++k) {
+        in_order = same_expression(*a.children[k], *b.children[k]);
+    }
+    if (in_order) return true;
+    return a.kind == ExprKind::BINARY && isCommutative(a.text) && a.children.size() == 2 &&
+           same_expression(*a.children[0], *b.children[1]) && same_expression(*a.children[1], *b.children[0]);
+}
+
+bool is_aggregate(const Expr& e) {
+    return e.kind == ExprKind::FUNCTION && (e.text == "COUNT" || e.text == "SUM" || e.text == "AVG" ||
+                                            e.text == "MIN" || e.text == "MAX" || e.text == "GROUP_CONCAT");
+}
+
+void visit_expression(const Expr& e, const std::function<void(const Expr&)>& fn) {
+    fn(e);
+    for (const auto& c : e.children) visit_expression(*c, fn);
+}
+
+ExprPtr replace_subexpressions(const ExprPtr& e, const std::function<ExprPtr(const Expr&)>& fn) {
+    if (ExprPtr replacement = fn(*e)) return replacement;
+    bool changed = false;
+    std::vector<ExprPtr> children;
+    children.reserve(e->children.size());
+    for (const auto& c : e->children) {
+        children.push_back(replace_subexpressions(c, fn));
+        changed = changed || children.back() != c;
+    }
+    if (!changed) return e;
+    return make_expression(e->kind, e->text, std::move(children), e->distinct);
+}
+
+} // namespace sqlopt
@@ -0,0 +1,800 @@
+#include "expression_simplifier.h"
+#include "utils.h"
+#include <algorithm>
+#include <climits>
+#include <cstdio>
+#include <map>
+#include <optional>
+
+namespace sqlopt {
+
+namespace {
+
+// Exact decimal value: mantissa / 10^scale, the way MySQL evaluates literal arithmetic
+struct Decimal {
+    long long mantissa = 0;
+    int scale = 0;
+};
+
+bool parseDecimal(const Expr& e, Decimal& out) {
+    if (e.kind != ExprKind::NUMBER) return false;
+    const std::string& t = e.text;
+    size_t k = t.size() > 0 && t[0] == '-' ? 1 : 0;
+    long long m = 0;
+    int scale = 0;
+    bool dot = false, digits = false;
+    for (; k < t.size(); ++k) {
+        if (t[k] == '.') {
+            if (dot) return false;
+            dot = true;
+            continue;
+        }
+        if (t[k] < '0' || t[k] > '9') return false;
+        if (__builtin_mul_overflow(m, 10LL, &m) || __builtin_add_overflow(m, static_cast<long long>(t[k] - '0'), &m)) {
+            return false;
+        }
+        if (dot) ++scale;
+        digits = true;
+    }
+    if (!digits) return false;
+    out.mantissa = t[0] == '-' ? -m : m;
+    out.scale = scale;
+    return true;
+}
+
+bool rescale(Decimal& d, int scale) {
+    for (; d.scale < scale; ++d.scale) {
+        if (__builtin_mul_overflow(d.mantissa, 10LL, &d.mantissa)) return false;
+    }
+    return true;
+}
+
+bool align(Decimal& a, Decimal& b) {
+    int scale = std::max(a.scale, b.scale);
+    return rescale(a, scale) && rescale(b, scale);
+}
+
+std::string formatDecimal(const Decimal& d) {
+    unsigned long long magnitude = d.mantissa < 0 ? 0ULL - static_cast<unsigned long long>(d.mantissa)
+                                                  : static_cast<unsigned long long>(d.mantissa);
+    std::string digits = std::to_string(magnitude);
+    if (d.scale > 0) {
+        if (digits.size() <= static_cast<size_t>(d.scale)) digits.insert(0, d.scale + 1 - digits.size(), '0');
+        digits.insert(digits.size() - d.scale, ".");
+    }
+    return d.mantissa < 0 ? "-" + digits : digits;
+}
+
+ExprPtr number(const Decimal& d) { return make_expression(ExprKind::NUMBER, formatDecimal(d)); }
+ExprPtr boolean(bool b) { return make_expression(ExprKind::NUMBER, b ? "1" : "0"); }
+ExprPtr null() { return make_expression(ExprKind::NULL_VALUE, "NULL"); }
+
+// Result scales follow MySQL: the larger for + and -, the sum for *, the dividend's
+// plus four (div_precision_increment) for /. A quotient is folded only when exact.
+bool arithmetic(const std::string& op, Decimal a, Decimal b, Decimal& out) {
+    if (op == "+" || op == "-") {
+        if (!align(a, b)) return false;
+        out.scale = a.scale;
+        return op == "+" ? !__builtin_add_overflow(a.mantissa, b.mantissa, &out.mantissa)
+                         : !__builtin_sub_overflow(a.mantissa, b.mantissa, &out.mantissa);
+    }
+    if (op == "*") {
+        out.scale = a.scale + b.scale;
+        return !__builtin_mul_overflow(a.mantissa, b.mantissa, &out.mantissa);
+    }
+    if (op == "/") {
+        int result_scale = a.scale + 4;
+        if (b.mantissa == 0 || !align(a, b) || (a.mantissa == LLONG_MIN && b.mantissa == -1)) return false;
+        for (int k = 0; k <= 4; ++k) {
+            if (a.mantissa % b.mantissa == 0) {
+                out = {a.mantissa / b.mantissa, k};
+                return rescale(out, result_scale);
+            }
+            if (__builtin_mul_overflow(a.mantissa, 10LL, &a.mantissa)) return false;
+        }
+        return false;
+    }
+    if (op == "%") {
+        if (a.scale || b.scale || b.mantissa == 0 || b.mantissa == -1) return false;
+        out = {a.mantissa % b.mantissa, 0};
+        return true;
+    }
+    return false;
+}
+
+bool isInteger(const Expr& e, long long& value) {
+    Decimal d;
+    if (!parseDecimal(e, d) || d.scale != 0) return false;
+    value = d.mantissa;
+    return true;
+}
+
+struct DateTime {
+    int year = 0, month = 0, day = 0, hour = 0, minute = 0, second = 0;
+    bool has_time = false;
+};
+
+int daysInMonth(int year, int month) {
+    static const int days[] = {31, 28, 31, 30, 31, 30, 31, 31, 30, 31, 30, 31};
+    bool leap = (year % 4 == 0 && year % 100 != 0) || year % 400 == 0;
+    return month == 2 && leap ? 29 : days[month - 1];
+}
+
+// Days since 1970-01-01 of a proleptic Gregorian date, and back
+long long daysFromCivil(int y, int m, int d) {
+    y -= m <= 2;
+    long long era = (y >= 0 ? y : y - 399) / 400;
+    long long yoe = y - era * 400;
+    long long doy = (153 * (m + (m > 2 ? -3 : 9)) + 2) / 5 + d - 1;
+    long long doe = yoe * 365 + yoe / 4 - yoe / 100 + doy;
+    return era * 146097 + doe - 719468;
+}
+
+void civilFromDays(long long z, int& y, int& m, int& d) {
+    z += 719468;
+    long long era = (z >= 0 ? z : z - 146096) / 146097;
+    long long doe = z - era * 146097;
+    long long yoe = (doe - doe / 1460 + doe / 36524 - doe / 146096) / 365;
+    long long doy = doe - (365 * yoe + yoe / 4 - yoe / 100);
+    long long mp = (5 * doy + 2) / 153;
+    d = static_cast<int>(doy - (153 * mp + 2) / 5 + 1);
+    m = static_cast<int>(mp < 10 ? mp + 3 : mp - 9);
+    y = static_cast<int>(yoe + era * 400 + (m <= 2));
+}
+
+// 'YYYY-MM-DD' or 'YYYY-MM-DD HH:MM:SS'
+bool parseDate(const std::string& s, DateTime& out) {
+    DateTime dt;
+    char tail = 0;
+    dt.has_time = s.size() == 19;
+    bool parsed = dt.has_time ? std::sscanf(s.c_str(), "%4d-%2d-%2d %2d:%2d:%2d%c", &dt.year, &dt.month, &dt.day,
+                                            &dt.hour, &dt.minute, &dt.second, &tail) == 6
+                              : s.size() == 10 &&
+                                    std::sscanf(s.c_str(), "%4d-%2d-%2d%c", &dt.year, &dt.month, &dt.day, &tail) == 3;
+    if (!parsed) return false;
+    if (dt.year < 1 || dt.month < 1 || dt.month > 12 || dt.day < 1 || dt.day > daysInMonth(dt.year, dt.month) ||
+        dt.hour > 23 || dt.minute > 59 || dt.second > 59) {
+        return false;
+    }
+    out = dt;
+    return true;
+}
+
+std::string formatDate(const DateTime& dt) {
+    char buf[32];
+    if (dt.has_time) {
+        std::snprintf(buf, sizeof(buf), "%04d-%02d-%02d %02d:%02d:%02d", dt.year, dt.month, dt.day, dt.hour, dt.minute,
+                      dt.second);
+    } else {
+        std::snprintf(buf, sizeof(buf), "%04d-%02d-%02d", dt.year, dt.month, dt.day);
+    }
+    return buf;
+}
+
+// MySQL's DATE_ADD: month units clamp the day to the end of the month
+bool addInterval(DateTime& dt, long long amount, const std::string& unit) {
+    if (std::llabs(amount) > 10000000) return false;
+    long long months = 0, seconds = 0;
+    if (unit == "YEAR") months = amount * 12;
+    else if (unit == "QUARTER") months = amount * 3;
+    else if (unit == "MONTH") months = amount;
+    else if (unit == "WEEK") seconds = amount * 7 * 86400;
+    else if (unit == "DAY") seconds = amount * 86400;
+    else if (unit == "HOUR") seconds = amount * 3600;
+    else if (unit == "MINUTE") seconds = amount * 60;
+    else if (unit == "SECOND") seconds = amount;
+    else return false;
+
+    if (months != 0) {
+        long long total = dt.year * 12LL + (dt.month - 1) + months;
+        if (total < 12 || total >= 10000 * 12) return false;
+        dt.year = static_cast<int>(total / 12);
+        dt.month = static_cast<int>(total % 12) + 1;
+        dt.day = std::min(dt.day, daysInMonth(dt.year, dt.month));
+    } else {
+        if (unit == "HOUR" || unit == "MINUTE" || unit == "SECOND") dt.has_time = true;
+        long long t = daysFromCivil(dt.year, dt.month, dt.day) * 86400 + dt.hour * 3600 + dt.minute * 60 + dt.second +
+                      seconds;
+        long long days = t >= 0 ? t / 86400 : (t - 86399) / 86400;
+        long long rest = t - days * 86400;
+        civilFromDays(days, dt.year, dt.month, dt.day);
+        dt.hour = static_cast<int>(rest / 3600);
+        dt.minute = static_cast<int>(rest / 60 % 60);
+        dt.second = static_cast<int>(rest % 60);
+    }
+    return dt.year >= 1 && dt.year <= 9999;
+}
+
+// A date written as a string or a DATE/TIMESTAMP literal
+bool literalDate(const Expr& e, DateTime& dt) {
+    if (e.kind == ExprKind::STRING) return parseDate(e.text, dt);
+    return e.kind == ExprKind::FUNCTION && (e.text == "DATE" || e.text == "TIMESTAMP") && e.children.size() == 1 &&
+           e.children[0]->kind == ExprKind::STRING && parseDate(e.children[0]->text, dt);
+}
+
+bool intervalAmount(const Expr& e, long long& amount, std::string& unit) {
+    if (e.kind != ExprKind::INTERVAL) return false;
+    const Expr& value = *e.children[0];
+    unit = e.text;
+    if (value.kind == ExprKind::STRING) return isInteger(*make_expression(ExprKind::NUMBER, trim(value.text)), amount);
+    return isInteger(value, amount);
+}
+
+bool isLiteral(const Expr& e) {
+    DateTime dt;
+    return e.kind == ExprKind::NUMBER || e.kind == ExprKind::STRING || e.kind == ExprKind::NULL_VALUE || literalDate(e, dt);
+}
+
+// A DATE/TIMESTAMP literal, as opposed to a string that only looks like a date
+bool isTemporalLiteral(const Expr& e) {
+    return e.kind == ExprKind::FUNCTION && (e.text == "DATE" || e.text == "TIMESTAMP");
+}
+
+auto dateKey(const DateTime& d) {
+    return std::make_tuple(d.year, d.month, d.day, d.hour, d.minute, d.second);
+}
+
+// Order of two literals when this code can tell: numbers exactly, dates by value
+// when at least one side is temporal, strings only when identical. Two strings are
+// compared as text by MySQL even when both look like dates, and '2024-01-05' and
+// '2024-01-05 00:00:00' differ as text.
+std::optional<int> compareLiterals(const Expr& a, const Expr& b) {
+    Decimal x, y;
+    if (parseDecimal(a, x) && parseDecimal(b, y)) {
+        if (!align(x, y)) return std::nullopt;
+        return x.mantissa < y.mantissa ? -1 : x.mantissa > y.mantissa ? 1 : 0;
+    }
+    DateTime p, q;
+    if ((isTemporalLiteral(a) || isTemporalLiteral(b)) && literalDate(a, p) && literalDate(b, q)) {
+        return dateKey(p) < dateKey(q) ? -1 : dateKey(q) < dateKey(p) ? 1 : 0;
+    }
+    if (a.kind == ExprKind::STRING && b.kind == ExprKind::STRING && a.text == b.text) return 0;
+    return std::nullopt;
+}
+
+bool isComparison(const std::string& op) {
+    return op == "=" || op == "<>" || op == "!=" || op == "<" || op == "<=" || op == ">" || op == ">=" || op == "<=>";
+}
+
+bool comparisonHolds(const std::string& op, int c) {
+    if (op == "=" || op == "<=>") return c == 0;
+    if (op == "<>" || op == "!=") return c != 0;
+    if (op == "<") return c < 0;
+    if (op == "<=") return c <= 0;
+    if (op == ">") return c > 0;
+    return c >= 0;
+}
+
+// a op b == b mirrored(op) a
+std::string mirrored(const std::string& op) {
+    if (op == "<") return ">";
+    if (op == "<=") return ">=";
+    if (op == ">") return "<";
+    if (op == ">=") return "<=";
+    return op;
+}
+
+// NOT (a op b) == a inverted(op) b; empty for <=>, which is never NULL
+std::string inverted(const std::string& op) {
+    if (op == "=") return "<>";
+    if (op == "<>" || op == "!=") return "=";
+    if (op == "<") return ">=";
+    if (op == "<=") return ">";
+    if (op == ">") return "<=";
+    if (op == ">=") return "<";
+    return "";
+}
+
+// True when the value is only ever 0, 1 or NULL, so a truth-preserving rewrite
+// also preserves the value
+bool isPredicate(const Expr& e) {
+    switch (e.kind) {
+        case ExprKind::BINARY:
+            return isComparison(e.text) || e.text == "AND" || e.text == "OR" || e.text == "LIKE" || e.text == "NOT LIKE";
+        case ExprKind::UNARY:
+            return e.text == "NOT";
+        case ExprKind::IS_NULL:
+        case ExprKind::BETWEEN:
+        case ExprKind::IN_LIST:
+            return true;
+        case ExprKind::FUNCTION:
+            return e.text == "EXISTS";
+        case ExprKind::NUMBER:
+            return e.text == "0" || e.text == "1";
+        default:
+            return false;
+    }
+}
+
+// Truth of a numeric literal: nullopt when e is not one
+std::optional<bool> literalTruth(const Expr& e) {
+    Decimal d;
+    if (!parseDecimal(e, d)) return std::nullopt;
+    return d.mantissa != 0;
+}
+
+ExprPtr fold(const ExprPtr& e, bool condition);
+
+// Date arithmetic on a constant date: the result as a 'YYYY-MM-DD[ HH:MM:SS]' string
+ExprPtr foldDate(const Expr& date, const Expr& interval, bool subtract) {
+    DateTime dt;
+    long long amount;
+    std::string unit;
+    if (!literalDate(date, dt) || !intervalAmount(interval, amount, unit)) return nullptr;
+    if (!addInterval(dt, subtract ? -amount : amount, unit)) return nullptr;
+    return make_expression(ExprKind::STRING, formatDate(dt));
+}
+
+// X + k op c solved for X: X op c - k, for integer k and c; X + INTERVAL n DAY op d
+// (and DATE_ADD/DATE_SUB/ADDDATE/SUBDATE) as X op d - n days. Month units are left
+// alone: adding a month is not invertible (Jan 29..31 all become Feb 29).
+ExprPtr solveForOperand(const std::string& op, const Expr& left, const Expr& right) {
+    ExprPtr operand;
+    long long shift = 0;
+    bool days = false;
+    if (left.kind == ExprKind::BINARY && (left.text == "+" || left.text == "-")) {
+        const Expr& a = *left.children[0];
+        const Expr& b = *left.children[1];
+        long long k;
+        std::string unit;
+        if (isInteger(b, k) && !isLiteral(a)) {
+            operand = left.children[0];
+            shift = left.text == "+" ? k : -k;
+        } else if (left.text == "+" && isInteger(a, k) && !isLiteral(b)) {
+            operand = left.children[1];
+            shift = k;
+        } else if (intervalAmount(b, k, unit) && (unit == "DAY" || unit == "WEEK") && !isLiteral(a)) {
+            operand = left.children[0];
+            shift = (left.text == "+" ? k : -k) * (unit == "WEEK" ? 7 : 1);
+            days = true;
+        } else if (left.text == "+" && intervalAmount(a, k, unit) && (unit == "DAY" || unit == "WEEK") && !isLiteral(b)) {
+            operand = left.children[1];
+            shift = k * (unit == "WEEK" ? 7 : 1);
+            days = true;
+        }
+    } else if (left.kind == ExprKind::FUNCTION && left.children.size() == 2 &&
+               (left.text == "DATE_ADD" || left.text == "ADDDATE" || left.text == "DATE_SUB" || left.text == "SUBDATE")) {
+        long long k;
+        std::string unit = "DAY";
+        bool sign = left.text == "DATE_ADD" || left.text == "ADDDATE";
+        const Expr& amount = *left.children[1];
+        bool plain_days = (left.text == "ADDDATE" || left.text == "SUBDATE") && isInteger(amount, k);
+        if ((plain_days || (intervalAmount(amount, k, unit) && (unit == "DAY" || unit == "WEEK"))) &&
+            !isLiteral(*left.children[0])) {
+            operand = left.children[0];
+            shift = (sign ? k : -k) * (unit == "WEEK" ? 7 : 1);
+            days = true;
+        }
+    }
+    if (!operand) return nullptr;
+
+    ExprPtr bound;
+    if (days) {
+        DateTime dt;
+        if (!literalDate(right, dt) || std::llabs(shift) > 10000000 || !addInterval(dt, -shift, "DAY")) return nullptr;
+        bound = make_expression(ExprKind::STRING, formatDate(dt));
+    } else {
+        long long c;
+        if (!isInteger(right, c) || __builtin_sub_overflow(c, shift, &c)) return nullptr;
+        bound = make_expression(ExprKind::NUMBER, std::to_string(c));
+    }
+    return make_expression(ExprKind::BINARY, op, {operand, bound});
+}
+
+ExprPtr foldComparison(const ExprPtr& e, bool condition) {
+    const std::string& op = e->text;
+    const Expr& l = *e->children[0];
+    const Expr& r = *e->children[1];
+    if (l.kind == ExprKind::NULL_VALUE || r.kind == ExprKind::NULL_VALUE) {
+        if (op != "<=>") return null();
+        if (l.kind == r.kind) return boolean(true);
+        if (isLiteral(l) && isLiteral(r)) return boolean(false);
+        return e;
+    }
+    if (auto c = compareLiterals(l, r)) return boolean(comparisonHolds(op, *c));
+    if (op == "<=>") return e;
+    if (isLiteral(r)) {
+        if (ExprPtr solved = solveForOperand(op, l, r)) return fold(solved, condition);
+    } else if (isLiteral(l)) {
+        if (ExprPtr solved = solveForOperand(mirrored(op), r, l)) return fold(solved, condition);
+    }
+    return e;
+}
+
+ExprPtr foldNot(const ExprPtr& e, bool condition) {
+    const ExprPtr& x = e->children[0];
+    if (x->kind == ExprKind::NULL_VALUE) return x;
+    if (auto truth = literalTruth(*x)) return boolean(!*truth);
+    switch (x->kind) {
+        case ExprKind::UNARY:
+            if (x->text == "NOT" && (condition || isPredicate(*x->children[0]))) return x->children[0];
+            break;
+        case ExprKind::BINARY: {
+            if (x->text == "LIKE" || x->text == "NOT LIKE") {
+                return make_expression(ExprKind::BINARY, x->text == "LIKE" ? "NOT LIKE" : "LIKE", x->children);
+            }
+            std::string op = inverted(x->text);
+            if (!op.empty()) return make_expression(ExprKind::BINARY, op, x->children);
+            break;
+        }
+        case ExprKind::IS_NULL:
+            return make_expression(ExprKind::IS_NULL, x->text == "IS NULL" ? "IS NOT NULL" : "IS NULL", x->children);
+        case ExprKind::BETWEEN:
+            return make_expression(ExprKind::BETWEEN, x->text == "BETWEEN" ? "NOT BETWEEN" : "BETWEEN", x->children);
+        case ExprKind::IN_LIST:
+            return make_expression(ExprKind::IN_LIST, x->text == "IN" ? "NOT IN" : "IN", x->children);
+        default:
+            break;
+    }
+    return e;
+}
+
+// AND/OR under three-valued logic: FALSE AND x and TRUE OR x decide the result
+// whatever x is, NULL included; TRUE AND x and FALSE OR x keep x's truth
+ExprPtr foldLogical(const ExprPtr& e, bool condition) {
+    bool is_and = e->text == "AND";
+    const ExprPtr& l = e->children[0];
+    const ExprPtr& r = e->children[1];
+    auto lt = literalTruth(*l), rt = literalTruth(*r);
+    if ((lt && *lt != is_and) || (rt && *rt != is_and)) return boolean(!is_and);
+    if (lt && (condition || isPredicate(*r))) return r;
+    if (rt && (condition || isPredicate(*l))) return l;
+    if (same_expression(*l, *r) && (condition || isPredicate(*l))) return l;
+    return e;
+}
+
+ExprPtr foldArithmetic(const ExprPtr& e) {
+    const Expr& l = *e->children[0];
+    const Expr& r = *e->children[1];
+    if (l.kind == ExprKind::NULL_VALUE || r.kind == ExprKind::NULL_VALUE) return null();
+    Decimal a, b, out;
+    if (parseDecimal(l, a) && parseDecimal(r, b)) return arithmetic(e->text, a, b, out) ? number(out) : e;
+    if (e->text == "+" || e->text == "-") {
+        if (ExprPtr date = foldDate(l, r, e->text == "-")) return date;
+        if (e->text == "+") {
+            if (ExprPtr date = foldDate(r, l, false)) return date;
+        }
+    }
+    return e;
+}
+
+// Node by node, children already folded
+ExprPtr fold(const ExprPtr& e, bool condition) {
+    switch (e->kind) {
+        case ExprKind::UNARY: {
+            if (e->text == "NOT") return foldNot(e, condition);
+            Decimal d;
+            if (parseDecimal(*e->children[0], d) && d.mantissa != LLONG_MIN) return number({-d.mantissa, d.scale});
+            if (e->children[0]->kind == ExprKind::NULL_VALUE) return null();
+            return e;
+        }
+        case ExprKind::BINARY:
+            if (e->text == "AND" || e->text == "OR") return foldLogical(e, condition);
+            if (isComparison(e->text)) return foldComparison(e, condition);
+            if (e->text == "+" || e->text == "-" || e->text == "*" || e->text == "/" || e->text == "%") {
+                return foldArithmetic(e);
+            }
+            return e;
+        case ExprKind::IS_NULL: {
+            const Expr& x = *e->children[0];
+            if (!isLiteral(x)) return e;
+            return boolean((x.kind == ExprKind::NULL_VALUE) == (e->text == "IS NULL"));
+        }
+        case ExprKind::BETWEEN: {
+            auto low = compareLiterals(*e->children[1], *e->children[0]);
+            auto high = compareLiterals(*e->children[0], *e->children[2]);
+            if (!low || !high) return e;
+            return boolean((*low <= 0 && *high <= 0) == (e->text == "BETWEEN"));
+        }
+        case ExprKind::IN_LIST:
+            // x IN (v) is x = v
+            if (e->children.size() == 2 && e->children[1]->kind != ExprKind::SUBQUERY) {
+                return fold(make_expression(ExprKind::BINARY, e->text == "IN" ? "=" : "<>", e->children), condition);
+            }
+            return e;
+        case ExprKind::FUNCTION:
+            if (e->children.size() == 2) {
+                bool add = e->text == "DATE_ADD" || e->text == "ADDDATE";
+                bool sub = e->text == "DATE_SUB" || e->text == "SUBDATE";
+                if (!add && !sub) return e;
+                ExprPtr amount = e->children[1];
+                // ADDDATE(d, n) and SUBDATE(d, n) count days
+                if ((e->text == "ADDDATE" || e->text == "SUBDATE") && amount->kind == ExprKind::NUMBER) {
+                    amount = make_expression(ExprKind::INTERVAL, "DAY", {amount});
+                }
+                if (ExprPtr date = foldDate(*e->children[0], *amount, sub)) return date;
+            }
+            return e;
+        default:
+            return e;
+    }
+}
+
+bool isAscii(const std::string& s) {
+    return std::all_of(s.begin(), s.end(), [](unsigned char c) { return c < 0x80; });
+}
+
+// Two equality constants that can never both match one value. Strings count as
+// different only when they differ in ASCII text beyond case and trailing spaces,
+// which no collation equates, and are not the same date written two ways, which a
+// temporal column equates.
+bool definitelyDifferent(const Expr& a, const Expr& b) {
+    if (auto c = compareLiterals(a, b)) return *c != 0;
+    if (a.kind != ExprKind::STRING || b.kind != ExprKind::STRING || !isAscii(a.text) || !isAscii(b.text)) return false;
+    DateTime p, q;
+    if (literalDate(a, p) && literalDate(b, q) && dateKey(p) == dateKey(q)) return false;
+    auto key = [](const std::string& s) {
+        std::string k = to_lower(s);
+        k.erase(k.find_last_not_of(' ') + 1);
+        return k;
+    };
+    return key(a.text) != key(b.text);
+}
+
+struct Bound {
+    ExprPtr value;
+    bool inclusive;
+};
+
+struct ColumnFacts {
+    std::string name;
+    std::vector<Bound> lower, upper;
+    std::vector<ExprPtr> equal, not_equal;
+    bool is_null = false, not_null = false, compared = false;
+};
+
+bool contradicts(const ColumnFacts& f) {
+    if (f.is_null && (f.not_null || f.compared)) return true;
+    for (size_t i = 0; i < f.equal.size(); ++i) {
+        for (size_t j = i + 1; j < f.equal.size(); ++j) {
+            if (definitelyDifferent(*f.equal[i], *f.equal[j])) return true;
+        }
+        for (const auto& ne : f.not_equal) {
+            auto c = compareLiterals(*f.equal[i], *ne);
+            if (c && *c == 0) return true;
+        }
+    }
+    auto empty = [](const Bound& lo, const Bound& hi) {
+        auto c = compareLiterals(*lo.value, *hi.value);
+        return c && (*c > 0 || (*c == 0 && !(lo.inclusive && hi.inclusive)));
+    };
+    for (const auto& lo : f.lower) {
+        for (const auto& hi : f.upper) {
+            if (empty(lo, hi)) return true;
+        }
+        for (const auto& eq : f.equal) {
+            if (empty(lo, {eq, true})) return true;
+        }
+    }
+    for (const auto& hi : f.upper) {
+        for (const auto& eq : f.equal) {
+            if (empty({eq, true}, hi)) return true;
+        }
+    }
+    return false;
+}
+
+} // namespace
+
+ExprPtr simplify_expression(const ExprPtr& e, bool condition) {
+    // The operands of AND, OR and NOT of a condition are conditions themselves
+    bool logical = (e->kind == ExprKind::BINARY && (e->text == "AND" || e->text == "OR")) ||
+                   (e->kind == ExprKind::UNARY && e->text == "NOT");
+    bool changed = false;
+    std::vector<ExprPtr> children;
+    children.reserve(e->children.size());
+    for (const auto& c : e->children) {
+        children.push_back(simplify_expression(c, condition && logical));
+        changed = changed || children.back() != c;
+    }
+    ExprPtr node = changed ? make_expression(e->kind, e->text, std::move(children), e->distinct) : e;
+    return fold(node, condition);
+}
+
+std::vector<ExprPtr> split_conjuncts(const ExprPtr& e) {
+    if (e->kind != ExprKind::BINARY || e->text != "AND") return {e};
+    std::vector<ExprPtr> out = split_conjuncts(e->children[0]);
+    for (auto& c : split_conjuncts(e->children[1])) out.push_back(std::move(c));
+    return out;
+}
+
+namespace {
+
+bool isLogical(const Expr& e, const char* op) { return e.kind == ExprKind::BINARY && e.text == op; }
+
+// Operands of nested ANDs (or ORs) as one list
+void flatten(const ExprPtr& e, const char* op, std::vector<ExprPtr>& out) {
+    if (!isLogical(*e, op)) {
+        out.push_back(e);
+        return;
+    }
+    flatten(e->children[0], op, out);
+    flatten(e->children[1], op, out);
+}
+
+bool containsAtom(const std::vector<ExprPtr>& atoms, const Expr& atom) {
+    for (const auto& a : atoms) {
+        if (same_expression(*a, atom)) return true;
+    }
+    return false;
+}
+
+// Negation normal form: NOT only directly above atoms it could not fold into
+ExprPtr negationNormal(const ExprPtr& e, bool negated) {
+    if (isLogical(*e, "AND") || isLogical(*e, "OR")) {
+        bool is_and = e->text == "AND";
+        const char* op = is_and != negated ? "AND" : "OR";
+        return make_expression(ExprKind::BINARY, op,
+                               {negationNormal(e->children[0], negated), negationNormal(e->children[1], negated)});
+    }
+    if (e->kind == ExprKind::UNARY && e->text == "NOT") return negationNormal(e->children[0], !negated);
+    return negated ? simplify_expression(make_expression(ExprKind::UNARY, "NOT", {e}), true) : e;
+}
+
+ExprPtr factor(const ExprPtr& e) {
+    if (isLogical(*e, "AND")) {
+        ExprPtr l = factor(e->children[0]), r = factor(e->children[1]);
+        return l == e->children[0] && r == e->children[1] ? e : make_expression(ExprKind::BINARY, "AND", {l, r});
+    }
+    if (!isLogical(*e, "OR")) return e;
+
+    std::vector<ExprPtr> branches;
+    flatten(e, "OR", branches);
+    std::vector<std::vector<ExprPtr>> terms;
+    for (const auto& b : branches) {
+        terms.emplace_back();
+        flatten(factor(b), "AND", terms.back());
+    }
+    std::vector<ExprPtr> common;
+    for (const auto& atom : terms[0]) {
+        bool everywhere = !containsAtom(common, *atom);
+        for (size_t t = 1; t < terms.size() && everywhere; ++t) everywhere = containsAtom(terms[t], *atom);
+        if (everywhere) common.push_back(atom);
+    }
+
+    std::vector<ExprPtr> rest;
+    bool absorbed = false; // a branch is nothing but the common atoms: the OR of the rest holds
+    for (const auto& term : terms) {
+        std::vector<ExprPtr> remaining;
+        for (const auto& atom : term) {
+            if (!containsAtom(common, *atom)) remaining.push_back(atom);
+        }
+        if (remaining.empty()) absorbed = true;
+        else rest.push_back(join_atoms(remaining, "AND"));
+    }
+    std::vector<ExprPtr> conjuncts = common;
+    if (!absorbed) conjuncts.push_back(join_atoms(rest, "OR"));
+    return join_atoms(conjuncts, "AND");
+}
+
+using NormalForm = std::vector<std::vector<ExprPtr>>;
+
+// Clauses (or terms) of outer_op-ed groups of inner_op-ed atoms; false when the
+// expansion would exceed the bound
+bool normalForm(const ExprPtr& e, const char* outer_op, const char* inner_op, size_t bound, NormalForm& out) {
+    if (isLogical(*e, outer_op)) {
+        NormalForm l, r;
+        if (!normalForm(e->children[0], outer_op, inner_op, bound, l) ||
+            !normalForm(e->children[1], outer_op, inner_op, bound, r) || l.size() + r.size() > bound) {
+            return false;
+        }
+        out = std::move(l);
+        out.insert(out.end(), r.begin(), r.end());
+        return true;
+    }
+    if (isLogical(*e, inner_op)) {
+        // Distribute: every group of one side combined with every group of the other
+        NormalForm l, r;
+        if (!normalForm(e->children[0], outer_op, inner_op, bound, l) ||
+            !normalForm(e->children[1], outer_op, inner_op, bound, r) || l.size() * r.size() > bound) {
+            return false;
+        }
+        out.clear();
+        for (const auto& a : l) {
+            for (const auto& b : r) {
+                std::vector<ExprPtr> group = a;
+                for (const auto& atom : b) {
+                    if (!containsAtom(group, *atom)) group.push_back(atom);
+                }
+                out.push_back(std::move(group));
+            }
+        }
+        return true;
+    }
+    out = {{e}};
+    return true;
+}
+
+// Drops repeated groups and groups containing another one (absorption)
+NormalForm removeSubsumed(const NormalForm& groups) {
+    auto subset = [](const std::vector<ExprPtr>& a, const std::vector<ExprPtr>& b) {
+        for (const auto& atom : a) {
+            if (!containsAtom(b, *atom)) return false;
+        }
+        return true;
+    };
+    NormalForm kept;
+    for (size_t i = 0; i < groups.size(); ++i) {
+        bool redundant = false;
+        for (size_t j = 0; j < groups.size() && !redundant; ++j) {
+            if (i == j || !subset(groups[j], groups[i])) continue;
+            // Equal groups: keep the first
+            redundant = !subset(groups[i], groups[j]) || j < i;
+        }
+        if (!redundant) kept.push_back(groups[i]);
+    }
+    return kept;
+}
+
+} // namespace
+
+ExprPtr factor_condition(const ExprPtr& e) {
+    return factor(negationNormal(e, false));
+}
+
+std::vector<std::vector<ExprPtr>> to_cnf(const ExprPtr& e, size_t max_clauses) {
+    NormalForm clauses;
+    if (!normalForm(negationNormal(e, false), "AND", "OR", max_clauses, clauses)) return {};
+    return removeSubsumed(clauses);
+}
+
+std::vector<std::vector<ExprPtr>> to_dnf(const ExprPtr& e, size_t max_terms) {
+    NormalForm terms;
+    if (!normalForm(negationNormal(e, false), "OR", "AND", max_terms, terms)) return {};
+    return removeSubsumed(terms);
+}
+
+ExprPtr join_atoms(const std::vector<ExprPtr>& atoms, const char* op) {
+    ExprPtr out = atoms.empty() ? make_expression(ExprKind::NUMBER, std::string(op) == "AND" ? "1" : "0") : atoms[0];
+    for (size_t i = 1; i < atoms.size(); ++i) out = make_expression(ExprKind::BINARY, op, {out, atoms[i]});
+    return out;
+}
+
+std::string find_contradiction(const std::vector<ExprPtr>& conjuncts) {
+    std::map<std::string, ColumnFacts> columns;
+    auto facts = [&](const Expr& column) -> ColumnFacts& {
+        ColumnFacts& f = columns[to_lower(column.text)];
+        f.name = column.text;
+        return f;
+    };
+    for (const auto& c : conjuncts) {
+        auto truth = literalTruth(*c);
+        if (c->kind == ExprKind::NULL_VALUE || (truth && !*truth)) return expression_to_sql(*c) + " is never true";
+
+        if (c->kind == ExprKind::BINARY && isComparison(c->text) && c->text != "<=>") {
+            const Expr* column = c->children[0].get();
+            ExprPtr value = c->children[1];
+            std::string op = c->text;
+            if (column->kind != ExprKind::COLUMN) {
+                column = c->children[1].get();
+                value = c->children[0];
+                op = mirrored(op);
+            }
+            if (column->kind != ExprKind::COLUMN || !isLiteral(*value)) continue;
+            ColumnFacts& f = facts(*column);
+            f.compared = true;
+            if (op == "=") f.equal.push_back(value);
+            else if (op == "<>" || op == "!=") f.not_equal.push_back(value);
+            else if (op == "<" || op == "<=") f.upper.push_back({value, op == "<="});
+            else f.lower.push_back({value, op == ">="});
+        } else if (c->kind == ExprKind::BETWEEN && c->text == "BETWEEN" && c->children[0]->kind == ExprKind::COLUMN &&
+                   isLiteral(*c->children[1]) && isLiteral(*c->children[2])) {
+            ColumnFacts& f = facts(*c->children[0]);
+            f.compared = true;
+            f.lower.push_back({c->children[1], true});
+            f.upper.push_back({c->children[2], true});
+        } else if (c->kind == ExprKind::IS_NULL && c->children[0]->kind == ExprKind::COLUMN) {
+            ColumnFacts& f = facts(*c->children[0]);
+            (c->text == "IS NULL" ? f.is_null : f.not_null) = true;
+        } else if ((c->kind == ExprKind::IN_LIST && c->text == "IN") ||
+                   (c->kind == ExprKind::BINARY && (c->text == "LIKE" || c->text == "NOT LIKE"))) {
+            if (c->children[0]->kind == ExprKind::COLUMN) facts(*c->children[0]).compared = true;
+        }
+    }
+    for (const auto& kv : columns) {
+        if (contradicts(kv.second)) return "the conditions on " + kv.second.name + " cannot all hold";
+    }
+    return "";
+}
+
+} // namespace sqlopt
@@ -0,0 +1,159 @@
+#include "fingerprint.h"
+#include <cctype>
+#include <cstdio>
+
+namespace sqlopt {
+
+namespace {
+
+bool isIdentChar(char c) {
+    return std::isalnum(static_cast<unsigned char>(c)) || c == '_' || c == '$';
+}
+
+// Collapse "(?, ?, ?)" lists to "(?+)" so IN lists of any length match
+std::string collapseLists(const std::string& s) {
+    std::string out;
+    out.reserve(s.size());
+    for (size_t i = 0; i < s.size(); ++i) {
+        if (s[i] == '(' && i + 1 < s.size() && s[i + 1] == '?') {
+            size_t j = i + 2;
+            // a single value after IN is still a list
+            bool list = out.size() >= 3 && out.compare(out.size() - 3, 3, "in ") == 0;
+            while (j + 2 < s.size() && s[j] == ',' && s[j + 1] == ' ' && s[j + 2] == '?') {
+                j += 3;
+                list = true;
+            }
+            if (list && j < s.size() && s[j] == ')') {
+                out += "(?+)";
+                i = j;
+                continue;
+            }
+        }
+        out += s[i];
+    }
+    return out;
+}
+
+} // namespace
+
+std::string fingerprint_query(const std::string& sql) {
+    std::string out;
+    out.reserve(sql.size());
+    bool pending_space = false;
+
+    auto emit = [&](const std::string& tok) {
+        if (pending_space && !out.empty()) out += ' ';
+        pending_space = false;
+        out += tok;
+    };
+
+    size_t i = 0, n = sql.size();
+    while (i < n) {
+        char c = sql[i];
+        if (std::isspace(static_cast<unsigned char>(c))) {
+            pending_space = out.empty() || out.back() != '.';
+            ++i;
+        } else if (c == '-' && i + 1 < n && sql[i + 1] == '-') {
+            // -- comment to end of line
+            while (i < n && sql[i] != '\n') ++i;
+            pending_space = true;
+        } else if (c == '#') {
+            while (i < n && sql[i] != '\n') ++i;
+            pending_space = true;
+        } else if (c == '/' && i + 1 < n && sql[i + 1] == '*') {
+            size_t end = sql.find("*/", i + 2);
+            i = end == std::string::npos ? n : end + 2;
+            pending_space = true;
+        } else if (c == '\'' || c == '"') {
+            // string literal, honouring backslash and doubled-quote escapes
+            ++i;
+            while (i < n) {
+                if (sql[i] == '\\') { i += 2; continue; }
+                if (sql[i] == c) {
+                    if (i + 1 < n && sql[i + 1] == c) { i += 2; continue; }
+                    ++i;
+                    break;
+                }
+                ++i;
+            }
+            emit("?");
+        } else if (c == '`') {
+            size_t end = sql.find('`', i + 1);
+            if (end == std::string::npos) end = n - 1;
+            std::string ident;
+            for (size_t k = i + 1; k < end; ++k) ident += static_cast<char>(std::tolower(static_cast<unsigned char>(sql[k])));
+            emit(ident);
+            i = end + 1;
+        } else if (std::isdigit(static_cast<unsigned char>(c)) ||
+                   (c == '.' && i + 1 < n && std::isdigit(static_cast<unsigned char>(sql[i + 1])))) {
+            // a number, unless it is part of an identifier such as t1
+            if (!out.empty() && !pending_space && isIdentChar(out.back())) {
+                out += c;
+                ++i;
+                continue;
+            }
+            while (i < n && (isIdentChar(sql[i]) || sql[i] == '.')) ++i;
+            // fold a unary minus into the literal
+            if (!out.empty() && out.back() == '-') {
+                size_t prev = out.find_last_not_of(" -");
+                bool operand_before = prev != std::string::npos && (isIdentChar(out[prev]) || out[prev] == ')' || out[prev] == '?');
+                if (!operand_before) {
+                    out.pop_back();
+                    if (!out.empty() && out.back() == ' ') { out.pop_back(); pending_space = true; }
+                }
+            }
+            emit("?");
+        } else if (isIdentChar(c)) {
+            std::string word;
+            while (i < n && isIdentChar(sql[i])) {
+                word += static_cast<char>(std::tolower(static_cast<unsigned char>(sql[i])));
+                ++i;
+            }
+            emit(word);
+        } else if (c == ';') {
+            ++i;
+        } else if (c == ',') {
+            out += ',';
+            pending_space = true;
+            ++i;
+        } else {
+            std::string op(1, c);
+            // keep two-character comparison operators together
+            if (i + 1 < n && (sql[i + 1] == '=' || (c == '<' && sql[i + 1] == '>'))) op += sql[++i];
+            if (c == '.') {
+                // qualified names stay together: "u . id" and "u.id" match
+                out += c;
+                pending_space = false;
+            } else if (c == '(' || c == ')') {
+                // no spaces inside parentheses
+                if (c == ')') pending_space = false;
+                emit(op);
+                if (c == '(') pending_space = false;
+            } else {
+                // operators are always spaced, so "a=1" and "a = 1" match
+                pending_space = out.empty() || out.back() != '(';
+                emit(op);
+                pending_space = true;
+            }
+            ++i;
+        }
+    }
+    return collapseLists(out);
+}
+
+uint64_t fingerprint_id(const std::string& fingerprint) {
+    uint64_t h = 14695981039346656037ULL;
+    for (unsigned char c : fingerprint) {
+        h ^= c;
+        h *= 1099511628211ULL;
+    }
+    return h;
+}
+
+std::string fingerprint_id_hex(const std::string& fingerprint) {
+    char buf[17];
+    std::snprintf(buf, sizeof(buf), "%016llx", static_cast<unsigned long long>(fingerprint_id(fingerprint)));
+    return buf;
+}
+
+} // namespace sqlopt
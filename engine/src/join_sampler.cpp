@@ -0,0 +1,127 @@
+#include "join_sampler.h"
+#include "column_index.h"
+#include <algorithm>
+#include <random>
+#include <string>
+
+namespace sqlopt {
+
+namespace {
+
+// Where a join key comes from: a column of an already joined table, probing the
+// index on a column of the table being joined
+struct SampleKey {
+    RefId outer_ref = INVALID_REF;
+    const Column* outer = nullptr;
+    const ColumnIndex* index = nullptr;
+};
+
+// The first edge of the ON conditions of the table reference `inner_ref` that joins
+// an indexed column of it to a column of a table joined before it. `tables` holds
+// the loaded table of every reference joined so far, by RefId.
+bool findSampleKey(const ColumnStore& store, const std::vector<const ColumnTable*>& tables,
+                   const std::vector<BoundPredicate>& on, RefId inner_ref, const ColumnTable& inner,
+                   SampleKey& key) {
+    for (const auto& pred : on) {
+        for (const JoinEdge& edge : pred.edges) {
+            bool inner_left = edge.left.ref == inner_ref;
+            if (inner_left == (edge.right.ref == inner_ref)) continue;
+            const BoundColumn& outer_column = inner_left ? edge.right : edge.left;
+            const BoundColumn& inner_column = inner_left ? edge.left : edge.right;
+            if (outer_column.ref >= tables.size()) continue; // joined later, or unbound
+
+            const ColumnIndex* index = store.index(inner.name, inner_column.name);
+            if (!index) continue;
+            const ColumnTable* outer_table = tables[outer_column.ref];
+            int column = outer_table->columnIndex(outer_column.name);
+            if (column < 0) continue;
+            const Column* outer = &outer_table->columns[column];
+            bool outer_text = outer->type() == ColumnType::STRING;
+            bool inner_text = dynamic_cast<const ArtIndex*>(index) != nullptr;
+            if (outer_text != inner_text) continue;
+            key = {outer_column.ref, outer, index};
+            return true;
+        }
+    }
+    return false;
+}
+
+} // namespace
+
+std::vector<double> JoinSampler::estimateJoins(const SelectQuery& query, const BoundQuery& bound) const {
+    std::vector<double> estimates;
+    const ColumnTable* first = store_->table(query.from_table.name);
+    if (!first || first->row_count == 0) return estimates;
+
+    std::mt19937 rng(42); // fixed seed: the same query plans the same way
+    // Loaded table of every reference joined so far, by RefId; a tuple's row ids are
+    // in the same order
+    std::vector<const ColumnTable*> tables{first};
+
+    // Sampled tuples, one row id per table reference, stored row-major. A reservoir keeps a
+    // uniform sample of everything offered to it.
+    size_t width = 1;
+    std::vector<RowId> sample;
+    size_t offered = 0;
+    std::vector<RowId> tuple;
+    auto offer = [&](std::vector<RowId>& reservoir) {
+        ++offered;
+        if (offered <= sample_rows_) {
+            reservoir.insert(reservoir.end(), tuple.begin(), tuple.end());
+            return;
+        }
+        size_t slot = std::uniform_int_distribution<size_t>(0, offered - 1)(rng);
+        if (slot < sample_rows_) std::copy(tuple.begin(), tuple.end(), reservoir.begin() + slot * tuple.size());
+    };
+    tuple.resize(1);
+    for (RowId row = 0; row < first->row_count; ++row) {
+        tuple[0] = row;
+        offer(sample);
+    }
+    double scale = static_cast<double>(first->row_count) / (sample.size() / width); // rows per sampled tuple
+
+    std::vector<RowId> matches;
+    for (size_t i = 0; i < query.joins.size() && i < bound.on.size(); ++i) {
+        const JoinClause& join = query.joins[i];
+        RefId ref = static_cast<RefId>(i + 1);
+        const ColumnTable* inner = store_->table(join.table.name);
+        SampleKey key;
+        if (!inner || !findSampleKey(*store_, tables, bound.on[i], ref, *inner, key)) break;
+        bool keep_unmatched = join.type == JoinType::LEFT;
+        if (join.type != JoinType::INNER && !keep_unmatched) break;
+
+        auto btree = dynamic_cast<const BTreeIndex*>(key.index);
+        auto art = dynamic_cast<const ArtIndex*>(key.index);
+        std::vector<RowId> next;
+        offered = 0;
+        tuple.resize(width + 1);
+        for (size_t t = 0; t * width < sample.size(); ++t) {
+            std::copy(sample.begin() + t * width, sample.begin() + (t + 1) * width, tuple.begin());
+            RowId outer_row = tuple[key.outer_ref];
+            matches.clear();
+            if (outer_row != NULL_ROW && !key.outer->isNull(outer_row)) {
+                if (btree) {
+                    BTreeIndex::Bound equal{true, key.outer->numberAt(outer_row), true};
+                    btree->range(equal, equal, matches);
+                } else {
+                    art->lookup(key.outer->stringAt(outer_row), matches);
+                }
+            }
+            if (matches.empty() && keep_unmatched) matches.push_back(NULL_ROW);
+            for (RowId row : matches) {
+                tuple[width] = row;
+                offer(next);
+            }
+        }
+
+        estimates.push_back(offered * scale);
+        if (offered == 0) break; // nothing left to join: later estimates would all be 0
+        scale *= static_cast<double>(offered) / std::min(offered, sample_rows_);
+        sample = std::move(next);
+        tables.push_back(inner);
+        ++width;
+    }
+    return estimates;
+}
+
+} // namespace sqlopt
@@ -8,6 +8,7 @@ static bool is_ident_char(char c){ return std::isalnum((unsigned char)c) || c=='
 
 std::vector<Token> Lexer::tokenize(){
     std::vector<Token> out; int start=0;
+    out.reserve(n/2+2); // a token per two characters covers "t.col = 5"; grows once at most for denser input
     auto push=[&](TokenType t, const std::string &tx){ out.push_back({t,tx,i}); };
     while(i<n){
         char c=s[i];
@@ -33,12 +34,17 @@ std::vector<Token> Lexer::tokenize(){
             std::string id = s.substr(start,i-start);
             std::string low; low.resize(id.size());
             for(size_t k=0;k<id.size();++k) low[k]=std::tolower((unsigned char)id[k]);
-            static const std::vector<std::string> kws={"select","from","where","join","on","inner","left","right","full","natural","anti","outer","group","by","order","asc","desc","limit","as","and","having","between","in","sum","count","avg","min","max","or","not","like","any","all","case","insert","update","delete","into","set","values"};
+            static const std::vector<std::string> kws={"select","distinct","from","where","join","on","inner","left","right","full","natural","anti","outer","group","by","order","asc","desc","limit","as","and","having","between","in","sum","count","avg","min","max","or","not","like","any","all","case","insert","update","delete","into","set","values"};
             bool iskw=false; for(auto &kw:kws){ if(low==kw){ iskw=true; break; } }
             push(iskw?TokenType::KW:TokenType::IDENT, id);
             continue;
         }
-        if(c=='<'){ if(i+1<n && s[i+1]=='<'){ push(TokenType::OP,"<<"); i+=2; } else { start=i; ++i; if(i<n && s[i]=='=') ++i; push(TokenType::OP, s.substr(start,i-start)); } continue; }
+        if(c=='<'){
+            // <<, <>, <=>, <= and <
+            if(i+1<n && (s[i+1]=='<' || s[i+1]=='>')){ push(TokenType::OP, s.substr(i,2)); i+=2; }
+            else { start=i; ++i; if(i<n && s[i]=='=') ++i; if(i<n && s[i-1]=='=' && s[i]=='>') ++i; push(TokenType::OP, s.substr(start,i-start)); }
+            continue;
+        }
         if(c=='>'){ if(i+1<n && s[i+1]=='>'){ push(TokenType::OP,">>"); i+=2; } else { start=i; ++i; if(i<n && s[i]=='=') ++i; push(TokenType::OP, s.substr(start,i-start)); } continue; }
         if(std::string("=<>!~+-*/%&|^").find(c)!=std::string::npos){
             start=i; ++i; if(i<n && (s[i]=='=' || s[i]=='>' || s[i]=='<' || s[i]=='|')) ++i;
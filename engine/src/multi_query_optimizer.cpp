@@ -0,0 +1,560 @@
+#include "multi_query_optimizer.h"
+#include "bound_query.h"
+#include "cost_estimator.h"
+#include "utils.h"
+#include <algorithm>
+#include <bitset>
+#include <map>
+#include <regex>
+#include <set>
+#include <sstream>
+
+namespace sqlopt {
+
+namespace {
+
+// Tables per shared subexpression; the candidates of a query grow combinatorially past it
+constexpr size_t MAX_SHARED_TABLES = 4;
+// Queries with more tables than this are optimized on their own
+constexpr size_t MAX_BATCH_TABLES = 16;
+
+struct Relation {
+    std::string table; // as written
+    std::string ref;   // lower-cased alias, or table name
+};
+
+// A WHERE or ON condition and the relations it references
+struct Conjunct {
+    std::string text;
+    TableMask mask = 0;
+};
+
+struct BatchQuery {
+    bool eligible = false;
+    std::vector<Relation> relations; // FROM table, then joins in order
+    std::vector<Conjunct> conjuncts;
+    std::vector<TableMask> adjacent; // per relation: relations a condition joins it to
+};
+
+// expr with the contents of string literals blanked, so patterns only match SQL text
+std::string maskLiterals(const std::string& expr) {
+    std::string masked = expr;
+    char quote = 0;
+    for (auto& c : masked) {
+        if (quote) {
+            if (c == quote) quote = 0;
+            else c = ' ';
+        } else if (c == '\'' || c == '"') {
+            quote = c;
+        }
+    }
+    return masked;
+}
+
+// Rewrite the qualified column references of expr; `replace` gets the lower-cased
+// qualifier and the column and returns the new text, or an empty string to keep it
+template <typename Fn>
+std::string rewriteColumns(const std::string& expr, Fn replace) {
+    static const std::regex column_ref(R"(\b([A-Za-z_]\w*)\s*\.\s*([A-Za-z_]\w*))");
+    std::string masked = maskLiterals(expr);
+    std::string out;
+    size_t copied = 0;
+    for (std::sregex_iterator it(masked.begin(), masked.end(), column_ref), end; it != end; ++it) {
+        std::string replacement = replace(to_lower((*it)[1].str()), (*it)[2].str());
+        if (replacement.empty()) continue;
+        out.append(expr, copied, it->position() - copied);
+        out += replacement;
+        copied = it->position() + it->length();
+    }
+    out.append(expr, copied, std::string::npos);
+    return out;
+}
+
+// A bare identifier that is neither a keyword, a function name nor part of a
+// qualified reference: its table cannot be told without the schema
+bool hasUnqualifiedColumn(const std::string& expr) {
+    static const std::set<std::string> keywords = {
+        "and", "or", "not", "in", "is", "null", "like", "between", "true", "false", "as", "asc", "desc",
+        "case", "when", "then", "else", "end", "distinct", "escape", "interval", "day", "month", "year"};
+    std::string masked = maskLiterals(expr);
+    for (size_t i = 0; i < masked.size();) {
+        char c = masked[i];
+        bool starts = (std::isalpha(static_cast<unsigned char>(c)) || c == '_') &&
+                      (i == 0 || !(std::isalnum(static_cast<unsigned char>(masked[i - 1])) || masked[i - 1] == '_'));
+        if (!starts) {
+            ++i;
+            continue;
+        }
+        size_t end = i;
+        while (end < masked.size() && (std::isalnum(static_cast<unsigned char>(masked[end])) || masked[end] == '_')) ++end;
+        size_t before = masked.find_last_not_of(' ', i == 0 ? std::string::npos : i - 1);
+        size_t after = masked.find_first_not_of(' ', end);
+        bool qualified = (i > 0 && before != std::string::npos && masked[before] == '.') ||
+                         (after != std::string::npos && masked[after] == '.');
+        bool function = after != std::string::npos && masked[after] == '(';
+        if (!qualified && !function && !keywords.count(to_lower(masked.substr(i, end - i)))) return true;
+        i = end;
+    }
+    return false;
+}
+
+// Lower-cased SQL text with whitespace outside literals removed, the sides of a
+// column equality in order, so that equivalent conditions compare equal
+std::string canonical(const std::string& expr) {
+    std::string out;
+    char quote = 0;
+    for (char c : expr) {
+        if (quote) {
+            out += c;
+            if (c == quote) quote = 0;
+        } else if (c == '\'' || c == '"') {
+            quote = c;
+            out += c;
+        } else if (!std::isspace(static_cast<unsigned char>(c))) {
+            out += static_cast<char>(std::tolower(static_cast<unsigned char>(c)));
+        }
+    }
+    static const std::regex equality(R"(^(\w+\.\w+)=(\w+\.\w+)$)");
+    std::smatch m;
+    if (std::regex_match(out, m, equality) && m[2].str() < m[1].str()) out = m[2].str() + "=" + m[1].str();
+    return out;
+}
+
+std::string refOf(const TableRef& table) {
+    return to_lower(table.alias.empty() ? table.name : table.alias);
+}
+
+int relationOf(const BatchQuery& bq, const std::string& ref) {
+    for (size_t r = 0; r < bq.relations.size(); ++r) {
+        if (bq.relations[r].ref == ref) return static_cast<int>(r);
+    }
+    return -1;
+}
+
+BatchQuery analyze(const SelectQuery& q) {
+    BatchQuery bq;
+    if (!q.subqueries.empty() || q.from_table.pushedLimit >= 0) return bq;
+    bq.relations.push_back({q.from_table.name, refOf(q.from_table)});
+    for (const auto& join : q.joins) {
+        if (join.type != JoinType::INNER) return bq;
+        bq.relations.push_back({join.table.name, refOf(join.table)});
+    }
+    if (bq.relations.size() > MAX_BATCH_TABLES) return bq;
+    std::set<std::string> tables, refs;
+    for (const auto& rel : bq.relations) {
+        if (!tables.insert(to_lower(rel.table)).second || !refs.insert(rel.ref).second) return bq;
+    }
+
+    std::vector<std::string> expressions;
+    for (const auto& item : q.select_items) {
+        std::string expr = trim(item.expr);
+        if (expr == "*" || (expr.size() > 1 && expr.substr(expr.size() - 2) == ".*")) return bq;
+        expressions.push_back(expr);
+    }
+    if (q.select_items.empty()) return bq;
+    for (const auto& g : q.group_by) expressions.push_back(g);
+    for (const auto& h : q.having_conditions) expressions.push_back(h);
+    for (const auto& o : q.order_by) expressions.push_back(o.expr);
+
+    // Every column is qualified (checked below), so the binding needs no statistics
+    BoundQuery bound(q);
+    auto addConjunct = [&](const std::string& cond, const BoundPredicate& binding) {
+        bq.conjuncts.push_back({cond, binding.tables});
+        expressions.push_back(cond);
+        return !binding.opaque;
+    };
+    for (size_t i = 0; i < q.where_conditions.size(); ++i) {
+        if (!addConjunct(q.where_conditions[i], bound.where[i])) return bq;
+    }
+    for (size_t j = 0; j < q.joins.size(); ++j) {
+        for (size_t i = 0; i < q.joins[j].on_conds.size(); ++i) {
+            if (!addConjunct(q.joins[j].on_conds[i], bound.on[j][i])) return bq;
+        }
+    }
+    bool unknown_ref = false;
+    for (const auto& expr : expressions) {
+        if (expr.find("(SELECT") != std::string::npos || hasUnqualifiedColumn(expr)) return bq;
+        rewriteColumns(expr, [&](const std::string& ref, const std::string&) {
+            if (relationOf(bq, ref) < 0) unknown_ref = true;
+            return std::string();
+        });
+    }
+    if (unknown_ref) return bq;
+
+    bq.adjacent.assign(bq.relations.size(), 0);
+    for (const auto& c : bq.conjuncts) {
+        if (std::bitset<64>(c.mask).count() < 2) continue;
+        for (size_t r = 0; r < bq.relations.size(); ++r) {
+            if (c.mask & (TableMask(1) << r)) bq.adjacent[r] |= c.mask & ~(TableMask(1) << r);
+        }
+    }
+    bq.eligible = true;
+    return bq;
+}
+
+// Connected sets of up to MAX_SHARED_TABLES relations: single relations only when
+// a condition filters them, since an unfiltered scan is not worth materializing
+std::vector<TableMask> candidateSets(const BatchQuery& bq) {
+    std::set<TableMask> seen;
+    std::vector<TableMask> pending;
+    for (size_t r = 0; r < bq.relations.size(); ++r) pending.push_back(TableMask(1) << r);
+    std::vector<TableMask> sets;
+    while (!pending.empty()) {
+        TableMask set = pending.back();
+        pending.pop_back();
+        if (!seen.insert(set).second) continue;
+        size_t size = std::bitset<64>(set).count();
+        bool filtered = std::any_of(bq.conjuncts.begin(), bq.conjuncts.end(),
+                                    [&](const Conjunct& c) { return c.mask == set; });
+        if (size > 1 || filtered) sets.push_back(set);
+        if (size == MAX_SHARED_TABLES) continue;
+        for (size_t r = 0; r < bq.relations.size(); ++r) {
+            TableMask bit = TableMask(1) << r;
+            if (!(set & bit) && (bq.adjacent[r] & set)) pending.push_back(set | bit);
+        }
+    }
+    return sets;
+}
+
+// Tables and local conditions of a set, by table name, independent of aliases
+std::string subexpressionKey(const BatchQuery& bq, TableMask set) {
+    std::vector<std::string> tables, conditions;
+    for (size_t r = 0; r < bq.relations.size(); ++r) {
+        if (set & (TableMask(1) << r)) tables.push_back(to_lower(bq.relations[r].table));
+    }
+    for (const auto& c : bq.conjuncts) {
+        if (c.mask == 0 || (c.mask & ~set)) continue;
+        conditions.push_back(canonical(rewriteColumns(c.text, [&](const std::string& ref, const std::string& column) {
+            return to_lower(bq.relations[relationOf(bq, ref)].table) + "." + column;
+        })));
+    }
+    std::sort(tables.begin(), tables.end());
+    std::sort(conditions.begin(), conditions.end());
+    std::string key;
+    for (const auto& t : tables) key += t + ",";
+    key += "|";
+    for (const auto& c : conditions) key += c + " AND ";
+    return key;
+}
+
+// Name of a shared result's column holding table.column
+std::string sharedColumn(const std::string& table, const std::string& column) {
+    return to_lower(table) + "_" + to_lower(column);
+}
+
+// Columns of the set's tables that a query reads outside the set's own conditions,
+// as (relation, column)
+std::set<std::pair<int, std::string>> columnsUsed(const SelectQuery& q, const BatchQuery& bq, TableMask set) {
+    std::set<std::pair<int, std::string>> used;
+    auto collect = [&](const std::string& expr) {
+        rewriteColumns(expr, [&](const std::string& ref, const std::string& column) {
+            int r = relationOf(bq, ref);
+            if (r >= 0 && (set & (TableMask(1) << r))) used.insert({r, to_lower(column)});
+            return std::string();
+        });
+    };
+    for (const auto& item : q.select_items) collect(item.expr);
+    for (const auto& g : q.group_by) collect(g);
+    for (const auto& h : q.having_conditions) collect(h);
+    for (const auto& o : q.order_by) collect(o.expr);
+    for (const auto& c : bq.conjuncts) {
+        if (c.mask & ~set) collect(c.text);
+    }
+    return used;
+}
+
+// Rebuild a join list over `relations` from conjuncts given as (text, mask): each
+// condition joining two or more relations goes to the ON clause of the last of
+// them, the rest to WHERE
+void layoutJoins(SelectQuery& q, const std::vector<TableRef>& relations, const std::vector<Conjunct>& conjuncts) {
+    q.from_table = relations[0];
+    q.joins.clear();
+    q.where_conditions.clear();
+    for (size_t r = 1; r < relations.size(); ++r) q.joins.push_back({JoinType::INNER, relations[r], {}});
+    for (const auto& c : conjuncts) {
+        if (std::bitset<64>(c.mask).count() < 2) {
+            q.where_conditions.push_back(c.text);
+            continue;
+        }
+        size_t last = 63 - static_cast<size_t>(__builtin_clzll(c.mask));
+        q.joins[last - 1].on_conds.push_back(c.text);
+    }
+}
+
+// The set as a query of its own, with a column per entry of `columns`
+SelectQuery sharedQuery(const SelectQuery& q, const BatchQuery& bq, TableMask set,
+                        const std::set<std::pair<std::string, std::string>>& columns) {
+    std::vector<TableRef> relations;
+    std::vector<int> position(bq.relations.size(), -1);
+    for (size_t r = 0; r < bq.relations.size(); ++r) {
+        if (!(set & (TableMask(1) << r))) continue;
+        position[r] = static_cast<int>(relations.size());
+        relations.push_back(r == 0 ? q.from_table : q.joins[r - 1].table);
+    }
+    std::vector<Conjunct> conjuncts;
+    for (const auto& c : bq.conjuncts) {
+        if (c.mask == 0 || (c.mask & ~set)) continue;
+        TableMask mask = 0;
+        for (size_t r = 0; r < bq.relations.size(); ++r) {
+            if (c.mask & (TableMask(1) << r)) mask |= TableMask(1) << position[r];
+        }
+        conjuncts.push_back({c.text, mask});
+    }
+
+    SelectQuery shared;
+    layoutJoins(shared, relations, conjuncts);
+    for (const auto& tc : columns) {
+        for (size_t r = 0; r < bq.relations.size(); ++r) {
+            if (position[r] < 0 || to_lower(bq.relations[r].table) != tc.first) continue;
+            const TableRef& rel = relations[position[r]];
+            shared.select_items.push_back({(rel.alias.empty() ? rel.name : rel.alias) + "." + tc.second,
+                                           sharedColumn(tc.first, tc.second)});
+        }
+    }
+    return shared;
+}
+
+// A shared result a consumer reads: the relations it covers and its table name
+struct Consumed {
+    TableMask set;
+    std::string name;
+};
+
+// The consumer joining each shared result in place of the relations it covers,
+// its other references to those relations renamed to the shared result's columns
+SelectQuery consumerQuery(const SelectQuery& q, const BatchQuery& bq, const std::vector<Consumed>& consumed) {
+    auto sharedOf = [&](int r) -> const Consumed* {
+        for (const auto& c : consumed) {
+            if (r >= 0 && (c.set & (TableMask(1) << r))) return &c;
+        }
+        return nullptr;
+    };
+    auto rename = [&](const std::string& expr) {
+        return rewriteColumns(expr, [&](const std::string& ref, const std::string& column) {
+            int r = relationOf(bq, ref);
+            const Consumed* shared = sharedOf(r);
+            if (!shared) return std::string();
+            return shared->name + "." + sharedColumn(bq.relations[r].table, column);
+        });
+    };
+
+    std::vector<TableRef> relations;
+    std::vector<int> position(bq.relations.size(), -1);
+    std::map<std::string, int> shared_position;
+    for (size_t r = 0; r < bq.relations.size(); ++r) {
+        if (const Consumed* shared = sharedOf(static_cast<int>(r))) {
+            auto inserted = shared_position.emplace(shared->name, static_cast<int>(relations.size()));
+            if (inserted.second) relations.push_back({shared->name, shared->name, {}, {}, -1, {}});
+            position[r] = inserted.first->second;
+            continue;
+        }
+        position[r] = static_cast<int>(relations.size());
+        relations.push_back(r == 0 ? q.from_table : q.joins[r - 1].table);
+    }
+    std::vector<Conjunct> conjuncts;
+    for (const auto& c : bq.conjuncts) {
+        bool computed = std::any_of(consumed.begin(), consumed.end(),
+                                    [&](const Consumed& s) { return c.mask != 0 && !(c.mask & ~s.set); });
+        if (computed) continue;
+        TableMask mask = 0;
+        for (size_t r = 0; r < bq.relations.size(); ++r) {
+            if (c.mask & (TableMask(1) << r)) mask |= TableMask(1) << position[r];
+        }
+        conjuncts.push_back({rename(c.text), mask});
+    }
+
+    SelectQuery consumer = q;
+    layoutJoins(consumer, relations, conjuncts);
+    static const std::regex plain_column(R"(^\s*[A-Za-z_]\w*\s*\.\s*([A-Za-z_]\w*)\s*$)");
+    for (auto& item : consumer.select_items) {
+        std::string renamed = rename(item.expr);
+        std::smatch m;
+        // Keep the output column's name: "u.name" is named name, mqo_1.users_name would not be
+        if (renamed != item.expr && item.alias.empty() && std::regex_match(item.expr, m, plain_column)) {
+            item.alias = m[1].str();
+        }
+        item.expr = renamed;
+    }
+    for (auto& g : consumer.group_by) g = rename(g);
+    for (auto& h : consumer.having_conditions) h = rename(h);
+    for (auto& o : consumer.order_by) o.expr = rename(o.expr);
+    return consumer;
+}
+
+// Statistics of a materialized result: its estimated rows, and each column's source
+// statistics with distinct values capped by them
+TableStatistics sharedStats(const SharedSubplan& shared, const StatisticsManager& stats,
+                            const std::map<std::string, std::string>& sources) {
+    TableStatistics ts;
+    ts.table_name = shared.name;
+    ts.row_count = shared.optimized.plan.getCardinality();
+    ts.page_count = (ts.row_count + 99) / 100;
+    for (const auto& item : shared.query.select_items) {
+        ColumnStats cs;
+        std::vector<CommonValue> common;
+        auto source = sources.find(item.alias);
+        if (source != sources.end()) {
+            size_t dot = source->second.find('.');
+            const TableStatistics* table = stats.getTableStatsCI(source->second.substr(0, dot));
+            if (const ColumnStats* column = table ? stats.findColumnCI(*table, source->second.substr(dot + 1)) : nullptr) {
+                cs = *column;
+                common = table->commonValueList(*column);
+            }
+        }
+        cs.column_name = item.alias;
+        cs.distinct_values = std::min(cs.distinct_values ? cs.distinct_values : ts.row_count, ts.row_count);
+        ts.setColumn(std::move(cs), common);
+    }
+    return ts;
+}
+
+struct Candidate {
+    std::vector<std::pair<size_t, TableMask>> occurrences; // (query, set)
+    double cost = 0.0;
+    double rows = 0.0;
+    double width = 0.0;
+};
+
+} // namespace
+
+MultiQueryOptimizer::MultiQueryOptimizer(std::shared_ptr<StatisticsManager> stats_mgr)
+    : stats_mgr_(std::move(stats_mgr)) {}
+
+std::string MultiQueryOptimizer::materializeSQL(const SharedSubplan& shared) {
+    return "CREATE TEMPORARY TABLE " + shared.name + " AS " + shared.optimized.rewritten_sql;
+}
+
+BatchOptimizeResult MultiQueryOptimizer::optimize(const std::vector<SelectQuery>& batch) const {
+    BatchOptimizeResult result;
+    std::vector<BatchQuery> analyzed;
+    std::vector<double> independent;
+    Optimizer optimizer(stats_mgr_);
+    for (const auto& q : batch) {
+        analyzed.push_back(analyze(q));
+        independent.push_back(optimizer.optimize(q).plan.getCost());
+        result.independent_cost += independent.back();
+    }
+
+    // Subexpressions by key, in the order first seen
+    std::map<std::string, size_t> by_key;
+    std::vector<Candidate> candidates;
+    for (size_t i = 0; i < batch.size(); ++i) {
+        if (!analyzed[i].eligible) continue;
+        for (TableMask set : candidateSets(analyzed[i])) {
+            auto inserted = by_key.emplace(subexpressionKey(analyzed[i], set), candidates.size());
+            if (inserted.second) candidates.emplace_back();
+            candidates[inserted.first->second].occurrences.push_back({i, set});
+        }
+    }
+    for (auto& c : candidates) {
+        if (c.occurrences.size() < 2) continue;
+        const auto& first = c.occurrences[0];
+        const auto& bq = analyzed[first.first];
+        std::set<std::pair<std::string, std::string>> columns;
+        for (const auto& occurrence : c.occurrences) {
+            const auto& consumer = analyzed[occurrence.first];
+            for (const auto& rc : columnsUsed(batch[occurrence.first], consumer, occurrence.second)) {
+                columns.insert({to_lower(consumer.relations[rc.first].table), rc.second});
+            }
+        }
+        auto optimized = optimizer.optimize(sharedQuery(batch[first.first], bq, first.second, columns));
+        c.cost = optimized.plan.getCost();
+        c.rows = static_cast<double>(optimized.plan.getCardinality());
+        c.width = static_cast<double>(std::max<size_t>(columns.size(), 1));
+    }
+
+    // Greedy by estimated savings; a query consumes sets that do not overlap
+    std::vector<size_t> order;
+    for (size_t i = 0; i < candidates.size(); ++i) {
+        if (candidates[i].occurrences.size() >= 2) order.push_back(i);
+    }
+    auto estimate = [](const Candidate& c, size_t consumers) {
+        return (static_cast<double>(consumers) - 1.0) * c.cost - cost_model::materialize(c.rows, c.width).total();
+    };
+    std::stable_sort(order.begin(), order.end(), [&](size_t a, size_t b) {
+        return estimate(candidates[a], candidates[a].occurrences.size()) >
+               estimate(candidates[b], candidates[b].occurrences.size());
+    });
+
+    std::vector<TableMask> covered(batch.size(), 0);
+    std::vector<std::vector<Consumed>> consumed(batch.size());
+    auto batch_stats = std::make_shared<StatisticsManager>(*stats_mgr_);
+    std::ostringstream log;
+    int step = 1;
+    for (size_t index : order) {
+        const Candidate& c = candidates[index];
+        std::vector<std::pair<size_t, TableMask>> consumers;
+        for (const auto& occurrence : c.occurrences) {
+            if (!(covered[occurrence.first] & occurrence.second)) consumers.push_back(occurrence);
+        }
+        if (consumers.size() < 2 || estimate(c, consumers.size()) <= 0.0) continue;
+
+        SharedSubplan shared;
+        shared.name = "mqo_" + std::to_string(result.shared.size() + 1);
+        std::set<std::pair<std::string, std::string>> columns;
+        std::map<std::string, std::string> sources;
+        for (const auto& consumer : consumers) {
+            const auto& bq = analyzed[consumer.first];
+            for (const auto& rc : columnsUsed(batch[consumer.first], bq, consumer.second)) {
+                std::string table = to_lower(bq.relations[rc.first].table);
+                columns.insert({table, rc.second});
+                sources[sharedColumn(table, rc.second)] = table + "." + rc.second;
+            }
+        }
+        if (columns.empty()) {
+            // Consumers only count rows: keep one column of the join so the table is not empty of columns
+            const auto& bq = analyzed[consumers[0].first];
+            for (const auto& cj : bq.conjuncts) {
+                if (!cj.mask || (cj.mask & ~consumers[0].second) || !columns.empty()) continue;
+                rewriteColumns(cj.text, [&](const std::string& ref, const std::string& column) {
+                    if (columns.empty()) columns.insert({to_lower(bq.relations[relationOf(bq, ref)].table), to_lower(column)});
+                    return std::string();
+                });
+            }
+        }
+        shared.query = sharedQuery(batch[consumers[0].first], analyzed[consumers[0].first], consumers[0].second, columns);
+        shared.optimized = optimizer.optimize(shared.query);
+        shared.cost = shared.optimized.plan.getCost();
+        shared.materialize_cost =
+            cost_model::materialize(static_cast<double>(shared.optimized.plan.getCardinality()),
+                                    static_cast<double>(shared.query.select_items.size()))
+                .total();
+        shared.savings = (static_cast<double>(consumers.size()) - 1.0) * shared.cost - shared.materialize_cost;
+        shared.stats = sharedStats(shared, *stats_mgr_, sources);
+        batch_stats->updateTableStats(shared.name, shared.stats);
+
+        std::set<std::string> others;
+        for (const auto& consumer : consumers) {
+            size_t q = consumer.first;
+            shared.consumers.push_back(q);
+            covered[q] |= consumer.second;
+            consumed[q].push_back({consumer.second, shared.name});
+            for (size_t r = 0; r < analyzed[q].relations.size(); ++r) {
+                if (!(covered[q] & (TableMask(1) << r))) others.insert(analyzed[q].relations[r].table);
+            }
+        }
+        shared.other_tables.assign(others.begin(), others.end());
+
+        log << step++ << ". [shared_subplan] " << shared.name << " = " << shared.optimized.rewritten_sql
+            << "\n   computed once for queries";
+        for (size_t q : shared.consumers) log << " " << (q + 1);
+        log << ": cost " << shared.cost << " each time, materializing " << shared.materialize_cost << ", saves "
+            << shared.savings << "\n";
+        result.shared.push_back(std::move(shared));
+    }
+
+    Optimizer batch_optimizer(batch_stats);
+    for (size_t q = 0; q < batch.size(); ++q) {
+        result.queries.push_back(batch_optimizer.optimize(
+            consumed[q].empty() ? batch[q] : consumerQuery(batch[q], analyzed[q], consumed[q])));
+        result.batch_cost += result.queries.back().plan.getCost();
+    }
+    for (const auto& shared : result.shared) result.batch_cost += shared.cost + shared.materialize_cost;
+
+    if (result.shared.empty()) log << "No subexpression is shared by two queries of the batch\n";
+    log << "Batch cost " << result.batch_cost << " vs " << result.independent_cost << " for the queries one by one\n";
+    result.log = log.str();
+    return result;
+}
+
+} // namespace sqlopt
@@ -27,6 +27,10 @@ bool MySQLConnector::connect(const std::string& host, const std::string& user,
     if (mysql_real_connect(mysql_, host.c_str(), user.c_str(), password.c_str(),
                           database.empty() ? nullptr : database.c_str(), port, nullptr, 0)) {
         connected_ = true;
+        host_ = host;
+        user_ = user;
+        password_ = password;
+        port_ = port;
         return true;
     }
 
@@ -100,15 +104,17 @@ MySQLConnector::QueryResult MySQLConnector::executeQuery(const std::string& sql)
     unsigned int num_fields = mysql_num_fields(mysql_result);
     MYSQL_FIELD* fields = mysql_fetch_fields(mysql_result);
 
-    // Get column names
+    // Get column names and types
     for (unsigned int i = 0; i < num_fields; ++i) {
         result.columns.push_back(fields[i].name);
+        result.column_types.push_back(fieldInfo(fields[i]));
     }
 
     // Get rows
     MYSQL_ROW row;
     while ((row = mysql_fetch_row(mysql_result))) {
         result.rows.push_back(fetchRow(row, num_fields));
+        result.null_flags.push_back(nullFlags(row, num_fields));
     }
 
     freeResult(mysql_result);
@@ -116,6 +122,76 @@ MySQLConnector::QueryResult MySQLConnector::executeQuery(const std::string& sql)
     return result;
 }
 
+MySQLConnector::QueryResult MySQLConnector::streamQuery(const std::string& sql, size_t batch_rows,
+                                                       const RowBatchFn& on_rows) {
+    QueryResult result;
+    result.success = false;
+    result.affected_rows = 0;
+
+    if (!connected_) {
+        result.error_message = "Not connected to database";
+        return result;
+    }
+
+    if (mysql_real_query(mysql_, sql.data(), sql.size()) != 0) {
+        result.error_message = mysql_error(mysql_);
+        return result;
+    }
+
+    // Rows are read off the socket one by one rather than buffered whole
+    MYSQL_RES* mysql_result = mysql_use_result(mysql_);
+    if (!mysql_result) {
+        if (mysql_field_count(mysql_) != 0) {
+            result.error_message = mysql_error(mysql_);
+            return result;
+        }
+        result.affected_rows = mysql_affected_rows(mysql_);
+        result.success = true;
+        return result;
+    }
+
+    unsigned int num_fields = mysql_num_fields(mysql_result);
+    MYSQL_FIELD* fields = mysql_fetch_fields(mysql_result);
+    for (unsigned int i = 0; i < num_fields; ++i) {
+        result.columns.push_back(fields[i].name);
+        result.column_types.push_back(fieldInfo(fields[i]));
+    }
+
+    std::vector<std::vector<std::string>> batch;
+    bool wanted = true;
+    auto deliver = [&]() {
+        result.affected_rows += batch.size();
+        wanted = on_rows(result.columns, batch);
+        batch.clear();
+    };
+    MYSQL_ROW row;
+    while (wanted && (row = mysql_fetch_row(mysql_result))) {
+        batch.push_back(fetchRow(row, num_fields));
+        if (batch.size() >= batch_rows) deliver();
+    }
+    if (wanted && !batch.empty()) deliver();
+
+    if (!wanted) {
+        // Freeing the result reads what the server still sends; stop it sending first
+        result.cancelled = true;
+        cancelQuery();
+    } else if (mysql_errno(mysql_) != 0) {
+        result.error_message = mysql_error(mysql_);
+        freeResult(mysql_result);
+        return result;
+    }
+    freeResult(mysql_result);
+    result.success = true;
+    return result;
+}
+
+bool MySQLConnector::cancelQuery() {
+    if (!connected_) return false;
+    MySQLConnector side;
+    if (!side.connect(host_, user_, password_, "", port_)) return false;
+    return side.executeStatement("KILL QUERY " + std::to_string(mysql_thread_id(mysql_)));
+}
+
 bool MySQLConnector::executeStatement(const std::string& sql) {
     if (!connected_) return false;
 
@@ -226,4 +302,21 @@ std::vector<std::string> MySQLConnector::fetchRow(MYSQL_ROW row, unsigned int nu
     return result_row;
 }
 
+std::vector<bool> MySQLConnector::nullFlags(MYSQL_ROW row, unsigned int num_fields) {
+    std::vector<bool> nulls(num_fields);
+    for (unsigned int i = 0; i < num_fields; ++i) nulls[i] = row[i] == nullptr;
+    return nulls;
+}
+
+MySQLConnector::FieldInfo MySQLConnector::fieldInfo(const MYSQL_FIELD& field) {
+    FieldInfo info;
+    info.table = field.table ? field.table : "";
+    info.type = field.type;
+    info.flags = field.flags;
+    info.charsetnr = field.charsetnr;
+    info.length = field.length;
+    info.decimals = field.decimals;
+    return info;
+}
+
 } // namespace sqlopt  
@@ -0,0 +1,919 @@
+#include "native_executor.h"
+#include "ast.h"
+#include "column_index.h"
+#include "utils.h"
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#include <iterator>
+#include <numeric>
+#include <stdexcept>
+#include <unordered_map>
+
+namespace sqlopt {
+
+namespace {
+
+// Raised for anything the native path does not handle; the caller falls back to MySQL
+struct Unsupported : std::runtime_error {
+    using std::runtime_error::runtime_error;
+};
+
+// A table instance in the intermediate result
+struct Binding {
+    std::string alias; // lower-cased alias, or table name when unaliased
+    const ColumnTable* table;
+};
+
+// Intermediate result: for each row, one row id per bound table (NULL_ROW for the
+// missing side of an outer join). Values stay in the store until projected.
+struct RowIdSet {
+    std::vector<Binding> bindings;
+    std::vector<std::vector<RowId>> ids; // ids[binding][row]
+
+    size_t size() const { return ids.empty() ? 0 : ids[0].size(); }
+
+    void appendRow(const RowIdSet& left, size_t l, const RowIdSet* right, size_t r) {
+        size_t b = 0;
+        for (; b < left.ids.size(); ++b) ids[b].push_back(left.ids[b][l]);
+        for (size_t rb = 0; rb < right_width; ++rb, ++b) ids[b].push_back(right ? right->ids[rb][r] : NULL_ROW);
+    }
+    void popRow() {
+        for (auto& column : ids) column.pop_back();
+    }
+
+    size_t right_width = 0; // bindings contributed by the right input while joining
+    bool table_order = false; // one table, row ids ascending (a scan, possibly filtered)
+};
+
+// SQL LIKE: '%' matches any run of characters, '_' any one, case-insensitively
+bool likeMatch(std::string_view text, std::string_view pattern) {
+    size_t t = 0, p = 0;
+    size_t star = std::string_view::npos, resume = 0;
+    auto same = [](char a, char b) {
+        return std::tolower(static_cast<unsigned char>(a)) == std::tolower(static_cast<unsigned char>(b));
+    };
+    while (t < text.size()) {
+        if (p < pattern.size() && (pattern[p] == '_' || (pattern[p] != '%' && same(pattern[p], text[t])))) {
+            ++t;
+            ++p;
+        } else if (p < pattern.size() && pattern[p] == '%') {
+            star = p++;
+            resume = t;
+        } else if (star != std::string_view::npos) {
+            p = star + 1;
+            t = ++resume;
+        } else {
+            return false;
+        }
+    }
+    while (p < pattern.size() && pattern[p] == '%') ++p;
+    return p == pattern.size();
+}
+
+struct ColumnRef {
+    size_t binding;
+    const Column* column;
+};
+
+struct Value {
+    bool null = true;
+    bool numeric = false;
+    double number = 0.0;
+    std::string_view text;
+};
+
+// Operand of a predicate: a column or a literal
+struct Operand {
+    bool is_column = false;
+    ColumnRef column{0, nullptr};
+    Value literal;
+    std::string literal_text;
+};
+
+struct Predicate {
+    Operand lhs;
+    CompareOp op;
+    Operand rhs;
+};
+
+class Evaluator {
+public:
+    explicit Evaluator(size_t& values_read) : values_read_(values_read) {}
+
+    ColumnRef resolve(const std::string& ref, const RowIdSet& set) const {
+        std::string name = to_lower(ref);
+        std::string qualifier;
+        size_t dot = name.rfind('.');
+        if (dot != std::string::npos) {
+            qualifier = name.substr(0, dot);
+            name = name.substr(dot + 1);
+        }
+
+        bool found = false;
+        ColumnRef out{0, nullptr};
+        for (size_t b = 0; b < set.bindings.size(); ++b) {
+            const Binding& binding = set.bindings[b];
+            if (!qualifier.empty() && qualifier != binding.alias) continue;
+            int index = binding.table->columnIndex(name);
+            if (index < 0) continue;
+            if (found) throw Unsupported("ambiguous column " + ref);
+            out = {b, &binding.table->columns[index]};
+            found = true;
+        }
+        if (!found) throw Unsupported("unknown column " + ref);
+        return out;
+    }
+
+    Value read(const ColumnRef& ref, const RowIdSet& set, size_t row) const {
+        Value v;
+        RowId id = set.ids[ref.binding][row];
+        ++values_read_;
+        if (id == NULL_ROW || ref.column->isNull(id)) return v;
+        v.null = false;
+        if (ref.column->type() == ColumnType::STRING) {
+            v.text = ref.column->stringAt(id);
+        } else {
+            v.numeric = true;
+            v.number = ref.column->numberAt(id);
+        }
+        return v;
+    }
+
+    // "u . age > 25", "o.status = 'shipped'", "u.email IS NOT NULL"
+    Predicate compile(const std::string& condition, const RowIdSet& set) const {
+        std::vector<std::string> tokens = tokenize(condition);
+        Predicate p;
+        if (tokens.size() == 3 && to_lower(tokens[1]) == "is" && to_lower(tokens[2]) == "null") {
+            p.lhs = operand(tokens[0], set);
+            p.op = CompareOp::IS_NULL;
+            return p;
+        }
+        if (tokens.size() == 4 && to_lower(tokens[1]) == "is" && to_lower(tokens[2]) == "not" &&
+            to_lower(tokens[3]) == "null") {
+            p.lhs = operand(tokens[0], set);
+            p.op = CompareOp::IS_NOT_NULL;
+            return p;
+        }
+        if (tokens.size() != 3) throw Unsupported("condition " + condition);
+
+        static const std::pair<const char*, CompareOp> ops[] = {
+            {"=", CompareOp::EQ}, {"!=", CompareOp::NE}, {"<>", CompareOp::NE}, {"<", CompareOp::LT},
+            {"<=", CompareOp::LE}, {">", CompareOp::GT}, {">=", CompareOp::GE}, {"like", CompareOp::LIKE}};
+        bool known = false;
+        for (const auto& op : ops) {
+            if (to_lower(tokens[1]) == op.first) {
+                p.op = op.second;
+                known = true;
+            }
+        }
+        if (!known) throw Unsupported("operator " + tokens[1]);
+        p.lhs = operand(tokens[0], set);
+        p.rhs = operand(tokens[2], set);
+
+        // DATE columns hold day numbers: compare them with the literal's day number
+        for (auto sides : {std::make_pair(&p.lhs, &p.rhs), std::make_pair(&p.rhs, &p.lhs)}) {
+            Operand& column = *sides.first;
+            Operand& literal = *sides.second;
+            if (!column.is_column || column.column.column->type() != ColumnType::DATE) continue;
+            if (literal.is_column || literal.literal.null || literal.literal.numeric) continue;
+            int64_t days;
+            if (!parse_date(literal.literal_text, days)) throw Unsupported("date literal " + literal.literal_text);
+            literal.literal.numeric = true;
+            literal.literal.number = static_cast<double>(days);
+        }
+        return p;
+    }
+
+    // The mirrored operator, for "literal op column" written as "column op' literal"
+    static CompareOp flip(CompareOp op) {
+        switch (op) {
+            case CompareOp::LT: return CompareOp::GT;
+            case CompareOp::LE: return CompareOp::GE;
+            case CompareOp::GT: return CompareOp::LT;
+            case CompareOp::GE: return CompareOp::LE;
+            default: return op;
+        }
+    }
+
+    bool test(const Predicate& p, const RowIdSet& set, size_t row) const {
+        Value l = value(p.lhs, set, row);
+        if (p.op == CompareOp::IS_NULL) return l.null;
+        if (p.op == CompareOp::IS_NOT_NULL) return !l.null;
+        Value r = value(p.rhs, set, row);
+        if (l.null || r.null) return false; // comparisons with NULL are never true
+        if (p.op == CompareOp::LIKE) {
+            if (l.numeric || r.numeric) throw Unsupported("LIKE on a number");
+            return likeMatch(l.text, r.text);
+        }
+
+        int cmp = compare(l, r);
+        switch (p.op) {
+            case CompareOp::EQ: return cmp == 0;
+            case CompareOp::NE: return cmp != 0;
+            case CompareOp::LT: return cmp < 0;
+            case CompareOp::LE: return cmp <= 0;
+            case CompareOp::GT: return cmp > 0;
+            case CompareOp::GE: return cmp >= 0;
+            default: return false;
+        }
+    }
+
+    // Strings compare case-insensitively, like MySQL's default collations
+    static int compare(const Value& l, const Value& r) {
+        if (l.numeric != r.numeric) throw Unsupported("comparison between a number and a string");
+        if (l.numeric) return l.number < r.number ? -1 : l.number > r.number ? 1 : 0;
+        return compare_nocase(l.text, r.text);
+    }
+
+private:
+    size_t& values_read_;
+
+    Value value(const Operand& o, const RowIdSet& set, size_t row) const {
+        return o.is_column ? read(o.column, set, row) : o.literal;
+    }
+
+    Operand operand(const std::string& token, const RowIdSet& set) const {
+        Operand o;
+        if (token.size() >= 2 && token.front() == '\'' && token.back() == '\'') {
+            o.literal_text = token.substr(1, token.size() - 2);
+            o.literal.null = false;
+            return o;
+        }
+        char* end = nullptr;
+        double number = std::strtod(token.c_str(), &end);
+        if (!token.empty() && *end == '\0') {
+            o.literal.null = false;
+            o.literal.numeric = true;
+            o.literal.number = number;
+            return o;
+        }
+        if (to_lower(token) == "null") return o;
+        if (!std::isalpha(static_cast<unsigned char>(token[0])) && token[0] != '_') {
+            throw Unsupported("operand " + token);
+        }
+        o.is_column = true;
+        o.column = resolve(token, set);
+        return o;
+    }
+
+    static std::vector<std::string> tokenize(const std::string& s) {
+        std::vector<std::string> tokens;
+        size_t i = 0;
+        while (i < s.size()) {
+            char c = s[i];
+            if (std::isspace(static_cast<unsigned char>(c))) {
+                ++i;
+            } else if (c == '\'') {
+                size_t end = s.find('\'', i + 1);
+                if (end == std::string::npos) throw Unsupported("unterminated string");
+                tokens.push_back(s.substr(i, end - i + 1));
+                i = end + 1;
+            } else if (std::strchr("=<>!", c)) {
+                size_t len = (i + 1 < s.size() && std::strchr("=>", s[i + 1])) ? 2 : 1;
+                tokens.push_back(s.substr(i, len));
+                i += len;
+            } else if (std::isalnum(static_cast<unsigned char>(c)) || c == '_' || c == '.' || c == '-') {
+                // identifiers with qualifiers ("u . age" arrives with spaces around the dot)
+                std::string tok;
+                while (i < s.size()) {
+                    char d = s[i];
+                    if (std::isalnum(static_cast<unsigned char>(d)) || d == '_' || d == '.' ||
+                        (d == '-' && tok.empty())) {
+                        tok += d;
+                        ++i;
+                    } else if (std::isspace(static_cast<unsigned char>(d))) {
+                        size_t next = s.find_first_not_of(" \t", i);
+                        bool joins_dot = next != std::string::npos && (s[next] == '.' || (!tok.empty() && tok.back() == '.'));
+                        if (!joins_dot) break;
+                        i = next;
+                    } else {
+                        break;
+                    }
+                }
+                tokens.push_back(tok);
+            } else {
+                throw Unsupported(std::string("character '") + c + "'");
+            }
+        }
+        // operands are strings with the literals' quotes; literal text lives in Operand
+        return tokens;
+    }
+
+public:
+    // Point string literals at their owned text once the predicate has its final address
+    static void bindLiterals(Predicate& p) {
+        for (Operand* o : {&p.lhs, &p.rhs}) {
+            if (!o->is_column && !o->literal.null && !o->literal.numeric) o->literal.text = o->literal_text;
+        }
+    }
+};
+
+class PlanRunner {
+public:
+    PlanRunner(const ColumnStore& store, NativeExecutor::Result& result)
+        : store_(store), result_(result), eval_(result.values_read) {}
+
+    RowIdSet run(const PlanNode* node) {
+        if (!node) throw Unsupported("empty plan");
+        RowIdSet set = runOperator(node);
+        node->actual_rows = static_cast<long long>(set.size());
+        return set;
+    }
+
+    // Late materialization: fetch the projected values of the surviving row ids
+    void project(const RowIdSet& set, const std::vector<std::string>& projections) {
+        std::vector<ColumnRef> columns;
+        for (const auto& projection : projections) {
+            std::string expr = projection, alias;
+            std::string lower = to_lower(projection);
+            size_t as = lower.rfind(" as ");
+            if (as != std::string::npos) {
+                expr = trim(projection.substr(0, as));
+                alias = trim(projection.substr(as + 4));
+            }
+            std::string compact;
+            for (char c : expr) {
+                if (!std::isspace(static_cast<unsigned char>(c))) compact += c;
+            }
+
+            std::string star_qualifier;
+            bool star = compact == "*";
+            if (compact.size() > 2 && compact.compare(compact.size() - 2, 2, ".*") == 0) {
+                star = true;
+                star_qualifier = to_lower(compact.substr(0, compact.size() - 2));
+            }
+            if (star) {
+                for (size_t b = 0; b < set.bindings.size(); ++b) {
+                    if (!star_qualifier.empty() && set.bindings[b].alias != star_qualifier) continue;
+                    for (const auto& column : set.bindings[b].table->columns) {
+                        columns.push_back({b, &column});
+                        result_.columns.push_back(column.name());
+                    }
+                }
+                continue;
+            }
+            for (char c : compact) {
+                if (!std::isalnum(static_cast<unsigned char>(c)) && c != '_' && c != '.') {
+                    throw Unsupported("expression " + expr);
+                }
+            }
+            ColumnRef ref = eval_.resolve(compact, set);
+            columns.push_back(ref);
+            result_.columns.push_back(alias.empty() ? ref.column->name() : alias);
+        }
+
+        result_.rows.reserve(set.size());
+        for (size_t row = 0; row < set.size(); ++row) {
+            std::vector<std::string> values;
+            values.reserve(columns.size());
+            for (const auto& ref : columns) {
+                RowId id = set.ids[ref.binding][row];
+                values.push_back(id == NULL_ROW ? "NULL" : ref.column->valueAt(id));
+            }
+            result_.values_materialized += columns.size();
+            result_.rows.push_back(std::move(values));
+        }
+    }
+
+    void projectAll(const RowIdSet& set) { project(set, {"*"}); }
+
+private:
+    const ColumnStore& store_;
+    NativeExecutor::Result& result_;
+    Evaluator eval_;
+
+    // One operator over the results of its inputs
+    RowIdSet runOperator(const PlanNode* node) {
+        switch (node->type) {
+            case PlanNodeType::SCAN: {
+                auto scan = static_cast<const ScanNode*>(node);
+                return scanTable(*scan, scan->table, scan->alias, scan->filters);
+            }
+            case PlanNodeType::INDEX_SCAN: {
+                // Through the column's loaded index when there is one; otherwise the
+                // table is read (and sorted, for an ordered scan)
+                auto scan = static_cast<const IndexScanNode*>(node);
+                const ColumnIndex* index = store_.index(scan->table, scan->index_column);
+                RowIdSet set = bindTable(scan->table, scan->alias);
+                if (index && indexLookup(*scan, *index, set)) return set;
+                if (index && scan->ordered) {
+                    walkIndex(*scan, *index, set);
+                    return set;
+                }
+                set = scanTable(*scan, scan->table, scan->alias, scan->filters);
+                if (scan->ordered) {
+                    OrderItem key{scan->index_column, !scan->descending};
+                    sortRows(set, {key}, 0);
+                }
+                return set;
+            }
+            case PlanNodeType::FILTER: {
+                auto filter = static_cast<const FilterNode*>(node);
+                return applyFilter(run(filter->child.get()), filter->conditions);
+            }
+            case PlanNodeType::JOIN:
+                return join(*static_cast<const JoinNode*>(node));
+            case PlanNodeType::SORT: {
+                auto sort = static_cast<const SortNode*>(node);
+                RowIdSet set = run(sort->child.get());
+                std::vector<OrderItem> keys;
+                for (size_t i = 0; i < sort->sort_keys.size(); ++i) {
+                    keys.push_back({sort->sort_keys[i], i < sort->ascending.size() ? sort->ascending[i] : true});
+                }
+                sortRows(set, keys, sort->top_n);
+                return set;
+            }
+            case PlanNodeType::LIMIT: {
+                auto limit = static_cast<const LimitNode*>(node);
+                RowIdSet set = run(limit->child.get());
+                if (limit->limit_count < set.size()) {
+                    for (auto& column : set.ids) column.resize(limit->limit_count);
+                }
+                return set;
+            }
+            default:
+                throw Unsupported("operator not supported natively");
+        }
+    }
+
+    // An empty row id set over one table
+    RowIdSet bindTable(const std::string& table_name, const std::string& alias) {
+        const ColumnTable* table = store_.table(table_name);
+        if (!table) throw Unsupported("table " + table_name + " is not loaded");
+        RowIdSet set;
+        set.bindings.push_back({to_lower(alias.empty() ? table_name : alias), table});
+        set.ids.emplace_back();
+        return set;
+    }
+
+    RowIdSet scanTable(const std::string& table_name, const std::string& alias) {
+        RowIdSet set = bindTable(table_name, alias);
+        set.ids[0].resize(set.bindings[0].table->row_count);
+        std::iota(set.ids[0].begin(), set.ids[0].end(), RowId{0});
+        set.table_order = true;
+        return set;
+    }
+
+    // Rows matching the scan's key conditions, in key order, fetched from the index:
+    // a range for a B+tree, an exact or prefix lookup for an ART. False when no key
+    // condition has a shape the index answers.
+    bool indexLookup(const IndexScanNode& scan, const ColumnIndex& index, RowIdSet& set) {
+        const Column& indexed = set.bindings[0].table->columns[set.bindings[0].table->columnIndex(scan.index_column)];
+        BTreeIndex::Bound lower, upper;
+        const Predicate* text_key = nullptr;
+        std::vector<Predicate> predicates;
+        for (const auto& cond : scan.key_conditions) {
+            try {
+                predicates.push_back(eval_.compile(cond, set));
+            } catch (const Unsupported&) {
+                // the Filter above evaluates it
+            }
+        }
+        for (auto& p : predicates) Evaluator::bindLiterals(p);
+
+        bool bounded = false;
+        for (const auto& p : predicates) {
+            if (p.lhs.is_column == p.rhs.is_column) continue;
+            const Operand& column = p.lhs.is_column ? p.lhs : p.rhs;
+            const Operand& literal = p.lhs.is_column ? p.rhs : p.lhs;
+            if (column.column.column != &indexed || literal.literal.null) continue;
+            CompareOp op = p.lhs.is_column ? p.op : Evaluator::flip(p.op);
+
+            if (dynamic_cast<const ArtIndex*>(&index)) {
+                bool prefix_like = op == CompareOp::LIKE && p.lhs.is_column && literal.literal_text.size() > 1 &&
+                    literal.literal_text.find_first_of("%_") == literal.literal_text.size() - 1 &&
+                    literal.literal_text.back() == '%';
+                if (!literal.literal.numeric && (op == CompareOp::EQ || prefix_like) &&
+                    (!text_key || text_key->op != CompareOp::EQ)) {
+                    text_key = &p;
+                }
+                continue;
+            }
+            if (!literal.literal.numeric) continue;
+            double v = literal.literal.number;
+            bool raise_lower = op == CompareOp::EQ || op == CompareOp::GT || op == CompareOp::GE;
+            bool lower_upper = op == CompareOp::EQ || op == CompareOp::LT || op == CompareOp::LE;
+            bool inclusive = op == CompareOp::EQ || op == CompareOp::GE || op == CompareOp::LE;
+            if (raise_lower && (!lower.set || v > lower.key || (v == lower.key && !inclusive))) lower = {true, v, inclusive};
+            if (lower_upper && (!upper.set || v < upper.key || (v == upper.key && !inclusive))) upper = {true, v, inclusive};
+            bounded = bounded || raise_lower || lower_upper;
+        }
+
+        std::vector<RowId>& ids = set.ids[0];
+        if (auto* btree = dynamic_cast<const BTreeIndex*>(&index)) {
+            if (!bounded) return false;
+            btree->range(lower, upper, ids);
+        } else if (auto* art = dynamic_cast<const ArtIndex*>(&index)) {
+            if (!text_key) return false;
+            const Operand& literal = text_key->lhs.is_column ? text_key->rhs : text_key->lhs;
+            if (text_key->op == CompareOp::LIKE) {
+                art->prefix(std::string_view(literal.literal_text).substr(0, literal.literal_text.size() - 1), ids);
+            } else {
+                art->lookup(literal.literal_text, ids);
+            }
+        } else {
+            return false;
+        }
+        result_.values_read += ids.size();
+        return true;
+    }
+
+    // Every row in index key order: NULLs first ascending, last descending, as in MySQL
+    void walkIndex(const IndexScanNode& scan, const ColumnIndex& index, RowIdSet& set) {
+        const ColumnTable* table = set.bindings[0].table;
+        const Column& indexed = table->columns[table->columnIndex(scan.index_column)];
+        std::vector<RowId>& ids = set.ids[0];
+        ids.reserve(table->row_count);
+        auto appendNulls = [&] {
+            if (index.size() == table->row_count) return;
+            for (RowId row = 0; row < table->row_count; ++row) {
+                if (indexed.isNull(row)) ids.push_back(row);
+            }
+        };
+        const std::vector<RowId>& ordered = index.rowsInKeyOrder();
+        if (scan.descending) {
+            ids.assign(ordered.rbegin(), ordered.rend());
+            appendNulls();
+        } else {
+            appendNulls();
+            ids.insert(ids.end(), ordered.begin(), ordered.end());
+        }
+    }
+
+    // Scan that emits only the rows of chunks whose zone maps admit every pushed
+    // column-vs-literal filter (other filters are left to the Filter above); the
+    // chunks considered and skipped are recorded on the plan node
+    RowIdSet scanTable(const PlanNode& node, const std::string& table_name, const std::string& alias,
+                       const std::vector<std::string>& filters) {
+        RowIdSet set = scanTable(table_name, alias);
+        const ColumnTable* table = set.bindings[0].table;
+        size_t chunks = table->columns.empty() ? 0 : table->columns[0].chunkCount();
+        node.chunks_total = chunks;
+        node.chunks_skipped = 0;
+
+        std::vector<Predicate> predicates;
+        for (const auto& cond : filters) {
+            try {
+                Predicate p = eval_.compile(cond, set);
+                if (p.lhs.is_column != p.rhs.is_column) predicates.push_back(std::move(p));
+            } catch (const Unsupported&) {
+                // not a shape the zone maps can answer
+            }
+        }
+        if (predicates.empty()) return set;
+
+        std::vector<RowId>& ids = set.ids[0];
+        size_t kept = 0;
+        for (size_t k = 0; k < chunks; ++k) {
+            bool may_match = std::all_of(predicates.begin(), predicates.end(),
+                                         [&](const Predicate& p) { return chunkMayMatch(p, k); });
+            size_t begin = k * Column::CHUNK_ROWS;
+            size_t end = std::min(table->row_count, begin + Column::CHUNK_ROWS);
+            if (!may_match) {
+                ++node.chunks_skipped;
+                continue;
+            }
+            for (size_t row = begin; row < end; ++row) ids[kept++] = static_cast<RowId>(row);
+        }
+        ids.resize(kept);
+        return set;
+    }
+
+    // Whether a column-vs-literal predicate can hold for some row of the chunk
+    static bool chunkMayMatch(const Predicate& p, size_t chunk) {
+        const Operand& column = p.lhs.is_column ? p.lhs : p.rhs;
+        const Operand& literal = p.lhs.is_column ? p.rhs : p.lhs;
+        const Column& data = *column.column.column;
+        if (p.op == CompareOp::IS_NULL || p.op == CompareOp::IS_NOT_NULL) return data.chunkMayMatch(chunk, p.op, 0.0);
+        if (literal.literal.null) return false; // comparisons with NULL are never true
+        CompareOp op = p.lhs.is_column ? p.op : Evaluator::flip(p.op);
+        bool text_column = data.type() == ColumnType::STRING;
+        if (text_column == literal.literal.numeric) return true; // mixed types: left to the Filter
+        return text_column ? data.chunkMayMatch(chunk, op, literal.literal_text)
+                           : data.chunkMayMatch(chunk, op, literal.literal.number);
+    }
+
+    std::vector<Predicate> compileAll(const ConditionList& conditions, const RowIdSet& set) {
+        std::vector<Predicate> predicates;
+        predicates.reserve(conditions.size());
+        for (const auto& cond : conditions) predicates.push_back(eval_.compile(cond, set));
+        for (auto& p : predicates) Evaluator::bindLiterals(p);
+        return predicates;
+    }
+
+    bool testAll(const std::vector<Predicate>& predicates, const RowIdSet& set, size_t row) {
+        for (const auto& p : predicates) {
+            if (!eval_.test(p, set, row)) return false;
+        }
+        return true;
+    }
+
+    // When `set` holds rows of one table in ascending order (all of them, or those of
+    // the chunks a scan kept), one column-vs-literal comparison is evaluated on the
+    // encoded chunks to produce the candidate rows
+    RowIdSet applyFilter(RowIdSet set, const ConditionList& conditions) {
+        std::vector<Predicate> predicates = compileAll(conditions, set);
+
+        if (set.table_order) {
+            for (size_t k = 0; k < predicates.size(); ++k) {
+                const Predicate& p = predicates[k];
+                if (p.op == CompareOp::IS_NULL || p.op == CompareOp::IS_NOT_NULL || p.op == CompareOp::LIKE) continue;
+                if (p.lhs.is_column == p.rhs.is_column) continue;
+                const Operand& column = p.lhs.is_column ? p.lhs : p.rhs;
+                const Operand& literal = p.lhs.is_column ? p.rhs : p.lhs;
+                CompareOp op = p.lhs.is_column ? p.op : Evaluator::flip(p.op);
+                bool text_column = column.column.column->type() == ColumnType::STRING;
+                if (literal.literal.null || text_column == literal.literal.numeric) continue;
+
+                std::vector<RowId> rows;
+                const Column& data = *column.column.column;
+                result_.values_read += text_column ? data.select(op, literal.literal_text, rows)
+                                                   : data.select(op, literal.literal.number, rows);
+                if (set.size() < data.size()) {
+                    std::vector<RowId> kept;
+                    std::set_intersection(rows.begin(), rows.end(), set.ids[0].begin(), set.ids[0].end(),
+                                          std::back_inserter(kept));
+                    rows = std::move(kept);
+                }
+                set.ids[0] = std::move(rows);
+                predicates.erase(predicates.begin() + k);
+                for (auto& q : predicates) Evaluator::bindLiterals(q); // literals moved with their predicates
+                break;
+            }
+        }
+
+        size_t kept = 0;
+        for (size_t row = 0; row < set.size(); ++row) {
+            if (!testAll(predicates, set, row)) continue;
+            for (auto& column : set.ids) column[kept] = column[row];
+            ++kept;
+        }
+        for (auto& column : set.ids) column.resize(kept);
+        return set;
+    }
+
+    // Hash join on the first equality between the two inputs, or for an index nested
+    // loop a probe of the inner column's loaded index per outer row; other conditions
+    // are checked on each candidate pair. The hash table holds only keys and row
+    // positions.
+    RowIdSet join(const JoinNode& node) {
+        std::string type = to_lower(node.join_type);
+        bool outer = type == "left";
+        if (type != "inner" && !outer) throw Unsupported(node.join_type + " join");
+
+        RowIdSet left = run(node.left.get());
+
+        // The inner input of an index nested loop is only bound; it is probed below
+        const IndexScanNode* inner = nullptr;
+        const ColumnIndex* inner_index = nullptr;
+        if (node.algorithm == JoinAlgorithm::INDEX_NESTED_LOOP && node.right &&
+            node.right->type == PlanNodeType::INDEX_SCAN) {
+            inner = static_cast<const IndexScanNode*>(node.right.get());
+            inner_index = inner->key_conditions.empty() ? store_.index(inner->table, inner->index_column) : nullptr;
+        }
+        RowIdSet right = inner_index ? bindTable(inner->table, inner->alias) : run(node.right.get());
+
+        RowIdSet out;
+        out.bindings = left.bindings;
+        out.bindings.insert(out.bindings.end(), right.bindings.begin(), right.bindings.end());
+        out.ids.resize(out.bindings.size());
+        out.right_width = right.bindings.size();
+
+        std::vector<Predicate> predicates = compileAll(node.conditions, out);
+
+        // Equality whose sides come from different inputs: hash on it
+        const Predicate* key = nullptr;
+        bool key_lhs_left = true;
+        for (const auto& p : predicates) {
+            if (p.op != CompareOp::EQ || !p.lhs.is_column || !p.rhs.is_column) continue;
+            bool l_left = p.lhs.column.binding < left.bindings.size();
+            bool r_left = p.rhs.column.binding < left.bindings.size();
+            if (l_left == r_left) continue;
+            bool l_num = p.lhs.column.column->type() != ColumnType::STRING;
+            bool r_num = p.rhs.column.column->type() != ColumnType::STRING;
+            if (l_num != r_num) continue;
+            key = &p;
+            key_lhs_left = l_left;
+            break;
+        }
+
+        auto emitMatches = [&](size_t l, const std::vector<size_t>& candidates) {
+            bool matched = false;
+            for (size_t r : candidates) {
+                out.appendRow(left, l, &right, r);
+                if (testAll(predicates, out, out.size() - 1)) {
+                    matched = true;
+                } else {
+                    out.popRow();
+                }
+            }
+            if (!matched && outer) out.appendRow(left, l, nullptr, 0);
+        };
+
+        if (inner_index) {
+            const ColumnTable* table = right.bindings[0].table;
+            const Column* indexed = &table->columns[table->columnIndex(inner->index_column)];
+            if (key && (key_lhs_left ? key->rhs : key->lhs).column.column == indexed) {
+                probeIndex(left, right, *key, key_lhs_left, *inner, *inner_index, emitMatches);
+                return out;
+            }
+            right = run(node.right.get()); // the index does not serve the join key
+        }
+
+        if (!key) {
+            // Nested loop: every pair is a candidate
+            std::vector<size_t> all(right.size());
+            std::iota(all.begin(), all.end(), size_t{0});
+            for (size_t l = 0; l < left.size(); ++l) emitMatches(l, all);
+            return out;
+        }
+
+        ColumnRef left_key = key_lhs_left ? key->lhs.column : key->rhs.column;
+        ColumnRef right_key = key_lhs_left ? key->rhs.column : key->lhs.column;
+        right_key.binding -= left.bindings.size();
+        bool numeric = left_key.column->type() != ColumnType::STRING;
+
+        // Chained hash table: key -> first right position, next[] links equal keys
+        constexpr size_t END = static_cast<size_t>(-1);
+        std::vector<size_t> next(right.size(), END);
+        std::vector<size_t> candidates;
+        auto probe = [&](auto& heads, const auto& key_of) {
+            heads.reserve(right.size());
+            for (size_t r = right.size(); r-- > 0;) {
+                Value v = eval_.read(right_key, right, r);
+                if (v.null) continue;
+                auto inserted = heads.emplace(key_of(v), r);
+                if (!inserted.second) {
+                    next[r] = inserted.first->second;
+                    inserted.first->second = r;
+                }
+            }
+            for (size_t l = 0; l < left.size(); ++l) {
+                candidates.clear();
+                Value v = eval_.read(left_key, left, l);
+                if (!v.null) {
+                    auto it = heads.find(key_of(v));
+                    for (size_t r = it == heads.end() ? END : it->second; r != END; r = next[r]) candidates.push_back(r);
+                }
+                emitMatches(l, candidates);
+            }
+        };
+
+        if (numeric) {
+            std::unordered_map<double, size_t> heads;
+            probe(heads, [](const Value& v) { return v.number; });
+        } else {
+            std::unordered_map<std::string, size_t> heads;
+            probe(heads, [](const Value& v) { return to_lower(std::string(v.text)); });
+        }
+        return out;
+    }
+
+    // Index nested loop: the inner rows equal to each outer key are looked up in the
+    // index and appended to `right`, which therefore holds every probed row
+    template <typename Emit>
+    void probeIndex(const RowIdSet& left, RowIdSet& right, const Predicate& key, bool key_lhs_left,
+                    const IndexScanNode& inner, const ColumnIndex& index, Emit& emitMatches) {
+        ColumnRef left_key = key_lhs_left ? key.lhs.column : key.rhs.column;
+        auto btree = dynamic_cast<const BTreeIndex*>(&index);
+        auto art = dynamic_cast<const ArtIndex*>(&index);
+        std::vector<RowId> rows;
+        std::vector<size_t> candidates;
+        for (size_t l = 0; l < left.size(); ++l) {
+            candidates.clear();
+            Value v = eval_.read(left_key, left, l);
+            if (!v.null) {
+                rows.clear();
+                if (btree) {
+                    BTreeIndex::Bound equal{true, v.number, true};
+                    btree->range(equal, equal, rows);
+                } else if (art) {
+                    art->lookup(v.text, rows);
+                }
+                for (RowId row : rows) {
+                    candidates.push_back(right.size());
+                    right.ids[0].push_back(row);
+                }
+            }
+            emitMatches(l, candidates);
+        }
+        result_.values_read += right.size();
+        inner.actual_rows = static_cast<long long>(right.size());
+    }
+
+    // Order rows by the keys (NULLs first ascending, last descending, as in MySQL);
+    // with top_n only the first top_n rows are ordered and kept
+    void sortRows(RowIdSet& set, const std::vector<OrderItem>& keys, size_t top_n) {
+        std::vector<ColumnRef> refs;
+        std::vector<bool> ascending;
+        for (const auto& key : keys) {
+            std::string compact;
+            for (char c : key.expr) {
+                if (!std::isspace(static_cast<unsigned char>(c))) compact += c;
+            }
+            refs.push_back(eval_.resolve(compact, set));
+            ascending.push_back(key.asc);
+        }
+
+        std::vector<size_t> order(set.size());
+        std::iota(order.begin(), order.end(), size_t{0});
+        auto less = [&](size_t a, size_t b) {
+            for (size_t k = 0; k < refs.size(); ++k) {
+                Value va = eval_.read(refs[k], set, a), vb = eval_.read(refs[k], set, b);
+                int cmp;
+                if (va.null || vb.null) {
+                    cmp = va.null == vb.null ? 0 : va.null ? -1 : 1;
+                } else {
+                    cmp = Evaluator::compare(va, vb);
+                }
+                if (cmp != 0) return ascending[k] ? cmp < 0 : cmp > 0;
+            }
+            return false;
+        };
+        if (top_n > 0 && top_n < order.size()) {
+            std::partial_sort(order.begin(), order.begin() + top_n, order.end(), less);
+            order.resize(top_n);
+        } else {
+            std::stable_sort(order.begin(), order.end(), less);
+        }
+
+        for (auto& column : set.ids) {
+            std::vector<RowId> sorted;
+            sorted.reserve(order.size());
+            for (size_t i : order) sorted.push_back(column[i]);
+            column = std::move(sorted);
+        }
+        set.table_order = false;
+    }
+};
+
+void collectTables(const PlanNode* node, std::vector<std::string>& tables) {
+    if (!node) return;
+    switch (node->type) {
+        case PlanNodeType::SCAN:
+            tables.push_back(static_cast<const ScanNode*>(node)->table);
+            break;
+        case PlanNodeType::INDEX_SCAN:
+            tables.push_back(static_cast<const IndexScanNode*>(node)->table);
+            break;
+        case PlanNodeType::JOIN:
+            collectTables(static_cast<const JoinNode*>(node)->left.get(), tables);
+            collectTables(static_cast<const JoinNode*>(node)->right.get(), tables);
+            break;
+        case PlanNodeType::FILTER:
+            collectTables(static_cast<const FilterNode*>(node)->child.get(), tables);
+            break;
+        case PlanNodeType::PROJECT:
+            collectTables(static_cast<const ProjectNode*>(node)->child.get(), tables);
+            break;
+        case PlanNodeType::SORT:
+            collectTables(static_cast<const SortNode*>(node)->child.get(), tables);
+            break;
+        case PlanNodeType::AGGREGATE:
+            collectTables(static_cast<const AggregateNode*>(node)->child.get(), tables);
+            break;
+        case PlanNodeType::DISTINCT:
+            collectTables(static_cast<const DistinctNode*>(node)->child.get(), tables);
+            break;
+        case PlanNodeType::LIMIT:
+            collectTables(static_cast<const LimitNode*>(node)->child.get(), tables);
+            break;
+    }
+}
+
+} // namespace
+
+bool NativeExecutor::canExecute(const PlanNode* root) const {
+    if (!store_ || !root) return false;
+    std::vector<std::string> tables;
+    collectTables(root, tables);
+    return !tables.empty() && std::all_of(tables.begin(), tables.end(),
+                                          [&](const std::string& t) { return store_->table(t) != nullptr; });
+}
+
+bool NativeExecutor::execute(const PlanNode* root, Result& result, std::string& error) const {
+    result = Result();
+    if (!canExecute(root)) {
+        error = "plan reads tables that are not loaded";
+        return false;
+    }
+
+    try {
+        PlanRunner runner(*store_, result);
+        if (root->type == PlanNodeType::PROJECT) {
+            auto project = static_cast<const ProjectNode*>(root);
+            runner.project(runner.run(project->child.get()), project->projections);
+            root->actual_rows = static_cast<long long>(result.rows.size());
+        } else {
+            runner.projectAll(runner.run(root));
+        }
+    } catch (const Unsupported& e) {
+        error = e.what();
+        result = Result();
+        return false;
+    }
+    return true;
+}
+
+} // namespace sqlopt
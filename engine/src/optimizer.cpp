@@ -3,22 +3,12 @@
 #include <sstream>
 #include <regex>
 #include "ast.h"
+#include "expression.h"
+#include "utils.h"
+#include <algorithm>
 
 namespace sqlopt {
 
-static std::string join_type_to_string(JoinType jt) {
-    switch (jt) {
-        case JoinType::INNER: return "INNER";
-        case JoinType::LEFT: return "LEFT";
-        case JoinType::FULL: return "FULL";
-        case JoinType::NATURAL: return "NATURAL";
-        case JoinType::LEFT_ANTI: return "LEFT ANTI";
-        case JoinType::RIGHT_ANTI: return "RIGHT ANTI";
-        case JoinType::FULL_OUTER_ANTI: return "FULL OUTER ANTI";
-        default: return "INNER";
-    }
-}
-
 static std::string forceCommaJoinConversion(const std::string& sql, const SelectQuery& query) {
     // Force conversion of comma joins to explicit JOINs at SQL level
     // This is a fallback for complex queries that weren't properly converted
@@ -130,61 +120,254 @@ static std::string forceSubqueryToJoinConversion(const std::string& sql) {
     return result;
 }
 
+// DISTINCT is redundant when every table's rows are already unique in the projection:
+// each table has its primary key, or a unique index over NOT NULL columns, among the
+// selected columns (SELECT * selects all)
+static bool projectionIsUnique(const SelectQuery& sq, const StatisticsManager& stats) {
+    if (!sq.group_by.empty()) return false;
+
+    std::vector<std::string> projected;
+    bool star = false;
+    for (const auto& item : sq.select_items) {
+        std::string expr;
+        for (char c : item.expr) {
+            if (!std::isspace(static_cast<unsigned char>(c))) expr += static_cast<char>(std::tolower(static_cast<unsigned char>(c)));
+        }
+        if (expr == "*") star = true;
+        projected.push_back(expr);
+    }
+
+    std::vector<const TableRef*> refs = {&sq.from_table};
+    for (const auto& j : sq.joins) refs.push_back(&j.table);
+    for (const TableRef* ref : refs) {
+        const TableStatistics* ts = stats.getTableStatsCI(ref->name);
+        if (!ts) return false;
+        std::string qualifier = to_lower(ref->alias.empty() ? ref->name : ref->alias);
+        auto selected = [&](const std::string& column) {
+            std::string col = to_lower(column);
+            for (const auto& p : projected) {
+                if (p == qualifier + ".*" || p == qualifier + "." + col || (refs.size() == 1 && p == col)) return true;
+            }
+            return star;
+        };
+        // A UNIQUE index admits any number of rows that are NULL in a key column;
+        // only the primary key or a key over NOT NULL columns makes rows distinct
+        auto notNull = [&](const std::string& column) {
+            const ColumnStats* cs = ts->column(column);
+            return cs && !cs->nullable;
+        };
+        bool covered = false;
+        for (const auto& idx : ts->available_indexes) {
+            if (!idx.is_unique || idx.columns.empty()) continue;
+            if (idx.index_name != "PRIMARY" && !std::all_of(idx.columns.begin(), idx.columns.end(), notNull)) continue;
+            if (std::all_of(idx.columns.begin(), idx.columns.end(), selected)) {
+                covered = true;
+                break;
+            }
+        }
+        if (!covered) return false;
+    }
+    return true;
+}
+
+// All columns of expr are known to read only `ref`
+static bool onlyReferences(const BoundPredicate& expr, RefId ref) {
+    return !expr.opaque && expr.tables == refBit(ref);
+}
+
+// An inner join keeps every row of a preserved table when its only condition follows a
+// NOT NULL foreign key from that table to the joined one: each row finds its parent
+static bool followsForeignKey(const BoundQuery& bound, size_t join, TableMask preserved) {
+    RefId joined = static_cast<RefId>(join + 1);
+    if (bound.on[join].size() != 1) return false;
+    const BoundPredicate& cond = bound.on[join][0];
+    if (cond.opaque || cond.columns.size() != 2 || cond.edges.size() != 1) return false;
+
+    BoundColumn child = cond.edges[0].left, parent = cond.edges[0].right;
+    if (child.ref == joined) std::swap(child, parent);
+    if (parent.ref != joined || !(preserved & refBit(child.ref))) return false;
+
+    const TableStatistics* ts = bound.tableStats(child.ref);
+    const ColumnStats* cs = bound.columnStats(child);
+    if (!ts || !cs || parent.column == INVALID_ID) return false;
+    for (const auto& fk : ts->foreign_keys) {
+        if (to_lower(fk.column) != to_lower(child.name)) continue;
+        if (to_lower(fk.referenced_table) != to_lower(bound.ref(joined).name) ||
+            to_lower(fk.referenced_column) != to_lower(parent.name)) continue;
+        return !cs->nullable;
+    }
+    return false;
+}
+
+// Push ORDER BY + LIMIT below the joins onto the FROM table when every one of its rows
+// survives the joins at least once: the first N rows of the table (in ORDER BY order)
+// then produce at least the N rows the query returns. The outer ORDER BY/LIMIT stay.
+static bool pushLimitBelowJoins(SelectQuery& sq, BoundQuery& bound) {
+    if (sq.limit < 0 || sq.joins.empty() || sq.distinct || !sq.group_by.empty() || !sq.having_conditions.empty()) {
+        return false;
+    }
+    static const std::regex agg_pattern(R"(^\s*(count|sum|avg|min|max|group_concat)\s*\()", std::regex::icase);
+    for (const auto& item : sq.select_items) {
+        if (std::regex_search(item.expr, agg_pattern) || item.expr.find("(SELECT") != std::string::npos) return false;
+    }
+
+    for (const auto& ob : sq.order_by) {
+        if (!onlyReferences(bind_condition(bound, ob.expr), 0)) return false;
+    }
+    // Filters on other tables could drop the rows the LIMIT kept
+    for (const auto& cond : bound.where) {
+        if (!onlyReferences(cond, 0)) return false;
+    }
+
+    TableMask preserved = refBit(0);
+    for (size_t i = 0; i < sq.joins.size(); ++i) {
+        if (sq.joins[i].type == JoinType::LEFT) continue;
+        if (sq.joins[i].type != JoinType::INNER || !followsForeignKey(bound, i, preserved)) return false;
+        preserved |= refBit(static_cast<RefId>(i + 1));
+    }
+
+    for (const auto& cond : sq.where_conditions) sq.from_table.pushedFilters.push_back(cond);
+    sq.where_conditions.clear();
+    sq.from_table.pushedOrder = sq.order_by;
+    sq.from_table.pushedLimit = sq.limit;
+    bound.rebind(sq);
+    return true;
+}
+
+// With no row passing WHERE the result is empty, unless aggregates over the whole
+// input still produce their one row (COUNT(*) is 0)
+static bool returnsNoRowsWhenFiltered(const SelectQuery& sq) {
+    if (!sq.group_by.empty()) return true;
+    if (!sq.having_conditions.empty()) return false;
+    for (const auto& item : sq.select_items) {
+        ExprPtr tree = parse_expression(item.expr);
+        if (!tree) return false;
+        bool aggregate = false;
+        visit_expression(*tree, [&](const Expr& e) { aggregate = aggregate || is_aggregate(e); });
+        if (aggregate) return false;
+    }
+    return true;
+}
+
+static std::string tableToSQL(const TableRef& table) {
+    return table.derived_sql.empty() ? table.name : "(" + table.derived_sql + ")";
+}
+
+// Appends items[0] sep items[1] ... to out
+template <typename Items, typename Text>
+static void appendJoined(std::string& out, const Items& items, const char* sep, Text&& text) {
+    bool first = true;
+    for (const auto& item : items) {
+        if (!first) out += sep;
+        first = false;
+        text(out, item);
+    }
+}
+
+static void appendText(std::string& out, const std::string& s) { out += s; }
+
+static void appendOrderItem(std::string& out, const OrderItem& ob) {
+    out += ob.expr;
+    if (!ob.asc) out += " DESC";
+}
+
+// Built by appending to one string reserved up front: this runs for every optimized query
 static std::string selectQueryToSQL(const SelectQuery& sq) {
-    std::stringstream sql;
-    sql << "SELECT ";
+    size_t estimate = 64;
+    for (const auto& item : sq.select_items) estimate += item.expr.size() + item.alias.size() + 6;
+    for (const auto& j : sq.joins) {
+        estimate += j.table.name.size() + j.table.alias.size() + j.table.derived_sql.size() + 24;
+        for (const auto& c : j.on_conds) estimate += c.size() + 5;
+    }
+    for (const auto& c : sq.where_conditions) estimate += c.size() + 5;
+    for (const auto& c : sq.from_table.pushedFilters) estimate += c.size() + 5;
+    for (const auto& c : sq.having_conditions) estimate += c.size() + 5;
+    for (const auto& g : sq.group_by) estimate += g.size() + 2;
+    for (const auto& ob : sq.order_by) estimate += ob.expr.size() + 7;
+
+    std::string sql;
+    sql.reserve(estimate + sq.from_table.derived_sql.size());
+    sql += "SELECT ";
+    if (sq.distinct) sql += "DISTINCT ";
     if (!sq.select_items.empty()) {
-        for (size_t i = 0; i < sq.select_items.size(); ++i) {
-            sql << sq.select_items[i].expr;
-            if (!sq.select_items[i].alias.empty()) sql << " AS " << sq.select_items[i].alias;
-            if (i + 1 < sq.select_items.size()) sql << ", ";
+        appendJoined(sql, sq.select_items, ", ", [](std::string& out, const SelectItem& item) {
+            out += item.expr;
+            if (!item.alias.empty()) {
+                out += " AS ";
+                out += item.alias;
+            }
+        });
+    } else {
+        sql += "*";
+    }
+    sql += " FROM ";
+    const TableRef& from = sq.from_table;
+    if (from.pushedLimit >= 0) {
+        // Top-N of the FROM table as a derived table, so the server stops after N rows
+        sql += "(SELECT * FROM ";
+        sql += from.name;
+        if (!from.alias.empty()) {
+            sql += " AS ";
+            sql += from.alias;
         }
+        if (!from.pushedFilters.empty()) {
+            sql += " WHERE ";
+            appendJoined(sql, from.pushedFilters, " AND ", appendText);
+        }
+        if (!from.pushedOrder.empty()) {
+            sql += " ORDER BY ";
+            appendJoined(sql, from.pushedOrder, ", ", appendOrderItem);
+        }
+        sql += " LIMIT ";
+        sql += std::to_string(from.pushedLimit);
+        sql += ") AS ";
+        sql += from.alias.empty() ? from.name : from.alias;
     } else {
-        sql << "*";
-    }
-    sql << " FROM " << sq.from_table.name;
-    if (!sq.from_table.alias.empty()) sql << " AS " << sq.from_table.alias;
-    if (!sq.joins.empty()) {
-        for (const auto& j : sq.joins) {
-            sql << " " << join_type_to_string(j.type) << " JOIN " << j.table.name;
-            if (!j.table.alias.empty()) sql << " AS " << j.table.alias;
-            if (!j.on_conds.empty()) {
-                sql << " ON ";
-                for (size_t i = 0; i < j.on_conds.size(); ++i) {
-                    sql << j.on_conds[i];
-                    if (i + 1 < j.on_conds.size()) sql << " AND ";
-                }
-            }
+        sql += tableToSQL(from);
+        if (!from.alias.empty()) {
+            sql += " AS ";
+            sql += from.alias;
         }
     }
-    // Collect filters from pushed filters (from_table) and remaining where_conditions
-    std::vector<std::string> filters;
-    for (const auto& f : sq.from_table.pushedFilters) filters.push_back(f);
-    for (const auto& f : sq.where_conditions) filters.push_back(f);
-    if (!filters.empty()) {
-        sql << " WHERE ";
-        for (size_t i = 0; i < filters.size(); ++i) {
-            sql << filters[i];
-            if (i + 1 < filters.size()) sql << " AND ";
+    for (const auto& j : sq.joins) {
+        sql += " ";
+        sql += join_type_to_string(j.type);
+        sql += " JOIN ";
+        sql += tableToSQL(j.table);
+        if (!j.table.alias.empty()) {
+            sql += " AS ";
+            sql += j.table.alias;
         }
+        if (!j.on_conds.empty()) {
+            sql += " ON ";
+            appendJoined(sql, j.on_conds, " AND ", appendText);
+        }
+    }
+    // Filters pushed onto the FROM table (unless they went into its top-N) and the remaining WHERE conditions
+    bool pushed = from.pushedLimit < 0 && !from.pushedFilters.empty();
+    if (pushed || !sq.where_conditions.empty()) {
+        sql += " WHERE ";
+        if (pushed) appendJoined(sql, from.pushedFilters, " AND ", appendText);
+        if (pushed && !sq.where_conditions.empty()) sql += " AND ";
+        appendJoined(sql, sq.where_conditions, " AND ", appendText);
     }
     if (!sq.group_by.empty()) {
-        sql << " GROUP BY ";
-        for (size_t i = 0; i < sq.group_by.size(); ++i) sql << sq.group_by[i] << (i + 1 < sq.group_by.size() ? ", " : "");
+        sql += " GROUP BY ";
+        appendJoined(sql, sq.group_by, ", ", appendText);
     }
     if (!sq.having_conditions.empty()) {
-        sql << " HAVING ";
-        for (size_t i = 0; i < sq.having_conditions.size(); ++i) {
-            sql << sq.having_conditions[i];
-            if (i + 1 < sq.having_conditions.size()) sql << " AND ";
-        }
+        sql += " HAVING ";
+        appendJoined(sql, sq.having_conditions, " AND ", appendText);
     }
     if (!sq.order_by.empty()) {
-        sql << " ORDER BY ";
-        for (size_t i = 0; i < sq.order_by.size(); ++i) sql << sq.order_by[i].expr << (sq.order_by[i].asc ? "" : " DESC") << (i + 1 < sq.order_by.size() ? ", " : "");
+        sql += " ORDER BY ";
+        appendJoined(sql, sq.order_by, ", ", appendOrderItem);
     }
-    if (sq.limit >= 0) sql << " LIMIT " << sq.limit;
-    return sql.str();
+    if (sq.limit >= 0) {
+        sql += " LIMIT ";
+        sql += std::to_string(sq.limit);
+    }
+    return sql;
 }
 
 } // namespace sqlopt
@@ -196,11 +379,11 @@ Optimizer::Optimizer(std::shared_ptr<StatisticsManager> stats_mgr)
       cost_estimator_(std::make_shared<CostEstimator>(stats_mgr_)),
       plan_generator_(std::make_shared<PlanGenerator>(stats_mgr_, cost_estimator_)) {}
 
-OptimizeResult Optimizer::optimize(const SelectQuery& q) {
+OptimizeResult Optimizer::optimize(SelectQuery q) {
     OptimizeResult result;
 
-    // Make a copy for rewriting
-    SelectQuery rewritten_query = q;
+    // The query is ours: the rewrites work on it in place
+    SelectQuery rewritten_query = std::move(q);
 
     // Check for comma joins before rewriting (more comprehensive detection)
     bool has_comma_joins = false;
@@ -243,9 +426,28 @@ OptimizeResult Optimizer::optimize(const SelectQuery& q) {
     }
     
     size_t original_join_count = rewritten_query.joins.size();
+
+    // Bound once here; every stage below keeps it current as it changes the query
+    BoundQuery bound(rewritten_query, stats_mgr_.get());
+
+    // Cost of the query as written (nothing is rewritten yet), to measure what the rewrites buy
+    auto original_plans = plan_generator_->generatePlans(rewritten_query, bound);
+    if (!original_plans.empty()) result.original_cost = plan_generator_->getBestPlan(original_plans).getCost();
     
     // Apply logical optimizations
-    rewriter_.rewrite(rewritten_query);
+    TransformLog log;
+    rewriter_.eliminateCommonSubexpressions(rewritten_query, bound, log);
+    bool satisfiable = rewriter_.foldConstants(rewritten_query, bound, log);
+    rewriter_.normalizePredicates(rewritten_query, bound, log);
+    rewriter_.rewrite(rewritten_query, bound);
+
+    bool distinct_eliminated = false;
+    if (rewritten_query.distinct && projectionIsUnique(rewritten_query, *stats_mgr_)) {
+        rewritten_query.distinct = false;
+        distinct_eliminated = true;
+    }
+
+    bool limit_pushed = pushLimitBelowJoins(rewritten_query, bound);
     
     // Check if subqueries were converted to joins (will be used later in logging)
     // bool subqueries_converted = (rewritten_query.joins.size() > original_join_count) && has_subqueries;
@@ -267,28 +469,32 @@ OptimizeResult Optimizer::optimize(const SelectQuery& q) {
     }
 
     // Generate multiple execution plans
-    auto plans = plan_generator_->generatePlans(rewritten_query);
+    auto plans = plan_generator_->generatePlans(rewritten_query, bound);
 
     if (plans.empty()) {
-        result.log = "Generated fallback execution plan for demonstration";
+        result.log = log.str() + "Generated fallback execution plan for demonstration";
         // Create a minimal plan for execution
         result.plan = ExecutionPlan();
         result.plan.setCost(100);
         result.plan.setCardinality(10);
         result.plan.setOriginalQuery(result.rewritten_sql);
+        if (result.original_cost == 0.0) result.original_cost = result.plan.getCost();
         return result;
     }
 
     // Select the best plan
     result.plan = plan_generator_->getBestPlan(plans);
     result.plan.setOriginalQuery(result.rewritten_sql);
+    if (!satisfiable && returnsNoRowsWhenFiltered(rewritten_query)) {
+        result.plan.setKnownEmpty(true);
+        result.plan.setCost(0.0);
+        result.plan.setCardinality(0);
+        log.add("contradiction", "No row can pass WHERE; the plan returns an empty result without running");
+    }
 
     // Generate log
-    std::ostringstream log_stream;
-    int step = 1;
-    
     if (has_comma_joins) {
-        log_stream << step++ << ". [comma_join_conversion] Converted comma-separated tables to explicit JOINs\n";
+        log.add("comma_join_conversion", "Converted comma-separated tables to explicit JOINs");
     }
     
     // Check if subqueries were actually converted (more accurate check)
@@ -299,18 +505,29 @@ OptimizeResult Optimizer::optimize(const SelectQuery& q) {
     }
     
     if (actual_subqueries_converted || ultimate_subquery_conversion) {
-        log_stream << step++ << ". [subquery_to_join_conversion] Converted scalar subqueries to JOINs for better performance\n";
+        log.add("subquery_to_join_conversion", "Converted scalar subqueries to JOINs for better performance");
     }
     
+    if (distinct_eliminated) {
+        log.add("distinct_elimination", "Removed DISTINCT: the projection contains a unique key");
+    }
+
+    if (limit_pushed) {
+        log.add("limit_pushdown", "Took the first " + std::to_string(rewritten_query.limit) + " rows of " +
+                rewritten_query.from_table.name + " before joining; every row survives the joins");
+    }
+
     if (rewritten_query.joins.empty()) {
-        log_stream << step++ << ". [projection_pushdown] Keeping only selected columns\n";
+        log.add("projection_pushdown", "Keeping only selected columns");
         if (!rewritten_query.where_conditions.empty()) {
-            log_stream << step++ << ". [predicate_pushdown] Applied filters to table scan\n";
+            log.add("predicate_pushdown", "Applied filters to table scan");
         }
     } else {
-        log_stream << step++ << ". [join_reordering] Optimized join order\n";
-        log_stream << step++ << ". [predicate_pushdown] Pushed filters to appropriate tables\n";
+        log.add("join_reordering", "Optimized join order");
+        log.add("predicate_pushdown", "Pushed filters to appropriate tables");
     }
+    std::ostringstream log_stream;
+    log_stream << log.str();
     log_stream << "Generated " << plans.size() << " execution plans\n";
     if (!plans.empty()) {
         log_stream << "Selected best plan with cost: " << result.plan.getCost() << "\n";
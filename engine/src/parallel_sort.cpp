@@ -0,0 +1,254 @@
+#include "parallel_sort.h"
+#include <algorithm>
+#include <cctype>
+#include <cerrno>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <queue>
+#include <thread>
+
+namespace sqlopt {
+
+namespace {
+
+// Below this many keys per thread, thread startup costs more than it saves
+constexpr size_t MIN_KEYS_PER_THREAD = 16384;
+
+struct SortItem {
+    const std::string* key;
+    size_t row;
+
+    bool operator<(const SortItem& other) const {
+        int c = key->compare(*other.key);
+        return c != 0 ? c < 0 : row < other.row;  // row breaks ties: stable, total order
+    }
+};
+
+bool parseNumber(const std::string& v, double& out) {
+    if (v.empty()) return false;
+    const char* begin = v.c_str();
+    char* end = nullptr;
+    errno = 0;
+    out = std::strtod(begin, &end);
+    return end == begin + v.size() && errno != ERANGE;
+}
+
+bool parseSigned(const std::string& v, int64_t& out) {
+    if (v.empty()) return false;
+    const char* begin = v.c_str();
+    char* end = nullptr;
+    errno = 0;
+    out = std::strtoll(begin, &end, 10);
+    return end == begin + v.size() && errno != ERANGE;
+}
+
+bool parseUnsigned(const std::string& v, uint64_t& out) {
+    if (v.empty() || v[0] == '-') return false;
+    const char* begin = v.c_str();
+    char* end = nullptr;
+    errno = 0;
+    out = std::strtoull(begin, &end, 10);
+    return end == begin + v.size() && errno != ERANGE;
+}
+
+void appendBigEndian(std::string& key, uint64_t bits) {
+    for (int shift = 56; shift >= 0; shift -= 8) key.push_back(static_cast<char>((bits >> shift) & 0xFF));
+}
+
+void appendNumber(std::string& key, double d) {
+    uint64_t bits;
+    std::memcpy(&bits, &d, sizeof(bits));
+    // negative numbers: flip everything; positive: flip the sign bit
+    bits = (bits & (uint64_t(1) << 63)) ? ~bits : bits ^ (uint64_t(1) << 63);
+    appendBigEndian(key, bits);
+}
+
+bool padsSpace(SortKind kind) {
+    return kind == SortKind::BINARY_PAD_SPACE || kind == SortKind::ASCII_CI;
+}
+
+// Whether the value compares under kind exactly as its encoding does. Trimming
+// trailing spaces matches PAD SPACE only while no byte sorts below a space.
+bool encodable(const std::string& v, SortKind kind) {
+    double d;
+    int64_t i;
+    uint64_t u;
+    switch (kind) {
+        case SortKind::SIGNED: return parseSigned(v, i);
+        case SortKind::UNSIGNED: return parseUnsigned(v, u);
+        case SortKind::REAL: return parseNumber(v, d);
+        case SortKind::BINARY: return true;
+        case SortKind::BINARY_PAD_SPACE:
+        case SortKind::ASCII_CI:
+            for (unsigned char c : v) {
+                if (c < ' ' || (kind == SortKind::ASCII_CI && c >= 0x80)) return false;
+            }
+            return true;
+    }
+    return false;
+}
+
+void appendText(std::string& key, const std::string& v, SortKind kind) {
+    size_t len = v.size();
+    if (padsSpace(kind)) {
+        while (len > 0 && v[len - 1] == ' ') --len;
+    }
+    for (size_t i = 0; i < len; ++i) {
+        unsigned char c = static_cast<unsigned char>(v[i]);
+        if (c == 0) {
+            key.push_back('\0');
+            key.push_back('\xFF');
+        } else {
+            // the _ci collations weigh ASCII letters as their upper case
+            key.push_back(static_cast<char>(kind == SortKind::ASCII_CI ? std::toupper(c) : c));
+        }
+    }
+    // terminator sorts below any escaped byte, so prefixes come first
+    key.push_back('\0');
+    key.push_back('\0');
+}
+
+template <typename F>
+void runParallel(size_t threads, F&& work) {
+    std::vector<std::thread> pool;
+    for (size_t t = 1; t < threads; ++t) pool.emplace_back(work, t);
+    work(0);
+    for (auto& th : pool) th.join();
+}
+
+} // namespace
+
+std::string normalize_sort_key(const std::vector<std::string>& row, const std::vector<bool>& nulls,
+                               const std::vector<SortColumn>& columns) {
+    std::string key;
+    for (const auto& col : columns) {
+        size_t start = key.size();
+        const std::string& v = col.column < row.size() ? row[col.column] : std::string();
+        double d;
+        int64_t s;
+        uint64_t u;
+        if (col.column < nulls.size() && nulls[col.column]) {
+            key.push_back('\0');
+        } else if (col.kind == SortKind::SIGNED && parseSigned(v, s)) {
+            key.push_back('\1');
+            appendBigEndian(key, static_cast<uint64_t>(s) ^ (uint64_t(1) << 63));
+        } else if (col.kind == SortKind::UNSIGNED && parseUnsigned(v, u)) {
+            key.push_back('\1');
+            appendBigEndian(key, u);
+        } else if (col.kind == SortKind::REAL && parseNumber(v, d)) {
+            key.push_back('\1');
+            appendNumber(key, d);
+        } else {
+            key.push_back('\1');
+            appendText(key, v, col.kind);
+        }
+        if (!col.ascending) {
+            for (size_t i = start; i < key.size(); ++i) key[i] = static_cast<char>(~key[i]);
+        }
+    }
+    return key;
+}
+
+std::vector<size_t> parallel_sort_order(const std::vector<std::string>& keys, size_t threads) {
+    const size_t n = keys.size();
+    std::vector<SortItem> items(n);
+    for (size_t i = 0; i < n; ++i) items[i] = {&keys[i], i};
+
+    threads = std::max<size_t>(1, std::min(threads, n / MIN_KEYS_PER_THREAD));
+    std::vector<size_t> order(n);
+    if (threads == 1) {
+        std::sort(items.begin(), items.end());
+        for (size_t i = 0; i < n; ++i) order[i] = items[i].row;
+        return order;
+    }
+
+    // 1. sort one chunk per thread
+    std::vector<size_t> chunk_begin(threads + 1);
+    for (size_t t = 0; t <= threads; ++t) chunk_begin[t] = n * t / threads;
+    runParallel(threads, [&](size_t t) {
+        std::sort(items.begin() + chunk_begin[t], items.begin() + chunk_begin[t + 1]);
+    });
+
+    // 2. regular sampling: evenly spaced samples of every sorted chunk give
+    //    threads-1 splitters that balance the merge partitions
+    const size_t oversample = 4 * threads;
+    std::vector<SortItem> samples;
+    for (size_t t = 0; t < threads; ++t) {
+        size_t len = chunk_begin[t + 1] - chunk_begin[t];
+        for (size_t s = 1; s <= oversample; ++s) samples.push_back(items[chunk_begin[t] + len * s / (oversample + 1)]);
+    }
+    std::sort(samples.begin(), samples.end());
+    std::vector<SortItem> splitters;
+    for (size_t p = 1; p < threads; ++p) splitters.push_back(samples[samples.size() * p / threads]);
+
+    // bounds[t][p]: start of partition p inside chunk t
+    std::vector<std::vector<size_t>> bounds(threads, std::vector<size_t>(threads + 1));
+    for (size_t t = 0; t < threads; ++t) {
+        auto first = items.begin() + chunk_begin[t];
+        auto last = items.begin() + chunk_begin[t + 1];
+        bounds[t][0] = chunk_begin[t];
+        for (size_t p = 1; p < threads; ++p) {
+            bounds[t][p] = std::lower_bound(first, last, splitters[p - 1]) - items.begin();
+        }
+        bounds[t][threads] = chunk_begin[t + 1];
+    }
+    std::vector<size_t> out_begin(threads + 1, 0);
+    for (size_t p = 0; p < threads; ++p) {
+        size_t size = 0;
+        for (size_t t = 0; t < threads; ++t) size += bounds[t][p + 1] - bounds[t][p];
+        out_begin[p + 1] = out_begin[p] + size;
+    }
+
+    // 3. each thread merges its partition of every chunk with a heap
+    runParallel(threads, [&](size_t p) {
+        using Run = std::pair<size_t, size_t>; // (position, end) inside items
+        auto greater = [&](const Run& a, const Run& b) { return items[b.first] < items[a.first]; };
+        std::priority_queue<Run, std::vector<Run>, decltype(greater)> heap(greater);
+        for (size_t t = 0; t < threads; ++t) {
+            if (bounds[t][p] < bounds[t][p + 1]) heap.push({bounds[t][p], bounds[t][p + 1]});
+        }
+        size_t out = out_begin[p];
+        while (!heap.empty()) {
+            Run r = heap.top();
+            heap.pop();
+            order[out++] = items[r.first].row;
+            if (++r.first < r.second) heap.push(r);
+        }
+    });
+    return order;
+}
+
+bool parallel_sort_rows(std::vector<std::vector<std::string>>& rows, const std::vector<std::vector<bool>>& nulls,
+                        const std::vector<SortColumn>& columns, size_t threads) {
+    if (rows.size() < 2 || columns.empty()) return true;
+
+    static const std::vector<bool> no_nulls;
+    auto rowNulls = [&](size_t i) -> const std::vector<bool>& { return i < nulls.size() ? nulls[i] : no_nulls; };
+    for (const auto& col : columns) {
+        for (size_t i = 0; i < rows.size(); ++i) {
+            const std::vector<bool>& null = rowNulls(i);
+            if (col.column < null.size() && null[col.column]) continue;
+            const std::string& v = col.column < rows[i].size() ? rows[i][col.column] : std::string();
+            if (!encodable(v, col.kind)) return false;
+        }
+    }
+
+    const size_t n = rows.size();
+    size_t workers = std::max<size_t>(1, std::min(threads, n / MIN_KEYS_PER_THREAD));
+    std::vector<std::string> keys(n);
+    runParallel(workers, [&](size_t t) {
+        for (size_t i = n * t / workers; i < n * (t + 1) / workers; ++i) {
+            keys[i] = normalize_sort_key(rows[i], rowNulls(i), columns);
+        }
+    });
+
+    std::vector<size_t> order = parallel_sort_order(keys, threads);
+    std::vector<std::vector<std::string>> sorted;
+    sorted.reserve(n);
+    for (size_t idx : order) sorted.push_back(std::move(rows[idx]));
+    rows = std::move(sorted);
+    return true;
+}
+
+} // namespace sqlopt
@@ -7,6 +7,29 @@ using namespace sqlopt;
 static std::string lower(const std::string &s){ return to_lower(s); }
 static bool is_kw(const Token &t, const char* kw){ return t.type==TokenType::KW && lower(t.text)==kw; }
 
+// Text of a select item or sort key: tokens spaced except around dots, inside
+// parentheses and around stars ("COUNT(*)", "u.age*2 + 1"), string literals quoted
+static std::string join_select_tokens(const std::vector<Token> &toks, int begin, int end){
+    std::string expr;
+    for(int k=begin; k<end; ++k){
+        if(toks[k].type==TokenType::STRING){
+            expr += "'";
+            for(char c : toks[k].text){ if(c=='\'' || c=='\\') expr += '\\'; expr += c; }
+            expr += "'";
+        } else {
+            expr += toks[k].text;
+        }
+        if(k+1<end &&
+           toks[k+1].type != TokenType::DOT && toks[k].type != TokenType::DOT &&
+           toks[k+1].type != TokenType::LPAREN &&
+           toks[k+1].type != TokenType::RPAREN && toks[k].type != TokenType::LPAREN &&
+           toks[k+1].type != TokenType::STAR && toks[k].type != TokenType::STAR) {
+            expr += " ";
+        }
+    }
+    return trim(expr);
+}
+
 bool Parser::parse_query(Query &out, ParseError &err){
     if (i >= n) { err = {"Empty query", -1}; return false; }
     if (is_kw(toks[i], "select")) {
@@ -46,21 +69,15 @@ bool Parser::parse_select(SelectQuery &out, ParseError &err){
 
     while(i<n && !is_kw(toks[i],"from") && toks[i].type != TokenType::COMMA){
         SelectItem item;
-        std::string expr;
-    while(i<n && !is_kw(toks[i],"from") && toks[i].type != TokenType::COMMA && !is_kw(toks[i],"as") ){
-            expr += toks[i].text;
-            // Add space between tokens except for dots, parentheses, and stars
-            if(i+1<n && !is_kw(toks[i+1],"from") && toks[i+1].type != TokenType::COMMA && !is_kw(toks[i+1],"as") && 
-               toks[i+1].type != TokenType::DOT && toks[i].type != TokenType::DOT &&
-               toks[i+1].type != TokenType::LPAREN && toks[i].type != TokenType::RPAREN &&
-               toks[i+1].type != TokenType::RPAREN && toks[i].type != TokenType::LPAREN &&
-               toks[i+1].type != TokenType::STAR && toks[i].type != TokenType::STAR) {
-                expr += " ";
-            }
+        // Scalar subqueries and calls nest FROM, AS and commas inside parentheses
+        int begin = i, depth = 0;
+        while(i<n && toks[i].type != TokenType::END && (depth > 0 || (!is_kw(toks[i],"from") && toks[i].type != TokenType::COMMA && !is_kw(toks[i],"as")))){
+            if(toks[i].type==TokenType::LPAREN) ++depth;
+            if(toks[i].type==TokenType::RPAREN) --depth;
             ++i;
         }
-        item.expr = trim(expr);
-        if(is_kw(toks[i],"as")){ ++i; if(i<n && toks[i].type==TokenType::IDENT){ item.alias = toks[i].text; ++i; } }
+        item.expr = join_select_tokens(toks, begin, i);
+        if(i<n && is_kw(toks[i],"as")){ ++i; if(i<n && toks[i].type==TokenType::IDENT){ item.alias = toks[i].text; ++i; } }
         else if(i<n && toks[i].type==TokenType::IDENT && !is_kw(toks[i],"from") && toks[i].type != TokenType::COMMA){ item.alias = toks[i].text; ++i; }
         out.select_items.push_back(item);
         if(accept([&](const Token&t){return t.type==TokenType::COMMA;})) continue; else break;
@@ -122,9 +139,20 @@ bool Parser::parse_select(SelectQuery &out, ParseError &err){
 
     if(i<n && is_kw(toks[i],"where")){
         ++i;
+        // Conjuncts split at top-level AND; the AND of a BETWEEN and anything inside
+        // parentheses (subqueries, OR groups) stays with its condition
         std::string accum;
-        while(i<n && !(toks[i].type==TokenType::KW && (lower(toks[i].text)=="group"||lower(toks[i].text)=="order"||lower(toks[i].text)=="limit"))){
-            if(toks[i].type==TokenType::KW && lower(toks[i].text)=="and"){ if(!accum.empty()){ out.where_conditions.push_back(accum); accum.clear(); } ++i; continue; }
+        int depth = 0;
+        bool between = false;
+        while(i<n && toks[i].type != TokenType::END && !(depth == 0 && toks[i].type==TokenType::KW && (lower(toks[i].text)=="group"||lower(toks[i].text)=="order"||lower(toks[i].text)=="limit"))){
+            if(toks[i].type==TokenType::LPAREN) ++depth;
+            if(toks[i].type==TokenType::RPAREN) --depth;
+            if(depth == 0 && is_kw(toks[i],"between")) between = true;
+            else if(depth == 0 && is_kw(toks[i],"and")){
+                if(between){ between = false; }
+                else { if(!accum.empty()){ out.where_conditions.push_back(accum); accum.clear(); } ++i; continue; }
+            }
+            if(toks[i].type==TokenType::SEMICOLON) break;
             if(!accum.empty()) accum.push_back(' ');
             accum += toks[i].type==TokenType::STRING ? ("'"+toks[i].text+"'") : toks[i].text;
             ++i;
@@ -152,9 +180,18 @@ bool Parser::parse_select(SelectQuery &out, ParseError &err){
     if(i<n && is_kw(toks[i],"having")){
         ++i;
         std::string accum;
-        while(i<n && !(toks[i].type==TokenType::KW && (lower(toks[i].text)=="order"||lower(toks[i].text)=="limit"))){
-            if(toks[i].type==TokenType::COMMA){ ++i; continue; }
-            if(toks[i].type==TokenType::KW && lower(toks[i].text)=="and"){ if(!accum.empty()){ out.having_conditions.push_back(accum); accum.clear(); } ++i; continue; }
+        int depth = 0;
+        bool between = false;
+        while(i<n && toks[i].type != TokenType::END && !(depth == 0 && toks[i].type==TokenType::KW && (lower(toks[i].text)=="order"||lower(toks[i].text)=="limit"))){
+            if(toks[i].type==TokenType::LPAREN) ++depth;
+            if(toks[i].type==TokenType::RPAREN) --depth;
+            if(depth == 0 && toks[i].type==TokenType::COMMA){ ++i; continue; }
+            if(depth == 0 && is_kw(toks[i],"between")) between = true;
+            else if(depth == 0 && is_kw(toks[i],"and")){
+                if(between){ between = false; }
+                else { if(!accum.empty()){ out.having_conditions.push_back(accum); accum.clear(); } ++i; continue; }
+            }
+            if(toks[i].type==TokenType::SEMICOLON) break;
             if(!accum.empty()) accum.push_back(' ');
             accum += toks[i].type==TokenType::STRING ? ("'"+toks[i].text+"'") : toks[i].text;
             ++i;
@@ -164,7 +201,16 @@ bool Parser::parse_select(SelectQuery &out, ParseError &err){
 
     if(i<n && is_kw(toks[i],"order")){
         ++i; if(!expect([&](const Token&t){return is_kw(t,"by");}, "BY")) return false; ++i;
-        while(i<n && toks[i].type==TokenType::IDENT){ OrderItem oi{toks[i++].text,true};
+        // Sort keys are columns, select aliases or expressions
+        while(i<n && toks[i].type != TokenType::END && toks[i].type != TokenType::SEMICOLON && !is_kw(toks[i],"limit")){
+            int begin = i, depth = 0;
+            while(i<n && toks[i].type != TokenType::END && (depth > 0 || (toks[i].type != TokenType::COMMA && toks[i].type != TokenType::SEMICOLON && !is_kw(toks[i],"asc") && !is_kw(toks[i],"desc") && !is_kw(toks[i],"limit")))){
+                if(toks[i].type==TokenType::LPAREN) ++depth;
+                if(toks[i].type==TokenType::RPAREN) --depth;
+                ++i;
+            }
+            if(i == begin){ err={"Expected ORDER BY expression", i<n?toks[i].pos:-1}; return false; }
+            OrderItem oi{join_select_tokens(toks, begin, i), true};
             if(i<n && toks[i].type==TokenType::KW && (lower(toks[i].text)=="asc"||lower(toks[i].text)=="desc")){ oi.asc = lower(toks[i].text)=="asc"; ++i; }
             out.order_by.push_back(oi); if(i<n && toks[i].type==TokenType::COMMA){ ++i; } else break;
         }
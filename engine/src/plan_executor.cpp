@@ -1,10 +1,157 @@
 #include "plan_executor.h"
+#include "native_executor.h"
+#include "parallel_sort.h"
+#include "utils.h"
+#include <algorithm>
 #include <iostream>
+#include <iterator>
 #include <sstream>
 #include <chrono>
 
 namespace sqlopt {
 
+namespace {
+
+// Parallel sort node at the top of the plan (above it only projections and an
+// unbounded limit), or nullptr
+const SortNode* topLevelParallelSort(const PlanNode* node) {
+    while (node) {
+        switch (node->type) {
+            case PlanNodeType::PROJECT:
+                node = static_cast<const ProjectNode*>(node)->child.get();
+                break;
+            case PlanNodeType::LIMIT: {
+                auto limit = static_cast<const LimitNode*>(node);
+                if (limit->limit_count != static_cast<size_t>(-1)) return nullptr;
+                node = limit->child.get();
+                break;
+            }
+            case PlanNodeType::SORT: {
+                auto sort = static_cast<const SortNode*>(node);
+                return sort->parallel_workers > 1 ? sort : nullptr;
+            }
+            default:
+                return nullptr;
+        }
+    }
+    return nullptr;
+}
+
+// Position of the outermost trailing ORDER BY, or npos when the statement has none
+// or a LIMIT follows it (the server must then order the rows itself)
+size_t trailingOrderBy(const std::string& sql) {
+    std::string upper = sql;
+    for (auto& c : upper) c = static_cast<char>(std::toupper(static_cast<unsigned char>(c)));
+    size_t found = std::string::npos;
+    int depth = 0;
+    char quote = 0;
+    for (size_t i = 0; i < upper.size(); ++i) {
+        char c = upper[i];
+        if (quote) {
+            if (c == quote) quote = 0;
+        } else if (c == '\'' || c == '"' || c == '`') {
+            quote = c;
+        } else if (c == '(') {
+            ++depth;
+        } else if (c == ')') {
+            --depth;
+        } else if (depth == 0 && upper.compare(i, 9, " ORDER BY") == 0) {
+            found = i;
+        }
+    }
+    if (found == std::string::npos || upper.find(" LIMIT ", found) != std::string::npos) return std::string::npos;
+    return found;
+}
+
+// How the server orders a result column, when the client can reproduce it. Numbers
+// go by the field type; strings by collation id, of which only the byte-order and
+// ASCII-simple ones qualify (utf8mb4_0900_ai_ci and other UCA collations do not).
+bool sortKindFor(const MySQLConnector::FieldInfo& field, SortKind& kind) {
+    if (field.flags & (ENUM_FLAG | SET_FLAG)) return false;  // ordered by member index
+    if (IS_NUM(field.type)) {
+        switch (field.type) {
+            case MYSQL_TYPE_FLOAT:
+            case MYSQL_TYPE_DOUBLE:
+                kind = SortKind::REAL;
+                return true;
+            case MYSQL_TYPE_DECIMAL:
+            case MYSQL_TYPE_NEWDECIMAL: {
+                // length counts the digits plus a point and a sign
+                unsigned long digits = field.length - (field.decimals > 0 ? 1 : 0) -
+                                       ((field.flags & UNSIGNED_FLAG) ? 0 : 1);
+                if (digits > 15) return false;  // distinct values could meet as doubles
+                kind = SortKind::REAL;
+                return true;
+            }
+            default:
+                kind = (field.flags & UNSIGNED_FLAG) ? SortKind::UNSIGNED : SortKind::SIGNED;
+                return true;
+        }
+    }
+    switch (field.type) {
+        case MYSQL_TYPE_TIME:
+        case MYSQL_TYPE_TIME2:
+        case MYSQL_TYPE_JSON:
+        case MYSQL_TYPE_GEOMETRY:
+            return false;  // text form does not sort like the value
+        default:
+            break;
+    }
+    switch (field.charsetnr) {
+        case 63:   // binary, also reported for temporal types
+        case 309:  // utf8mb4_0900_bin
+            kind = SortKind::BINARY;
+            return true;
+        case 46:  // utf8mb4_bin
+        case 47:  // latin1_bin
+        case 65:  // ascii_bin
+        case 83:  // utf8mb3_bin
+            kind = SortKind::BINARY_PAD_SPACE;
+            return true;
+        case 8:   // latin1_swedish_ci
+        case 11:  // ascii_general_ci
+        case 33:  // utf8mb3_general_ci
+        case 45:  // utf8mb4_general_ci
+            kind = SortKind::ASCII_CI;
+            return true;
+        default:
+            return false;
+    }
+}
+
+// Result column for a sort key such as "u.name" or "name": the one column of that
+// name, from that table when the key is qualified. False when none or several match
+// (SELECT u.id, o.id ... ORDER BY id), which leaves the ordering to the server.
+bool resolveSortColumn(const std::string& key, const std::vector<std::string>& columns,
+                       const std::vector<MySQLConnector::FieldInfo>& types, size_t& index) {
+    std::string k = to_lower(trim(key));
+    size_t dot = k.rfind('.');
+    std::string qualifier = dot == std::string::npos ? "" : trim(k.substr(0, dot));
+    std::string bare = trim(dot == std::string::npos ? k : k.substr(dot + 1));
+    size_t matches = 0;
+    for (size_t i = 0; i < columns.size(); ++i) {
+        if (to_lower(columns[i]) != bare) continue;
+        if (!qualifier.empty() && (i >= types.size() || to_lower(types[i].table) != qualifier)) continue;
+        index = i;
+        ++matches;
+    }
+    return matches == 1;
+}
+
+// Hands rows already produced to on_rows in batches; false when it stopped them
+bool deliverRows(const std::vector<std::string>& columns, std::vector<std::vector<std::string>>& rows,
+                 size_t batch_rows, const MySQLConnector::RowBatchFn& on_rows) {
+    std::vector<std::vector<std::string>> batch;
+    for (size_t i = 0; i < rows.size(); i += batch_rows) {
+        size_t end = std::min(rows.size(), i + batch_rows);
+        batch.assign(std::make_move_iterator(rows.begin() + i), std::make_move_iterator(rows.begin() + end));
+        if (!on_rows(columns, batch)) return false;
+    }
+    return true;
+}
+
+} // namespace
+
 PlanExecutor::PlanExecutor(std::shared_ptr<MySQLConnector> connector)
     : connector_(connector) {}
 
@@ -17,8 +164,17 @@ PlanExecutor::ExecutionResult PlanExecutor::execute(const ExecutionPlan& plan) {
     try {
         // For now, convert the plan back to SQL and execute it
         // In a full implementation, this would execute each node in the plan tree
-        std::string sql = planToSQL(plan);
-        result = executeRawSQL(sql);
+        if (plan.isKnownEmpty()) {
+            if (plan.getRoot()) result.columns = plan.getRoot()->output_columns;
+            result.rows_affected = 0;
+            result.success = true;
+        } else if (!executeNative(plan, result)) {
+            std::string sql = planToSQL(plan);
+            const SortNode* sort = topLevelParallelSort(plan.getRoot());
+            if (!sort || !executeParallelSort(sql, *sort, result)) {
+                result = executeRawSQL(sql);
+            }
+        }
     } catch (const std::exception& e) {
         result.error_message = e.what();
     }
@@ -30,6 +186,56 @@ PlanExecutor::ExecutionResult PlanExecutor::execute(const ExecutionPlan& plan) {
     return result;
 }
 
+PlanExecutor::ExecutionResult PlanExecutor::executeStreaming(const ExecutionPlan& plan, size_t batch_rows,
+                                                            const MySQLConnector::RowBatchFn& on_rows) {
+    ExecutionResult result;
+    result.success = false;
+    batch_rows = std::max<size_t>(batch_rows, 1);
+
+    auto start_time = std::chrono::high_resolution_clock::now();
+    auto elapsed_ms = [&]() {
+        return std::chrono::duration_cast<std::chrono::milliseconds>(
+            std::chrono::high_resolution_clock::now() - start_time).count();
+    };
+    MySQLConnector::RowBatchFn counted = [&](const std::vector<std::string>& columns,
+                                             const std::vector<std::vector<std::string>>& rows) {
+        if (result.first_row_ms < 0 && !rows.empty()) result.first_row_ms = elapsed_ms();
+        result.rows_streamed += rows.size();
+        return on_rows(columns, rows);
+    };
+
+    try {
+        // Results produced whole are handed over in batches; only their output is paged
+        if (plan.isKnownEmpty()) {
+            if (plan.getRoot()) result.columns = plan.getRoot()->output_columns;
+            result.rows_affected = 0;
+            result.success = true;
+        } else if (executeNative(plan, result)) {
+            result.cancelled = !deliverRows(result.columns, result.rows, batch_rows, counted);
+            result.rows.clear();
+        } else {
+            std::string sql = planToSQL(plan);
+            const SortNode* sort = topLevelParallelSort(plan.getRoot());
+            if (sort && executeParallelSort(sql, *sort, result)) {
+                result.cancelled = !deliverRows(result.columns, result.rows, batch_rows, counted);
+                result.rows.clear();
+            } else {
+                MySQLConnector::QueryResult streamed = connector_->streamQuery(sql, batch_rows, counted);
+                result.success = streamed.success;
+                result.columns = std::move(streamed.columns);
+                result.rows_affected = streamed.affected_rows;
+                result.error_message = std::move(streamed.error_message);
+                result.cancelled = streamed.cancelled;
+            }
+        }
+    } catch (const std::exception& e) {
+        result.error_message = e.what();
+    }
+
+    result.execution_time_ms = elapsed_ms();
+    return result;
+}
+
 PlanExecutor::ExecutionResult PlanExecutor::executeRawSQL(const std::string& sql) {
     ExecutionResult result;
 
@@ -50,6 +256,54 @@ PlanExecutor::ExecutionResult PlanExecutor::executeRawSQL(const std::string& sql
     return result;
 }
 
+bool PlanExecutor::executeNative(const ExecutionPlan& plan, ExecutionResult& result) {
+    NativeExecutor native(column_store_);
+    if (!native.canExecute(plan.getRoot())) return false;
+
+    NativeExecutor::Result native_result;
+    std::string error;
+    if (!native.execute(plan.getRoot(), native_result, error)) return false;
+
+    result.columns = std::move(native_result.columns);
+    result.rows = std::move(native_result.rows);
+    result.rows_affected = 0;
+    result.success = true;
+    result.native = true;
+    return true;
+}
+
+bool PlanExecutor::executeParallelSort(const std::string& sql, const SortNode& sort, ExecutionResult& result) {
+    size_t order_by = trailingOrderBy(sql);
+    if (order_by == std::string::npos) return false;
+    std::string unordered_sql = sql.substr(0, order_by);
+
+    // The column types decide whether the client can sort as the server would; read
+    // them from an empty result before fetching every row
+    MySQLConnector::QueryResult probe = connector_->executeQuery(unordered_sql + " LIMIT 0");
+    if (!probe.success) return false;
+    std::vector<SortColumn> columns;
+    for (size_t i = 0; i < sort.sort_keys.size(); ++i) {
+        SortColumn col;
+        if (!resolveSortColumn(sort.sort_keys[i], probe.columns, probe.column_types, col.column)) return false;
+        if (col.column >= probe.column_types.size() || !sortKindFor(probe.column_types[col.column], col.kind)) {
+            return false;
+        }
+        col.ascending = i < sort.ascending.size() ? sort.ascending[i] : true;
+        columns.push_back(col);
+    }
+
+    MySQLConnector::QueryResult unsorted = connector_->executeQuery(unordered_sql);
+    if (!unsorted.success) return false;
+    // Values the kind cannot reproduce (non-ASCII text under a _ci collation) leave
+    // the ordering to the server after all
+    if (!parallel_sort_rows(unsorted.rows, unsorted.null_flags, columns, sort.parallel_workers)) return false;
+    result.success = true;
+    result.rows = std::move(unsorted.rows);
+    result.columns = std::move(unsorted.columns);
+    result.rows_affected = unsorted.affected_rows;
+    return true;
+}
+
 std::string PlanExecutor::planToSQL(const ExecutionPlan& plan) const {
     // Simple conversion back to SQL - in a full implementation,
     // this would traverse the plan tree and generate appropriate SQL
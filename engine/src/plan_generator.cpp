@@ -1,32 +1,296 @@
 #include "plan_generator.h"
+#include "expression_simplifier.h"
+#include "join_sampler.h"
+#include "lexer.h"
+#include "parser.h"
+#include "utils.h"
 #include <algorithm>
+#include <cmath>
 #include <iostream>
+#include <regex>
+#include <thread>
 
 namespace sqlopt {
 
-std::vector<std::unique_ptr<PlanNode>> PlanGenerator::generateScanPlans(const std::string& table_name,
-                                                                       const std::string& alias) {
+namespace {
+
+struct EquiJoinKey {
+    std::string left_col;  // column of the outer input
+    std::string right_col; // column of the inner input
+};
+
+// The side of a join edge on table reference `ref`, or nullptr when neither is
+const BoundColumn* sideOn(const JoinEdge& edge, RefId ref, const BoundColumn*& other) {
+    if (edge.right.ref == ref) {
+        other = &edge.left;
+        return &edge.right;
+    }
+    if (edge.left.ref == ref) {
+        other = &edge.right;
+        return &edge.left;
+    }
+    return nullptr;
+}
+
+// Find the first join edge of the conditions with one side on the inner input
+bool findEquiJoinKey(const ConditionList& conditions, RefId right, EquiJoinKey& key) {
+    for (size_t i = 0; i < conditions.size(); ++i) {
+        for (const JoinEdge& edge : conditions.entry(i).binding.edges) {
+            const BoundColumn* outer = nullptr;
+            const BoundColumn* inner = sideOn(edge, right, outer);
+            if (!inner) continue;
+            key = {outer->name, inner->name};
+            return true;
+        }
+    }
+    return false;
+}
+
+// Index scans return rows in key order, so a merge join can skip sorting them
+bool isOrderedOn(const PlanNode* node, const std::string& column) {
+    if (!node || node->type != PlanNodeType::INDEX_SCAN) return false;
+    return to_lower(static_cast<const IndexScanNode*>(node)->index_column) == to_lower(column);
+}
+
+// Average number of inner rows matching one index probe
+double matchesPerProbe(const StatisticsManager& stats, const TableStatistics& ts, const IndexInfo& idx,
+                       const std::string& column) {
+    if (idx.is_unique && idx.columns.size() == 1) return 1.0;
+    const ColumnStats* cs = stats.findColumnCI(ts, column);
+    if (cs && cs->distinct_values > 0) return std::max(1.0, static_cast<double>(ts.row_count) / cs->distinct_values);
+    return std::max(1.0, ts.row_count * 0.1);
+}
+
+// Select-list expressions that are aggregate function calls
+std::vector<std::string> aggregateItems(const SelectQuery& query) {
+    static const std::regex agg_pattern(R"(^\s*(count|sum|avg|min|max|group_concat)\s*\()", std::regex::icase);
+    std::vector<std::string> aggregates;
+    for (const auto& item : query.select_items) {
+        if (std::regex_search(item.expr, agg_pattern)) aggregates.push_back(item.expr);
+    }
+    return aggregates;
+}
+
+// Column references without whitespace ("u . age" -> "u.age")
+std::string compactColumn(const std::string& expr) {
+    std::string out;
+    for (char c : expr) {
+        if (!std::isspace(static_cast<unsigned char>(c))) out += c;
+    }
+    return out;
+}
+
+// The input arrives ordered on the single DISTINCT column (an index scan on it)
+bool orderedForDistinct(const PlanNode* node, const std::vector<std::string>& columns) {
+    if (columns.size() != 1) return false;
+    while (node && node->type == PlanNodeType::FILTER) node = static_cast<const FilterNode*>(node)->child.get();
+    std::string col = columns[0];
+    size_t dot = col.rfind('.');
+    return isOrderedOn(node, dot == std::string::npos ? col : col.substr(dot + 1));
+}
+
+// A condition an index on `column` can answer: "[ref.]column op literal" with a
+// comparison, or LIKE with a pattern whose only wildcard is a trailing '%'
+struct KeyCondition {
+    std::string op;    // "=", "<", "<=", ">", ">=", "LIKE"
+    std::string value; // literal without quotes
+};
+
+bool sargableOn(const ConditionEntry& cond, ColumnId column, RefId ref, KeyCondition& key) {
+    const Expr* e = cond.tree.get();
+    if (!e || e->kind != ExprKind::BINARY || cond.binding.columns.size() != 1) return false;
+    const Expr& l = *e->children[0];
+    const Expr& r = *e->children[1];
+    const BoundColumn& bound = cond.binding.columns[0];
+    if (l.kind != ExprKind::COLUMN || bound.ref != ref || bound.column == INVALID_ID || bound.column != column) {
+        return false;
+    }
+    if (e->text != "=" && e->text != "<" && e->text != "<=" && e->text != ">" && e->text != ">=" &&
+        e->text != "LIKE") {
+        return false;
+    }
+    if (r.kind != ExprKind::NUMBER && r.kind != ExprKind::STRING) return false;
+    key.op = e->text;
+    key.value = r.text;
+    if (key.op == "LIKE") {
+        size_t wildcard = key.value.find_first_of("%_");
+        return r.kind == ExprKind::STRING && wildcard != std::string::npos && wildcard > 0 &&
+               wildcard == key.value.size() - 1 && key.value.back() == '%';
+    }
+    return true;
+}
+
+// A scan that can take the single-table conditions of a filter above it
+struct FilterableScan {
+    std::vector<std::string>* filters;
+    RefId ref;
+};
+
+// Scans under `node` whose every row a filter above may drop: not the null-supplying
+// side of an outer join, not below a LIMIT or aggregate, and index scans only when
+// they are not feeding an ORDER BY (native execution reads those as table scans)
+void filterableScans(PlanNode* node, std::vector<FilterableScan>& scans) {
+    if (!node) return;
+    switch (node->type) {
+        case PlanNodeType::SCAN: {
+            auto scan = static_cast<ScanNode*>(node);
+            scans.push_back({&scan->filters, scan->ref});
+            break;
+        }
+        case PlanNodeType::INDEX_SCAN: {
+            auto scan = static_cast<IndexScanNode*>(node);
+            if (!scan->ordered) scans.push_back({&scan->filters, scan->ref});
+            break;
+        }
+        case PlanNodeType::FILTER:
+            filterableScans(static_cast<FilterNode*>(node)->child.get(), scans);
+            break;
+        case PlanNodeType::JOIN: {
+            auto join = static_cast<JoinNode*>(node);
+            std::string type = to_lower(join->join_type);
+            if (type != "right" && type != "full") filterableScans(join->left.get(), scans);
+            if (type != "left" && type != "full") filterableScans(join->right.get(), scans);
+            break;
+        }
+        default:
+            break;
+    }
+}
+
+// The condition reads only columns of table reference `ref`, or no columns at all
+// when the scan is the only table
+bool readsOnly(const ConditionEntry& cond, RefId ref, bool only_table) {
+    if (cond.binding.opaque || ref == INVALID_REF) return false;
+    return cond.binding.tables ? cond.binding.tables == refBit(ref) : only_table;
+}
+
+// Rows flow through without being buffered, so a LIMIT above stops the input early
+bool streamsRows(const PlanNode* node) {
+    while (node) {
+        switch (node->type) {
+            case PlanNodeType::SCAN:
+            case PlanNodeType::INDEX_SCAN:
+                return true;
+            case PlanNodeType::FILTER:
+                node = static_cast<const FilterNode*>(node)->child.get();
+                break;
+            case PlanNodeType::JOIN: {
+                // Nested loops pull the outer input row by row; hash and merge joins consume an input first
+                auto join = static_cast<const JoinNode*>(node);
+                if (join->algorithm != JoinAlgorithm::NESTED_LOOP &&
+                    join->algorithm != JoinAlgorithm::INDEX_NESTED_LOOP) return false;
+                node = join->left.get();
+                break;
+            }
+            case PlanNodeType::LIMIT:
+                node = static_cast<const LimitNode*>(node)->child.get();
+                break;
+            default:
+                return false;
+        }
+    }
+    return false;
+}
+
+} // namespace
+
+void PlanGenerator::useBinding(const BoundQuery& bound) {
+    bound_ = &bound;
+    // Statistics may have changed since the last query
+    handles_.clear();
+    handles_.reserve(bound.size());
+    for (const auto& ref : bound.refs()) handles_.push_back(cost_estimator_->resolveTable(ref.table));
+    // Every plan of this query refers to its conditions in one pool
+    pool_ = std::make_shared<ConditionPool>(bound_);
+}
+
+void PlanGenerator::bindTables(const std::vector<std::string>& tables) {
+    SelectQuery query;
+    if (!tables.empty()) query.from_table.name = tables[0];
+    for (size_t i = 1; i < tables.size(); ++i) {
+        JoinClause join;
+        join.type = JoinType::INNER;
+        join.table.name = tables[i];
+        query.joins.push_back(std::move(join));
+    }
+    owned_bound_.bind(query, stats_mgr_.get());
+    useBinding(owned_bound_);
+}
+
+double PlanGenerator::joinCardinality(const std::string& join_type, size_t left_card, size_t right_card,
+                                      const ConditionList& conditions, RefId right) {
+    double rows = static_cast<double>(left_card) * right_card;
+    bool keyed = false;
+    for (size_t i = 0; i < conditions.size(); ++i) {
+        // The first edge between the two inputs in each condition
+        for (const JoinEdge& edge : conditions.entry(i).binding.edges) {
+            const BoundColumn* outer = nullptr;
+            const BoundColumn* inner = sideOn(edge, right, outer);
+            if (!inner) continue;
+            rows *= stats_mgr_->estimateJoinSelectivity(bound_->ref(outer->ref).name, outer->name,
+                                                        bound_->ref(right).name, inner->name, left_card, right_card);
+            keyed = true;
+            break;
+        }
+    }
+    if (!keyed && !conditions.empty()) rows *= DEFAULT_JOIN_SELECTIVITY;
+
+    // Outer joins keep every row of their preserved side; anti joins only the unmatched ones
+    std::string type = to_lower(join_type);
+    if (type == "left" || type == "full") rows = std::max(rows, static_cast<double>(left_card));
+    if (type == "right" || type == "full") rows = std::max(rows, static_cast<double>(right_card));
+    if (type == "left anti") rows = left_card - std::min(rows, static_cast<double>(left_card));
+    if (type == "right anti") rows = right_card - std::min(rows, static_cast<double>(right_card));
+    return std::max(1.0, rows);
+}
+
+double PlanGenerator::sortCost(size_t rows) {
+    return rows > 1 ? cost_estimator_->estimateSortCost(rows, 1).total() : 0.0;
+}
+
+std::vector<std::unique_ptr<PlanNode>> PlanGenerator::generateScanPlans(RefId ref,
+                                                                       const std::vector<std::string>& filters) {
     std::vector<std::unique_ptr<PlanNode>> plans;
 
-    const TableStatistics* ts = stats_mgr_->getTableStats(table_name);
+    const TableStatistics* ts = bound_->tableStats(ref);
     if (!ts) return plans;
+    const BoundRef& table = bound_->ref(ref);
 
     // Table scan plan
-    auto scan_plan = std::make_unique<ScanNode>(table_name, alias);
+    auto scan_plan = std::make_unique<ScanNode>(table.name, table.alias);
+    scan_plan->ref = ref;
     scan_plan->estimated_cardinality = ts->row_count;
-    auto scan_cost = cost_estimator_->estimateTableScan(table_name);
+    const TableStatsHandle& handle = tableHandle(ref);
+    auto scan_cost = cost_estimator_->estimateTableScan(handle);
     scan_plan->estimated_cost = scan_cost.total();
     plans.push_back(std::move(scan_plan));
 
-    // Index scan plans (if indexes exist)
+    // Index lookups: an index whose leading column the filters bound
     for (const auto& idx : ts->available_indexes) {
-        for (const auto& col : idx.columns) {
-            auto idx_scan = std::make_unique<IndexScanNode>(table_name, col, alias);
-            idx_scan->estimated_cardinality = static_cast<size_t>(ts->row_count * 0.1); // Estimate
-            auto idx_cost = cost_estimator_->estimateIndexScan(table_name, col);
-            idx_scan->estimated_cost = idx_cost.total();
-            plans.push_back(std::move(idx_scan));
+        if (idx.columns.empty()) continue;
+        const std::string& col = idx.columns[0];
+        ColumnId col_id = stats_mgr_->columnIdCI(table.table, col);
+
+        std::vector<std::string> key_conditions;
+        double selectivity = 1.0;
+        for (const auto& cond : filters) {
+            KeyCondition key;
+            if (!sargableOn(conditionEntry(cond), col_id, ref, key)) continue;
+            key_conditions.push_back(cond);
+            if (key.op == "=" && idx.is_unique && idx.columns.size() == 1) {
+                selectivity *= ts->row_count > 0 ? 1.0 / ts->row_count : 1.0;
+            } else {
+                selectivity *= stats_mgr_->estimateSelectivity(ts->table_name, col, key.op, key.value);
+            }
         }
+        if (key_conditions.empty()) continue;
+
+        auto idx_scan = std::make_unique<IndexScanNode>(table.name, col, table.alias);
+        idx_scan->ref = ref;
+        idx_scan->key_conditions = std::move(key_conditions);
+        idx_scan->estimated_cardinality = std::max<size_t>(1, static_cast<size_t>(ts->row_count * selectivity));
+        idx_scan->estimated_cost = cost_estimator_->estimateIndexLookup(handle, idx, selectivity).total();
+        plans.push_back(std::move(idx_scan));
     }
 
     return plans;
@@ -40,7 +304,7 @@ std::vector<std::unique_ptr<PlanNode>> PlanGenerator::generateJoinPlans(
 
     if (tables.size() < 2) return plans;
 
-    // Generate left-deep join plans
+    // Generate left-deep join plans (the tables are bound there)
     try {
         auto left_deep = generateLeftDeepJoin(tables, join_conditions);
         if (left_deep) {
@@ -52,8 +316,9 @@ std::vector<std::unique_ptr<PlanNode>> PlanGenerator::generateJoinPlans(
 
     // If no plans generated, create a basic nested loop join
     if (plans.empty() && tables.size() >= 2) {
-        auto left_scans = generateScanPlans(tables[0]);
-        auto right_scans = generateScanPlans(tables[1]);
+        bindTables(tables);
+        auto left_scans = generateScanPlans(0);
+        auto right_scans = generateScanPlans(1);
         
         if (!left_scans.empty() && !right_scans.empty()) {
             std::vector<std::string> join_conds;
@@ -62,7 +327,7 @@ std::vector<std::unique_ptr<PlanNode>> PlanGenerator::generateJoinPlans(
             }
             
             auto join_node = std::make_unique<JoinNode>("INNER", 
-                std::move(left_scans[0]), std::move(right_scans[0]), join_conds);
+                std::move(left_scans[0]), std::move(right_scans[0]), conditionList(join_conds));
             
             // Set reasonable estimates
             join_node->estimated_cost = 100;
@@ -80,54 +345,154 @@ std::unique_ptr<PlanNode> PlanGenerator::generateLeftDeepJoin(
     const std::vector<std::vector<std::string>>& conditions) {
 
     if (tables.empty()) return nullptr;
+    bindTables(tables);
 
-    // Start with first table
-    auto left_scans = generateScanPlans(tables[0]);
-    if (left_scans.empty()) return nullptr;
-
-    // Choose the best scan for first table
-    std::unique_ptr<PlanNode> current = std::move(left_scans[0]);
-    for (size_t i = 1; i < left_scans.size(); ++i) {
-        if (left_scans[i]->estimated_cost < current->estimated_cost) {
-            current = std::move(left_scans[i]);
-        }
-    }
+    // Start with the cheapest scan of the first table
+    std::unique_ptr<PlanNode> current = generateBestScan(0);
 
     // Join remaining tables
     for (size_t i = 1; i < tables.size(); ++i) {
-        auto right_scans = generateScanPlans(tables[i]);
-        if (right_scans.empty()) continue;
-
-        // Choose best scan for right table
-        std::unique_ptr<PlanNode> right = std::move(right_scans[0]);
-        for (size_t j = 1; j < right_scans.size(); ++j) {
-            if (right_scans[j]->estimated_cost < right->estimated_cost) {
-                right = std::move(right_scans[j]);
-            }
-        }
-
         // Get join conditions for this pair
         std::vector<std::string> join_conds;
         if (i-1 < conditions.size() && !conditions[i-1].empty()) {
             join_conds = conditions[i-1];
         }
 
-        // Create join node
-        auto join_node = std::make_unique<JoinNode>("inner", std::move(current), std::move(right), join_conds);
+        RefId ref = static_cast<RefId>(i);
+        current = generatePhysicalJoin("INNER", std::move(current), generateBestScan(ref), conditionList(join_conds), ref);
+    }
 
-        // Estimate join cost and cardinality
-        size_t left_card = join_node->left ? join_node->left->estimated_cardinality : 1;
-        size_t right_card = join_node->right ? join_node->right->estimated_cardinality : 1;
-        auto join_cost = cost_estimator_->estimateJoinCost(left_card, right_card);
-        join_node->estimated_cost = (join_node->left ? join_node->left->estimated_cost : 0) +
-                                   (join_node->right ? join_node->right->estimated_cost : 0) +
-                                   join_cost.total();
-        join_node->estimated_cardinality = left_card * right_card / 10; // Rough estimate
+    return current;
+}
 
-        current = std::move(join_node);
+std::unique_ptr<PlanNode> PlanGenerator::generateBestScan(RefId ref, const std::vector<std::string>& filters) {
+    auto scans = generateScanPlans(ref, filters);
+
+    if (scans.empty() && !bound_->ref(ref).derived_sql.empty()) {
+        if (auto derived = generateDerivedScan(ref)) return derived;
     }
 
-    return current;
+    // No statistics: placeholder scan so the join can still be planned
+    if (scans.empty()) {
+        auto scan = std::make_unique<ScanNode>(bound_->ref(ref).name, bound_->ref(ref).alias);
+        scan->ref = ref;
+        scan->estimated_cost = 7;
+        scan->estimated_cardinality = 7;
+        return scan;
+    }
+
+    size_t best = 0;
+    for (size_t i = 1; i < scans.size(); ++i) {
+        if (scans[i]->estimated_cost < scans[best]->estimated_cost) best = i;
+    }
+    return std::move(scans[best]);
+}
+
+std::unique_ptr<PlanNode> PlanGenerator::generateDerivedScan(RefId ref) {
+    Lexer lexer(bound_->ref(ref).derived_sql);
+    Parser parser(lexer.tokenize());
+    Query parsed;
+    ParseError err;
+    if (!parser.parse_query(parsed, err) || !std::holds_alternative<SelectQuery>(parsed)) return nullptr;
+    const SelectQuery& inner = std::get<SelectQuery>(parsed);
+
+    PlanGenerator planner(stats_mgr_, cost_estimator_);
+    std::vector<ExecutionPlan> plans = planner.generatePlans(inner);
+    if (plans.empty() || !plans.front().getRoot()) return nullptr;
+    ExecutionPlan best = planner.getBestPlan(plans);
+
+    // The aggregation keeps one row per group: the product of the keys' NDVs, at most
+    // one per input row. Its own estimate (a tenth of the input) knows no NDVs.
+    const PlanNode* node = best.getRoot();
+    while (node && node->type == PlanNodeType::PROJECT) node = static_cast<const ProjectNode*>(node)->child.get();
+    double rows = static_cast<double>(best.getRoot()->estimated_cardinality);
+    if (node && node->type == PlanNodeType::AGGREGATE && !inner.group_by.empty()) {
+        const PlanNode* input = static_cast<const AggregateNode*>(node)->child.get();
+        double groups = 1.0;
+        for (const auto& key : inner.group_by) {
+            size_t ndv = planner.columnDistinctValues(key);
+            groups *= ndv > 0 ? static_cast<double>(ndv) : static_cast<double>(input->estimated_cardinality);
+        }
+        rows = std::min(groups, static_cast<double>(input->estimated_cardinality));
+    }
+
+    auto scan = std::make_unique<ScanNode>(bound_->ref(ref).name, bound_->ref(ref).alias);
+    scan->ref = ref;
+    scan->estimated_cost = best.getCost();
+    scan->estimated_cardinality = std::max<size_t>(1, static_cast<size_t>(rows));
+    return scan;
+}
+
+std::unique_ptr<PlanNode> PlanGenerator::generatePhysicalJoin(const std::string& join_type,
+                                                              std::unique_ptr<PlanNode> left,
+                                                              std::unique_ptr<PlanNode> right,
+                                                              const ConditionList& conditions,
+                                                              RefId right_ref) {
+    size_t left_card = left ? left->estimated_cardinality : 1;
+    size_t right_card = right ? right->estimated_cardinality : 1;
+    double left_cost = left ? left->estimated_cost : 0;
+    double inputs_cost = left_cost + (right ? right->estimated_cost : 0);
+
+    // Nested loop handles any condition and is the baseline to beat
+    JoinAlgorithm best_algo = JoinAlgorithm::NESTED_LOOP;
+    double best_cost = inputs_cost + cost_estimator_->estimateJoinCost(left_card, right_card).total();
+    std::unique_ptr<PlanNode> index_probe;
+
+    EquiJoinKey key;
+    if (findEquiJoinKey(conditions, right_ref, key)) {
+        // Hash join: build on one input, probe with the other
+        double hash_cost = inputs_cost + cost_estimator_->estimateJoinCost(left_card, right_card, JoinAlgorithm::HASH).total();
+        if (hash_cost < best_cost) {
+            best_algo = JoinAlgorithm::HASH;
+            best_cost = hash_cost;
+        }
+
+        // Merge join: inputs not already ordered on the key must be sorted first
+        double merge_cost = inputs_cost + cost_estimator_->estimateJoinCost(left_card, right_card, JoinAlgorithm::MERGE).total();
+        if (!isOrderedOn(left.get(), key.left_col)) merge_cost += sortCost(left_card);
+        if (!isOrderedOn(right.get(), key.right_col)) merge_cost += sortCost(right_card);
+        if (merge_cost < best_cost) {
+            best_algo = JoinAlgorithm::MERGE;
+            best_cost = merge_cost;
+        }
+
+        // Index nested loop: the inner side is never scanned, only probed through
+        // an index whose leading column is the join key. Only inner and left joins:
+        // the inner rows no probe reached never surface, so RIGHT and FULL would lose them.
+        std::string type = to_lower(join_type);
+        const TableStatistics* ts = bound_->tableStats(right_ref);
+        if (ts && (type == "inner" || type == "left")) {
+            const TableStatsHandle& inner = tableHandle(right_ref);
+            for (const auto& idx : ts->available_indexes) {
+                if (idx.columns.empty() || to_lower(idx.columns[0]) != to_lower(key.right_col)) continue;
+
+                double matches = matchesPerProbe(*stats_mgr_, *ts, idx, key.right_col);
+                double inl_cost = left_cost +
+                    cost_estimator_->estimateIndexNestedLoopCost(left_card, inner, matches, idx).total();
+                if (inl_cost < best_cost) {
+                    best_algo = JoinAlgorithm::INDEX_NESTED_LOOP;
+                    best_cost = inl_cost;
+                    auto probe = std::make_unique<IndexScanNode>(ts->table_name, idx.columns[0],
+                                                                 bound_->ref(right_ref).alias);
+                    probe->ref = right_ref;
+                    index_probe = std::move(probe);
+                    index_probe->estimated_cardinality = static_cast<size_t>(std::ceil(matches));
+                    index_probe->estimated_cost =
+                        cost_estimator_->estimateIndexNestedLoopCost(1, inner, matches, idx).total();
+                }
+            }
+        }
+    }
+
+    if (best_algo == JoinAlgorithm::INDEX_NESTED_LOOP) right = std::move(index_probe);
+
+    auto join_node = std::make_unique<JoinNode>(join_type, std::move(left), std::move(right), conditions);
+    join_node->algorithm = best_algo;
+    join_node->estimated_cost = best_cost;
+    join_node->estimated_cardinality = static_cast<size_t>(std::llround(
+        joinCardinality(join_type, left_card, right_card, conditions, right_ref)));
+
+    return join_node;
 }
 
 std::unique_ptr<PlanNode> PlanGenerator::generateBushyJoin(
@@ -139,14 +504,193 @@ std::unique_ptr<PlanNode> PlanGenerator::generateBushyJoin(
     return generateLeftDeepJoin(tables, conditions);
 }
 
+const ColumnStats* PlanGenerator::columnStats(const std::string& column, std::string& table) {
+    BoundColumn bound = bound_->bindColumn(column);
+    const ColumnStats* cs = bound_->columnStats(bound);
+    if (cs) table = bound_->tableStats(bound.ref)->table_name;
+    return cs;
+}
+
+namespace {
+
+bool isLiteral(const Expr& e) { return e.kind == ExprKind::NUMBER || e.kind == ExprKind::STRING; }
+
+std::string mirroredOp(const std::string& op) {
+    if (op == "<") return ">";
+    if (op == ">") return "<";
+    if (op == "<=") return ">=";
+    if (op == ">=") return "<=";
+    return op;
+}
+
+void flattenLogical(const ExprPtr& e, const char* op, std::vector<ExprPtr>& out) {
+    if (e->kind == ExprKind::BINARY && e->text == op) {
+        flattenLogical(e->children[0], op, out);
+        flattenLogical(e->children[1], op, out);
+    } else {
+        out.push_back(e);
+    }
+}
+
+void addAtoms(const std::vector<ExprPtr>& atoms, std::vector<ExprPtr>& into) {
+    for (const auto& atom : atoms) {
+        bool seen = false;
+        for (const auto& a : into) seen = seen || same_expression(*a, *atom);
+        if (!seen) into.push_back(atom);
+    }
+}
+
+} // namespace
+
+double PlanGenerator::predicateSelectivity(const ExprPtr& predicate) {
+    const Expr& e = *predicate;
+    auto clamp = [](double s) { return std::min(1.0, std::max(0.0, s)); };
+    auto product = [&](const std::vector<ExprPtr>& atoms) {
+        double s = 1.0;
+        for (const auto& atom : atoms) s *= predicateSelectivity(atom);
+        return s;
+    };
+    // Selectivity of "column op literal" from the column's statistics
+    auto compare = [&](const Expr& column, const std::string& op, const Expr& literal) {
+        std::string table;
+        if (column.kind != ExprKind::COLUMN || !isLiteral(literal)) return DEFAULT_FILTER_SELECTIVITY;
+        const ColumnStats* cs = columnStats(column.text, table);
+        if (!cs) return DEFAULT_FILTER_SELECTIVITY;
+        return stats_mgr_->estimateSelectivity(table, cs->column_name.empty() ? column.text : cs->column_name, op,
+                                               literal.text);
+    };
+
+    switch (e.kind) {
+        case ExprKind::NUMBER:
+            return e.text.find_first_not_of("0.") == std::string::npos ? 0.0 : 1.0;
+        case ExprKind::NULL_VALUE:
+            return 0.0;
+        case ExprKind::UNARY:
+            return e.text == "NOT" ? 1.0 - predicateSelectivity(e.children[0]) : DEFAULT_FILTER_SELECTIVITY;
+        case ExprKind::IS_NULL: {
+            std::string table;
+            const ColumnStats* cs =
+                e.children[0]->kind == ExprKind::COLUMN ? columnStats(e.children[0]->text, table) : nullptr;
+            double null_fraction = cs && !cs->nullable ? 0.0 : 0.1;
+            return e.text == "IS NULL" ? null_fraction : 1.0 - null_fraction;
+        }
+        case ExprKind::BETWEEN: {
+            double s = compare(*e.children[0], ">=", *e.children[1]) * compare(*e.children[0], "<=", *e.children[2]);
+            return e.text == "BETWEEN" ? s : 1.0 - s;
+        }
+        case ExprKind::IN_LIST: {
+            if (e.children.size() == 2 && e.children[1]->kind == ExprKind::SUBQUERY) return DEFAULT_FILTER_SELECTIVITY;
+            double s = 0.0;
+            for (size_t i = 1; i < e.children.size(); ++i) s += compare(*e.children[0], "=", *e.children[i]);
+            return e.text == "IN" ? clamp(s) : 1.0 - clamp(s);
+        }
+        case ExprKind::BINARY:
+            break;
+        default:
+            return DEFAULT_FILTER_SELECTIVITY;
+    }
+
+    const Expr& l = *e.children[0];
+    const Expr& r = *e.children[1];
+    if (e.text == "AND") {
+        std::vector<ExprPtr> parts, atoms;
+        flattenLogical(e.children[0], "AND", parts);
+        flattenLogical(e.children[1], "AND", parts);
+        addAtoms(parts, atoms);
+        return clamp(product(atoms));
+    }
+    if (e.text == "OR") {
+        // P(t1 OR ... OR tn) over the terms of the disjunctive normal form: the sum
+        // over non-empty subsets of terms, signed by their size, of P(all their atoms)
+        std::vector<std::vector<ExprPtr>> terms = to_dnf(predicate, MAX_INCLUSION_EXCLUSION_TERMS);
+        if (terms.empty()) {
+            std::vector<ExprPtr> parts;
+            flattenLogical(predicate, "OR", parts);
+            double none = 1.0;
+            for (const auto& p : parts) none *= 1.0 - predicateSelectivity(p);
+            return clamp(1.0 - none);
+        }
+        double s = 0.0;
+        for (size_t mask = 1; mask < (size_t{1} << terms.size()); ++mask) {
+            std::vector<ExprPtr> atoms;
+            int count = 0;
+            for (size_t i = 0; i < terms.size(); ++i) {
+                if (!(mask & (size_t{1} << i))) continue;
+                addAtoms(terms[i], atoms);
+                ++count;
+            }
+            s += (count % 2 ? 1.0 : -1.0) * product(atoms);
+        }
+        return clamp(s);
+    }
+    if (e.text == "LIKE" || e.text == "NOT LIKE") {
+        double s = compare(l, "LIKE", r);
+        return e.text == "LIKE" ? s : 1.0 - s;
+    }
+    if (e.text == "=" && l.kind == ExprKind::COLUMN && r.kind == ExprKind::COLUMN) {
+        std::string lt, rt;
+        const ColumnStats* lc = columnStats(l.text, lt);
+        const ColumnStats* rc = columnStats(r.text, rt);
+        size_t ndv = std::max(lc ? lc->distinct_values : 0, rc ? rc->distinct_values : 0);
+        return ndv > 0 ? 1.0 / ndv : DEFAULT_JOIN_SELECTIVITY;
+    }
+    bool column_left = l.kind == ExprKind::COLUMN;
+    const Expr& column = column_left ? l : r;
+    const Expr& literal = column_left ? r : l;
+    std::string op = column_left ? e.text : mirroredOp(e.text);
+    if (op == "<>" || op == "!=") return 1.0 - compare(column, "=", literal);
+    if (op == "=" || op == "<" || op == ">" || op == "<=" || op == ">=") return compare(column, op, literal);
+    return DEFAULT_FILTER_SELECTIVITY;
+}
+
+double PlanGenerator::conditionSelectivity(const ConditionList& conditions, const std::vector<std::string>& applied) {
+    std::vector<ExprPtr> atoms;
+    double unparsed = 1.0;
+    for (size_t i = 0; i < conditions.size(); ++i) {
+        const ConditionEntry& cond = conditions.entry(i);
+        if (std::find(applied.begin(), applied.end(), cond.text) != applied.end()) continue;
+        if (!cond.tree) {
+            unparsed *= DEFAULT_FILTER_SELECTIVITY;
+            continue;
+        }
+        addAtoms(split_conjuncts(cond.tree), atoms);
+    }
+    double s = unparsed;
+    for (const auto& atom : atoms) s *= predicateSelectivity(atom);
+    return std::min(1.0, std::max(0.0, s));
+}
+
+ConditionList PlanGenerator::conditionList(const std::vector<std::string>& conditions) {
+    if (!pool_) pool_ = std::make_shared<ConditionPool>(bound_);
+    return pool_->addList(conditions);
+}
+
+const ConditionEntry& PlanGenerator::conditionEntry(const std::string& condition) {
+    if (!pool_) pool_ = std::make_shared<ConditionPool>(bound_);
+    return (*pool_)[pool_->intern(condition)];
+}
+
 std::unique_ptr<PlanNode> PlanGenerator::generateFilterPlan(std::unique_ptr<PlanNode> child,
-                                                           const std::vector<std::string>& conditions) {
+                                                           const ConditionList& conditions) {
     if (!child || conditions.empty()) return child;
 
     auto filter_node = std::make_unique<FilterNode>(std::move(child), conditions);
 
-    // Estimate selectivity (simplified)
-    double selectivity = 0.5; // Assume 50% selectivity for filters
+    // Hand single-table conditions to the scans too, so native scans can skip chunks
+    std::vector<FilterableScan> scans;
+    filterableScans(filter_node->child.get(), scans);
+    PlanNodeType child_type = filter_node->child->type;
+    bool single_table = child_type == PlanNodeType::SCAN || child_type == PlanNodeType::INDEX_SCAN;
+    for (const auto& scan : scans) {
+        for (size_t i = 0; i < conditions.size(); ++i) {
+            if (readsOnly(conditions.entry(i), scan.ref, single_table)) scan.filters->push_back(conditions[i]);
+        }
+    }
+
+    // An index scan's cardinality already reflects the conditions it looked up
+    double selectivity = child_type == PlanNodeType::INDEX_SCAN
+        ? conditionSelectivity(conditions, static_cast<const IndexScanNode*>(filter_node->child.get())->key_conditions)
+        : conditionSelectivity(conditions);
     filter_node->estimated_cardinality = static_cast<size_t>(
         filter_node->child->estimated_cardinality * selectivity);
 
@@ -163,16 +707,30 @@ std::unique_ptr<PlanNode> PlanGenerator::generateSortPlan(std::unique_ptr<PlanNo
 
     std::vector<std::string> sort_keys;
     std::vector<bool> ascending;
+    sort_keys.reserve(order_by.size());
+    ascending.reserve(order_by.size());
     for (const auto& item : order_by) {
         sort_keys.push_back(item.expr);
         ascending.push_back(item.asc);
     }
 
-    auto sort_node = std::make_unique<SortNode>(std::move(child), sort_keys, ascending);
+    size_t key_count = sort_keys.size();
+    auto sort_node = std::make_unique<SortNode>(std::move(child), std::move(sort_keys), std::move(ascending));
     sort_node->estimated_cardinality = sort_node->child->estimated_cardinality;
 
-    auto sort_cost = cost_estimator_->estimateSortCost(sort_node->estimated_cardinality, sort_keys.size());
-    sort_node->estimated_cost = sort_node->child->estimated_cost + sort_cost.total();
+    double sort_cost = cost_estimator_->estimateSortCost(sort_node->estimated_cardinality, key_count).total();
+
+    // Large sorts may be spread over all cores when that is cheaper
+    size_t workers = std::thread::hardware_concurrency();
+    if (workers > 1 && sort_node->estimated_cardinality >= PARALLEL_SORT_MIN_ROWS) {
+        double parallel_cost = cost_estimator_->estimateParallelSortCost(
+            sort_node->estimated_cardinality, key_count, workers).total();
+        if (parallel_cost < sort_cost) {
+            sort_node->parallel_workers = workers;
+            sort_cost = parallel_cost;
+        }
+    }
+    sort_node->estimated_cost = sort_node->child->estimated_cost + sort_cost;
 
     return sort_node;
 }
@@ -180,7 +738,8 @@ std::unique_ptr<PlanNode> PlanGenerator::generateSortPlan(std::unique_ptr<PlanNo
 std::unique_ptr<PlanNode> PlanGenerator::generateAggregatePlan(std::unique_ptr<PlanNode> child,
                                                               const std::vector<std::string>& group_by,
                                                               const std::vector<std::string>& aggregates) {
-    if (!child) return child;
+    // Nothing to aggregate: rows pass through unchanged
+    if (!child || (group_by.empty() && aggregates.empty())) return child;
 
     auto agg_node = std::make_unique<AggregateNode>(std::move(child), group_by, aggregates);
 
@@ -199,16 +758,105 @@ std::unique_ptr<PlanNode> PlanGenerator::generateAggregatePlan(std::unique_ptr<P
     return agg_node;
 }
 
+size_t PlanGenerator::columnDistinctValues(const std::string& column) {
+    const ColumnStats* cs = bound_->columnStats(bound_->bindColumn(compactColumn(column)));
+    return cs ? cs->distinct_values : 0;
+}
+
+std::unique_ptr<PlanNode> PlanGenerator::generateDistinctPlan(std::unique_ptr<PlanNode> child,
+                                                             const SelectQuery& query) {
+    if (!child || !query.distinct) return child;
+
+    std::vector<std::string> columns;
+    for (const auto& item : query.select_items) {
+        if (compactColumn(item.expr) != "*") columns.push_back(compactColumn(item.expr));
+    }
+
+    // Distinct rows: product of the projected columns' NDVs, capped by the input.
+    // Unknown columns (and SELECT *) leave the input cardinality as the estimate.
+    size_t input_rows = child->estimated_cardinality;
+    double distinct_rows = columns.empty() ? static_cast<double>(input_rows) : 1.0;
+    for (const auto& col : columns) {
+        size_t ndv = columnDistinctValues(col);
+        distinct_rows *= ndv > 0 ? static_cast<double>(ndv) : static_cast<double>(input_rows);
+        if (distinct_rows >= input_rows) break;
+    }
+    size_t out_rows = std::max(size_t(1), static_cast<size_t>(std::min<double>(distinct_rows, input_rows)));
+    size_t width = std::max(size_t(1), columns.size());
+
+    bool presorted = orderedForDistinct(child.get(), columns);
+    double hash_cost = cost_estimator_->estimateDistinctCost(input_rows, out_rows, width, DistinctAlgorithm::HASH).total();
+    double sort_cost = cost_estimator_->estimateDistinctCost(input_rows, out_rows, width, DistinctAlgorithm::SORT,
+                                                             presorted).total();
+
+    auto distinct_node = std::make_unique<DistinctNode>(std::move(child), std::move(columns));
+    distinct_node->input_sorted = presorted;
+    distinct_node->algorithm = sort_cost < hash_cost ? DistinctAlgorithm::SORT : DistinctAlgorithm::HASH;
+    distinct_node->estimated_cardinality = out_rows;
+    distinct_node->estimated_cost = distinct_node->child->estimated_cost + std::min(hash_cost, sort_cost);
+
+    return distinct_node;
+}
+
 std::unique_ptr<PlanNode> PlanGenerator::generateLimitPlan(std::unique_ptr<PlanNode> child, size_t limit) {
-    if (!child || limit == 0) return child;
+    if (!child) return child;
+
+    // A sort feeding the limit only has to keep the first `limit` rows (top_n 0 means
+    // all of them, so LIMIT 0 keeps the full sort and lets the LimitNode drop them)
+    if (limit > 0 && child->type == PlanNodeType::SORT && child->estimated_cardinality > limit) {
+        auto sort = static_cast<SortNode*>(child.get());
+        double top_n_cost = cost_estimator_->estimateTopNSortCost(sort->estimated_cardinality, limit,
+                                                                  sort->sort_keys.size()).total();
+        double full_cost = sort->estimated_cost - sort->child->estimated_cost;
+        if (top_n_cost < full_cost) {
+            sort->top_n = limit;
+            sort->parallel_workers = 1;
+            sort->estimated_cost = sort->child->estimated_cost + top_n_cost;
+        }
+    }
 
     auto limit_node = std::make_unique<LimitNode>(std::move(child), limit);
-    limit_node->estimated_cardinality = std::min(limit, limit_node->child->estimated_cardinality);
+    size_t input_rows = limit_node->child->estimated_cardinality;
+    limit_node->estimated_cardinality = std::min(limit, input_rows);
     limit_node->estimated_cost = limit_node->child->estimated_cost; // Limit doesn't add much cost
 
+    // A streaming input is abandoned once the limit is reached: pay for that fraction only
+    if (input_rows > limit && streamsRows(limit_node->child.get())) {
+        limit_node->estimated_cost *= static_cast<double>(limit) / input_rows;
+    }
+
     return limit_node;
 }
 
+std::unique_ptr<PlanNode> PlanGenerator::generateTopNScan(RefId ref, const std::vector<std::string>& filters,
+                                                         const std::vector<OrderItem>& order_by, size_t limit) {
+    ConditionList filter_list = conditionList(filters);
+    auto best = generateLimitPlan(generateSortPlan(generateFilterPlan(generateBestScan(ref, filters), filter_list),
+                                                   order_by), limit);
+
+    // An index whose leading column is the (single) ORDER BY key yields rows in order,
+    // forwards or backwards, so no sort is needed and the scan stops after `limit` rows
+    const TableStatistics* ts = bound_->tableStats(ref);
+    if (!ts || order_by.size() != 1) return best;
+    BoundColumn key = bound_->bindColumn(compactColumn(order_by[0].expr));
+    if (key.ref != ref || key.column == INVALID_ID) return best;
+
+    for (const auto& idx : ts->available_indexes) {
+        if (idx.columns.empty() || stats_mgr_->columnIdCI(bound_->ref(ref).table, idx.columns[0]) != key.column) continue;
+
+        auto scan = std::make_unique<IndexScanNode>(ts->table_name, idx.columns[0], bound_->ref(ref).alias);
+        scan->ref = ref;
+        scan->ordered = true;
+        scan->descending = !order_by[0].asc;
+        scan->estimated_cardinality = ts->row_count;
+        scan->estimated_cost = cost_estimator_->estimateIndexScan(tableHandle(ref)).total();
+
+        auto candidate = generateLimitPlan(generateFilterPlan(std::move(scan), filter_list), limit);
+        if (candidate->estimated_cost < best->estimated_cost) best = std::move(candidate);
+    }
+    return best;
+}
+
 void PlanGenerator::estimatePlanCosts(PlanNode* node) {
     if (!node) return;
 
@@ -217,7 +865,20 @@ void PlanGenerator::estimatePlanCosts(PlanNode* node) {
 }
 
 std::vector<ExecutionPlan> PlanGenerator::generatePlans(const SelectQuery& query) {
+    owned_bound_.bind(query, stats_mgr_.get());
+    return generatePlans(query, owned_bound_);
+}
+
+std::vector<ExecutionPlan> PlanGenerator::generatePlans(const SelectQuery& query, const BoundQuery& bound) {
     std::vector<ExecutionPlan> plans;
+    useBinding(bound);
+
+    // The select list as the projection reads it
+    std::vector<std::string> projections;
+    projections.reserve(query.select_items.size());
+    for (const auto& item : query.select_items) {
+        projections.push_back(item.alias.empty() ? item.expr : item.expr + " as " + item.alias);
+    }
 
     // Get table names
     std::vector<std::string> table_names;
@@ -227,38 +888,58 @@ std::vector<ExecutionPlan> PlanGenerator::generatePlans(const SelectQuery& query
     }
 
     // Generate join conditions (simplified)
-    std::vector<std::vector<std::string>> join_conds(query.joins.size());
-    for (size_t i = 0; i < query.joins.size(); ++i) {
-        join_conds[i] = query.joins[i].on_conds;
-    }
+    std::vector<ConditionList> join_conds;
+    join_conds.reserve(query.joins.size());
+    for (const auto& join : query.joins) join_conds.push_back(conditionList(join.on_conds));
 
     if (table_names.size() == 1) {
         // Single-table query: generate scans, then apply operators
-        auto scans = generateScanPlans(table_names[0], query.from_table.alias);
-        
+        // The rewriter moves single-table predicates onto the table itself
+        std::vector<std::string> filters = query.from_table.pushedFilters;
+        filters.insert(filters.end(), query.where_conditions.begin(), query.where_conditions.end());
+        ConditionList filter_list = conditionList(filters);
+
+        auto scans = generateScanPlans(0, filters);
+
         // Force creation of at least one scan plan
         if (scans.empty()) {
             auto scan = std::make_unique<ScanNode>(table_names[0], query.from_table.alias);
-            const TableStatistics* ts = stats_mgr_->getTableStatsCI(table_names[0]);
+            scan->ref = 0;
+            const TableStatistics* ts = bound_->tableStats(0);
             scan->estimated_cost = ts ? ts->row_count : 100;
             scan->estimated_cardinality = ts ? ts->row_count : 100;
             scans.push_back(std::move(scan));
         }
-        
+
+        // ORDER BY ... LIMIT over plain rows may be answered straight from an ordered index
+        if (query.limit >= 0 && !query.order_by.empty() && !query.distinct && query.group_by.empty() &&
+            aggregateItems(query).empty()) {
+            auto top_n = generateTopNScan(0, filters, query.order_by, query.limit);
+            if (top_n) scans.push_back(std::move(top_n));
+        }
+
         for (auto& scan : scans) {
-            auto filtered = generateFilterPlan(std::move(scan), query.where_conditions);
-            auto agg = generateAggregatePlan(std::move(filtered), query.group_by, {});
-            std::vector<OrderItem> order_items;
-            for (const auto& ob : query.order_by) order_items.push_back(ob);
-            auto sorted = generateSortPlan(std::move(agg), order_items);
-            auto final_plan = generateLimitPlan(std::move(sorted), query.limit);
+            if (scan->type == PlanNodeType::LIMIT) {
+                // Already a complete top-N plan: only the projection is left to add
+                auto final_plan = std::move(scan);
+                if (!query.select_items.empty()) {
+                    auto project_node = std::make_unique<ProjectNode>(std::move(final_plan), projections);
+                    project_node->estimated_cost = project_node->child->estimated_cost + 1;
+                    project_node->estimated_cardinality = project_node->child->estimated_cardinality;
+                    final_plan = std::move(project_node);
+                }
+                plans.emplace_back(std::move(final_plan));
+                continue;
+            }
+
+            auto filtered = generateFilterPlan(std::move(scan), filter_list);
+            auto agg = generateAggregatePlan(std::move(filtered), query.group_by, aggregateItems(query));
+            auto distinct = generateDistinctPlan(std::move(agg), query);
+            auto sorted = generateSortPlan(std::move(distinct), query.order_by);
+            auto final_plan = query.limit >= 0 ? generateLimitPlan(std::move(sorted), query.limit) : std::move(sorted);
             
             // Add projection node for selected columns
             if (final_plan && !query.select_items.empty()) {
-                std::vector<std::string> projections;
-                for (const auto& item : query.select_items) {
-                    projections.push_back(item.expr + (item.alias.empty() ? "" : " as " + item.alias));
-                }
                 auto project_node = std::make_unique<ProjectNode>(std::move(final_plan), projections);
                 project_node->estimated_cost = project_node->child->estimated_cost + 1;
                 project_node->estimated_cardinality = project_node->child->estimated_cardinality;
@@ -270,70 +951,50 @@ std::vector<ExecutionPlan> PlanGenerator::generatePlans(const SelectQuery& query
             }
         }
     } else {
-        // Multi-table query: create a simple nested loop join directly
+        // Multi-table query: left-deep join in query order, with the physical
+        // algorithm of every join chosen by cost
         std::vector<std::unique_ptr<PlanNode>> join_plans;
-        
-        if (table_names.size() >= 2) {
-            auto left_scans = generateScanPlans(table_names[0], query.from_table.alias);
-            auto right_scans = generateScanPlans(table_names[1], query.joins.empty() ? "" : query.joins[0].table.alias);
-            
-            // Force creation even if scans are empty
-            if (left_scans.empty()) {
-                auto scan = std::make_unique<ScanNode>(table_names[0], query.from_table.alias);
-                scan->estimated_cost = 7;
-                scan->estimated_cardinality = 7;
-                left_scans.push_back(std::move(scan));
-            }
-            if (right_scans.empty()) {
-                auto scan = std::make_unique<ScanNode>(table_names[1], query.joins.empty() ? "" : query.joins[0].table.alias);
-                scan->estimated_cost = 7;
-                scan->estimated_cardinality = 7;
-                right_scans.push_back(std::move(scan));
-            }
-            
-            std::vector<std::string> join_conds_flat;
-            if (!join_conds.empty() && !join_conds[0].empty()) {
-                join_conds_flat = join_conds[0];
+
+        // A top-N pushed below the joins is planned on the FROM table alone
+        std::unique_ptr<PlanNode> current =
+            query.from_table.pushedLimit >= 0
+                ? generateTopNScan(0, query.from_table.pushedFilters, query.from_table.pushedOrder,
+                                   query.from_table.pushedLimit)
+                : generateBestScan(0);
+
+        // Sampled join sizes, when the tables are loaded, replace the estimates from statistics
+        std::vector<double> sampled;
+        if (join_sampler_ && query.from_table.pushedLimit < 0) sampled = join_sampler_->estimateJoins(query, *bound_);
+
+        for (size_t i = 0; i < query.joins.size(); ++i) {
+            RefId ref = static_cast<RefId>(i + 1);
+            current = generatePhysicalJoin(join_type_to_string(query.joins[i].type), std::move(current),
+                                           generateBestScan(ref), join_conds[i], ref);
+            if (i < sampled.size()) {
+                current->estimated_cardinality = std::max<size_t>(1, static_cast<size_t>(std::llround(sampled[i])));
             }
-            
-            auto join_node = std::make_unique<JoinNode>("NESTED", 
-                std::move(left_scans[0]), std::move(right_scans[0]), join_conds_flat);
-            
-            // Set reasonable estimates based on table stats
-            const TableStatistics* left_stats = stats_mgr_->getTableStatsCI(table_names[0]);
-            const TableStatistics* right_stats = stats_mgr_->getTableStatsCI(table_names[1]);
-            size_t left_rows = left_stats ? left_stats->row_count : 7;
-            size_t right_rows = right_stats ? right_stats->row_count : 7;
-            
-            join_node->estimated_cost = left_rows + right_rows + (left_rows * right_rows / 10);
-            join_node->estimated_cardinality = std::max(size_t(1), left_rows * right_rows / 10);
-            
-            join_plans.push_back(std::move(join_node));
         }
+        join_plans.push_back(std::move(current));
 
         for (auto& join_plan : join_plans) {
             // Apply filters
-            auto filtered_plan = generateFilterPlan(std::move(join_plan), query.where_conditions);
+            auto filtered_plan = generateFilterPlan(std::move(join_plan), conditionList(query.where_conditions));
 
             // Apply aggregation
-            auto agg_plan = generateAggregatePlan(std::move(filtered_plan), query.group_by, {});
+            auto agg_plan = generateAggregatePlan(std::move(filtered_plan), query.group_by, aggregateItems(query));
+
+            // Apply DISTINCT
+            auto distinct_plan = generateDistinctPlan(std::move(agg_plan), query);
 
             // Apply sorting
-            std::vector<OrderItem> order_items;
-            for (const auto& ob : query.order_by) {
-                order_items.push_back(ob);
-            }
-            auto sorted_plan = generateSortPlan(std::move(agg_plan), order_items);
+            auto sorted_plan = generateSortPlan(std::move(distinct_plan), query.order_by);
 
             // Apply limit
-            auto final_plan = generateLimitPlan(std::move(sorted_plan), query.limit);
+            auto final_plan = query.limit >= 0 ? generateLimitPlan(std::move(sorted_plan), query.limit)
+                                               : std::move(sorted_plan);
             
             // Add projection node for selected columns
             if (final_plan && !query.select_items.empty()) {
-                std::vector<std::string> projections;
-                for (const auto& item : query.select_items) {
-                    projections.push_back(item.expr + (item.alias.empty() ? "" : " as " + item.alias));
-                }
                 auto project_node = std::make_unique<ProjectNode>(std::move(final_plan), projections);
                 project_node->estimated_cost = project_node->child->estimated_cost + 1;
                 project_node->estimated_cardinality = project_node->child->estimated_cardinality;
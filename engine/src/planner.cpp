@@ -1,7 +1,7 @@
 #include "planner.h"
 #include <sstream>
 
-using namespace sqlopt;
+using namespace sqlopt::planner;
 
 static std::string indent_str(int n){ return std::string(n,' ');
 }
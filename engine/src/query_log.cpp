@@ -0,0 +1,127 @@
+#include "query_log.h"
+#include "utils.h"
+#include <fstream>
+#include <regex>
+
+namespace sqlopt {
+
+namespace {
+
+// Connection id, command and argument of a general log entry, optionally preceded by a timestamp:
+// "2024-05-01T10:00:00.123456Z\t   12 Query\tSELECT 1"
+const std::regex& generalLogEntry() {
+    static const std::regex re(R"(^(?:\S+\s+)?\s*\d+\s+([A-Z][a-z]+(?: [A-Za-z]+)?)\t(.*)$)");
+    return re;
+}
+
+// Value of the first string field named key in a flat JSON object
+bool jsonStringField(const std::string& line, const std::string& key, std::string& value) {
+    std::string needle = "\"" + key + "\"";
+    size_t pos = line.find(needle);
+    while (pos != std::string::npos) {
+        size_t i = pos + needle.size();
+        while (i < line.size() && std::isspace(static_cast<unsigned char>(line[i]))) ++i;
+        if (i < line.size() && line[i] == ':') {
+            ++i;
+            while (i < line.size() && std::isspace(static_cast<unsigned char>(line[i]))) ++i;
+            if (i >= line.size() || line[i] != '"') return false;
+            value.clear();
+            for (++i; i < line.size() && line[i] != '"'; ++i) {
+                if (line[i] != '\\' || i + 1 >= line.size()) { value += line[i]; continue; }
+                char e = line[++i];
+                switch (e) {
+                    case 'n': value += '\n'; break;
+                    case 't': value += '\t'; break;
+                    case 'r': value += '\r'; break;
+                    case 'u': value += '?'; i += 4; break; // non-ASCII escapes are not needed for replay
+                    default: value += e; break;
+                }
+            }
+            return true;
+        }
+        pos = line.find(needle, pos + 1);
+    }
+    return false;
+}
+
+bool isNumber(const std::string& s) {
+    return !s.empty() && std::all_of(s.begin(), s.end(), [](unsigned char c) { return std::isdigit(c); });
+}
+
+} // namespace
+
+QueryLogFormat detect_query_log_format(const std::vector<std::string>& first_lines) {
+    for (const auto& raw : first_lines) {
+        std::string line = trim(raw);
+        if (line.empty()) continue;
+        if (line[0] == '{') return QueryLogFormat::JSONL;
+        // general log files start with the server banner or the column header
+        if (line.find("Tcp port:") != std::string::npos || line.rfind("Time ", 0) == 0 ||
+            std::regex_match(raw, generalLogEntry())) {
+            return QueryLogFormat::GENERAL_LOG;
+        }
+    }
+    return QueryLogFormat::PLAIN;
+}
+
+bool load_query_log(const std::string& path, std::vector<std::string>& queries,
+                    std::string& error, QueryLogFormat format) {
+    std::ifstream in(path);
+    if (!in) {
+        error = "Cannot open query log: " + path;
+        return false;
+    }
+
+    std::vector<std::string> lines;
+    std::string line;
+    while (std::getline(in, line)) {
+        if (!line.empty() && line.back() == '\r') line.pop_back();
+        lines.push_back(line);
+    }
+
+    if (format == QueryLogFormat::AUTO) {
+        std::vector<std::string> head(lines.begin(), lines.begin() + std::min<size_t>(lines.size(), 10));
+        format = detect_query_log_format(head);
+    }
+
+    if (format == QueryLogFormat::JSONL) {
+        for (const auto& l : lines) {
+            std::string sql;
+            if (jsonStringField(l, "query", sql) || jsonStringField(l, "sql", sql) ||
+                jsonStringField(l, "statement", sql)) {
+                sql = trim(sql);
+                if (!sql.empty()) queries.push_back(sql);
+            }
+        }
+    } else if (format == QueryLogFormat::GENERAL_LOG) {
+        // Multi-line statements continue on lines that do not start a new entry
+        bool in_query = false;
+        for (const auto& l : lines) {
+            std::smatch m;
+            if (std::regex_match(l, m, generalLogEntry())) {
+                in_query = m[1].str() == "Query" || m[1].str() == "Execute";
+                if (in_query) queries.push_back(m[2].str());
+            } else if (in_query) {
+                queries.back() += "\n" + l;
+            }
+        }
+        for (auto& q : queries) q = trim(q);
+    } else {
+        std::string current;
+        for (const auto& raw : lines) {
+            std::string l = trim(raw);
+            // skip comments and a leading statement count such as the one in test_queries.txt
+            if (current.empty() && (l.empty() || l.rfind("--", 0) == 0 || l[0] == '#' || isNumber(l))) continue;
+            current += (current.empty() ? "" : " ") + l;
+            if (!l.empty() && l.back() == ';') {
+                current.pop_back();
+                queries.push_back(trim(current));
+                current.clear();
+            }
+        }
+        if (!trim(current).empty()) queries.push_back(trim(current));
+    }
+    return true;
+}
+
+} // namespace sqlopt
@@ -1,33 +1,40 @@
 #include "query_rewriter.h"
+#include "expression.h"
+#include "expression_simplifier.h"
+#include "parser.h"
+#include "utils.h"
+#include <algorithm>
 #include <regex>
-#include <set>
+#include <variant>
 
 namespace sqlopt {
 
-void QueryRewriter::rewrite(SelectQuery& query) {
+void QueryRewriter::rewrite(SelectQuery& query, BoundQuery& bound) {
     // Convert comma joins to explicit joins first
-    convertCommaJoins(query);
+    convertCommaJoins(query, bound);
     
     // Convert subqueries to joins for better performance
+    size_t join_count = query.joins.size();
     convertSubqueriesToJoins(query);
+    if (query.joins.size() != join_count) bound.rebind(query);
     
     // Apply predicate pushdown
-    pushdownPredicates(query);
+    pushdownPredicates(query, bound);
     
     // Apply projection pushdown
     pushdownProjections(query);
     
     // Apply join reordering
-    reorderJoins(query);
+    reorderJoins(query, bound);
 }
 
-void QueryRewriter::pushdownPredicates(SelectQuery& query) {
-    // Simple predicate pushdown for single-table queries
-    // For now, assume all predicates can be pushed to the main table
-    // In a full implementation, this would analyze which predicates reference which tables
-    if (query.joins.empty()) {
+void QueryRewriter::pushdownPredicates(SelectQuery& query, BoundQuery& bound) {
+    // Simple predicate pushdown for single-table queries: every condition reads
+    // the one table, so all of them move onto its scan
+    if (query.joins.empty() && !query.where_conditions.empty()) {
         query.from_table.pushedFilters = query.where_conditions;
         query.where_conditions.clear();
+        bound.where.clear();
     }
 }
 
@@ -38,81 +45,46 @@ void QueryRewriter::pushdownProjections(SelectQuery& query) {
     (void)query; // Suppress unused parameter warning
 }
 
-void QueryRewriter::convertCommaJoins(SelectQuery& query) {
-    // Enhanced comma join conversion - handle all cases
-    std::vector<std::string> remaining_conditions;
+void QueryRewriter::convertCommaJoins(SelectQuery& query, BoundQuery& bound) {
+    // A comma join (ON "1=1") takes the WHERE conditions that read its table, some
+    // table before it and none after it: the first join where they can be evaluated
+    std::vector<bool> moved(query.where_conditions.size(), false);
     bool conversions_made = false;
-    
-    for (auto& join : query.joins) {
-        if (!join.on_conds.empty() && join.on_conds[0] == "1=1") {
-            std::vector<std::string> join_conditions;
-            
-            // Get all possible table aliases for this join
-            std::vector<std::string> table_aliases;
-            
-            // Add main table alias
-            std::string main_alias = query.from_table.alias.empty() ? query.from_table.name : query.from_table.alias;
-            table_aliases.push_back(main_alias);
-            
-            // Add current join table alias
-            std::string join_alias = join.table.alias.empty() ? join.table.name : join.table.alias;
-            table_aliases.push_back(join_alias);
-            
-            // Add all previous join table aliases
-            for (const auto& prev_join : query.joins) {
-                if (&prev_join == &join) break; // Stop at current join
-                std::string prev_alias = prev_join.table.alias.empty() ? prev_join.table.name : prev_join.table.alias;
-                table_aliases.push_back(prev_alias);
-            }
-            
-            // Find conditions that involve the current join table
-            for (const auto& cond : query.where_conditions) {
-                bool involves_join_table = false;
-                bool involves_other_table = false;
-                
-                // Check if condition involves the join table (look for both alias. and alias space)
-                if (cond.find(join_alias + ".") != std::string::npos || 
-                    cond.find(join_alias + " ") != std::string::npos) {
-                    involves_join_table = true;
-                }
-                
-                // Check if condition involves any other table
-                for (const auto& alias : table_aliases) {
-                    if (alias != join_alias && 
-                        (cond.find(alias + ".") != std::string::npos || 
-                         cond.find(alias + " ") != std::string::npos)) {
-                        involves_other_table = true;
-                        break;
-                    }
-                }
-                
-                // If condition involves both the join table and another table, it's a join condition
-                if (involves_join_table && involves_other_table) {
-                    join_conditions.push_back(cond);
-                }
-            }
-            
-            // Update join conditions
-            if (!join_conditions.empty()) {
-                join.on_conds = join_conditions;
-                conversions_made = true;
+
+    for (size_t j = 0; j < query.joins.size(); ++j) {
+        auto& join = query.joins[j];
+        TableMask self = refBit(static_cast<RefId>(j + 1));
+        if (self == 0 || join.on_conds.empty() || join.on_conds[0] != "1=1") continue;
+        TableMask earlier = self - 1;
+
+        std::vector<std::string> join_conditions;
+        for (size_t i = 0; i < bound.where.size(); ++i) {
+            const BoundPredicate& cond = bound.where[i];
+            if (moved[i] || cond.opaque || !(cond.tables & self) || !(cond.tables & earlier) ||
+                (cond.tables & ~(self | earlier))) {
+                continue;
             }
+            join_conditions.push_back(query.where_conditions[i]);
+            moved[i] = true;
+        }
+
+        // Update join conditions
+        if (!join_conditions.empty()) {
+            join.on_conds = std::move(join_conditions);
+            conversions_made = true;
         }
     }
     
     // Now remove all join conditions from WHERE clause
-    for (const auto& cond : query.where_conditions) {
-        bool is_join_condition = false;
+    std::vector<std::string> remaining_conditions;
+    for (size_t i = 0; i < query.where_conditions.size(); ++i) {
+        const std::string& cond = query.where_conditions[i];
+        bool is_join_condition = moved[i];
         
-        // Check if this condition was moved to any join
+        // Also a condition written again in some join's ON
         for (const auto& join : query.joins) {
-            for (const auto& jc : join.on_conds) {
-                if (cond == jc) {
-                    is_join_condition = true;
-                    break;
-                }
-            }
             if (is_join_condition) break;
+            is_join_condition = std::find(join.on_conds.begin(), join.on_conds.end(), cond) != join.on_conds.end();
         }
         
         if (!is_join_condition) {
@@ -121,97 +93,86 @@ void QueryRewriter::convertCommaJoins(SelectQuery& query) {
     }
     
     // Update WHERE conditions with remaining conditions
-    query.where_conditions = remaining_conditions;
+    if (remaining_conditions.size() != query.where_conditions.size() || conversions_made) {
+        query.where_conditions = std::move(remaining_conditions);
+        bound.rebind(query);
+    }
     
     // Additional check: If no conversions were made but we suspect comma joins,
     // this might be a complex query that wasn't parsed with comma joins
     // In this case, we should still try to optimize the structure
     if (!conversions_made && query.joins.empty() && !query.where_conditions.empty()) {
         // Try to reconstruct comma joins from WHERE conditions
-        reconstructCommaJoins(query);
+        reconstructCommaJoins(query, bound);
     }
 }
 
-void QueryRewriter::reconstructCommaJoins(SelectQuery& query) {
+void QueryRewriter::reconstructCommaJoins(SelectQuery& query, BoundQuery& bound) {
     // Try to reconstruct comma joins from WHERE conditions for complex queries
-    // This is a fallback for queries that weren't parsed with comma join structures
-    
-    std::vector<std::string> remaining_conditions;
-    std::vector<JoinClause> reconstructed_joins;
-    
-    // Extract table aliases from WHERE conditions
-    std::set<std::string> table_aliases;
-    for (const auto& cond : query.where_conditions) {
-        // Look for patterns like "alias.column = alias.column"
-        std::regex table_pattern(R"((\w+)\.(\w+)\s*=\s*(\w+)\.(\w+))");
-        std::smatch matches;
-        if (std::regex_search(cond, matches, table_pattern)) {
-            table_aliases.insert(matches[1].str());
-            table_aliases.insert(matches[3].str());
+    // This is a fallback for queries that weren't parsed with comma join structures:
+    // a qualifier naming no table of the query, in a condition between qualified
+    // columns, is taken for a table of its own
+    for (const auto& cond : bound.where) {
+        size_t qualified = 0;
+        for (const auto& column : cond.columns) qualified += !column.qualifier.empty();
+        if (qualified < 2) continue;
+
+        for (const auto& column : cond.columns) {
+            if (column.qualifier.empty() || column.ref != INVALID_REF || bound.findRef(column.qualifier) != INVALID_REF) {
+                continue;
+            }
+            const std::string& alias = column.qualifier;
+            JoinClause new_join;
+            new_join.type = JoinType::INNER;
+            
+            // Map common aliases to table names
+            std::string table_name = alias;
+            if (alias == "ew") table_name = "electionwinner";
+            else if (alias == "c") table_name = "candidate";
+            else if (alias == "e") table_name = "election";
+            else if (alias == "p") table_name = "party";
+            else if (alias == "d") table_name = "district";
+            else if (alias == "po") table_name = "post";
+            else if (alias == "v") table_name = "voter";
+            else if (alias == "s") table_name = "state";
+            
+            new_join.table.name = table_name;
+            new_join.table.alias = alias;
+            bound.addRef(new_join.table);
+            query.joins.push_back(new_join);
         }
     }
-    
-    // Remove the main table alias
-    std::string main_alias = query.from_table.alias.empty() ? query.from_table.name : query.from_table.alias;
-    table_aliases.erase(main_alias);
-    
-    // Create joins for each additional table
-    for (const auto& alias : table_aliases) {
-        JoinClause new_join;
-        new_join.type = JoinType::INNER;
-        
-        // Map common aliases to table names
-        std::string table_name = alias;
-        if (alias == "ew") table_name = "electionwinner";
-        else if (alias == "c") table_name = "candidate";
-        else if (alias == "e") table_name = "election";
-        else if (alias == "p") table_name = "party";
-        else if (alias == "d") table_name = "district";
-        else if (alias == "po") table_name = "post";
-        else if (alias == "v") table_name = "voter";
-        else if (alias == "s") table_name = "state";
-        
-        new_join.table.name = table_name;
-        new_join.table.alias = alias;
-        
-        // Find join conditions for this table
-        std::vector<std::string> join_conditions;
-        for (const auto& cond : query.where_conditions) {
-            if (cond.find(alias + ".") != std::string::npos && 
-                (cond.find(main_alias + ".") != std::string::npos || 
-                 cond.find("=") != std::string::npos)) {
-                join_conditions.push_back(cond);
+    if (query.joins.empty()) return;
+    bound.rebind(query);
+
+    // Each new table takes the conditions it completes: ones reading it, an earlier
+    // table and no later one
+    std::vector<bool> moved(query.where_conditions.size(), false);
+    for (size_t j = 0; j < query.joins.size(); ++j) {
+        TableMask self = refBit(static_cast<RefId>(j + 1));
+        TableMask earlier = self - 1;
+        for (size_t i = 0; i < bound.where.size(); ++i) {
+            const BoundPredicate& cond = bound.where[i];
+            if (self == 0 || moved[i] || cond.opaque || !(cond.tables & self) || !(cond.tables & earlier) ||
+                (cond.tables & ~(self | earlier))) {
+                continue;
             }
-        }
-        
-        if (!join_conditions.empty()) {
-            new_join.on_conds = join_conditions;
-            reconstructed_joins.push_back(new_join);
+            query.joins[j].on_conds.push_back(query.where_conditions[i]);
+            moved[i] = true;
         }
     }
     
-    // Update query with reconstructed joins
-    if (!reconstructed_joins.empty()) {
-        query.joins = reconstructed_joins;
-        
-        // Remove join conditions from WHERE clause
-        for (const auto& cond : query.where_conditions) {
-            bool is_join_condition = false;
-            for (const auto& join : query.joins) {
-                for (const auto& jc : join.on_conds) {
-                    if (cond == jc) {
-                        is_join_condition = true;
-                        break;
-                    }
-                }
-                if (is_join_condition) break;
-            }
-            if (!is_join_condition) {
-                remaining_conditions.push_back(cond);
-            }
-        }
-        query.where_conditions = remaining_conditions;
+    // Tables that joined on nothing are left out, and the conditions moved to a
+    // join removed from WHERE
+    query.joins.erase(std::remove_if(query.joins.begin(), query.joins.end(),
+                                     [](const JoinClause& join) { return join.on_conds.empty(); }),
+                      query.joins.end());
+    std::vector<std::string> remaining_conditions;
+    for (size_t i = 0; i < query.where_conditions.size(); ++i) {
+        if (!moved[i]) remaining_conditions.push_back(query.where_conditions[i]);
     }
+    query.where_conditions = std::move(remaining_conditions);
+    bound.rebind(query);
 }
 
 void QueryRewriter::convertSubqueriesToJoins(SelectQuery& query) {
@@ -339,33 +300,445 @@ void QueryRewriter::flattenSubqueries(SelectQuery& query) {
     }
 }
 
-void QueryRewriter::foldConstants(SelectQuery& query) {
-    // Simple constant folding for expressions like 1+2, 'a'+'b'
-    // This is a placeholder - full implementation would parse and evaluate expressions
-    for (auto& cond : query.where_conditions) {
-        // Example: replace "1=1" with "TRUE"
-        if (cond.find("1=1") != std::string::npos) {
-            cond = "TRUE";
+void QueryRewriter::reorderJoins(SelectQuery& query, BoundQuery& bound) {
+    // Simple heuristic: order joins by table name, as a stand-in for size, but only
+    // take a join once every table its ON conditions read is already joined.
+    // Outer joins keep the written order; moving them changes the result.
+    if (query.joins.size() < 2 || query.joins.size() >= MAX_MASK_REFS) return;
+    for (const auto& join : query.joins) {
+        if (join.type != JoinType::INNER) return;
+    }
+
+    // Each join with its own table's bit and the tables its ON conditions read
+    struct Candidate {
+        JoinClause join;
+        TableMask self;
+        TableMask reads = 0;
+    };
+    std::vector<Candidate> remaining;
+    remaining.reserve(query.joins.size());
+    for (size_t i = 0; i < query.joins.size(); ++i) {
+        Candidate c{std::move(query.joins[i]), refBit(static_cast<RefId>(i + 1))};
+        for (const auto& cond : bound.on[i]) c.reads |= cond.tables;
+        remaining.push_back(std::move(c));
+    }
+
+    TableMask joined = refBit(0);
+    auto connectable = [&](const Candidate& c) { return (c.reads & ~(joined | c.self)) == 0; };
+
+    std::stable_sort(remaining.begin(), remaining.end(),
+                     [](const Candidate& a, const Candidate& b) { return a.join.table.name < b.join.table.name; });
+    query.joins.clear();
+    bool moved = false;
+    while (!remaining.empty()) {
+        auto next = std::find_if(remaining.begin(), remaining.end(), connectable);
+        if (next == remaining.end()) next = remaining.begin(); // cross join or unknown reference
+        joined |= next->self;
+        moved = moved || next->self != refBit(static_cast<RefId>(query.joins.size() + 1));
+        query.joins.push_back(std::move(next->join));
+        remaining.erase(next);
+    }
+    // The joins are numbered in their new order
+    if (moved) bound.rebind(query);
+}
+
+namespace {
+
+// A qualified column reference that binds to a table of `bound`
+bool qualifiedIn(const BoundQuery& bound, const Expr& column) {
+    BoundColumn c = bound.bindColumn(column.text);
+    return !c.qualifier.empty() && c.ref != INVALID_REF;
+}
+
+// SQL for one entry of an AND-ed condition list: an OR keeps its parentheses
+std::string conditionSQL(const Expr& e) {
+    std::string sql = expression_to_sql(e);
+    return e.kind == ExprKind::BINARY && e.text == "OR" ? "(" + sql + ")" : sql;
+}
+
+bool isTrivial(const Expr& e) {
+    return e.kind == ExprKind::COLUMN || e.kind == ExprKind::NUMBER || e.kind == ExprKind::STRING ||
+           e.kind == ExprKind::NULL_VALUE || e.kind == ExprKind::STAR;
+}
+
+bool containsAggregate(const Expr& e) {
+    bool found = false;
+    visit_expression(e, [&](const Expr& n) { found = found || is_aggregate(n); });
+    return found;
+}
+
+// Subqueries in value position: not the list of IN or the argument of EXISTS
+void collectScalarSubqueries(const ExprPtr& e, std::vector<ExprPtr>& out) {
+    if (e->kind == ExprKind::SUBQUERY) { out.push_back(e); return; }
+    if (e->kind == ExprKind::FUNCTION && e->text == "EXISTS") return;
+    for (const auto& c : e->children) {
+        if (e->kind == ExprKind::IN_LIST && c->kind == ExprKind::SUBQUERY) continue;
+        collectScalarSubqueries(c, out);
+    }
+}
+
+ExprPtr replaceScalarSubquery(const ExprPtr& e, const Expr& target, const ExprPtr& replacement) {
+    if (e->kind == ExprKind::SUBQUERY) return same_expression(*e, target) ? replacement : e;
+    if (e->kind == ExprKind::FUNCTION && e->text == "EXISTS") return e;
+    bool changed = false;
+    std::vector<ExprPtr> children;
+    children.reserve(e->children.size());
+    for (const auto& c : e->children) {
+        bool in_subquery = e->kind == ExprKind::IN_LIST && c->kind == ExprKind::SUBQUERY;
+        children.push_back(in_subquery ? c : replaceScalarSubquery(c, target, replacement));
+        changed = changed || children.back() != c;
+    }
+    return changed ? make_expression(e->kind, e->text, std::move(children), e->distinct) : e;
+}
+
+// A scalar subquery computing one aggregate over its own tables, correlated with the
+// outer query only by equalities between inner and outer columns, rewritten as a
+// derived table grouped by the inner columns. Grouping leaves one row per key, so a
+// LEFT JOIN on the outer columns keeps every outer row once; rows without a match
+// read NULL, which is the subquery's value there except for COUNT (0).
+struct DerivedAggregate {
+    std::string sql;
+    std::vector<std::pair<std::string, std::string>> keys; // inner column, outer column
+    bool count = false;
+};
+
+bool decorrelateAggregate(const Expr& subquery, const BoundQuery& outer, DerivedAggregate& out) {
+    Lexer lexer(subquery.text);
+    Parser parser(lexer.tokenize());
+    Query parsed;
+    ParseError err;
+    if (!parser.parse_query(parsed, err) || !std::holds_alternative<SelectQuery>(parsed)) return false;
+    const SelectQuery& sub = std::get<SelectQuery>(parsed);
+    if (sub.distinct || sub.select_items.size() != 1 || !sub.group_by.empty() || !sub.having_conditions.empty() ||
+        sub.limit >= 0) {
+        return false;
+    }
+
+    for (const auto& join : sub.joins) {
+        if (join.type != JoinType::INNER) return false;
+    }
+    BoundQuery inner(sub, outer.statistics());
+    // Columns qualified by the subquery's own tables; an inner alias shadows an outer one
+    auto local = [&](const Expr& e) {
+        bool ok = true;
+        visit_expression(e, [&](const Expr& n) {
+            if (n.kind == ExprKind::SUBQUERY || (n.kind == ExprKind::COLUMN && !qualifiedIn(inner, n))) ok = false;
+        });
+        return ok;
+    };
+
+    ExprPtr value = parse_expression(sub.select_items[0].expr);
+    if (!value || !is_aggregate(*value) || !local(*value)) return false;
+    out.count = value->text == "COUNT";
+
+    std::vector<std::string> conditions;
+    for (const auto& cond : sub.where_conditions) {
+        ExprPtr c = parse_expression(cond);
+        if (!c) return false;
+        if (local(*c)) {
+            conditions.push_back(expression_to_sql(*c));
+            continue;
         }
+        if (c->kind != ExprKind::BINARY || c->text != "=" || c->children[0]->kind != ExprKind::COLUMN ||
+            c->children[1]->kind != ExprKind::COLUMN) {
+            return false;
+        }
+        const Expr& l = *c->children[0];
+        const Expr& r = *c->children[1];
+        if (qualifiedIn(inner, l) && qualifiedIn(outer, r)) out.keys.push_back({l.text, r.text});
+        else if (qualifiedIn(inner, r) && qualifiedIn(outer, l)) out.keys.push_back({r.text, l.text});
+        else return false;
     }
+    if (out.keys.empty()) return false;
+
+    std::string sql = "SELECT ";
+    for (size_t k = 0; k < out.keys.size(); ++k) sql += out.keys[k].first + " AS cse_key" + std::to_string(k + 1) + ", ";
+    sql += expression_to_sql(*value) + " AS cse_value FROM " + sub.from_table.name;
+    if (!sub.from_table.alias.empty()) sql += " AS " + sub.from_table.alias;
+    for (const auto& join : sub.joins) {
+        for (const auto& cond : join.on_conds) {
+            ExprPtr c = parse_expression(cond);
+            if (!c || !local(*c)) return false;
+        }
+        sql += " INNER JOIN " + join.table.name;
+        if (!join.table.alias.empty()) sql += " AS " + join.table.alias;
+        for (size_t k = 0; k < join.on_conds.size(); ++k) sql += (k == 0 ? " ON " : " AND ") + join.on_conds[k];
+    }
+    for (size_t k = 0; k < conditions.size(); ++k) sql += (k == 0 ? " WHERE " : " AND ") + conditions[k];
+    sql += " GROUP BY ";
+    for (size_t k = 0; k < out.keys.size(); ++k) sql += (k == 0 ? "" : ", ") + out.keys[k].first;
+    out.sql = sql;
+    return true;
 }
 
-void QueryRewriter::reorderJoins(SelectQuery& query) {
-    // Simple heuristic: order joins by table size (smallest first)
-    // In a full implementation, this would use cost estimates
-    if (query.joins.size() > 1) {
-        // For now, just sort by table name as a placeholder
-        std::sort(query.joins.begin(), query.joins.end(),
-                  [](const JoinClause& a, const JoinClause& b) {
-                      return a.table.name < b.table.name;
-                  });
+// Every expression of the query as a tree, written back only where a rewrite changed it
+struct ParsedClauses {
+    std::vector<ExprPtr> select, where, having, order;
+
+    explicit ParsedClauses(const SelectQuery& q) {
+        for (const auto& item : q.select_items) select.push_back(parse_expression(item.expr));
+        for (const auto& cond : q.where_conditions) where.push_back(parse_expression(cond));
+        for (const auto& cond : q.having_conditions) having.push_back(parse_expression(cond));
+        for (const auto& ob : q.order_by) order.push_back(parse_expression(ob.expr));
     }
+
+    template <typename Fn> void forEach(Fn fn) {
+        for (auto* clause : {&select, &where, &having, &order}) {
+            for (auto& e : *clause) {
+                if (e) fn(e);
+            }
+        }
+    }
+};
+
+} // namespace
+
+void QueryRewriter::eliminateCommonSubexpressions(SelectQuery& query, BoundQuery& bound, TransformLog& log) {
+    size_t logged = log.items.size();
+    ParsedClauses trees(query);
+    std::vector<ExprPtr> before[] = {trees.select, trees.where, trees.having, trees.order};
+
+    // Repeated scalar subqueries become one derived-table join
+    std::vector<ExprPtr> shared_values;
+    bool grouped = !query.group_by.empty();
+    for (const auto& e : trees.select) grouped = grouped || (e && containsAggregate(*e));
+    if (!grouped) {
+        std::vector<ExprPtr> subqueries;
+        trees.forEach([&](ExprPtr& e) { collectScalarSubqueries(e, subqueries); });
+        std::vector<bool> done(subqueries.size(), false);
+        int derived = 0;
+        for (size_t i = 0; i < subqueries.size(); ++i) {
+            if (done[i]) continue;
+            size_t copies = 0;
+            for (size_t j = i; j < subqueries.size(); ++j) {
+                if (!done[j] && subqueries[j]->hash == subqueries[i]->hash && same_expression(*subqueries[i], *subqueries[j])) {
+                    done[j] = true;
+                    ++copies;
+                }
+            }
+            DerivedAggregate agg;
+            if (copies < 2 || !decorrelateAggregate(*subqueries[i], bound, agg)) continue;
+
+            std::string name;
+            do { name = "cse_" + std::to_string(++derived); } while (bound.findRef(name) != INVALID_REF);
+            JoinClause join;
+            join.type = JoinType::LEFT;
+            join.table.name = name;
+            join.table.alias = name;
+            join.table.derived_sql = agg.sql;
+            for (size_t k = 0; k < agg.keys.size(); ++k) {
+                join.on_conds.push_back(name + ".cse_key" + std::to_string(k + 1) + " = " + agg.keys[k].second);
+            }
+            bound.addRef(join.table);
+            query.joins.push_back(join);
+
+            ExprPtr value = make_expression(ExprKind::COLUMN, name + ".cse_value");
+            if (agg.count) value = make_expression(ExprKind::FUNCTION, "COALESCE", {value, make_expression(ExprKind::NUMBER, "0")});
+            shared_values.push_back(value);
+            ExprPtr target = subqueries[i];
+            trees.forEach([&](ExprPtr& e) { e = replaceScalarSubquery(e, *target, value); });
+            log.add("common_subexpression", "Computed a subquery written " + std::to_string(copies) +
+                    " times once per key in derived table " + name + ", LEFT JOINed on " +
+                    joinPredicates(join.on_conds));
+        }
+    }
+
+    // ORDER BY and HAVING read a select item's alias instead of computing it again
+    for (size_t i = 0; i < trees.select.size(); ++i) {
+        const ExprPtr& item = trees.select[i];
+        const std::string& alias = query.select_items[i].alias;
+        if (!item || alias.empty() || isTrivial(*item)) continue;
+        ExprPtr ref = make_expression(ExprKind::COLUMN, alias);
+        bool reused = false;
+        for (auto& key : trees.order) {
+            if (key && same_expression(*key, *item)) { key = ref; reused = true; }
+        }
+        for (auto& cond : trees.having) {
+            if (!cond) continue;
+            ExprPtr rewritten = replace_subexpressions(cond, [&](const Expr& n) { return same_expression(n, *item) ? ref : nullptr; });
+            reused = reused || rewritten != cond;
+            cond = rewritten;
+        }
+        if (reused) log.add("common_subexpression", "ORDER BY/HAVING read select item " + alias + " instead of recomputing " + expression_to_sql(*item));
+    }
+
+    auto writeBack = [](const ExprPtr& now, const ExprPtr& was, std::string& text) {
+        if (now && now != was) text = expression_to_sql(*now);
+    };
+    for (size_t i = 0; i < trees.select.size(); ++i) writeBack(trees.select[i], before[0][i], query.select_items[i].expr);
+    for (size_t i = 0; i < trees.where.size(); ++i) writeBack(trees.where[i], before[1][i], query.where_conditions[i]);
+    for (size_t i = 0; i < trees.having.size(); ++i) writeBack(trees.having[i], before[2][i], query.having_conditions[i]);
+    for (size_t i = 0; i < trees.order.size(); ++i) writeBack(trees.order[i], before[3][i], query.order_by[i].expr);
+
+    // Conditions and sort keys written twice: the later copies change nothing
+    auto dropRepeats = [&](std::vector<ExprPtr>& exprs, auto& items, const char* clause) {
+        std::vector<bool> keep(exprs.size(), true);
+        for (size_t i = 0; i < exprs.size(); ++i) {
+            for (size_t j = 0; j < i && keep[i]; ++j) {
+                if (keep[j] && exprs[i] && exprs[j] && same_expression(*exprs[i], *exprs[j])) keep[i] = false;
+            }
+        }
+        size_t out = 0;
+        for (size_t i = 0; i < exprs.size(); ++i) {
+            if (!keep[i]) {
+                log.add("common_subexpression", std::string("Removed repeated ") + clause + " " + expression_to_sql(*exprs[i]));
+                continue;
+            }
+            exprs[out] = exprs[i];
+            items[out++] = items[i];
+        }
+        exprs.resize(out);
+        items.resize(out);
+    };
+    dropRepeats(trees.where, query.where_conditions, "WHERE condition");
+    dropRepeats(trees.having, query.having_conditions, "HAVING condition");
+    dropRepeats(trees.order, query.order_by, "ORDER BY key");
+
+    // What is left repeated runs once per copy; record the largest such expressions
+    std::vector<std::pair<ExprPtr, int>> repeats;
+    trees.forEach([&](ExprPtr& root) {
+        visit_expression(*root, [&](const Expr& n) {
+            if (isTrivial(n) || n.kind == ExprKind::SUBQUERY) return;
+            for (const auto& v : shared_values) {
+                if (same_expression(n, *v)) return;
+            }
+            for (auto& r : repeats) {
+                if (r.first->hash == n.hash && same_expression(*r.first, n)) { ++r.second; return; }
+            }
+            repeats.push_back({make_expression(n.kind, n.text, n.children, n.distinct), 1});
+        });
+    });
+    auto contains = [](const Expr& outer, const Expr& inner) {
+        bool found = false;
+        visit_expression(outer, [&](const Expr& n) { found = found || (&n != &outer && same_expression(n, inner)); });
+        return found;
+    };
+    std::vector<std::string> reported;
+    for (const auto& r : repeats) {
+        if (r.second < 2) continue;
+        bool part_of_larger = false;
+        for (const auto& other : repeats) {
+            part_of_larger = part_of_larger || (other.second == r.second && contains(*other.first, *r.first));
+        }
+        if (!part_of_larger) reported.push_back(expression_to_sql(*r.first) + " (" + std::to_string(r.second) + " copies)");
+    }
+    for (const auto& sql : reported) {
+        log.add("common_subexpression", "Left repeated, each copy evaluated per row: " + sql);
+    }
+    if (log.items.size() != logged) bound.rebind(query);
+}
+
+bool QueryRewriter::foldConstants(SelectQuery& query, BoundQuery& bound, TransformLog& log) {
+    size_t logged = log.items.size();
+    // Folds a list of AND-ed conditions; a condition that simplifies to an AND
+    // contributes its operands separately
+    auto foldConditions = [&](std::vector<std::string>& conds, const char* clause, std::vector<ExprPtr>* trees) {
+        std::vector<std::string> kept;
+        for (const auto& cond : conds) {
+            ExprPtr tree = parse_expression(cond);
+            ExprPtr folded = tree ? simplify_expression(tree, true) : nullptr;
+            if (!folded || folded == tree) {
+                kept.push_back(cond);
+                if (trees && tree) trees->push_back(tree);
+                continue;
+            }
+            std::vector<std::string> parts;
+            for (const auto& conjunct : split_conjuncts(folded)) {
+                if (conjunct->kind == ExprKind::NUMBER && conjunct->text == "1") continue;
+                parts.push_back(conditionSQL(*conjunct));
+                if (trees) trees->push_back(conjunct);
+            }
+            log.add("constant_folding", std::string(clause) + " " + expression_to_sql(*tree) + " -> " +
+                    (parts.empty() ? std::string("TRUE, removed") : joinPredicates(parts)));
+            kept.insert(kept.end(), parts.begin(), parts.end());
+        }
+        conds = kept;
+    };
+
+    std::vector<ExprPtr> where;
+    foldConditions(query.where_conditions, "WHERE", &where);
+    foldConditions(query.having_conditions, "HAVING", nullptr);
+    for (auto& join : query.joins) {
+        // "1=1" marks a comma join whose conditions are still in WHERE
+        if (join.on_conds.size() == 1 && join.on_conds[0] == "1=1") continue;
+        std::vector<std::string> on = join.on_conds;
+        foldConditions(on, "ON", nullptr);
+        // An outer join needs some ON condition
+        if (on.empty() && join.type != JoinType::INNER) on.push_back("TRUE");
+        join.on_conds = on;
+    }
+    for (auto& item : query.select_items) {
+        // Folding an unaliased item would rename its result column
+        if (item.alias.empty()) continue;
+        ExprPtr tree = parse_expression(item.expr);
+        ExprPtr folded = tree ? simplify_expression(tree, false) : nullptr;
+        if (!folded || folded == tree) continue;
+        std::string sql = expression_to_sql(*folded);
+        log.add("constant_folding", "SELECT " + expression_to_sql(*tree) + " -> " + sql);
+        item.expr = sql;
+    }
+
+    std::string contradiction = find_contradiction(where);
+    if (!contradiction.empty()) {
+        log.add("contradiction", "WHERE is never true: " + contradiction + "; replaced by FALSE");
+        query.where_conditions = {"FALSE"};
+    }
+    if (log.items.size() != logged) bound.rebind(query);
+    return contradiction.empty();
+}
+
+namespace {
+
+// More than one table in the mask
+bool severalTables(TableMask tables) { return (tables & (tables - 1)) != 0; }
+
+bool containsOr(const Expr& e) {
+    bool found = false;
+    visit_expression(e, [&](const Expr& n) { found = found || (n.kind == ExprKind::BINARY && n.text == "OR"); });
+    return found;
 }
 
-bool QueryRewriter::isPushablePredicate(const std::string& pred, const std::string& table_alias) {
-    // Check if predicate only references the given table
-    // Simplified check - look for table alias in predicate
-    return pred.find(table_alias + ".") != std::string::npos;
+const size_t kMaxCnfClauses = 8;
+
+} // namespace
+
+void QueryRewriter::normalizePredicates(SelectQuery& query, BoundQuery& bound, TransformLog& log) {
+    size_t logged = log.items.size();
+    std::vector<std::string> kept;
+    for (const auto& cond : query.where_conditions) {
+        ExprPtr tree = parse_expression(cond);
+        if (!tree || !containsOr(*tree)) {
+            kept.push_back(cond);
+            continue;
+        }
+        std::vector<std::string> parts;
+        for (const auto& conjunct : split_conjuncts(factor_condition(tree))) {
+            BoundPredicate bound_conjunct = bound.bindPredicate(conjunct.get());
+            std::vector<std::vector<ExprPtr>> clauses;
+            if (containsOr(*conjunct) && !bound_conjunct.opaque && severalTables(bound_conjunct.tables)) {
+                clauses = to_cnf(conjunct, kMaxCnfClauses);
+            }
+            bool pushable = false;
+            for (const auto& clause : clauses) {
+                TableMask clause_tables = bound.bindPredicate(join_atoms(clause, "OR").get()).tables;
+                pushable = pushable || (clause_tables != 0 && !severalTables(clause_tables));
+            }
+            if (!pushable) {
+                parts.push_back(conditionSQL(*conjunct));
+                continue;
+            }
+            for (const auto& clause : clauses) parts.push_back(conditionSQL(*join_atoms(clause, "OR")));
+        }
+        ExprPtr normalized = parse_expression(joinPredicates(parts));
+        if (parts.size() == 1 && normalized && same_expression(*normalized, *tree)) {
+            kept.push_back(cond);
+            continue;
+        }
+        log.add("predicate_normalization", "WHERE " + expression_to_sql(*tree) + " -> " + joinPredicates(parts));
+        kept.insert(kept.end(), parts.begin(), parts.end());
+    }
+    query.where_conditions = kept;
+    if (log.items.size() != logged) bound.rebind(query);
 }
 
 std::vector<std::string> QueryRewriter::splitPredicates(const std::string& predicates) {
@@ -0,0 +1,224 @@
+#include "slow_log.h"
+#include "fingerprint.h"
+#include "lexer.h"
+#include "optimizer.h"
+#include "parser.h"
+#include "utils.h"
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace sqlopt {
+
+namespace {
+
+bool startsWith(const char* data, size_t len, const char* prefix) {
+    size_t n = std::strlen(prefix);
+    return len >= n && std::memcmp(data, prefix, n) == 0;
+}
+
+// Value following "key:" in a "# Query_time: 1.5  Lock_time: 0.0 ..." line
+bool headerField(const std::string& line, const char* key, double& value) {
+    size_t pos = line.find(key);
+    if (pos == std::string::npos) return false;
+    value = std::strtod(line.c_str() + pos + std::strlen(key), nullptr);
+    return true;
+}
+
+// Split a buffer into lines; returns the bytes consumed (up to the last newline)
+template <typename F>
+size_t forEachLine(const char* data, size_t len, F&& on_line) {
+    size_t start = 0;
+    while (start < len) {
+        const void* nl = std::memchr(data + start, '\n', len - start);
+        if (!nl) break;
+        size_t end = static_cast<const char*>(nl) - data;
+        size_t line_len = end - start;
+        if (line_len > 0 && data[start + line_len - 1] == '\r') --line_len;
+        on_line(data + start, line_len);
+        start = end + 1;
+    }
+    return start;
+}
+
+} // namespace
+
+void SlowLogReader::flush(const EntryCallback& on_entry) {
+    std::string sql = trim(current_.sql);
+    while (!sql.empty() && sql.back() == ';') sql.pop_back();
+    if (have_header_ && !sql.empty()) {
+        current_.sql = trim(sql);
+        current_.database = database_;
+        on_entry(current_);
+    }
+    current_ = SlowLogEntry();
+    have_header_ = false;
+}
+
+void SlowLogReader::feedLine(const char* data, size_t len, const EntryCallback& on_entry) {
+    if (len == 0) return;
+
+    if (data[0] == '#') {
+        // "# Time:" and "# User@Host:" open a new entry; "# Query_time:" carries its metrics
+        bool opens_entry = startsWith(data, len, "# Time:") || startsWith(data, len, "# User@Host:");
+        bool metrics = startsWith(data, len, "# Query_time:");
+        if ((opens_entry || metrics) && !current_.sql.empty()) flush(on_entry);
+        if (metrics) {
+            std::string line(data, len);
+            double v = 0;
+            headerField(line, "Query_time:", current_.query_time);
+            headerField(line, "Lock_time:", current_.lock_time);
+            if (headerField(line, "Rows_sent:", v)) current_.rows_sent = static_cast<uint64_t>(v);
+            if (headerField(line, "Rows_examined:", v)) current_.rows_examined = static_cast<uint64_t>(v);
+            have_header_ = true;
+        }
+        return;
+    }
+
+    // Server banner repeated at every restart
+    if (startsWith(data, len, "Tcp port:") || startsWith(data, len, "Time ") ||
+        (data[0] == '/' && std::string(data, len).find(", Version:") != std::string::npos)) {
+        return;
+    }
+
+    if (current_.sql.empty()) {
+        std::string line = to_lower(std::string(data, std::min<size_t>(len, 64)));
+        if (line.rfind("set timestamp=", 0) == 0) return;
+        if (line.rfind("use ", 0) == 0) {
+            std::string db = trim(std::string(data + 4, len - 4));
+            while (!db.empty() && (db.back() == ';' || db.back() == '`')) db.pop_back();
+            if (!db.empty() && db.front() == '`') db.erase(0, 1);
+            database_ = db;
+            return;
+        }
+    }
+
+    if (!current_.sql.empty()) current_.sql += '\n';
+    current_.sql.append(data, len);
+}
+
+void SlowLogReader::finish(const EntryCallback& on_entry) {
+    flush(on_entry);
+}
+
+bool SlowLogReader::read(const std::string& path, const EntryCallback& on_entry, std::string& error) {
+    auto on_line = [&](const char* data, size_t len) { feedLine(data, len, on_entry); };
+
+    int fd = path == "-" ? STDIN_FILENO : ::open(path.c_str(), O_RDONLY);
+    if (fd < 0) {
+        error = "Cannot open slow log: " + path;
+        return false;
+    }
+
+    struct stat st;
+    bool mapped = false;
+    if (fd != STDIN_FILENO && ::fstat(fd, &st) == 0 && S_ISREG(st.st_mode) && st.st_size > 0) {
+        size_t size = static_cast<size_t>(st.st_size);
+        void* addr = ::mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (addr != MAP_FAILED) {
+            ::madvise(addr, size, MADV_SEQUENTIAL);
+            const char* data = static_cast<const char*>(addr);
+            size_t used = forEachLine(data, size, on_line);
+            if (used < size) on_line(data + used, size - used);
+            ::munmap(addr, size);
+            mapped = true;
+        }
+    }
+
+    if (!mapped) {
+        // Buffered fallback: carry the partial last line over to the next chunk
+        std::vector<char> buf(1 << 20);
+        size_t filled = 0;
+        while (true) {
+            if (filled == buf.size()) buf.resize(buf.size() * 2);  // a line longer than the buffer
+            ssize_t n = ::read(fd, buf.data() + filled, buf.size() - filled);
+            if (n < 0) {
+                error = "Error reading slow log: " + path;
+                if (fd != STDIN_FILENO) ::close(fd);
+                return false;
+            }
+            if (n == 0) break;
+            filled += static_cast<size_t>(n);
+            size_t used = forEachLine(buf.data(), filled, on_line);
+            std::memmove(buf.data(), buf.data() + used, filled - used);
+            filled -= used;
+        }
+        if (filled > 0) on_line(buf.data(), filled);
+    }
+
+    if (fd != STDIN_FILENO) ::close(fd);
+    finish(on_entry);
+    return true;
+}
+
+bool aggregate_slow_log(const std::string& path, std::unordered_map<std::string, SlowLogDigest>& digests,
+                        std::string& error) {
+    SlowLogReader reader;
+    return reader.read(path, [&](const SlowLogEntry& e) {
+        std::string fp = fingerprint_query(e.sql);
+        SlowLogDigest& d = digests[fp];
+        if (d.count == 0) d.fingerprint = fp;
+        ++d.count;
+        d.total_query_time += e.query_time;
+        d.total_rows_examined += e.rows_examined;
+        if (d.sample_sql.empty() || e.query_time > d.max_query_time) {
+            d.max_query_time = e.query_time;
+            d.sample_sql = e.sql;
+        }
+    }, error);
+}
+
+std::vector<SlowLogRewrite> rank_slow_log_rewrites(const std::unordered_map<std::string, SlowLogDigest>& digests,
+                                                   std::shared_ptr<StatisticsManager> stats_mgr, size_t top_n) {
+    std::vector<const SlowLogDigest*> by_time;
+    by_time.reserve(digests.size());
+    for (const auto& kv : digests) by_time.push_back(&kv.second);
+    std::sort(by_time.begin(), by_time.end(), [](const SlowLogDigest* a, const SlowLogDigest* b) {
+        return a->total_query_time > b->total_query_time;
+    });
+    if (by_time.size() > top_n) by_time.resize(top_n);
+
+    std::vector<SlowLogRewrite> ranked;
+    Optimizer opt(stats_mgr);
+    for (const SlowLogDigest* d : by_time) {
+        SlowLogRewrite r;
+        r.digest = *d;
+
+        Lexer lexer(d->sample_sql);
+        Parser parser(lexer.tokenize());
+        Query q;
+        ParseError err;
+        if (!parser.parse_query(q, err)) {
+            r.note = "parse error: " + err.message;
+        } else if (!std::holds_alternative<SelectQuery>(q)) {
+            r.note = "not a SELECT";
+        } else {
+            try {
+                auto res = opt.optimize(std::move(std::get<SelectQuery>(q)));
+                r.optimized = true;
+                r.rewritten_sql = res.rewritten_sql;
+                r.original_cost = res.original_cost;
+                r.optimized_cost = res.plan.getCost();
+                double reduction = std::max(0.0, r.original_cost - r.optimized_cost);
+                r.expected_savings = d->count * reduction;
+                if (r.original_cost > 0) r.reclaimed_seconds = d->total_query_time * reduction / r.original_cost;
+            } catch (const std::exception& e) {
+                r.note = std::string("optimizer error: ") + e.what();
+            }
+        }
+        ranked.push_back(std::move(r));
+    }
+
+    std::stable_sort(ranked.begin(), ranked.end(), [](const SlowLogRewrite& a, const SlowLogRewrite& b) {
+        if (a.expected_savings != b.expected_savings) return a.expected_savings > b.expected_savings;
+        return a.digest.total_query_time > b.digest.total_query_time;
+    });
+    return ranked;
+}
+
+} // namespace sqlopt
@@ -1,251 +1,718 @@
 #include "statistics_manager.h"
+#include "stats.h"
+#include "column_store.h"
+#include "async_mysql.h"
+#include "utils.h"
 #include <iostream>
 #include <algorithm>
 #include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <map>
+#include <unordered_map>
 #include <mysql/mysql.h> 
 
 namespace sqlopt {
 
+namespace {
+
+// The statements of a statistics crawl, and readers of their result sets shared by
+// the blocking and the asynchronous crawl
+
+std::string countSql(const std::string& table) { return "SELECT COUNT(*) FROM `" + table + "`"; }
+std::string describeSql(const std::string& table) { return "DESCRIBE `" + table + "`"; }
+std::string indexSql(const std::string& table) { return "SHOW INDEX FROM `" + table + "`"; }
+
+std::string distinctSql(const std::string& table, const std::string& col) {
+    return "SELECT COUNT(DISTINCT `" + col + "`) FROM `" + table + "`";
+}
+
+std::string minMaxSql(const std::string& table, const std::string& col) {
+    return "SELECT MIN(`" + col + "`), MAX(`" + col + "`) FROM `" + table + "`";
+}
+
+std::string commonValuesSql(const std::string& table, const std::string& col) {
+    return "SELECT `" + col + "`, COUNT(*) FROM `" + table + "` GROUP BY `" + col + "` ORDER BY COUNT(*) DESC LIMIT 10";
+}
+
+// Single-column foreign keys (composite keys are not used by the optimizer)
+const char* const FOREIGN_KEYS_SQL =
+    "SELECT TABLE_NAME, COLUMN_NAME, REFERENCED_TABLE_NAME, REFERENCED_COLUMN_NAME, CONSTRAINT_NAME "
+    "FROM information_schema.KEY_COLUMN_USAGE "
+    "WHERE TABLE_SCHEMA = DATABASE() AND REFERENCED_TABLE_NAME IS NOT NULL "
+    "ORDER BY TABLE_NAME, CONSTRAINT_NAME, ORDINAL_POSITION";
+
+// Runs sql and hands its result set to read; false when the statement failed
+template <typename F>
+bool queryRows(MYSQL* conn, const std::string& sql, F&& read) {
+    if (mysql_query(conn, sql.c_str()) != 0) return false;
+    MYSQL_RES* res = mysql_store_result(conn);
+    if (res) {
+        read(res);
+        mysql_free_result(res);
+    }
+    return true;
+}
+
+std::vector<std::string> readNames(MYSQL_RES* res) {
+    std::vector<std::string> names;
+    while (MYSQL_ROW row = mysql_fetch_row(res)) {
+        if (row[0]) names.push_back(row[0]);
+    }
+    return names;
+}
+
+size_t readCount(MYSQL_RES* res) {
+    MYSQL_ROW row = mysql_fetch_row(res);
+    return row && row[0] ? std::stoull(row[0]) : 0;
+}
+
+// DESCRIBE: the columns in table order, named and with their nullability
+std::vector<ColumnStats> readColumns(MYSQL_RES* res) {
+    std::vector<ColumnStats> columns;
+    while (MYSQL_ROW row = mysql_fetch_row(res)) {
+        ColumnStats cs;
+        cs.column_name = row[0];
+        cs.nullable = !(row[2] && std::string(row[2]) == "NO");
+        columns.push_back(std::move(cs));
+    }
+    return columns;
+}
+
+void setDistinct(ColumnStats& cs, size_t distinct, size_t row_count) {
+    cs.distinct_values = distinct;
+    if (row_count > 0) cs.selectivity = std::min(1.0, static_cast<double>(distinct) / row_count);
+}
+
+void readMinMax(MYSQL_RES* res, ColumnStats& cs) {
+    MYSQL_ROW row = mysql_fetch_row(res);
+    if (!row) return;
+    if (row[0]) cs.min_value = StatValue::fromText(row[0]);
+    if (row[1]) cs.max_value = StatValue::fromText(row[1]);
+}
+
+// Most common values are only collected for columns with few distinct values
+bool wantsCommonValues(const ColumnStats& cs) { return cs.distinct_values > 0 && cs.distinct_values <= 1000; }
+
+void readCommonValues(MYSQL_RES* res, size_t row_count, std::vector<CommonValue>& common) {
+    while (MYSQL_ROW row = mysql_fetch_row(res)) {
+        if (row[0] && row[1]) common.push_back({to_lower(row[0]), std::stod(row[1]) / row_count});
+    }
+}
+
+void readIndexes(MYSQL_RES* res, TableStatistics& ts) {
+    std::map<std::string, IndexInfo> indexes;
+    while (MYSQL_ROW row = mysql_fetch_row(res)) {
+        std::string idx_name = row[2];
+        std::string col_name = row[4];
+        bool is_unique = (row[1] && std::string(row[1]) == "0");
+
+        if (indexes.find(idx_name) == indexes.end()) {
+            indexes[idx_name] = {idx_name, {col_name}, is_unique, 0};
+        } else {
+            indexes[idx_name].columns.push_back(col_name);
+        }
+    }
+    for (auto& idx : indexes) ts.available_indexes.push_back(idx.second);
+}
+
+// (table, key) of every single-column foreign key
+std::vector<std::pair<std::string, ForeignKeyInfo>> readForeignKeys(MYSQL_RES* res) {
+    std::map<std::pair<std::string, std::string>, std::vector<ForeignKeyInfo>> constraints;
+    while (MYSQL_ROW row = mysql_fetch_row(res)) {
+        if (!row[0] || !row[1] || !row[2] || !row[3] || !row[4]) continue;
+        constraints[{row[0], row[4]}].push_back({row[1], row[2], row[3]});
+    }
+    std::vector<std::pair<std::string, ForeignKeyInfo>> keys;
+    for (const auto& kv : constraints) {
+        if (kv.second.size() == 1) keys.push_back({kv.first.first, kv.second[0]});
+    }
+    return keys;
+}
+
+} // namespace
+
+void StatisticsManager::addForeignKeys(const std::vector<std::pair<std::string, ForeignKeyInfo>>& keys) {
+    for (const auto& key : keys) {
+        TableId id = tableId(key.first);
+        if (id != INVALID_ID) tables_[id].foreign_keys.push_back(key.second);
+    }
+}
+
 void StatisticsManager::loadFromDatabase(void* mysql_conn, const std::string& db_name [[maybe_unused]]) {
     MYSQL* conn = static_cast<MYSQL*>(mysql_conn);
     if (!conn) return;
 
     // Get list of tables
-    std::string query = "SHOW TABLES";
-    if (mysql_query(conn, query.c_str()) != 0) {
+    std::vector<std::string> tables;
+    if (!queryRows(conn, "SHOW TABLES", [&](MYSQL_RES* res) { tables = readNames(res); })) {
         std::cerr << "Failed to get tables: " << mysql_error(conn) << std::endl;
         return;
     }
 
-    MYSQL_RES* res = mysql_store_result(conn);
-    MYSQL_ROW row;
-    std::vector<std::string> tables;
-
-    while ((row = mysql_fetch_row(res))) {
-        tables.push_back(row[0]);
-    }
-    mysql_free_result(res);
-
     // Load statistics for each table
     for (const auto& table : tables) {
         TableStatistics ts;
         ts.table_name = table;
+        queryRows(conn, countSql(table), [&](MYSQL_RES* res) { ts.row_count = readCount(res); });
 
-        // Get row count
-        query = "SELECT COUNT(*) FROM `" + table + "`";
-        if (mysql_query(conn, query.c_str()) == 0) {
-            MYSQL_RES* count_res = mysql_store_result(conn);
-            MYSQL_ROW count_row = mysql_fetch_row(count_res);
-            if (count_row) {
-                ts.row_count = std::stoull(count_row[0]);
+        // Estimate page count (rough estimate: 100 rows per page)
+        ts.page_count = (ts.row_count + 99) / 100;
+
+        std::vector<ColumnStats> columns;
+        queryRows(conn, describeSql(table), [&](MYSQL_RES* res) { columns = readColumns(res); });
+        for (auto& cs : columns) {
+            std::vector<CommonValue> common;
+            queryRows(conn, distinctSql(table, cs.column_name),
+                      [&](MYSQL_RES* res) { setDistinct(cs, readCount(res), ts.row_count); });
+            queryRows(conn, minMaxSql(table, cs.column_name), [&](MYSQL_RES* res) { readMinMax(res, cs); });
+            if (wantsCommonValues(cs)) {
+                queryRows(conn, commonValuesSql(table, cs.column_name),
+                          [&](MYSQL_RES* res) { readCommonValues(res, ts.row_count, common); });
             }
-            mysql_free_result(count_res);
+            ts.setColumn(std::move(cs), common);
         }
 
-        // Estimate page count (rough estimate: 100 rows per page)
-        ts.page_count = (ts.row_count + 99) / 100;
+        queryRows(conn, indexSql(table), [&](MYSQL_RES* res) { readIndexes(res, ts); });
+        storeTable(table, std::move(ts));
+    }
 
-        // Get columns
-        query = "DESCRIBE `" + table + "`";
-        if (mysql_query(conn, query.c_str()) == 0) {
-            MYSQL_RES* desc_res = mysql_store_result(conn);
-            MYSQL_ROW desc_row;
-            std::vector<std::string> columns;
+    std::vector<std::pair<std::string, ForeignKeyInfo>> keys;
+    queryRows(conn, FOREIGN_KEYS_SQL, [&](MYSQL_RES* res) { keys = readForeignKeys(res); });
+    addForeignKeys(keys);
+}
 
-            while ((desc_row = mysql_fetch_row(desc_res))) {
-                columns.push_back(desc_row[0]);
-            }
-            mysql_free_result(desc_res);
-
-            // Load column statistics
-            for (const auto& col : columns) {
-                ColumnStats cs;
-                cs.column_name = col;
-
-                // Get distinct values
-                query = "SELECT COUNT(DISTINCT `" + col + "`) FROM `" + table + "`";
-                if (mysql_query(conn, query.c_str()) == 0) {
-                    MYSQL_RES* dist_res = mysql_store_result(conn);
-                    MYSQL_ROW dist_row = mysql_fetch_row(dist_res);
-                    if (dist_row) {
-                        cs.distinct_values = std::stoull(dist_row[0]);
-                    }
-                    mysql_free_result(dist_res);
-                }
+void StatisticsManager::loadFromDatabase(AsyncMySQL& mysql) {
+    // A table while its statements are out; completions fill it in any order
+    struct Crawl {
+        TableStatistics ts;
+        std::vector<ColumnStats> columns;
+        std::vector<std::vector<CommonValue>> common;
+        int shape_pending = 2; // COUNT(*) and DESCRIBE, which the column statements need
+    };
+    std::vector<std::unique_ptr<Crawl>> crawls; // stable addresses for the completions
+    std::vector<std::pair<std::string, ForeignKeyInfo>> keys;
+
+    auto crawlColumns = [&mysql](Crawl& t) {
+        const std::string& table = t.ts.table_name;
+        t.common.resize(t.columns.size());
+        for (size_t i = 0; i < t.columns.size(); ++i) {
+            const std::string& col = t.columns[i].column_name;
+            mysql.submit(distinctSql(table, col), [&mysql, &t, i](const AsyncResult& r) {
+                if (!r.result) return;
+                ColumnStats& cs = t.columns[i];
+                setDistinct(cs, readCount(r.result), t.ts.row_count);
+                if (!wantsCommonValues(cs)) return;
+                mysql.submit(commonValuesSql(t.ts.table_name, cs.column_name), [&t, i](const AsyncResult& values) {
+                    if (values.result) readCommonValues(values.result, t.ts.row_count, t.common[i]);
+                });
+            });
+            mysql.submit(minMaxSql(table, col), [&t, i](const AsyncResult& r) {
+                if (r.result) readMinMax(r.result, t.columns[i]);
+            });
+        }
+    };
 
-                // Get min/max values
-                query = "SELECT MIN(`" + col + "`), MAX(`" + col + "`) FROM `" + table + "`";
-                if (mysql_query(conn, query.c_str()) == 0) {
-                    MYSQL_RES* mm_res = mysql_store_result(conn);
-                    MYSQL_ROW mm_row = mysql_fetch_row(mm_res);
-                    if (mm_row) {
-                        cs.min_value = mm_row[0] ? mm_row[0] : "";
-                        cs.max_value = mm_row[1] ? mm_row[1] : "";
-                    }
-                    mysql_free_result(mm_res);
-                }
+    mysql.submit("SHOW TABLES", [&](const AsyncResult& r) {
+        if (!r.success) {
+            std::cerr << "Failed to get tables: " << r.error_message << std::endl;
+            return;
+        }
+        if (!r.result) return;
+        for (const auto& table : readNames(r.result)) {
+            crawls.push_back(std::make_unique<Crawl>());
+            Crawl& t = *crawls.back();
+            t.ts.table_name = table;
+            auto shapeKnown = [&t, crawlColumns] {
+                if (--t.shape_pending == 0) crawlColumns(t);
+            };
+            mysql.submit(countSql(table), [&t, shapeKnown](const AsyncResult& r) {
+                if (r.result) t.ts.row_count = readCount(r.result);
+                t.ts.page_count = (t.ts.row_count + 99) / 100;
+                shapeKnown();
+            });
+            mysql.submit(describeSql(table), [&t, shapeKnown](const AsyncResult& r) {
+                if (r.result) t.columns = readColumns(r.result);
+                shapeKnown();
+            });
+            mysql.submit(indexSql(table), [&t](const AsyncResult& r) {
+                if (r.result) readIndexes(r.result, t.ts);
+            });
+        }
+    });
+    mysql.submit(FOREIGN_KEYS_SQL, [&keys](const AsyncResult& r) {
+        if (r.result) keys = readForeignKeys(r.result);
+    });
+    mysql.run();
+
+    // Stored in SHOW TABLES order, as the blocking crawl does, so table ids match it
+    for (auto& t : crawls) {
+        for (size_t i = 0; i < t->columns.size(); ++i) t->ts.setColumn(std::move(t->columns[i]), t->common[i]);
+        std::string table = t->ts.table_name;
+        storeTable(table, std::move(t->ts));
+    }
+    addForeignKeys(keys);
+}
 
-                // Calculate selectivity
-                if (ts.row_count > 0) {
-                    cs.selectivity = static_cast<double>(cs.distinct_values) / ts.row_count;
-                    if (cs.selectivity > 1.0) cs.selectivity = 1.0;
-                }
+void StatisticsManager::loadFromCatalog(const StatsCatalog& catalog) {
+    for (const auto& kv : catalog.tables) {
+        const sqlopt::TableStats& t = kv.second;
+        TableStatistics ts;
+        ts.table_name = t.name;
+        ts.row_count = static_cast<size_t>(t.row_count);
+        ts.page_count = (ts.row_count + 99) / 100;
 
-                // Build histogram (sample values)
-                if (cs.distinct_values > 0 && cs.distinct_values <= 1000) {
-                    query = "SELECT `" + col + "`, COUNT(*) FROM `" + table +
-                           "` GROUP BY `" + col + "` ORDER BY COUNT(*) DESC LIMIT 10";
-                    if (mysql_query(conn, query.c_str()) == 0) {
-                        MYSQL_RES* hist_res = mysql_store_result(conn);
-                        MYSQL_ROW hist_row;
-                        while ((hist_row = mysql_fetch_row(hist_res))) {
-                            if (hist_row[0] && hist_row[1]) {
-                                double freq = std::stod(hist_row[1]);
-                                cs.histogram.emplace_back(hist_row[0], freq / ts.row_count);
-                            }
-                        }
-                        mysql_free_result(hist_res);
-                    }
-                }
+        for (const auto& dv : t.distinct_vals) {
+            ColumnStats cs;
+            cs.column_name = dv.first;
+            cs.distinct_values = static_cast<size_t>(dv.second);
+            if (ts.row_count > 0) cs.selectivity = std::min(1.0, static_cast<double>(dv.second) / ts.row_count);
+            ts.setColumn(std::move(cs));
+        }
 
-                ts.column_stats[col] = cs;
-            }
+        // The catalog has no index metadata beyond columns; a single column with
+        // one distinct value per row is treated as a unique key
+        for (const auto& cols : t.indexes) {
+            if (cols.empty()) continue;
+            IndexInfo idx;
+            idx.index_name = "idx_" + t.name + "_" + cols[0];
+            idx.columns = cols;
+            auto it = t.distinct_vals.find(cols[0]);
+            idx.is_unique = cols.size() == 1 && it != t.distinct_vals.end() &&
+                            static_cast<size_t>(it->second) == ts.row_count;
+            idx.cardinality = it != t.distinct_vals.end() ? static_cast<size_t>(it->second) : 0;
+            ts.available_indexes.push_back(idx);
         }
 
-        // Get indexes
-        query = "SHOW INDEX FROM `" + table + "`";
-        if (mysql_query(conn, query.c_str()) == 0) {
-            MYSQL_RES* idx_res = mysql_store_result(conn);
-            MYSQL_ROW idx_row;
-            std::map<std::string, IndexInfo> indexes;
+        storeTable(t.name, std::move(ts));
+    }
+}
 
-            while ((idx_row = mysql_fetch_row(idx_res))) {
-                std::string idx_name = idx_row[2];
-                std::string col_name = idx_row[4];
-                bool is_unique = (idx_row[1] && std::string(idx_row[1]) == "0");
+void StatisticsManager::loadFromColumnStore(const ColumnStore& store) {
+    for (const auto& name : store.tableNames()) {
+        const ColumnTable* table = store.table(name);
+        TableStatistics ts;
+        if (const TableStatistics* known = getTableStatsCI(table->name)) {
+            ts.table_name = known->table_name;
+            ts.available_indexes = known->available_indexes;
+            ts.foreign_keys = known->foreign_keys;
+        } else {
+            ts.table_name = table->name;
+        }
+        ts.row_count = table->row_count;
+        ts.page_count = (ts.row_count + 99) / 100;
 
-                if (indexes.find(idx_name) == indexes.end()) {
-                    indexes[idx_name] = {idx_name, {col_name}, is_unique, 0};
+        for (const auto& column : table->columns) {
+            // Values in the text form MySQL reports them in; strings compare
+            // case-insensitively, so they are counted folded
+            auto text = [&](RowId row) -> std::string {
+                switch (column.type()) {
+                    case ColumnType::STRING: return std::string(column.stringAt(row));
+                    case ColumnType::DATE: return format_date(static_cast<int64_t>(column.numberAt(row)));
+                    case ColumnType::INT: return std::to_string(static_cast<long long>(column.numberAt(row)));
+                    case ColumnType::DOUBLE: {
+                        char buffer[32];
+                        std::snprintf(buffer, sizeof(buffer), "%.15g", column.numberAt(row));
+                        return buffer;
+                    }
+                }
+                return "";
+            };
+            std::unordered_map<std::string, size_t> counts;
+            RowId min_row = NULL_ROW, max_row = NULL_ROW;
+            size_t nulls = 0;
+            for (RowId row = 0; row < table->row_count; ++row) {
+                if (column.isNull(row)) {
+                    ++nulls;
+                    continue;
+                }
+                std::string value = text(row);
+                if (column.type() == ColumnType::STRING) value = to_lower(value);
+                ++counts[value];
+                bool less, greater;
+                if (column.type() == ColumnType::STRING) {
+                    less = min_row == NULL_ROW || compare_nocase(column.stringAt(row), column.stringAt(min_row)) < 0;
+                    greater = max_row == NULL_ROW || compare_nocase(column.stringAt(row), column.stringAt(max_row)) > 0;
                 } else {
-                    indexes[idx_name].columns.push_back(col_name);
+                    less = min_row == NULL_ROW || column.numberAt(row) < column.numberAt(min_row);
+                    greater = max_row == NULL_ROW || column.numberAt(row) > column.numberAt(max_row);
                 }
+                if (less) min_row = row;
+                if (greater) max_row = row;
             }
-            mysql_free_result(idx_res);
 
-            for (auto& idx : indexes) {
-                ts.available_indexes.push_back(idx.second);
+            ColumnStats cs;
+            cs.column_name = column.name();
+            cs.distinct_values = counts.size();
+            if (min_row != NULL_ROW) {
+                bool numeric = column.type() == ColumnType::INT || column.type() == ColumnType::DOUBLE;
+                cs.min_value = numeric ? StatValue::fromNumber(column.numberAt(min_row)) : StatValue::fromText(text(min_row));
+                cs.max_value = numeric ? StatValue::fromNumber(column.numberAt(max_row)) : StatValue::fromText(text(max_row));
             }
+            cs.nullable = nulls > 0;
+            if (ts.row_count > 0) cs.selectivity = std::min(1.0, static_cast<double>(counts.size()) / ts.row_count);
+
+            // Most common values, as loadFromDatabase collects them
+            std::vector<CommonValue> most_common;
+            if (!counts.empty() && counts.size() <= 1000 && ts.row_count > 0) {
+                std::vector<std::pair<std::string, size_t>> common(counts.begin(), counts.end());
+                std::sort(common.begin(), common.end(), [](const auto& a, const auto& b) {
+                    return a.second != b.second ? a.second > b.second : a.first < b.first;
+                });
+                if (common.size() > HISTOGRAM_BUCKETS) common.resize(HISTOGRAM_BUCKETS);
+                for (const auto& value : common) {
+                    most_common.push_back({value.first, static_cast<double>(value.second) / ts.row_count});
+                }
+            }
+            ts.setColumn(std::move(cs), most_common);
         }
+        std::string table_name = ts.table_name;
+        storeTable(table_name, std::move(ts));
+    }
+}
 
-        table_stats_[table] = ts;
+StatValue StatValue::fromText(const std::string& text) {
+    StatValue v;
+    char* end = nullptr;
+    double number = text.empty() ? 0.0 : std::strtod(text.c_str(), &end);
+    if (!text.empty() && end == text.c_str() + text.size()) {
+        v.kind = Kind::NUMBER;
+        v.number = number;
+    } else {
+        v.kind = Kind::TEXT;
+        v.text = text;
     }
+    return v;
+}
+
+StatValue StatValue::fromNumber(double number) {
+    StatValue v;
+    v.kind = Kind::NUMBER;
+    v.number = number;
+    return v;
+}
+
+std::string StatValue::toString() const {
+    if (kind == Kind::TEXT) return text;
+    if (kind == Kind::NONE) return "";
+    char buffer[32];
+    std::snprintf(buffer, sizeof(buffer), "%.15g", number);
+    return buffer;
+}
+
+namespace {
+
+// Gives the column a run of slots at the end of the table's common values
+void appendCommonValues(TableStatistics& table, ColumnStats& column, const std::vector<CommonValue>& common) {
+    column.common_first = static_cast<uint32_t>(table.common_values.size());
+    column.common_count = static_cast<uint32_t>(common.size());
+    for (const auto& c : common) {
+        CommonValueSlot slot;
+        slot.offset = static_cast<uint32_t>(table.common_text.size());
+        slot.length = static_cast<uint32_t>(c.value.size());
+        slot.frequency = c.frequency;
+        table.common_values.push_back(slot);
+        table.common_text += c.value;
+    }
+}
+
+} // namespace
+
+ColumnId TableStatistics::setColumn(ColumnStats column, const std::vector<CommonValue>& common) {
+    size_t id = 0;
+    while (id < columns.size() && columns[id].column_name != column.column_name) ++id;
+    if (id == columns.size()) {
+        appendCommonValues(*this, column, common);
+        columns.push_back(std::move(column));
+        return static_cast<ColumnId>(id);
+    }
+
+    // Replacing a column is rare: lay every run out again, the new one in its place
+    std::vector<std::vector<CommonValue>> lists;
+    for (size_t c = 0; c < columns.size(); ++c) lists.push_back(c == id ? common : commonValueList(columns[c]));
+    common_values.clear();
+    common_text.clear();
+    columns[id] = std::move(column);
+    for (size_t c = 0; c < columns.size(); ++c) appendCommonValues(*this, columns[c], lists[c]);
+    return static_cast<ColumnId>(id);
+}
+
+std::vector<CommonValue> TableStatistics::commonValueList(const ColumnStats& column) const {
+    std::vector<CommonValue> list;
+    for (const auto& c : commonValues(column)) list.push_back({std::string(c.value), c.frequency});
+    return list;
+}
+
+const ColumnStats* TableStatistics::column(const std::string& name) const {
+    for (const auto& c : columns) {
+        if (c.column_name == name) return &c;
+    }
+    return nullptr;
+}
+
+TableStatistics& StatisticsManager::storeTable(const std::string& table_name, TableStatistics stats) {
+    TableId id = table_ids_.intern(table_name);
+    if (id == tables_.size()) {
+        tables_.emplace_back();
+    } else {
+        // Columns the new statistics no longer have must stop resolving
+        for (const auto& c : tables_[id].columns) {
+            uint32_t name = column_names_.find(c.column_name);
+            if (name != INVALID_ID) column_ids_.set(IdMap::key(id, name), INVALID_ID);
+            uint32_t folded = folded_columns_.find(c.column_name);
+            if (folded != INVALID_ID) folded_column_ids_.set(IdMap::key(id, folded), INVALID_ID);
+        }
+    }
+    uint32_t folded_table = folded_tables_.intern(table_name);
+    if (folded_table == folded_table_ids_.size()) folded_table_ids_.push_back(id);
+    TableStatistics& ts = tables_[id];
+    ts = std::move(stats);
+    ts.id = id;
+    ts.columns.shrink_to_fit();
+    ts.common_values.shrink_to_fit();
+    ts.common_text.shrink_to_fit();
+    ts.available_indexes.shrink_to_fit();
+    for (size_t c = 0; c < ts.columns.size(); ++c) {
+        const std::string& name = ts.columns[c].column_name;
+        column_ids_.set(IdMap::key(id, column_names_.intern(name)), static_cast<ColumnId>(c));
+        uint64_t folded = IdMap::key(id, folded_columns_.intern(name));
+        if (folded_column_ids_.find(folded) == INVALID_ID) folded_column_ids_.set(folded, static_cast<ColumnId>(c));
+    }
+    return ts;
 }
 
 const TableStatistics* StatisticsManager::getTableStats(const std::string& table_name) const {
-    auto it = table_stats_.find(table_name);
-    return it != table_stats_.end() ? &it->second : nullptr;
+    TableId id = tableId(table_name);
+    return id != INVALID_ID ? &tables_[id] : nullptr;
+}
+
+TableId StatisticsManager::tableIdCI(const std::string& table_name) const {
+    TableId id = tableId(table_name);
+    if (id != INVALID_ID) return id;
+    uint32_t folded = folded_tables_.find(table_name);
+    return folded != INVALID_ID ? folded_table_ids_[folded] : INVALID_ID;
 }
 
 const TableStatistics* StatisticsManager::getTableStatsCI(const std::string& table_name) const {
-    // exact match first
-    auto it = table_stats_.find(table_name);
-    if (it != table_stats_.end()) return &it->second;
-    // case-insensitive search
-    std::string target = table_name;
-    std::transform(target.begin(), target.end(), target.begin(), [](unsigned char c){ return std::tolower(c); });
-    for (const auto& kv : table_stats_) {
-        std::string key = kv.first;
-        std::transform(key.begin(), key.end(), key.begin(), [](unsigned char c){ return std::tolower(c); });
-        if (key == target) return &kv.second;
+    TableId id = tableIdCI(table_name);
+    return id != INVALID_ID ? &tables_[id] : nullptr;
+}
+
+std::string StatisticsManager::resolveTableNameCI(const std::string& table_name) const {
+    TableId id = tableIdCI(table_name);
+    return id != INVALID_ID ? table_ids_.name(id) : table_name;
+}
+
+ColumnId StatisticsManager::columnId(TableId table, const std::string& column) const {
+    uint32_t name = column_names_.find(column);
+    return name != INVALID_ID ? column_ids_.find(IdMap::key(table, name)) : INVALID_ID;
+}
+
+ColumnId StatisticsManager::columnIdCI(TableId table, const std::string& column) const {
+    ColumnId id = columnId(table, column);
+    if (id != INVALID_ID) return id;
+    uint32_t folded = folded_columns_.find(column);
+    return folded != INVALID_ID ? folded_column_ids_.find(IdMap::key(table, folded)) : INVALID_ID;
+}
+
+const ColumnStats* StatisticsManager::findColumnCI(const TableStatistics& table, const std::string& column) const {
+    // Tables the manager holds resolve by id; copies being edited scan
+    if (table.id < tables_.size() && &tables_[table.id] == &table) {
+        ColumnId id = columnIdCI(table.id, column);
+        return id != INVALID_ID ? &table.columns[id] : nullptr;
+    }
+    if (const ColumnStats* cs = table.column(column)) return cs;
+    std::string target = to_lower(column);
+    for (const auto& c : table.columns) {
+        if (to_lower(c.column_name) == target) return &c;
     }
     return nullptr;
 }
 
-std::string StatisticsManager::resolveTableNameCI(const std::string& table_name) const {
-    auto it = table_stats_.find(table_name);
-    if (it != table_stats_.end()) return it->first;
-    std::string target = table_name;
-    std::transform(target.begin(), target.end(), target.begin(), [](unsigned char c){ return std::tolower(c); });
-    for (const auto& kv : table_stats_) {
-        std::string key = kv.first;
-        std::transform(key.begin(), key.end(), key.begin(), [](unsigned char c){ return std::tolower(c); });
-        if (key == target) return kv.first;
+namespace {
+
+size_t heapBytes(const std::string& s) {
+    return s.capacity() > std::string().capacity() ? s.capacity() + 1 : 0;
+}
+
+} // namespace
+
+size_t StatisticsManager::memoryBytes() const {
+    size_t bytes = tables_.size() * sizeof(TableStatistics) + table_ids_.memoryBytes() +
+                   column_names_.memoryBytes() + column_ids_.memoryBytes() + folded_tables_.memoryBytes() +
+                   folded_table_ids_.capacity() * sizeof(TableId) + folded_columns_.memoryBytes() +
+                   folded_column_ids_.memoryBytes();
+    for (const auto& ts : tables_) {
+        bytes += heapBytes(ts.table_name) + ts.columns.capacity() * sizeof(ColumnStats) +
+                 ts.common_values.capacity() * sizeof(CommonValueSlot) + heapBytes(ts.common_text) +
+                 ts.available_indexes.capacity() * sizeof(IndexInfo) +
+                 ts.foreign_keys.capacity() * sizeof(ForeignKeyInfo);
+        for (const auto& c : ts.columns) {
+            bytes += heapBytes(c.column_name) + heapBytes(c.min_value.text) + heapBytes(c.max_value.text);
+        }
+        for (const auto& idx : ts.available_indexes) {
+            bytes += heapBytes(idx.index_name) + idx.columns.capacity() * sizeof(std::string);
+            for (const auto& c : idx.columns) bytes += heapBytes(c);
+        }
+        for (const auto& fk : ts.foreign_keys) {
+            bytes += heapBytes(fk.column) + heapBytes(fk.referenced_table) + heapBytes(fk.referenced_column);
+        }
     }
-    return table_name;
+    return bytes;
+}
+
+namespace {
+
+// A literal as a number, when all of it is one
+bool parseNumber(const std::string& text, double& out) {
+    if (text.empty()) return false;
+    char* end = nullptr;
+    out = std::strtod(text.c_str(), &end);
+    return end == text.c_str() + text.size();
 }
 
+} // namespace
+
 double StatisticsManager::estimateSelectivity(const std::string& table_name, const std::string& column,
                                              const std::string& op, const std::string& value) const {
-    const TableStatistics* ts = getTableStats(table_name);
+    const TableStatistics* ts = getTableStatsCI(table_name);
     if (!ts) return 0.1; // Default selectivity
+    const ColumnStats* cs = findColumnCI(*ts, column);
+    if (!cs) return 0.1;
 
-    auto col_it = ts->column_stats.find(column);
-    if (col_it == ts->column_stats.end()) return 0.1;
-
-    const ColumnStats& cs = col_it->second;
-
-    // Use histogram if available
-    if (!cs.histogram.empty()) {
-        for (const auto& bucket : cs.histogram) {
-            if (bucket.first == value) {
-                return bucket.second;
-            }
+    if (op == "=") {
+        // A most common value has its own frequency; the other values share the
+        // remaining rows evenly
+        CommonValueRange common = ts->commonValues(*cs);
+        std::string folded = to_lower(value);
+        double mcv = 0.0;
+        for (const auto& c : common) {
+            if (c.value == folded) return c.frequency;
+            mcv += c.frequency;
         }
+        if (cs->distinct_values == 0) return common.empty() ? 0.1 : 0.0;
+        double rest_ndv = std::max(1.0, static_cast<double>(cs->distinct_values) - common.size());
+        return std::max(0.0, 1.0 - mcv) / rest_ndv;
     }
-
-    // Fallback to basic estimation
-    if (op == "=") {
-        return cs.selectivity;
-    } else if (op == ">" || op == "<" || op == ">=" || op == "<=") {
+    if (op == ">" || op == "<" || op == ">=" || op == "<=") {
+        // Numeric columns: the share of [min, max] on the matching side of the value
+        double lo = cs->min_value.number, hi = cs->max_value.number, v;
+        if (cs->min_value.isNumber() && cs->max_value.isNumber() && parseNumber(value, v) && hi > lo) {
+            double below = std::min(1.0, std::max(0.0, (v - lo) / (hi - lo)));
+            return op[0] == '<' ? below : 1.0 - below;
+        }
         return 0.3; // Assume 30% for range queries
-    } else if (op == "LIKE") {
+    }
+    if (op == "LIKE") {
         return 0.1; // Assume 10% for LIKE
     }
 
     return 0.1;
 }
 
+double StatisticsManager::estimateJoinSelectivity(const std::string& left_table, const std::string& left_column,
+                                                  const std::string& right_table, const std::string& right_column,
+                                                  size_t left_rows, size_t right_rows) const {
+    const TableStatistics* lt = getTableStatsCI(left_table);
+    const TableStatistics* rt = getTableStatsCI(right_table);
+    if (left_rows == 0 && lt) left_rows = lt->row_count;
+    if (right_rows == 0 && rt) right_rows = rt->row_count;
+    const ColumnStats* lc = lt ? findColumnCI(*lt, left_column) : nullptr;
+    const ColumnStats* rc = rt ? findColumnCI(*rt, right_column) : nullptr;
+
+    // Distinct values per side; without them a side is assumed to be a key
+    double left_ndv = lc && lc->distinct_values > 0 ? static_cast<double>(lc->distinct_values) : left_rows;
+    double right_ndv = rc && rc->distinct_values > 0 ? static_cast<double>(rc->distinct_values) : right_rows;
+    if (left_rows > 0) left_ndv = std::min(left_ndv, static_cast<double>(left_rows));
+    if (right_rows > 0) right_ndv = std::min(right_ndv, static_cast<double>(right_rows));
+    left_ndv = std::max(1.0, left_ndv);
+    right_ndv = std::max(1.0, right_ndv);
+
+    CommonValueRange left_common = lc ? lt->commonValues(*lc) : CommonValueRange();
+    CommonValueRange right_common = rc ? rt->commonValues(*rc) : CommonValueRange();
+    if (left_common.empty() || right_common.empty()) {
+        return 1.0 / std::max(left_ndv, right_ndv);
+    }
+
+    // Values in both MCV lists join with exactly the product of their frequencies
+    double match = 0.0, left_matched = 0.0, right_matched = 0.0;
+    double left_mcv = 0.0, right_mcv = 0.0;
+    for (const auto& r : right_common) right_mcv += r.frequency;
+    for (const auto& l : left_common) {
+        left_mcv += l.frequency;
+        for (const auto& r : right_common) {
+            if (l.value != r.value) continue;
+            match += l.frequency * r.frequency;
+            left_matched += l.frequency;
+            right_matched += r.frequency;
+            break;
+        }
+    }
+    left_mcv = std::min(1.0, left_mcv);
+    right_mcv = std::min(1.0, right_mcv);
+
+    // An MCV missing from the other list can only meet that side's non-MCV rows,
+    // which share its remaining distinct values evenly
+    double left_rest = 1.0 - left_mcv, right_rest = 1.0 - right_mcv;
+    double left_rest_ndv = std::max(1.0, left_ndv - left_common.size());
+    double right_rest_ndv = std::max(1.0, right_ndv - right_common.size());
+    double selectivity = match +
+        (left_mcv - left_matched) * right_rest / right_rest_ndv +
+        (right_mcv - right_matched) * left_rest / left_rest_ndv +
+        left_rest * right_rest / std::max(left_rest_ndv, right_rest_ndv);
+    return std::min(1.0, std::max(selectivity, 0.0));
+}
+
 size_t StatisticsManager::estimateRowCount(const std::string& table_name, double selectivity) const {
     const TableStatistics* ts = getTableStats(table_name);
     if (!ts) return 0;
     return static_cast<size_t>(ts->row_count * selectivity);
 }
 
-void StatisticsManager::updateTableStats(const std::string& table_name, const TableStatistics& stats) {
-    table_stats_[table_name] = stats;
+void StatisticsManager::updateTableStats(const std::string& table_name, TableStatistics stats) {
+    storeTable(table_name, std::move(stats));
 }
 
-void StatisticsManager::buildHistogram(ColumnStats& col_stats, const std::vector<std::string>& values) {
+void StatisticsManager::buildHistogram(TableStatistics& table, const std::string& column,
+                                       const std::vector<std::string>& values) {
     if (values.empty()) return;
 
     std::map<std::string, size_t> freq;
     for (const auto& val : values) {
-        freq[val]++;
+        freq[to_lower(val)]++;
     }
 
-    col_stats.histogram.clear();
+    std::vector<CommonValue> common;
     for (const auto& p : freq) {
-        col_stats.histogram.emplace_back(p.first, static_cast<double>(p.second) / values.size());
+        common.push_back({p.first, static_cast<double>(p.second) / values.size()});
     }
 
     // Sort by frequency descending
-    std::sort(col_stats.histogram.begin(), col_stats.histogram.end(),
-              [](const auto& a, const auto& b) { return a.second > b.second; });
+    std::stable_sort(common.begin(), common.end(),
+                     [](const CommonValue& a, const CommonValue& b) { return a.frequency > b.frequency; });
 
     // Keep only top buckets
-    if (col_stats.histogram.size() > HISTOGRAM_BUCKETS) {
-        col_stats.histogram.resize(HISTOGRAM_BUCKETS);
+    if (common.size() > HISTOGRAM_BUCKETS) {
+        common.resize(HISTOGRAM_BUCKETS);
     }
+
+    ColumnStats cs;
+    if (const ColumnStats* known = table.column(column)) cs = *known;
+    cs.column_name = column;
+    table.setColumn(std::move(cs), common);
 }
 
 void StatisticsManager::printStats() const {
     std::cout << "\n=== Database Statistics ===\n";
-    for (const auto& p : table_stats_) {
-        const TableStatistics& ts = p.second;
+    std::vector<TableId> by_name(tables_.size());
+    for (TableId id = 0; id < by_name.size(); ++id) by_name[id] = id;
+    std::sort(by_name.begin(), by_name.end(),
+              [&](TableId a, TableId b) { return table_ids_.name(a) < table_ids_.name(b); });
+    for (TableId id : by_name) {
+        const TableStatistics& ts = tables_[id];
         std::cout << "Table: " << ts.table_name << " (rows: " << ts.row_count << ", pages: " << ts.page_count << ")\n";
 
-        for (const auto& col_p : ts.column_stats) {
-            const ColumnStats& cs = col_p.second;
+        for (const auto& cs : ts.columns) {
             std::cout << "  Column: " << cs.column_name
                      << " (distinct: " << cs.distinct_values
                      << ", sel: " << cs.selectivity << ")\n";
@@ -0,0 +1,117 @@
+#include "symbol_table.h"
+#include <functional>
+
+namespace sqlopt {
+
+namespace {
+
+// Tables are kept at most half full, so probes stay short
+constexpr size_t MIN_SLOTS = 16;
+
+size_t mix(uint64_t key) {
+    key ^= key >> 33;
+    key *= 0xff51afd7ed558ccdULL;
+    key ^= key >> 33;
+    return static_cast<size_t>(key);
+}
+
+char foldCase(char c) { return c >= 'A' && c <= 'Z' ? static_cast<char>(c - 'A' + 'a') : c; }
+
+} // namespace
+
+size_t NameTable::hash(std::string_view name) const {
+    if (!fold_) return std::hash<std::string_view>()(name);
+    // FNV-1a over the folded bytes
+    uint64_t h = 14695981039346656037ULL;
+    for (char c : name) {
+        h ^= static_cast<unsigned char>(foldCase(c));
+        h *= 1099511628211ULL;
+    }
+    return mix(h);
+}
+
+bool NameTable::same(std::string_view a, std::string_view b) const {
+    if (!fold_) return a == b;
+    if (a.size() != b.size()) return false;
+    for (size_t i = 0; i < a.size(); ++i) {
+        if (foldCase(a[i]) != foldCase(b[i])) return false;
+    }
+    return true;
+}
+
+size_t NameTable::slotOf(std::string_view name, size_t hash) const {
+    size_t mask = slots_.size() - 1;
+    for (size_t i = hash & mask;; i = (i + 1) & mask) {
+        uint32_t id = slots_[i];
+        if (id == INVALID_ID || (hashes_[id] == hash && same(names_[id], name))) return i;
+    }
+}
+
+void NameTable::grow() {
+    slots_.assign(slots_.empty() ? MIN_SLOTS : slots_.size() * 2, INVALID_ID);
+    size_t mask = slots_.size() - 1;
+    for (uint32_t id = 0; id < names_.size(); ++id) {
+        size_t i = hashes_[id] & mask;
+        while (slots_[i] != INVALID_ID) i = (i + 1) & mask;
+        slots_[i] = id;
+    }
+}
+
+uint32_t NameTable::intern(std::string_view name) {
+    if ((names_.size() + 1) * 2 > slots_.size()) grow();
+    size_t h = hash(name);
+    size_t slot = slotOf(name, h);
+    if (slots_[slot] != INVALID_ID) return slots_[slot];
+    uint32_t id = static_cast<uint32_t>(names_.size());
+    names_.emplace_back(name);
+    hashes_.push_back(h);
+    slots_[slot] = id;
+    return id;
+}
+
+uint32_t NameTable::find(std::string_view name) const {
+    if (names_.empty()) return INVALID_ID;
+    return slots_[slotOf(name, hash(name))];
+}
+
+size_t NameTable::memoryBytes() const {
+    size_t bytes = names_.capacity() * sizeof(std::string) + hashes_.capacity() * sizeof(size_t) +
+                   slots_.capacity() * sizeof(uint32_t);
+    for (const auto& name : names_) {
+        if (name.capacity() > std::string().capacity()) bytes += name.capacity() + 1;
+    }
+    return bytes;
+}
+
+size_t IdMap::slotOf(uint64_t key) const {
+    size_t mask = slots_.size() - 1;
+    for (size_t i = mix(key) & mask;; i = (i + 1) & mask) {
+        if (!slots_[i].used || slots_[i].key == key) return i;
+    }
+}
+
+void IdMap::grow() {
+    std::vector<Slot> old = std::move(slots_);
+    slots_.assign(old.empty() ? MIN_SLOTS : old.size() * 2, Slot());
+    for (const auto& s : old) {
+        if (s.used) slots_[slotOf(s.key)] = s;
+    }
+}
+
+void IdMap::set(uint64_t key, uint32_t value) {
+    if ((used_ + 1) * 2 > slots_.size()) grow();
+    Slot& s = slots_[slotOf(key)];
+    if (!s.used) {
+        s.used = true;
+        s.key = key;
+        ++used_;
+    }
+    s.value = value;
+}
+
+uint32_t IdMap::find(uint64_t key) const {
+    if (slots_.empty()) return INVALID_ID;
+    return slots_[slotOf(key)].value;
+}
+
+} // namespace sqlopt
@@ -0,0 +1,291 @@
+// Replays a query log against MySQL at a fixed arrival rate (open loop) over N
+// connections driven from one thread, once with the original statements and once with the optimizer's
+// rewrites, and reports throughput, latency percentiles and errors per fingerprint.
+//
+// Connection settings come from MYSQL_HOST, MYSQL_USER, MYSQL_PWD and MYSQL_DB like the CLI.
+//
+//   sqlopt_replay --log test_queries.txt --qps 200 --connections 8 --duration 30
+#include "async_mysql.h"
+#include "fingerprint.h"
+#include "latency_histogram.h"
+#include "lexer.h"
+#include "optimizer.h"
+#include "parser.h"
+#include "query_log.h"
+#include "utils.h"
+#include <chrono>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <map>
+#include <thread>
+
+using namespace sqlopt;
+using Clock = std::chrono::steady_clock;
+
+namespace {
+
+struct ReplayOptions {
+    std::string log_path;
+    QueryLogFormat format = QueryLogFormat::AUTO;
+    double qps = 50.0;
+    size_t connections = 4;
+    double duration_s = 10.0;
+    bool run_original = true;
+    bool run_optimized = true;
+    bool allow_writes = false;
+};
+
+struct ReplayQuery {
+    std::string original;
+    std::string optimized;
+    std::string fingerprint;
+};
+
+struct FingerprintStats {
+    LatencyHistogram latency;
+    uint64_t errors = 0;
+    std::string last_error;
+
+    void merge(const FingerprintStats& other) {
+        latency.merge(other.latency);
+        errors += other.errors;
+        if (!other.last_error.empty()) last_error = other.last_error;
+    }
+};
+
+struct PhaseResult {
+    std::string name;
+    uint64_t sent = 0;
+    double elapsed_s = 0.0;
+    std::map<std::string, FingerprintStats> by_fingerprint;
+    FingerprintStats overall;
+};
+
+std::string env(const char* name, const std::string& fallback) {
+    const char* v = std::getenv(name);
+    return v ? std::string(v) : fallback;
+}
+
+bool isReadOnly(const std::string& sql) {
+    std::string head = to_lower(trim(sql).substr(0, 8));
+    return head.rfind("select", 0) == 0 || head.rfind("with", 0) == 0 || head.rfind("(select", 0) == 0;
+}
+
+// Optimizer rewrite of a statement, or the statement itself when it cannot be optimized
+std::string optimizeSql(const std::string& sql, const std::shared_ptr<StatisticsManager>& stats) {
+    Lexer lexer(sql);
+    Parser parser(lexer.tokenize());
+    Query q;
+    ParseError err;
+    if (!parser.parse_query(q, err) || !std::holds_alternative<SelectQuery>(q)) return sql;
+    try {
+        Optimizer opt(stats);
+        auto res = opt.optimize(std::move(std::get<SelectQuery>(q)));
+        return res.rewritten_sql.empty() ? sql : trim(res.rewritten_sql);
+    } catch (const std::exception&) {
+        return sql;
+    }
+}
+
+// Open-loop replay: arrivals follow the schedule regardless of how fast the server
+// answers, and latency is measured from the scheduled start, so queueing delay under
+// overload is part of the reported latency instead of being hidden by back-pressure.
+// All connections are driven from this thread, which also dispatches the arrivals, so
+// the statements in flight are bounded by the connections and the server alone.
+PhaseResult runPhase(const std::string& name, const std::vector<ReplayQuery>& queries, bool optimized,
+                     const ReplayOptions& opts, const std::string& host, const std::string& user,
+                     const std::string& password, const std::string& db) {
+    PhaseResult result;
+    result.name = name;
+
+    AsyncMySQL mysql(host, user, password, db);
+    mysql.open(opts.connections);
+
+    // Dispatcher: the k-th arrival is due at start + k / qps; completions run while it waits
+    auto start = Clock::now();
+    auto interval = std::chrono::duration<double>(1.0 / opts.qps);
+    auto stop = start + std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(opts.duration_s));
+    for (uint64_t k = 0;; ++k) {
+        auto due = start + std::chrono::duration_cast<Clock::duration>(interval * static_cast<double>(k));
+        if (due >= stop) break;
+        for (auto now = Clock::now(); now < due; now = Clock::now()) {
+            auto left = std::chrono::duration_cast<std::chrono::milliseconds>(due - now);
+            if (!mysql.runOnce(left)) std::this_thread::sleep_until(due);
+        }
+        const ReplayQuery& q = queries[k % queries.size()];
+        FingerprintStats* fs = &result.by_fingerprint[q.fingerprint];
+        mysql.submit(optimized ? q.optimized : q.original, [fs, due](const AsyncResult& res) {
+            auto micros = std::chrono::duration_cast<std::chrono::microseconds>(Clock::now() - due).count();
+            if (res.success) {
+                fs->latency.record(static_cast<uint64_t>(micros));
+            } else {
+                ++fs->errors;
+                fs->last_error = res.error_message;
+            }
+        });
+        ++result.sent;
+    }
+    mysql.run();
+    result.elapsed_s = std::chrono::duration<double>(Clock::now() - start).count();
+
+    if (mysql.failed() > 0) {
+        std::cerr << name << ": " << mysql.failed() << " of " << opts.connections
+                  << " connections failed: " << mysql.lastConnectError() << "\n";
+    }
+    for (const auto& kv : result.by_fingerprint) result.overall.merge(kv.second);
+    return result;
+}
+
+std::string millis(uint64_t micros) {
+    std::ostringstream oss;
+    oss << std::fixed << std::setprecision(2) << micros / 1000.0;
+    return oss.str();
+}
+
+void printPhase(const PhaseResult& r) {
+    uint64_t ok = r.overall.latency.count();
+    uint64_t total = ok + r.overall.errors;
+    std::cout << "\n=== " << r.name << " ===\n";
+    std::cout << "sent " << r.sent << ", completed " << ok << ", errors " << r.overall.errors
+              << " (" << std::fixed << std::setprecision(2) << (total ? 100.0 * r.overall.errors / total : 0.0)
+              << "%), throughput " << std::setprecision(1) << (r.elapsed_s > 0 ? ok / r.elapsed_s : 0.0) << " qps\n";
+    const auto& h = r.overall.latency;
+    std::cout << "latency ms: p50 " << millis(h.percentile(50)) << "  p90 " << millis(h.percentile(90))
+              << "  p99 " << millis(h.percentile(99)) << "  p99.9 " << millis(h.percentile(99.9))
+              << "  max " << millis(h.max()) << "\n";
+}
+
+void printFingerprints(const std::vector<PhaseResult>& phases, const std::vector<ReplayQuery>& queries) {
+    std::map<std::string, std::string> examples;
+    for (const auto& q : queries) examples.emplace(q.fingerprint, q.original);
+
+    std::cout << "\n=== Per fingerprint ===\n";
+    for (const auto& ex : examples) {
+        std::cout << "\n[" << fingerprint_id_hex(ex.first) << "] " << ex.first << "\n";
+        for (const auto& r : phases) {
+            auto it = r.by_fingerprint.find(ex.first);
+            if (it == r.by_fingerprint.end()) continue;
+            const auto& fs = it->second;
+            uint64_t total = fs.latency.count() + fs.errors;
+            std::cout << "  " << std::left << std::setw(10) << r.name << std::right
+                      << " n=" << total
+                      << " err=" << std::fixed << std::setprecision(2) << (total ? 100.0 * fs.errors / total : 0.0) << "%"
+                      << " p50=" << millis(fs.latency.percentile(50))
+                      << " p90=" << millis(fs.latency.percentile(90))
+                      << " p99=" << millis(fs.latency.percentile(99))
+                      << " max=" << millis(fs.latency.max()) << " ms\n";
+            if (!fs.last_error.empty()) std::cout << "             last error: " << fs.last_error << "\n";
+        }
+    }
+}
+
+void usage() {
+    std::cerr << "usage: sqlopt_replay --log FILE [--format auto|plain|jsonl|general] [--qps N]\n"
+              << "                     [--connections N] [--duration SECONDS]\n"
+              << "                     [--variant original|optimized|both] [--allow-writes]\n";
+}
+
+bool parseArgs(int argc, char* argv[], ReplayOptions& opts) {
+    for (int i = 1; i < argc; ++i) {
+        std::string a = argv[i];
+        auto next = [&]() -> std::string { return i + 1 < argc ? argv[++i] : ""; };
+        try {
+            if (a == "--log") opts.log_path = next();
+            else if (a == "--qps") opts.qps = std::stod(next());
+            else if (a == "--connections") opts.connections = std::stoul(next());
+            else if (a == "--duration") opts.duration_s = std::stod(next());
+            else if (a == "--allow-writes") opts.allow_writes = true;
+            else if (a == "--format") {
+                std::string f = next();
+                if (f == "plain") opts.format = QueryLogFormat::PLAIN;
+                else if (f == "jsonl") opts.format = QueryLogFormat::JSONL;
+                else if (f == "general") opts.format = QueryLogFormat::GENERAL_LOG;
+                else if (f != "auto") return false;
+            } else if (a == "--variant") {
+                std::string v = next();
+                opts.run_original = v == "original" || v == "both";
+                opts.run_optimized = v == "optimized" || v == "both";
+                if (!opts.run_original && !opts.run_optimized) return false;
+            } else {
+                return false;
+            }
+        } catch (const std::exception&) {
+            return false;
+        }
+    }
+    return !opts.log_path.empty() && opts.qps > 0 && opts.connections > 0 && opts.duration_s > 0;
+}
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+    ReplayOptions opts;
+    if (!parseArgs(argc, argv, opts)) {
+        usage();
+        return 2;
+    }
+
+    std::vector<std::string> statements;
+    std::string error;
+    if (!load_query_log(opts.log_path, statements, error, opts.format)) {
+        std::cerr << error << "\n";
+        return 1;
+    }
+
+    std::string host = env("MYSQL_HOST", "localhost");
+    std::string user = env("MYSQL_USER", "root");
+    std::string password = env("MYSQL_PWD", env("MYSQL_PASSWORD", ""));
+    std::string db = env("MYSQL_DB", "");
+
+    mysql_library_init(0, nullptr, nullptr);
+
+    // Statistics for the rewrites come from the target database, as in the CLI, crawled
+    // over as many connections as the replay uses
+    auto stats = std::make_shared<StatisticsManager>();
+    if (opts.run_optimized) {
+        AsyncMySQL mysql(host, user, password, db);
+        mysql.open(opts.connections);
+        stats->loadFromDatabase(mysql);
+        if (mysql.connected() == 0) {
+            std::cerr << "Failed to connect to MySQL: " << mysql.lastConnectError() << "\n";
+            return 1;
+        }
+    }
+
+    std::vector<ReplayQuery> queries;
+    size_t skipped = 0;
+    for (const auto& sql : statements) {
+        if (!opts.allow_writes && !isReadOnly(sql)) {
+            ++skipped;
+            continue;
+        }
+        ReplayQuery q;
+        q.original = sql;
+        q.fingerprint = fingerprint_query(sql);
+        q.optimized = opts.run_optimized ? optimizeSql(sql, stats) : sql;
+        queries.push_back(std::move(q));
+    }
+    if (queries.empty()) {
+        std::cerr << "No replayable statements in " << opts.log_path << "\n";
+        return 1;
+    }
+    std::cout << "Replaying " << queries.size() << " statements";
+    if (skipped) std::cout << " (" << skipped << " non-SELECT skipped, use --allow-writes to include)";
+    std::cout << " at " << opts.qps << " qps over " << opts.connections << " connections for "
+              << opts.duration_s << "s per variant\n";
+
+    std::vector<PhaseResult> phases;
+    if (opts.run_original) {
+        phases.push_back(runPhase("original", queries, false, opts, host, user, password, db));
+        printPhase(phases.back());
+    }
+    if (opts.run_optimized) {
+        phases.push_back(runPhase("optimized", queries, true, opts, host, user, password, db));
+        printPhase(phases.back());
+    }
+    printFingerprints(phases, queries);
+
+    mysql_library_end();
+    return 0;
+}
@@ -597,13 +597,81 @@ void classify_conditions(SelectQuery &q, vector<pair<pair<int,int>, Condition>>
     q.where_conditions = remaining;
 }
 
-// join-order DP (exact for up to n<=10 realistically)
+// join-order DP over connected subsets only. Each entry is a compact descriptor;
+// the plan tree is rebuilt for the winning subset alone.
 struct DPEntry {
-    bool ok = false;
-    shared_ptr<Plan> plan;
     double cost = 1e308;
+    double rows = 0;
+    uint64_t left = 0;   // subset joined on the left (0 for a base table)
+    uint64_t right = 0;  // subset joined on the right
 };
 
+// output rows of joining two inputs, same heuristic as make_join
+static double join_rows(double leftRows, double rightRows, bool hasJoinPred) {
+    return max(1.0, leftRows * rightRows * (hasJoinPred ? 0.01 : 1.0));
+}
+
+static vector<Condition> connecting_conditions(uint64_t left, uint64_t right, int n,
+                                               map<pair<int,int>, vector<Condition>> &joinMap) {
+    vector<Condition> conds;
+    for (int i=0;i<n;++i) if (left & (1ULL<<i)) {
+        for (int j=0;j<n;++j) if (right & (1ULL<<j)) {
+            auto it = joinMap.find({min(i,j), max(i,j)});
+            if (it != joinMap.end()) conds.insert(conds.end(), it->second.begin(), it->second.end());
+        }
+    }
+    return conds;
+}
+
+static uint64_t neighbourhood(uint64_t set, const vector<uint64_t> &adj) {
+    uint64_t out = 0;
+    for (uint64_t rest = set; rest; rest &= rest - 1) out |= adj[__builtin_ctzll(rest)];
+    return out & ~set;
+}
+
+// DPccp: every connected subset reachable from `set` by adding neighbours outside `excluded`
+template <class Emit>
+static void enumerate_csg_rec(uint64_t set, uint64_t excluded, const vector<uint64_t> &adj, Emit &emit) {
+    uint64_t nb = neighbourhood(set, adj) & ~excluded;
+    if (!nb) return;
+    // submasks in increasing order, so smaller subsets come first as DPccp requires
+    for (uint64_t sub = nb & -nb; sub; sub = (sub - nb) & nb) emit(set | sub);
+    for (uint64_t sub = nb & -nb; sub; sub = (sub - nb) & nb) enumerate_csg_rec(set | sub, excluded | nb, adj, emit);
+}
+
+// DPccp: calls emit(csg, cmp) once per unordered pair of disjoint, adjacent connected
+// subsets, so the work is bounded by the number of such pairs rather than by 2^n
+template <class Emit>
+static void enumerate_csg_cmp_pairs(int n, const vector<uint64_t> &adj, Emit &emit) {
+    auto below = [](int i) { return i == 63 ? ~0ULL : (2ULL << i) - 1; };  // {0..i}
+    auto emitCmp = [&](uint64_t csg) {
+        uint64_t excluded = csg | below(__builtin_ctzll(csg));
+        uint64_t nb = neighbourhood(csg, adj) & ~excluded;
+        for (uint64_t rest = nb; rest; ) {
+            int i = 63 - __builtin_clzll(rest);
+            rest &= ~(1ULL << i);
+            uint64_t start = 1ULL << i;
+            emit(csg, start);
+            auto emitFromCmp = [&](uint64_t cmp) { emit(csg, cmp); };
+            enumerate_csg_rec(start, excluded | (below(i) & nb), adj, emitFromCmp);
+        }
+    };
+    for (int i = n-1; i >= 0; --i) {
+        uint64_t start = 1ULL << i;
+        emitCmp(start);
+        enumerate_csg_rec(start, below(i), adj, emitCmp);
+    }
+}
+
+static shared_ptr<Plan> build_plan(uint64_t mask, const unordered_map<uint64_t, DPEntry> &dp,
+                                   const vector<shared_ptr<Plan>> &base, int n,
+                                   map<pair<int,int>, vector<Condition>> &joinMap) {
+    const DPEntry &e = dp.at(mask);
+    if (e.left == 0) return base[__builtin_ctzll(mask)];
+    return make_join(build_plan(e.left, dp, base, n, joinMap), build_plan(e.right, dp, base, n, joinMap),
+                     connecting_conditions(e.left, e.right, n, joinMap));
+}
+
 shared_ptr<Plan> cost_based_join_ordering(SelectQuery &q, vector<pair<pair<int,int>, Condition>> &joinPreds) {
     int n = (int)q.tables.size();
     if (n == 0) return nullptr;
@@ -616,48 +684,51 @@ shared_ptr<Plan> cost_based_join_ordering(SelectQuery &q, vector<pair<pair<int,i
     vector<shared_ptr<Plan>> base(n);
     for (int i=0;i<n;++i) base[i] = make_scan(q.tables[i]);
 
-    int FULL = 1<<n;
-    vector<DPEntry> dp(FULL);
-    // initialize singletons
-    for (int i=0;i<n;++i) {
-        int m = 1<<i;
-        dp[m].ok = true;
-        dp[m].plan = base[i];
-        dp[m].cost = base[i]->cost;
-    }
-
-    // iterate increasing sizes
-    for (int mask=1; mask < FULL; ++mask) {
-        if (__builtin_popcount((unsigned)mask) == 1) continue;
-        // try partition mask into two non-empty submasks
-        for (int left = (mask-1) & mask; left; left = (left-1) & mask) {
-            int right = mask ^ left;
-            if (!dp[left].ok || !dp[right].ok) continue;
-            // check if there is a join predicate between any table in left and any in right
-            vector<Condition> connectingConds;
-            bool hasJoinPred = false;
-            for (int i=0;i<n;++i) if (left & (1<<i)) {
-                for (int j=0;j<n;++j) if (right & (1<<j)) {
-                    pair<int,int> key = {min(i,j), max(i,j)};
-                    if (joinMap.count(key)) {
-                        hasJoinPred = true;
-                        for (auto &c : joinMap[key]) connectingConds.push_back(c);
-                    }
-                }
-            }
-            // allow cross join too (no connectingConds) but penalize
-            double penalty = hasJoinPred ? 1.0 : 1000.0;
-            auto cand = make_join(dp[left].plan, dp[right].plan, connectingConds);
-            cand->cost *= penalty;
-            double candCost = dp[left].cost + dp[right].cost + cand->rows * (hasJoinPred ? 1.0 : 10.0);
-            if (!dp[mask].ok || candCost < dp[mask].cost) {
-                dp[mask].ok = true;
-                dp[mask].plan = cand;
-                dp[mask].cost = candCost;
-            }
+    // subsets are 64-bit masks; beyond that only the greedy order below is possible
+    if (n <= 64) {
+        vector<uint64_t> adj(n, 0);
+        for (auto &kv : joinMap) {
+            adj[kv.first.first] |= 1ULL << kv.first.second;
+            adj[kv.first.second] |= 1ULL << kv.first.first;
         }
+        auto neighbours = [&](uint64_t set) { return neighbourhood(set, adj); };
+
+        unordered_map<uint64_t, DPEntry> dp;
+        for (int i=0;i<n;++i) dp[1ULL<<i] = DPEntry{base[i]->cost, base[i]->rows, 0, 0};
+
+        // Each csg-cmp pair is a split of its union into two connected, mutually connected
+        // halves. DPccp emits a pair only after every pair splitting either half, so both
+        // are final here and the pair is costed at once rather than kept.
+        auto costPair = [&](uint64_t csg, uint64_t cmp) {
+            // cost is symmetric; the larger mask goes left so ties resolve as before
+            uint64_t left = max(csg, cmp), right = min(csg, cmp);
+            DPEntry l = dp.at(left), r = dp.at(right);
+            double rows = join_rows(l.rows, r.rows, true);
+            double candCost = l.cost + r.cost + rows;
+            DPEntry &best = dp[left | right];
+            if (candCost < best.cost || (candCost == best.cost && left > best.left))
+                best = DPEntry{candCost, rows, left, right};
+        };
+        enumerate_csg_cmp_pairs(n, adj, costPair);
+
+        uint64_t full = n == 64 ? ~0ULL : (1ULL<<n) - 1;
+        log_transform("join_order_dp", "Costed " + to_string(dp.size()) + " connected subsets",
+                      to_string(n) + " tables", dp.count(full) ? "connected join graph" : "disconnected join graph");
+        if (dp.count(full)) return build_plan(full, dp, base, n, joinMap);
+
+        // disconnected query graph: cross join the best plan of each connected component
+        shared_ptr<Plan> acc;
+        uint64_t remaining = full;
+        while (remaining) {
+            uint64_t comp = remaining & -remaining;
+            for (uint64_t grow = neighbours(comp); grow; grow = neighbours(comp)) comp |= grow;
+            auto plan = build_plan(comp, dp, base, n, joinMap);
+            acc = acc ? make_join(acc, plan, {}) : plan;
+            remaining &= ~comp;
+        }
+        return acc;
     }
-    if (dp[FULL-1].ok) return dp[FULL-1].plan;
+
     // fallback: left-to-right greedy join
     shared_ptr<Plan> acc = base[0];
     for (int i=1;i<n;++i) {